@@ -0,0 +1,72 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_ACCESS_LOG_H
+#define HTTPSERVERC_ACCESS_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "http_req.h"
+
+/*
+    Binary access log, one record per response. The file starts with ACCESS_LOG_MAGIC,
+    every record is an AccessRecordHeader followed by length bytes of fields:
+
+    request: varints routeId, connectionIndex, requestIndex, durationUs, requestBytes,
+             responseBytes, then the client ip and the path, each as a varint length and the bytes
+    route:   varints routeId and the pattern length, then the pattern
+
+    Route ids are interned per file, a route record comes before the first request using it.
+    Id 0 is a request that matched no endpoint. Integers are little endian, varints LEB128.
+    Convert with the access_log_decode tool.
+*/
+
+#define ACCESS_LOG_MAGIC "HSCALOG1"
+/* Longer paths are cut */
+#define ACCESS_LOG_PATH_MAX 1024
+
+typedef enum AccessRecordType {
+    ACCESS_RECORD_REQUEST = 1,
+    ACCESS_RECORD_ROUTE = 2,
+} AccessRecordType;
+
+typedef struct AccessRecordHeader {
+    uint8_t type;
+    uint8_t method; /* HttpMethod, 255 when it was not parsed */
+    uint16_t status;
+    uint32_t length; /* of the fields that follow */
+    uint64_t timeNs; /* wall clock when the response was sent, 0 for route records */
+} AccessRecordHeader;
+
+/* A decoded record, the strings point into the decoded bytes and are not terminated */
+typedef struct AccessRecord {
+    AccessRecordHeader header;
+    uint64_t routeId;
+    uint64_t connectionIndex;
+    uint64_t requestIndex;
+    uint64_t durationUs;
+    uint64_t requestBytes;
+    uint64_t responseBytes;
+    string ip;
+    string path; /* the pattern for route records */
+} AccessRecord;
+
+/*
+    Appends records to path, opened with O_APPEND, NULL stops logging.
+    Records are queued on per thread rings and written in batches by a background thread.
+    Returns 0, or -1 when the file cannot be opened.
+*/
+int setAccessLogFile(const char *path);
+/*
+    Queues the record of a response, route is the matched endpoint pattern or NULL.
+    requestBytes is the content read so far, responseBytes what was sent.
+*/
+void logAccess(HttpReq *req, const char *route, int status, size_t requestBytes, size_t responseBytes);
+/* Blocks until every queued record is written */
+void flushAccessLog();
+/* Returns the size of the record at data, 0 when size cuts it short and -1 when it is malformed */
+long decodeAccessRecord(const unsigned char *data, size_t size, AccessRecord *record);
+
+#endif //HTTPSERVERC_ACCESS_LOG_H
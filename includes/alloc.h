@@ -32,6 +32,20 @@ void gcTrackWithStackArena(void *stackArenaChunk, size_t chunkSize);
 // cleans up tracked gc allocations
 void gcCleanup();
 
+typedef struct GcContext GcContext;
+
+// Moves the allocations tracked since the last gcCleanup into a context the thread's gcCleanup does not touch,
+// the thread goes on tracking with empty ones. Lets a paused request keep its memory while the thread serves others.
+// Not for threads tracking with a stack arena.
+GcContext *gcSuspend();
+
+// Exchanges the thread's tracking with the context's, call it once to continue the suspended
+// allocations and once more to get the thread's own back
+void gcSwapContext(GcContext *context);
+
+// Frees everything the context tracks and the context itself
+void gcFreeContext(GcContext *context);
+
 // de-initialises the GC engine
 // Call after Init
 void gcDestroy();
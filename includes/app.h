@@ -9,17 +9,72 @@
 
 #include "http_req.h"
 #include "http_resp.h"
+#include "http_router.h"
 
 typedef HttpResp (*HttpReqHandler) (HttpReq);
 
+typedef enum ServerMode {
+    SERVER_MODE_THREAD_PER_CONNECTION, /* default, one detached thread per accepted socket */
+    SERVER_MODE_REACTOR, /* fixed set of edge triggered epoll loops, see setWorkerThreads */
+    SERVER_MODE_WORKER_POOL, /* pre spawned workers fed by a bounded accept queue, overflow gets 503 */
+} ServerMode;
+
 /*
     asserts whether the app started or not succesfully
 */
 void initApp();
 void startApp(char* port);
+/*
+    Makes startApp close its listeners and connections and return, safe to call from a signal handler.
+    Only SERVER_MODE_REACTOR with setReusePort(1) returns, where SIGINT and SIGTERM call it too.
+    The other modes keep blocking in accept.
+*/
+void stopApp();
 void addEndpoint(char *path, HttpReqHandler handler);
+/* Only bodyMs and writeMs can differ per endpoint, the rest is known before routing */
+void addEndpointWithTimeouts(char *path, HttpReqHandler handler, RequestTimeouts timeouts);
+/*
+    Only serves the METHOD_BIT methods, other methods of the path get 405 with Allow.
+    HEAD uses the GET handler without sending the body, OPTIONS is answered by the router.
+*/
+void addEndpointForMethods(char *path, unsigned int methods, HttpReqHandler handler);
+/* maxBodySize overrides setMaxBodySize for this path, 0 keeps it and a negative one removes the limit */
+void addEndpointWithBodyLimit(char *path, HttpReqHandler handler, long maxBodySize);
+/*
+    The content is not buffered before the handler runs, the handler pulls it with reqReadBody.
+    Whatever it leaves unread is drained after the response. SERVER_MODE_REACTOR does not support it,
+    a handler cannot wait on a non blocking socket, so startApp exits if such an endpoint exists.
+*/
+void addStreamingEndpoint(char *path, HttpReqHandler handler, long maxBodySize);
 void setNotFoundCallback(HttpReqHandler handler);
 void setLogFile(const char *path);
+/* Call before startApp */
+void setServerMode(ServerMode mode);
+/* Threads serving connections outside of thread per connection mode, 0 means one per core */
+void setWorkerThreads(int count);
+/* Accepted connections waiting for a worker in SERVER_MODE_WORKER_POOL, default 1024 */
+void setAcceptQueueCapacity(unsigned int capacity);
+/* One SO_REUSEPORT listener per worker core instead of a single accepting thread */
+void setReusePort(int enabled);
+/* Pending connection backlog of every listener, default SOMAXCONN */
+void setListenBacklog(int backlog);
+/* Pins event loops and acceptors to a core each */
+void setCpuAffinity(int enabled);
+/* Idle keep alive connections wait in a shared epoll instead of holding a thread, default on */
+void setIdleParking(int enabled);
+/*
+    How long a connection waits for its next request before it is parked, default 10 ms.
+    Back to back requests then skip the parking thread, 0 parks as soon as the connection is idle.
+*/
+void setIdleParkingDelay(int delayMs);
+/* Largest content buffered or streamed for a request, over it answers 413. Default 8 MiB, negative means no limit */
+void setMaxBodySize(long bytes);
+/* Header, body, idle and write timeouts, fields <= 0 keep their current value */
+void setRequestTimeouts(RequestTimeouts timeouts);
+/* Times the stages of every request into the /metrics stage histograms, off by default */
+void setStageTiming(int enabled);
+/* Debugging aid, answers with a Server-Timing header of the stages before send. Turns stage timing on */
+void setServerTimingHeader(int enabled);
 pthread_t getMainThreadId();
 
 #endif //APP_H
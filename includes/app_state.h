@@ -7,15 +7,29 @@
 #include "connection.h"
 #include "../includes/alloc.h"
 
-typedef struct {
+typedef enum RequestPhase {
+    REQUEST_PHASE_IDLE = 0, /* waiting for the first byte of a request */
+    REQUEST_PHASE_HEAD,
+    REQUEST_PHASE_BODY,
+} RequestPhase;
+
+typedef struct SessionState {
     TcpSocket clientSocket;
+    RequestPhase phase;
     unsigned long connectionIndex;
     unsigned long requestIndex;
+    long long requestStartNs; /* monotonic, when the first byte of the current request arrived */
+    long long headParsedNs; /* stage timing stamps of the current request, see setStageTiming */
+    long long routedNs;
+    struct PausedResponse *pausedResponse; /* a producer waiting for a slow client in reactor mode */
 } SessionState;
 
 void initSessionStateFactory();
+/* Shared by every acceptor thread */
+unsigned long nextConnectionIndex();
 SessionState *newSessionState(TcpSocket socket, unsigned long connectionIndex);
+/* Closes the client socket and frees the state. Only for states not owned by a thread. */
+void destroySessionState(SessionState *state);
 void setSessionState(SessionState *state);
-SessionState *getSessionState();
 
 #endif //APP_STATE_H
@@ -5,7 +5,10 @@
 #ifndef CONNECTION_H
 #define CONNECTION_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #define NO_ERROR   0
 #define ESOCK      1
@@ -13,12 +16,58 @@
 
 typedef char port_t[6];
 
+typedef struct OutboundQueue OutboundQueue;
+
 typedef struct TcpSocket {
     int fd;
     int closed;
+    int nonBlocking;
+    long long deadline; /* monotonic ms, receive times out once it passes, 0 means none */
+    int writeTimeoutMs; /* longest stall while transmitting, 0 means the default */
+    int receiveTimeoutMs; /* kernel timeouts currently applied by the I/O backend */
+    int transmitTimeoutMs;
     char ip[16];
+    int captureSampled; /* 1 captured, -1 skipped by the wire capture sampling, 0 not decided yet */
+    size_t capturedBytes;
+    OutboundQueue *outbound; /* bytes a non-blocking socket did not take yet, see enableOutboundQueue */
 } TcpSocket;
 
+typedef enum IoBackendType {
+    IO_BACKEND_DIRECT = 0,
+    IO_BACKEND_POLL,
+    IO_BACKEND_URING, /* falls back to IO_BACKEND_POLL where io_uring is not available */
+} IoBackendType;
+
+typedef struct WireCaptureOptions {
+    const char *path; /* records are appended here, socketLog.txt when NULL */
+    unsigned int sampleEvery; /* captures one connection out of this many, 0 and 1 capture all */
+    size_t maxBytesPerConnection; /* payload captured per connection, 0 means no cap */
+} WireCaptureOptions;
+
+/*
+    The capture file starts with WIRE_CAPTURE_MAGIC, followed by a header per recv or send
+    and length bytes of its payload. Fields are in host byte order.
+*/
+#define WIRE_CAPTURE_MAGIC "HSCWIRE1"
+
+typedef struct WireRecordHeader {
+    uint64_t timeNs; /* CLOCK_REALTIME */
+    uint32_t length; /* payload bytes following the header */
+    uint32_t originalLength; /* bytes of the recv or send, more than length when cut */
+    int32_t fd;
+    uint8_t outgoing;
+    uint8_t reserved[3];
+    char ip[16];
+} WireRecordHeader;
+
+#define OUTBOUND_QUEUE_MAX_BYTES (16 << 20)
+
+typedef struct ListenOptions {
+    int backlog;
+    int reusePort;
+    int nonBlocking;
+} ListenOptions;
+
 typedef enum WriteEnum {
     WRITE_OK = 0,
     WRITE_TIMEOUT,
@@ -27,6 +76,12 @@ typedef enum WriteEnum {
     WRITE_SEND_ERROR,
     WRITE_OPEN_ERROR,
     WRITE_SENDFILE_ERROR,
+    /*
+        A full non-blocking socket. transmit waits or queues instead of returning it, except once an
+        outbound queue holds more than OUTBOUND_QUEUE_MAX_BYTES: the bytes are queued all the same
+        and the writer is asked to stop until the queue is flushed, see writeAccepted.
+    */
+    WRITE_WOULD_BLOCK,
 } WriteEnum;
 
 typedef struct WriteResult {
@@ -40,6 +95,7 @@ typedef enum ReadEnum {
     READ_CLOSED,
     READ_POLL_ERROR,
     READ_RECV_ERROR,
+    READ_WOULD_BLOCK,
 } ReadEnum;
 
 typedef struct ReadResult {
@@ -48,13 +104,47 @@ typedef struct ReadResult {
 } ReadResult;
 
 TcpSocket socketListen(const port_t port);
+TcpSocket socketListenWithOptions(const port_t port, ListenOptions options);
+ListenOptions defaultListenOptions();
 TcpSocket acceptConnection(TcpSocket socket);
+TcpSocket acceptConnectionWithFlags(TcpSocket socket, int flags);
 TcpSocket socketConnect(const char *host, const port_t port);
 void closeSocket(TcpSocket *sock);
+int setSocketNonBlocking(TcpSocket *sock);
+void setSocketDeadline(TcpSocket *sock, int timeoutMs);
 ReadEnum canRead(int fd, int timeoutMs);
 ReadResult receive(TcpSocket *sock, void *buffer, size_t size);
 WriteEnum canWrite(int fd, int timeoutMs);
 WriteResult transmit(TcpSocket *sock, const void *buffer, size_t size);
+WriteResult transmitFile(TcpSocket *sock, int fd, off_t offset, size_t count);
+WriteResult transmitVector(TcpSocket *sock, struct iovec *iov, int iovCount);
+WriteResult transmitOnce(TcpSocket *sock, const void *buffer, size_t size);
+/*
+    For non-blocking sockets served by an event loop. Once enabled, transmit, transmitVector
+    and transmitFile never wait for the peer: what the socket does not take is queued and
+    reported as sent, the owner calls flushOutbound when the socket becomes writable.
+    Queued files are kept open with their own descriptor. Past OUTBOUND_QUEUE_MAX_BYTES of
+    queued memory the writes return WRITE_WOULD_BLOCK, the owner should stop producing output
+    until the queue is flushed. closeSocket releases the queue.
+*/
+void enableOutboundQueue(TcpSocket *sock);
+/* 1 while queued bytes wait for flushOutbound */
+int outboundPending(const TcpSocket *sock);
+/* WRITE_OK once the queue is empty, WRITE_WOULD_BLOCK while the socket is full */
+WriteEnum flushOutbound(TcpSocket *sock);
+/* 1 when every byte was sent or queued, so the response can go on */
+int writeAccepted(WriteEnum result);
 int getClientIp(int fd, char *ip);
+void setIoBackend(IoBackendType type);
+void setTcpNoDelay(int enabled);
+void setSocketCork(TcpSocket *sock, int corked);
+/* Takes effect for connections seen afterwards, the path only before capture is first enabled */
+void setWireCaptureOptions(WireCaptureOptions options);
+/*
+    Off by default, I/O then never touches a file. Enabled, every thread queues its traffic
+    into its own ring and a background thread appends the rings to the capture file.
+    Records are dropped while a ring is full. Can be toggled at any time.
+*/
+void setWireCapture(int enabled);
 
 #endif //CONNECTION_H
@@ -13,6 +13,8 @@
 #define URI_TOO_LARGE_ERROR (-6)
 #define TCP_STREAM_CLOSED (-7)
 #define TCP_STREAM_TIMEOUT (-8)
+#define TCP_STREAM_WOULD_BLOCK (-9) /*NON BLOCKING SOCKET HAS NO MORE DATA YET*/
+#define EXPECTATION_FAILED_ERROR (-10) /*EXPECT OTHER THAN 100-CONTINUE*/
 
 const char* errToStr(int error);
 
@@ -0,0 +1,72 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_FILE_CACHE_H
+#define HTTPSERVERC_FILE_CACHE_H
+
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define FILE_ETAG_SIZE 64
+
+typedef enum ContentEncoding {
+    CONTENT_ENCODING_IDENTITY,
+    CONTENT_ENCODING_GZIP,
+    CONTENT_ENCODING_BROTLI,
+    CONTENT_ENCODING_COUNT,
+} ContentEncoding;
+
+/* data is NULL when the file is not resident or the encoding did not make it smaller */
+typedef struct EncodedContent {
+    char *data;
+    size_t length;
+    char etag[FILE_ETAG_SIZE];
+    size_t etagLength;
+} EncodedContent;
+
+/*
+    Open descriptor and metadata of a file served as response content.
+    Entries are shared between threads and immutable once published, a changed
+    file gets a new entry while senders of the old one keep its descriptor.
+*/
+typedef struct CachedFile {
+    char *path;
+    int fd;
+    off_t size;
+    dev_t device;
+    ino_t inode;
+    struct timespec modified;
+    char etag[FILE_ETAG_SIZE];
+    size_t etagLength;
+    char lastModified[32]; /* IMF-fixdate of modified */
+    const char *mimeType;
+    /* Files up to the resident limit are kept in memory, compressible ones with their encodings */
+    EncodedContent variants[CONTENT_ENCODING_COUNT];
+    atomic_int refs;
+    _Atomic long long checkedAtMs;
+    struct CachedFile *nextInBucket;
+    struct CachedFile *newer;
+    struct CachedFile *older;
+} CachedFile;
+
+/*
+    Returns a referenced entry, or NULL with errno set by stat or open.
+    Metadata is only looked at again once the revalidation interval passed.
+*/
+CachedFile *acquireCachedFile(const char *path);
+/* The descriptor is closed once the cache and every sender let go of it */
+void releaseCachedFile(CachedFile *file);
+/* Most files kept open, least recently used ones are dropped first. 0 disables caching, default 128 */
+void setFileCacheCapacity(int entries);
+/* Milliseconds an entry is trusted before its path is stat'ed again, default 1000 */
+void setFileCacheRevalidateMs(int ms);
+/* Largest file kept in memory and precompressed on load, 0 serves every file with sendfile, default 64 KiB */
+void setFileCacheResidentLimit(size_t bytes);
+/* "gzip" or "br" */
+const char *contentEncodingToStr(ContentEncoding encoding);
+/* Drops every entry, files still being sent stay open until released */
+void clearFileCache();
+
+#endif //HTTPSERVERC_FILE_CACHE_H
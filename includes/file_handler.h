@@ -8,5 +8,7 @@
 extern const char *defaultMimeType;
 char *getExtension(const char *filename);
 const char *getMimeType(const char *extension);
+int isCompressibleMimeType(const char *mimeType);
+int isTextMimeType(const char *mimeType);
 
 #endif //FILE_HANDLER_H
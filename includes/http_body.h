@@ -0,0 +1,58 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_HTTP_BODY_H
+#define HTTPSERVERC_HTTP_BODY_H
+
+#include "http_req.h"
+#include "tcp_stream.h"
+
+/* Longest chunk size line, extensions included */
+#define CHUNK_LINE_MAX 1024
+/* Trailer fields after the last chunk, they are read and ignored */
+#define CHUNK_TRAILERS_MAX 64
+
+typedef enum BodyFraming {
+    BODY_FRAMING_NONE,
+    BODY_FRAMING_LENGTH,
+    BODY_FRAMING_CHUNKED,
+    BODY_FRAMING_BUFFERED, /* already in the stream buffer, reads copy from content */
+} BodyFraming;
+
+/*
+    Content of one request, either buffered whole by bufferRequestBody or pulled
+    by the handler through reqReadBody. Pulled bytes are received straight into the
+    handler's buffer, only chunk size lines go through the stream, and their room
+    is reused once read, so an upload of any size needs a bounded amount of memory.
+*/
+struct HttpBody {
+    TcpStream *stream;
+    BodyFraming framing;
+    long remaining; /* of the content, the current chunk or the buffered content */
+    long received; /* decoded bytes so far */
+    long maxSize; /* <= 0 means no limit */
+    size_t base; /* stream offset of the first content byte */
+    const char *content; /* BODY_FRAMING_BUFFERED only */
+    int chunkEnded; /* the CRLF closing the last chunk's data is still unread */
+    int expectContinue; /* 100 Continue is owed before the first read */
+    int finished; /* every content byte left the socket */
+    int error; /* of the first failed read */
+};
+
+/*
+    Picks the framing from Content-Length or Transfer-Encoding: chunked, the stream cursor must be at the content.
+    Returns ENTITY_TOO_LARGE_ERROR for a declared length over maxSize, EXPECTATION_FAILED_ERROR for an
+    Expect other than 100-continue and BAD_REQUEST_ERROR for unknown or conflicting framing.
+*/
+int prepareRequestBody(HttpBody *body, HttpReq *req, TcpStream *stream, long maxSize);
+/* Reads the whole content into the stream, chunked content is decoded in place once all of it arrived */
+int bufferRequestBody(HttpBody *body, HttpReq *req);
+/* Sends the interim 100 Continue response */
+int sendContinue(HttpBody *body);
+/* Returns up to size decoded bytes, 0 at the end of the content or a negative error */
+ssize_t readRequestBody(HttpBody *body, void *buffer, size_t size);
+/* Reads and drops what the handler left of the content, so the next request on the connection can be parsed */
+int discardRequestBody(HttpBody *body);
+
+#endif //HTTPSERVERC_HTTP_BODY_H
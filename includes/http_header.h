@@ -14,12 +14,45 @@ typedef struct HttpHeader {
     string value;
 } HttpHeader;
 
+/* Headers the parser indexes while parsing, found without scanning arr */
+typedef enum KnownHeader {
+    HEADER_HOST,
+    HEADER_CONTENT_LENGTH,
+    HEADER_CONTENT_TYPE,
+    HEADER_CONTENT_ENCODING,
+    HEADER_CONNECTION,
+    HEADER_TRANSFER_ENCODING,
+    HEADER_ACCEPT,
+    HEADER_ACCEPT_ENCODING,
+    HEADER_IF_NONE_MATCH,
+    HEADER_IF_MODIFIED_SINCE,
+    HEADER_IF_RANGE,
+    HEADER_RANGE,
+    HEADER_EXPECT,
+    HEADER_USER_AGENT,
+    HEADER_COOKIE,
+    HEADER_AUTHORIZATION,
+    KNOWN_HEADER_COUNT,
+    HEADER_UNKNOWN = -1,
+} KnownHeader;
+
+/*
+    Every header is in arr, known holds the index + 1 of the first
+    occurrence of each known header, 0 when it is absent.
+*/
 typedef struct HttpHeaders {
     HttpHeader *arr;
     int count;
+    unsigned short known[KNOWN_HEADER_COUNT];
 } HttpHeaders;
 
 int parseHeadersStream(HttpHeaders *headers, TcpStream *stream);
+/* Case insensitive, HEADER_UNKNOWN for any other name */
+KnownHeader classifyHeader(const char *name, size_t length);
+/* Records arr[index] in the known slots, call after appending a header outside the parser */
+void indexHeader(HttpHeaders *headers, int index);
+/* Returns NULL if the header was not received */
+HttpHeader *getHeader(HttpHeaders *headers, KnownHeader header);
 HttpHeader *findHeader(HttpHeaders *headers, const char *key);
 HttpHeaders emptyHeaders();
 
@@ -6,15 +6,40 @@
 #define HTTPSERVERC_HTTP_PATH_H
 
 #include <sys/types.h>
+#include "utils.h"
 
+/* raw and elements point into the parsed string, nothing is copied */
 typedef struct HttpPath {
-    char *raw;
-    char **elements;
+    string raw;
+    string *elements;
     int elCount;
 } HttpPath;
 
+typedef enum PathParamType {
+    PATH_PARAM_INT, /* <int>, optional sign and digits */
+    PATH_PARAM_UUID, /* <uuid>, 8-4-4-4-12 hex digits */
+    PATH_PARAM_STR, /* <str>, any single segment */
+    PATH_PARAM_PATH, /* <path...>, every remaining segment, only last */
+} PathParamType;
+
+/* Value captured by a wildcard of the matched endpoint, <type:name> gives it a name */
+typedef struct HttpPathParam {
+    string name;
+    PathParamType type;
+    string value;
+    long intValue;
+} HttpPathParam;
+
+/* In the order of the wildcards in the endpoint path */
+typedef struct HttpPathParams {
+    HttpPathParam *items;
+    int count;
+} HttpPathParams;
+
 int parsePathTrackQueryParameterStart(HttpPath *path, const char *str, size_t n, ssize_t *queryParameterStart);
 int parsePath(HttpPath *path, const char *str, size_t n);
 int pathMatches(HttpPath *endpointPath, HttpPath *reqPath);
+/* Returns NULL if no wildcard has that name */
+HttpPathParam *findPathParam(HttpPathParams *params, const char *name);
 
 #endif //HTTPSERVERC_HTTP_PATH_H
\ No newline at end of file
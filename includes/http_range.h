@@ -0,0 +1,34 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_HTTP_RANGE_H
+#define HTTPSERVERC_HTTP_RANGE_H
+
+#include "http_req.h"
+#include "http_resp.h"
+
+/* More ranges than this in one request are ignored and the whole file is sent */
+#define MAX_BYTE_RANGES 16
+
+/* Inclusive byte positions */
+typedef struct ByteRange {
+    off_t start;
+    off_t end;
+} ByteRange;
+
+/*
+    Parses a "bytes=" Range value against a representation of size bytes.
+    Returns the amount of satisfiable ranges written to ranges, 0 when none is
+    satisfiable, -1 when the value is malformed or has more than maxRanges.
+*/
+int parseByteRanges(const string *value, off_t size, ByteRange *ranges, int maxRanges);
+
+/*
+    Applies If-None-Match, If-Modified-Since, Range and If-Range to a 200 file response,
+    after respNegotiateEncoding picked the representation. Produces 304, 206 with a single
+    range or multipart/byteranges, or 416. Other responses are left as they are.
+*/
+void respApplyConditionals(HttpResp *resp, HttpMethod method, HttpHeaders *requestHeaders);
+
+#endif //HTTPSERVERC_HTTP_RANGE_H
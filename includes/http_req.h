@@ -24,14 +24,26 @@ typedef enum HttpMethod {
     METHOD_UNKNOWN = -1,
 } HttpMethod;
 
+#define METHOD_COUNT (CONNECT + 1)
+#define METHOD_BIT(method) (1u << (method))
+#define ANY_METHOD (METHOD_BIT(METHOD_COUNT) - 1)
+
+typedef struct HttpBody HttpBody;
+
+/*
+    Every string of the request is a slice of the connection buffer, not null terminated,
+    valid until the handler returns. copyString makes an owned copy.
+*/
 typedef struct HttpReq {
     HttpMethod method;
     HttpPath path;
+    HttpPathParams params; /* filled by routing */
     HttpQuery query;
-    char *version;
+    string version;
     HttpHeaders headers;
-    void *content;
-    long contentLength;
+    void *content; /* NULL on streaming endpoints, see reqReadBody */
+    long contentLength; /* -1 for chunked content not buffered */
+    HttpBody *body;
     SessionState *appState;
     void *raw;
     size_t rawLength;
@@ -39,6 +51,14 @@ typedef struct HttpReq {
 
 HttpReq newRequest();
 int parseRequestStream(HttpReq *req, TcpStream *stream);
+int parseRequestHead(HttpReq *req, TcpStream *stream);
+int parseRequestContent(HttpReq *req, TcpStream *stream);
+/*
+    Copies up to size bytes of the content, chunked content comes decoded.
+    Returns 0 at the end and a negative error when the client fails or exceeds the size limit.
+    On streaming endpoints the first call sends 100 Continue to clients waiting for it.
+*/
+ssize_t reqReadBody(HttpReq *req, void *buffer, size_t size);
 const char *methodToStr(HttpMethod method);
 HttpMethod strnToMethod(const char *str, int n);
 int reqEq(HttpReq obj1, HttpReq obj2);
@@ -76,6 +76,31 @@ typedef enum HttpStatus {
     STATUS_UNKNOWN = -1,
 } HttpStatus;
 
+struct CachedFile;
+
+/* One part of a multipart/byteranges body */
+typedef struct HttpRangePart {
+    off_t start;
+    size_t length;
+    string head; /* delimiter line, Content-Type and Content-Range of the part */
+} HttpRangePart;
+
+typedef struct HttpRangeParts {
+    HttpRangePart *items;
+    int count;
+    string tail; /* closing delimiter */
+} HttpRangeParts;
+
+typedef struct HttpRespWriter HttpRespWriter;
+/*
+    Writes the content with respWrite while the response is sent, a negative return aborts it and closes the connection.
+    Returning RESP_PRODUCER_MORE gets the producer called again to continue the content. In SERVER_MODE_REACTOR that
+    call waits until a slow client caught up, which respWrite reports by returning RESP_PRODUCER_MORE.
+    A producer that never returns it has all of its content queued for a slow client.
+*/
+typedef int (*HttpRespProducer)(HttpRespWriter *writer, void *state);
+#define RESP_PRODUCER_MORE 1
+
 typedef struct HttpResp {
     const char *version;
     HttpStatus status;
@@ -83,6 +108,11 @@ typedef struct HttpResp {
     const void *content;
     size_t contentLength;
     int isContentFile;
+    struct CachedFile *file; /* referenced while the response lives, see respRelease */
+    off_t contentOffset; /* first byte of a file sent, in memory content is sliced instead */
+    HttpRangeParts *parts; /* set for multipart/byteranges, parts index into the content */
+    HttpRespProducer producer; /* content generated while sending, instead of content */
+    void *producerState;
 } HttpResp;
 
 typedef enum HttpMimeType
@@ -96,10 +126,16 @@ typedef struct HttpRespBuilder {
     HttpResp resp;
     int headersCapacity;
     unsigned int flags;
+    int contentSkipped;
 } HttpRespBuilder;
 
 const char *statusToStr(HttpStatus status);
 HttpStatus strnToStatus(const char *str, int n);
+/* Bytes writeRespHead needs, status line through the blank line */
+size_t respHeadSize(const HttpResp *resp);
+/* Serializes the head into out without formatting calls, returns the bytes written */
+size_t writeRespHead(const HttpResp *resp, char *out);
+/* writeRespHead into an arena buffer, for heads built once and kept */
 size_t buildRespStringUntilContent(HttpResp *resp, char **str);
 
 HttpResp newResp(HttpStatus status);
@@ -109,8 +145,30 @@ void respBuilderSetStatus(HttpRespBuilder *builder, HttpStatus status);
 void respBuilderSetVersion(HttpRespBuilder *builder, const char *version, int shouldCopy);
 void respBuilderAddHeader(HttpRespBuilder *builder, char *key, char *value);
 void respBuilderSetContent(HttpRespBuilder *builder, const void *content, size_t contentLength, int shouldCopy);
-/* set shouldCopy to true if the path should be copied to allocated memory */
+/*
+    The file comes from the shared file cache, shouldCopy is kept for compatibility, the cache owns a copy of the path.
+    The response holds a reference to the open file until respRelease.
+*/
 void respBuilderSetFileContent(HttpRespBuilder *builder, const char *path, int shouldCopy);
+/*
+    The content is produced while the response is sent, no Content-Length is computed.
+    HTTP/1.1 clients get it chunked, HTTP/1.0 ones until the connection closes.
+    state has to live until the response is sent, the request arena does, also across a paused producer.
+*/
+void respBuilderSetProducer(HttpRespBuilder *builder, HttpRespProducer producer, void *state);
+/*
+    For a GET handler answering HEAD (req.method == HEAD) without generating the content.
+    The length is unknown, so Content-Length is left out as RFC 9110 allows for HEAD.
+*/
+void respBuilderSkipContent(HttpRespBuilder *builder);
+/*
+    Buffers the bytes, full chunks are sent as they fill. Returns 0, RESP_PRODUCER_MORE once the client fell
+    behind and the producer should return it, or a negative value once the client is gone.
+    The bytes are taken in every case but the last.
+*/
+int respWrite(HttpRespWriter *writer, const void *data, size_t size);
+/* Sends what is buffered right away, for producers that pause between writes */
+int respFlush(HttpRespWriter *writer);
 #define SET_FLAGS 0
 #define UNSET_FLAGS 1
 #define REPLACE_FLAGS 2
@@ -118,6 +176,17 @@ void respBuilderSetFileContent(HttpRespBuilder *builder, const char *path, int s
 #define USE_NO_CONTENT_RESPONSE_FLAG 1 << 1
 void respBuilderSetFlags(HttpRespBuilder *builder, unsigned int flags, int behaviour);
 void respBuilderSetDefaultFlags(unsigned int flags);
+/* Every serialized head gets a Date header from the cached clock unless it has one, default on */
+void respSetDateHeaderEnabled(int enabled);
 HttpResp respBuild(HttpRespBuilder *builder);
+/*
+    Resident files are switched to their in memory bytes, in the best encoding
+    the request's Accept-Encoding allows. Length, ETag and Content-Encoding follow.
+*/
+void respNegotiateEncoding(HttpResp *resp, HttpHeaders *requestHeaders);
+/* Replaces the value of the first header named key, or appends the header. Neither string is copied */
+void respSetHeader(HttpResp *resp, string key, string value);
+/* Lets go of the cached file of a sent or discarded response */
+void respRelease(HttpResp *resp);
 
 #endif //HTTP_RESP_H
@@ -10,20 +10,52 @@
 
 typedef HttpResp (*HttpReqHandler)(HttpReq);
 
+/* Milliseconds, 0 inherits the app wide value */
+typedef struct RequestTimeouts {
+    int headerMs; /* request line and headers, from their first byte */
+    int bodyMs; /* the whole content */
+    int idleMs; /* keep alive wait for the next request */
+    int writeMs; /* longest stall while sending the response */
+} RequestTimeouts;
+
 typedef struct HttpEndpoint {
     HttpPath path;
     HttpReqHandler handler;
     const char* raw;
+    RequestTimeouts timeouts;
+    unsigned int methods; /* METHOD_BIT mask, ANY_METHOD by default */
+    long maxBodySize; /* 0 inherits the app wide limit, negative means none */
+    int streamBody; /* the handler pulls the content with reqReadBody instead of getting it buffered */
+    int metricsRoute; /* see addMetricsRoute */
 } HttpEndpoint;
 
+typedef struct RouteNode RouteNode;
+
+/*
+    Endpoints are compiled into a tree of path segments as they are added,
+    a lookup walks one node per request path element whatever the amount of endpoints.
+*/
 typedef struct HttpRouter {
     HttpEndpoint *endpoints;
     HttpReqHandler notFoundCallback;
     int length;
     int capacity;
+    RouteNode *root;
 } HttpRouter;
 
 HttpResp routeReq(HttpRouter *router, HttpReq *req);
+/*
+    Returns NULL if no endpoint matches, otherwise req->params holds the captures.
+    Static segments win over <int>, <uuid>, <str> and <path...>, in that order.
+    HEAD falls back to the GET endpoint. allowedMethods gets the methods the path
+    accepts when only the method did not match, 0 when the path is unknown.
+*/
+HttpEndpoint *findEndpoint(HttpRouter *router, HttpReq *req, unsigned int *allowedMethods);
+/*
+    Calls the endpoint handler. Without one, answers OPTIONS with 204 and other methods
+    with 405, both listing allowedMethods in Allow, or calls the not found callback.
+*/
+HttpResp dispatchReq(HttpRouter *router, HttpEndpoint *endpoint, HttpReq *req, unsigned int allowedMethods);
 HttpEndpoint newEndpoint(const char *str, HttpReqHandler handler);
 HttpRouter newRouter(HttpEndpoint *endpoints, int length);
 HttpRouter emptyRouter();
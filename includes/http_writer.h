@@ -0,0 +1,39 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_HTTP_WRITER_H
+#define HTTPSERVERC_HTTP_WRITER_H
+
+#include "connection.h"
+#include "http_resp.h"
+
+/* Content a producer writes is sent in chunks of up to this size */
+#define RESP_WRITER_CHUNK_SIZE (16 * 1024)
+
+/*
+    Sends a producer's content while it is written. The head leaves with the first chunk,
+    small writes are gathered in buffer, bigger ones are sent from the producer's memory.
+    transmit only returns once the socket took the bytes, a slow client holds the producer back.
+    On a socket with an outbound queue it returns right away, backedOff is set once the queue
+    is over its limit and the producer is asked to return RESP_PRODUCER_MORE.
+*/
+struct HttpRespWriter {
+    TcpSocket *socket;
+    const char *head; /* NULL once sent */
+    size_t headSize;
+    char *buffer;
+    size_t length;
+    size_t capacity;
+    int chunked; /* 0 for HTTP/1.0 clients, the content then ends with the connection */
+    size_t sent;
+    WriteEnum result;
+    int backedOff;
+};
+
+void initRespWriter(HttpRespWriter *writer, TcpSocket *socket, const char *head, size_t headSize,
+                    char *buffer, size_t capacity, int chunked);
+/* Sends the buffered content and the last chunk */
+WriteResult finishRespWriter(HttpRespWriter *writer);
+
+#endif //HTTPSERVERC_HTTP_WRITER_H
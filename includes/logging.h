@@ -8,7 +8,6 @@
 #define LOG_REQUESTS 1
 #define LOG_BY_LEVEL 1
 #define LOG_TXT_FILE 0
-#define LOG_JSON_FILE 0
 #define LOG_TRACES 0
 
 #if LOG_TRACES
@@ -17,13 +16,15 @@
 #define TRACE(_,...)
 #endif
 
+#include <stdatomic.h>
+#include <stdio.h>
+
 #include "connection.h"
 #include "http_req.h"
 #include "http_resp.h"
 
 #define PRINT_LOG 1 << 0
 #define FILE_LOG 1 << 1
-#define JSON_LOG 1 << 2
 
 typedef enum {
     DEBUG = 0,
@@ -34,14 +35,45 @@ typedef enum {
     TRACE_LOGLEVEL,
 } LogLevel;
 
+/* Levels below it are compiled out, build with -DLOG_MIN_LEVEL=INFO to drop every debug call */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL DEBUG
+#endif
+
+/* Read by every log call, see setLogLevel */
+extern atomic_int logLevelThreshold;
+
+/*
+    A disabled level costs one relaxed load and a branch, the arguments are not evaluated.
+    Enabled ones are copied into a per thread ring and formatted by the log writer thread.
+*/
+#if LOG_BY_LEVEL
+#define LOG_AT(level, ...) do { \
+    if ((level) >= LOG_MIN_LEVEL && (int) (level) >= atomic_load_explicit(&logLevelThreshold, memory_order_relaxed)) { \
+        logMessage(level, __VA_ARGS__); \
+    } \
+} while (0)
+#else
+#define LOG_AT(level, ...) do { } while (0)
+#endif
+
+#define debug(...) LOG_AT(DEBUG, __VA_ARGS__)
+#define info(...) LOG_AT(INFO, __VA_ARGS__)
+#define warning(...) LOG_AT(WARNING, __VA_ARGS__)
+#define error(...) LOG_AT(ERROR, __VA_ARGS__)
+/* Written out before it returns */
+#define fatal(...) LOG_AT(FATAL, __VA_ARGS__)
+
+/* Only the format pointer is recorded, it has to outlive the writer, as literals do */
+void logMessage(LogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
 void trace(const char *file, int line, const char *format, ...);
-void debug(const char *format, ...);
-void info(const char *format, ...);
-void warning(const char *format, ...);
-void error(const char *format, ...);
-void fatal(const char *format, ...);
+/* Records below level are skipped at runtime, default DEBUG */
+void setLogLevel(LogLevel level);
+/* Where leveled records and the response lines go, default stdout */
+void setLogStream(FILE *stream);
+/* Blocks until every record pushed so far is written */
+void flushLogs();
 void setLogFile(const char *path);
-void setJsonLogFile(const char *path);
 void setSocketLogFile(const char *path);
 void setLogFlags(int flags);
 void logResponse(HttpResp *resp, HttpReq *req);
@@ -0,0 +1,58 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_METRICS_H
+#define HTTPSERVERC_METRICS_H
+
+#include <stddef.h>
+
+#include "http_req.h"
+#include "http_resp.h"
+
+/*
+    Counters and latency histograms sharded per thread. A thread only writes its own shard,
+    with relaxed loads and stores and no locked instructions, a scrape sums every shard.
+    Shards of exited threads are folded into one kept for the life of the process.
+*/
+
+typedef enum MetricCounter {
+    METRIC_BYTES_RECEIVED,
+    METRIC_BYTES_SENT,
+    METRIC_SENDFILE_BYTES, /* also counted in METRIC_BYTES_SENT */
+    METRIC_CONNECTIONS_OPENED,
+    METRIC_CONNECTIONS_CLOSED,
+    METRIC_KEEP_ALIVE_REQUESTS, /* requests after the first of a connection */
+    METRIC_CONNECTIONS_PARKED, /* idle keep alive connections handed to the parking thread */
+    METRIC_ARENA_CHUNKS,
+    METRIC_GC_ENTRIES_FREED,
+    METRIC_COUNTER_COUNT,
+} MetricCounter;
+
+/* Stages of a request, timed when setStageTiming is on */
+typedef enum RequestStage {
+    REQUEST_STAGE_PARSE, /* first byte to the parsed head, slow clients show here */
+    REQUEST_STAGE_ROUTE,
+    REQUEST_STAGE_BODY, /* buffering the content, streamed content is read in the handler */
+    REQUEST_STAGE_HANDLER,
+    REQUEST_STAGE_SEND, /* serializing and sending, with producers and sendfile */
+    REQUEST_STAGE_COUNT,
+} RequestStage;
+
+/* Endpoint patterns past it are counted with the unmatched requests */
+#define METRICS_ROUTES_MAX 256
+
+void metricsAdd(MetricCounter counter, size_t value);
+/* An errors.h code that ended a request before its handler */
+void metricsCountError(int code);
+/* Index of an endpoint pattern, a pattern added twice keeps its index. 0 is for unmatched requests */
+int addMetricsRoute(const char *pattern);
+void metricsObserveRequest(int route, int status, long long durationNs);
+void metricsObserveStages(int route, const long long stageNs[REQUEST_STAGE_COUNT]);
+const char *stageToStr(RequestStage stage);
+/* Prometheus text format of every metric, allocated in the arena */
+size_t formatMetrics(char **out);
+/* Serves formatMetrics, register it with addEndpoint("/metrics", metricsH) */
+HttpResp metricsH(HttpReq req);
+
+#endif //HTTPSERVERC_METRICS_H
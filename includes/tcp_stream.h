@@ -9,14 +9,29 @@
 #include "connection.h"
 
 #define TCP_STREAM_BUFFER_SIZE 1024
+/* Buffers grown past this by a large request are dropped once it is drained */
+#define TCP_STREAM_MAX_RETAINED_CAPACITY (16 * 1024)
+/* Idle TCP_STREAM_BUFFER_SIZE buffers kept for reuse by any connection */
+#define TCP_STREAM_BUFFER_POOL_SIZE 1024
 
+typedef struct RetiredBuffer RetiredBuffer;
+
+/*
+    cursor and length index the buffer, start is where the current request begins.
+    Draining only moves start, unread bytes are moved to the front
+    when the buffer has no room left behind them.
+    Slices returned by the read functions stay valid until the next drain or rewind,
+    a buffer outgrown in the meantime is retired instead of freed.
+*/
 typedef struct TcpStream {
     TcpSocket *socket;
     int error;
+    size_t start;
     size_t cursor;
     size_t length;
     size_t capacity;
     char *buffer;
+    RetiredBuffer *retired;
 } TcpStream;
 
 /* Creates a blocking TcpStream. */
@@ -29,8 +44,18 @@ void tcpStreamWait(TcpStream *stream);
 void tcpStreamFill(TcpStream *stream, size_t length);
 /* Advances the cursor by size. Returns ptr. */
 void *tcpStreamReadSlice(TcpStream *stream, size_t size);
-/* Drains internal buffer until cursor. Performs memmove. */
+/* Copies up to size unread bytes, receives straight into buffer when none are left. Returns the amount or a negative error. */
+ssize_t tcpStreamReadInto(TcpStream *stream, void *buffer, size_t size);
+/* Once every received byte was read, drops the ones after position so their room is received into again. */
+void tcpStreamTruncate(TcpStream *stream, size_t position);
+/* Drains internal buffer until cursor. Compacts only when the buffer is out of room. */
 void tcpStreamDrain(TcpStream *stream);
+/* Returns the buffer to the pool if every received byte was read, the next fill takes a new one. */
+void tcpStreamRelease(TcpStream *stream);
+/* Moves the cursor back to the start of the current request, keeping the received bytes. */
+void tcpStreamRewind(TcpStream *stream);
+/* Received bytes not drained yet. */
+size_t tcpStreamPending(const TcpStream *stream);
 /* Reads until space character. */
 string tcpStreamReadUntilSpace(TcpStream *stream, size_t maxLength);
 /* Read until carriage return and new line. */
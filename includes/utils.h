@@ -25,13 +25,20 @@ int strnindexAny(const char *str, int n, const char *find);
 int isAlpha(char c);
 unsigned int hash(void *data, int len);
 size_t getCurrentFormattedTime(char *buf, size_t size);
+long long getMonotonicTimeMs();
+long long getMonotonicTimeNs();
 string copyString(string str);
 string copyStringFromSlice(const char *ptr, ssize_t len);
 ssize_t stringCompare(string *str1, string *str2);
 ssize_t stringCompareIgnoreCase(string *str1, string *str2);
+int stringEquals(const string *str, const char *cstring);
+/* Decimal digits of value without a terminator, out needs UNSIGNED_DIGITS_MAX bytes. Returns the digit count */
+size_t formatUnsigned(unsigned long long value, char *out);
 KeyValue *findKeyValue(KeyValue* keyValues, size_t count, const char *key);
 
 #define DECLARE_CURRENT_TIME(time) char time[128]; getCurrentFormattedTime(time, sizeof(time))
 #define EMPTY_STRING (string) {.ptr = NULL, .length = 0}
+#define STRING_LITERAL(literal) (string) {.ptr = (char*) (literal), .length = sizeof(literal) - 1}
+#define UNSIGNED_DIGITS_MAX 20
 
 #endif
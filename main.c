@@ -3,8 +3,10 @@
 #include <unistd.h>
 
 #include "includes/app.h"
+#include "includes/access_log.h"
 #include "includes/alloc.h"
 #include "includes/logging.h"
+#include "includes/metrics.h"
 #include "includes/http_query.h"
 
 HttpResp helloH(HttpReq);
@@ -13,7 +15,8 @@ HttpResp stylesheetH(HttpReq);
 HttpResp notFoundH(HttpReq);
 HttpResp assetH(HttpReq);
 HttpResp jsonFormatterH(HttpReq);
-HttpResp crudH(HttpReq);
+HttpResp crudGetH(HttpReq);
+HttpResp crudPostH(HttpReq);
 
 int main(int argc, char **argv)
 {
@@ -25,9 +28,11 @@ int main(int argc, char **argv)
     addEndpoint("/stylesheet", stylesheetH);
     addEndpoint("/assets/<str>", assetH);
     addEndpoint("/jsonFormatter", jsonFormatterH);
-    addEndpoint("/crud", crudH);
+    addEndpointForMethods("/crud", METHOD_BIT(GET), crudGetH);
+    addEndpointForMethods("/crud", METHOD_BIT(POST), crudPostH);
+    addEndpoint("/metrics", metricsH);
     setLogFile("logs.txt");
-    setJsonLogFile("logs.json");
+    setAccessLogFile("access.log");
     setNotFoundCallback(notFoundH);
     respBuilderSetDefaultFlags(0);
 
@@ -54,7 +59,7 @@ HttpResp indexH(HttpReq req)
     HttpQueryParameter *idParam = findQueryParameter(&req.query, "id");
 
     TRACE("%s", "checking conditions");
-    if (helloParam != NULL || (idParam != NULL && strcmp(idParam->value.ptr, "1") == 0)) {
+    if (helloParam != NULL || (idParam != NULL && stringEquals(&idParam->value, "1"))) {
         return helloH(req);
     }
     HttpRespBuilder builder = newRespBuilder();
@@ -85,7 +90,7 @@ HttpResp assetH(const HttpReq request)
     HttpRespBuilder builder = newRespBuilder();
 
     char assetPath[128];
-    sprintf(assetPath, "assets/%s", request.path.elements[1]);
+    snprintf(assetPath, sizeof(assetPath), "assets/%.*s", (int) request.path.elements[1].length, request.path.elements[1].ptr);
 
     respBuilderSetFileContent(&builder, assetPath, 1);
 
@@ -110,74 +115,83 @@ HttpResp jsonFormatterH(const HttpReq request) {
 }
 
 static pthread_mutex_t crud_mutex = PTHREAD_MUTEX_INITIALIZER;
-HttpResp crudH(HttpReq request) {
-    HttpRespBuilder b = newRespBuilder();
-    pthread_mutex_lock(&crud_mutex);
-    const char *path = "data.json";
-    FILE *fp = NULL;
-    char *buf = NULL;
 
-    fp = fopen(path, "a+");
+/* Opens the stored list, resetting it to [] when it is missing or invalid. Call with crud_mutex held. */
+static FILE *openCrudList(JToken *list) {
+    FILE *fp = fopen("data.json", "a+");
     if (!fp) {
-        respBuilderSetStatus(&b, INTERNAL_SERVER_ERROR);
-        goto _return;
+        return NULL;
     }
-
     if (fseek(fp, 0, SEEK_END) != 0) {
-        respBuilderSetStatus(&b, INTERNAL_SERVER_ERROR);
-        goto _return;
+        fclose(fp);
+        return NULL;
     }
-
     long size = ftell(fp);
     if (size < 0) {
-        respBuilderSetStatus(&b, INTERNAL_SERVER_ERROR);
-        goto _return;
+        fclose(fp);
+        return NULL;
     }
     rewind(fp);
 
-    buf = gcArenaAllocate(size, 1);
+    char *buf = gcArenaAllocate(size + 1, 1);
     fread(buf, 1, size, fp);
     RESULT_T(JToken) token = deserializeJson(buf, size);
     if (!token.ok || token.var.type != JSON_LIST) {
         static const char emptyList[] = "[]";
-        token.ok = 1;
         token.var = toJToken_JList(_JListEmpty());
-        strcpy(buf, emptyList);
         ftruncate(fileno(fp), 0);
         rewind(fp);
-        fwrite(buf, 1, strlen(emptyList), fp);
+        fwrite(emptyList, 1, strlen(emptyList), fp);
+    }
+    *list = token.var;
+    return fp;
+}
+
+HttpResp crudGetH(HttpReq req) {
+    HttpRespBuilder b = newRespBuilder();
+    pthread_mutex_lock(&crud_mutex);
+    JToken list;
+    FILE *fp = openCrudList(&list);
+    if (!fp) {
+        respBuilderSetStatus(&b, INTERNAL_SERVER_ERROR);
+    } else if (req.method == HEAD) {
+        respBuilderSkipContent(&b);
+        fclose(fp);
+    } else {
+        char *buf;
+        size_t length = serializeJson(list, &buf, 4);
+        respBuilderSetContent(&b, buf, length, 0);
+        fclose(fp);
     }
+    pthread_mutex_unlock(&crud_mutex);
+    return respBuild(&b);
+}
 
-    switch (request.method) {
-        case GET: {
-            size_t length = serializeJson(token.var, &buf, 4);
-            respBuilderSetContent(&b, buf, length, 0);
-            break;
-        }
-        case POST: {
-            RESULT_T(JToken) reqToken = deserializeJson(request.content, request.contentLength);
-            if (!reqToken.ok) {
-                respBuilderSetStatus(&b, BAD_REQUEST);
-                goto _return;
-            }
-            JList *list = &token.var.literal.list;
-            token.var.literal.list.tokens = list->tokens = gcReallocate(list->tokens, (list->count + 1) * sizeof(JToken));
-            list->tokens[list->count++] = reqToken.var;
-            size = serializeJson(token.var, &buf, 0);
-            rewind(fp);
-            ftruncate(fileno(fp), 0);
-            rewind(fp);
-            fwrite(buf, 1, size, fp);
-            respBuilderSetStatus(&b, CREATED);
-            break;
-        }
-        default:
-            respBuilderSetStatus(&b, METHOD_NOT_ALLOWED);
-            break;
+HttpResp crudPostH(HttpReq request) {
+    HttpRespBuilder b = newRespBuilder();
+    RESULT_T(JToken) reqToken = deserializeJson(request.content, request.contentLength);
+    if (!reqToken.ok) {
+        respBuilderSetStatus(&b, BAD_REQUEST);
+        return respBuild(&b);
     }
 
-_return:
-    if (fp) fclose(fp);
+    pthread_mutex_lock(&crud_mutex);
+    JToken token;
+    FILE *fp = openCrudList(&token);
+    if (!fp) {
+        respBuilderSetStatus(&b, INTERNAL_SERVER_ERROR);
+    } else {
+        JList *list = &token.literal.list;
+        list->tokens = gcReallocate(list->tokens, (list->count + 1) * sizeof(JToken));
+        list->tokens[list->count++] = reqToken.var;
+        char *buf;
+        size_t size = serializeJson(token, &buf, 0);
+        ftruncate(fileno(fp), 0);
+        rewind(fp);
+        fwrite(buf, 1, size, fp);
+        fclose(fp);
+        respBuilderSetStatus(&b, CREATED);
+    }
     pthread_mutex_unlock(&crud_mutex);
     return respBuild(&b);
-}
\ No newline at end of file
+}
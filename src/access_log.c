@@ -0,0 +1,372 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#define _GNU_SOURCE
+#include <access_log.h>
+#include <alloc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <logging.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <utils.h>
+
+#include "server/thread_rings.h"
+
+/*
+    A response costs two clock reads and one ring push of the raw values, the ip and the path.
+    The writer thread interns the routes, encodes the varints and appends 64 KiB at a time.
+*/
+
+#define ACCESS_RING_SIZE (256 * 1024)
+#define ACCESS_BATCH_SIZE (64 * 1024)
+#define ACCESS_DRAIN_INTERVAL_MS 10
+#define ACCESS_IP_MAX sizeof(((TcpSocket*) NULL)->ip)
+#define VARINT_MAX 10
+/* six numbers, two lengths and the strings */
+#define ACCESS_FIELDS_MAX (VARINT_MAX * 8 + ACCESS_IP_MAX + ACCESS_LOG_PATH_MAX)
+#define ENTRY_PADDING(size) ((8 - (size) % 8) % 8)
+
+/* What a request thread queues, the ip and the path follow, padded to 8 bytes */
+typedef struct AccessEntry {
+    uint32_t size;
+    uint16_t status;
+    uint8_t method;
+    uint8_t ipLength;
+    uint32_t pathLength;
+    uint32_t reserved;
+    uint64_t timeNs;
+    uint64_t durationUs;
+    uint64_t connectionIndex;
+    uint64_t requestIndex;
+    uint64_t requestBytes;
+    uint64_t responseBytes;
+    const char *route;
+} AccessEntry;
+
+#define ACCESS_ENTRY_MAX (sizeof(AccessEntry) + ACCESS_IP_MAX + ACCESS_LOG_PATH_MAX + 8)
+
+/* Open addressing on the pattern text, reset with every file so each one defines its routes */
+typedef struct RouteTable {
+    const char **patterns;
+    uint32_t *ids;
+    size_t capacity;
+    uint32_t count;
+} RouteTable;
+
+static ThreadRingSet accessRings = THREAD_RING_SET_INITIALIZER(ACCESS_RING_SIZE);
+static _Thread_local ThreadRing *threadRing = NULL;
+static atomic_int accessLogEnabled = 0;
+static atomic_int writerRunning = 0;
+/* Held by whoever drains, the fields below belong to it */
+static pthread_mutex_t writerMutex = PTHREAD_MUTEX_INITIALIZER;
+static int writerStarted = 0;
+static int accessLogFd = -1;
+static RouteTable routes;
+static unsigned char batch[ACCESS_BATCH_SIZE];
+static size_t batchLength = 0;
+static alignas(8) unsigned char wrappedEntry[ACCESS_ENTRY_MAX];
+
+static size_t putVarint(unsigned char *out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (unsigned char) value;
+    return length;
+}
+
+static int getVarint(const unsigned char **cursor, const unsigned char *end, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *cursor < end; shift += 7) {
+        unsigned char byte = *(*cursor)++;
+        result |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int getBytes(const unsigned char **cursor, const unsigned char *end, string *str) {
+    uint64_t length;
+    if (!getVarint(cursor, end, &length) || length > (uint64_t) (end - *cursor)) {
+        return 0;
+    }
+    str->ptr = (char*) *cursor;
+    str->length = (ssize_t) length;
+    *cursor += length;
+    return 1;
+}
+
+static void writeBatch() {
+    size_t written = 0;
+    while (accessLogFd >= 0 && written < batchLength) {
+        ssize_t result = write(accessLogFd, batch + written, batchLength - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            error("Failed writing the access log: %s", strerror(errno));
+            break;
+        }
+        written += (size_t) result;
+    }
+    batchLength = 0;
+}
+
+static void appendRecord(AccessRecordHeader header, const unsigned char *fields, size_t length) {
+    header.length = (uint32_t) length;
+    if (batchLength + sizeof(header) + length > sizeof(batch)) {
+        writeBatch();
+    }
+    memcpy(batch + batchLength, &header, sizeof(header));
+    memcpy(batch + batchLength + sizeof(header), fields, length);
+    batchLength += sizeof(header) + length;
+}
+
+static void clearRoutes() {
+    deallocate(routes.patterns);
+    deallocate(routes.ids);
+    routes = (RouteTable) {0};
+}
+
+static size_t routeSlot(const RouteTable *table, const char *pattern) {
+    size_t slot = hash((void*) pattern, (int) strlen(pattern)) & (table->capacity - 1);
+    while (table->patterns[slot] != NULL && strcmp(table->patterns[slot], pattern) != 0) {
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+    return slot;
+}
+
+static void growRoutes() {
+    RouteTable grown = {.capacity = routes.capacity > 0 ? routes.capacity * 2 : 64, .count = routes.count};
+    grown.patterns = allocate(grown.capacity * sizeof(*grown.patterns));
+    grown.ids = allocate(grown.capacity * sizeof(*grown.ids));
+    memset(grown.patterns, 0, grown.capacity * sizeof(*grown.patterns));
+    for (size_t i = 0; i < routes.capacity; i++) {
+        if (routes.patterns[i] != NULL) {
+            size_t slot = routeSlot(&grown, routes.patterns[i]);
+            grown.patterns[slot] = routes.patterns[i];
+            grown.ids[slot] = routes.ids[i];
+        }
+    }
+    deallocate(routes.patterns);
+    deallocate(routes.ids);
+    routes = grown;
+}
+
+/* The first use of a route in a file writes its definition */
+static uint32_t internRoute(const char *pattern) {
+    if (pattern == NULL) {
+        return 0;
+    }
+    if ((routes.count + 1) * 2 > routes.capacity) {
+        growRoutes();
+    }
+    size_t slot = routeSlot(&routes, pattern);
+    if (routes.patterns[slot] != NULL) {
+        return routes.ids[slot];
+    }
+    uint32_t id = ++routes.count;
+    routes.patterns[slot] = pattern;
+    routes.ids[slot] = id;
+
+    size_t patternLength = strnlen(pattern, ACCESS_LOG_PATH_MAX);
+    unsigned char fields[VARINT_MAX * 2 + ACCESS_LOG_PATH_MAX];
+    size_t length = putVarint(fields, id);
+    length += putVarint(fields + length, patternLength);
+    memcpy(fields + length, pattern, patternLength);
+    appendRecord((AccessRecordHeader) {.type = ACCESS_RECORD_ROUTE}, fields, length + patternLength);
+    return id;
+}
+
+/* Drain callback, takes one entry */
+static size_t writeEntry(SpscRing *ring, void *) {
+    uint32_t size;
+    const unsigned char *data = peekSizedRecord(ring, wrappedEntry, &size);
+    if (accessLogFd < 0) {
+        return size;
+    }
+    AccessEntry entry;
+    memcpy(&entry, data, sizeof(entry));
+    uint32_t routeId = internRoute(entry.route);
+
+    unsigned char fields[ACCESS_FIELDS_MAX];
+    size_t length = putVarint(fields, routeId);
+    length += putVarint(fields + length, entry.connectionIndex);
+    length += putVarint(fields + length, entry.requestIndex);
+    length += putVarint(fields + length, entry.durationUs);
+    length += putVarint(fields + length, entry.requestBytes);
+    length += putVarint(fields + length, entry.responseBytes);
+    length += putVarint(fields + length, entry.ipLength);
+    memcpy(fields + length, data + sizeof(entry), entry.ipLength);
+    length += entry.ipLength;
+    length += putVarint(fields + length, entry.pathLength);
+    memcpy(fields + length, data + sizeof(entry) + entry.ipLength, entry.pathLength);
+    length += entry.pathLength;
+
+    AccessRecordHeader header = {
+        .type = ACCESS_RECORD_REQUEST,
+        .method = entry.method,
+        .status = entry.status,
+        .timeNs = entry.timeNs,
+    };
+    appendRecord(header, fields, length);
+    return size;
+}
+
+/* Call with writerMutex held, returns the bytes written */
+static size_t drainAccessLog() {
+    size_t dropped = drainThreadRings(&accessRings, writeEntry, NULL);
+    size_t written = batchLength;
+    writeBatch();
+    if (dropped > 0) {
+        warning("Access log dropped %zu records, the writer fell behind", dropped);
+    }
+    return written;
+}
+
+void flushAccessLog() {
+    pthread_mutex_lock(&writerMutex);
+    drainAccessLog();
+    pthread_mutex_unlock(&writerMutex);
+}
+
+static void *writeAccessLog(void *) {
+    const struct timespec interval = {.tv_sec = 0, .tv_nsec = ACCESS_DRAIN_INTERVAL_MS * 1000000L};
+    for (;;) {
+        pthread_mutex_lock(&writerMutex);
+        size_t written = drainAccessLog();
+        pthread_mutex_unlock(&writerMutex);
+        if (written == 0) {
+            nanosleep(&interval, NULL);
+        }
+    }
+    return NULL;
+}
+
+/* Call with writerMutex held, without the thread every record is written synchronously */
+static void startWriter() {
+    writerStarted = 1;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, writeAccessLog, NULL) == 0) {
+        pthread_detach(thread);
+        atomic_store(&writerRunning, 1);
+    }
+    atexit(flushAccessLog);
+}
+
+int setAccessLogFile(const char *path) {
+    int fd = -1;
+    if (path != NULL) {
+        fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            error("Could not open access log %s: %s", path, strerror(errno));
+            return -1;
+        }
+    }
+    pthread_mutex_lock(&writerMutex);
+    /* queued records still go to the previous file */
+    drainAccessLog();
+    if (accessLogFd >= 0) {
+        close(accessLogFd);
+    }
+    accessLogFd = fd;
+    clearRoutes();
+    if (fd >= 0 && lseek(fd, 0, SEEK_END) == 0) {
+        memcpy(batch, ACCESS_LOG_MAGIC, sizeof(ACCESS_LOG_MAGIC) - 1);
+        batchLength = sizeof(ACCESS_LOG_MAGIC) - 1;
+        writeBatch();
+    }
+    if (fd >= 0 && !writerStarted) {
+        startWriter();
+    }
+    atomic_store_explicit(&accessLogEnabled, fd >= 0, memory_order_relaxed);
+    pthread_mutex_unlock(&writerMutex);
+    return 0;
+}
+
+void logAccess(HttpReq *req, const char *route, int status, size_t requestBytes, size_t responseBytes) {
+    if (!atomic_load_explicit(&accessLogEnabled, memory_order_relaxed)) {
+        return;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    AccessEntry entry = {
+        .status = (uint16_t) status,
+        .method = (uint8_t) req->method,
+        .timeNs = (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec,
+        .requestBytes = requestBytes,
+        .responseBytes = responseBytes,
+        .route = route,
+    };
+    const char *ip = NULL;
+    SessionState *state = req->appState;
+    if (state != NULL) {
+        ip = state->clientSocket.ip;
+        entry.ipLength = (uint8_t) strnlen(ip, ACCESS_IP_MAX);
+        entry.connectionIndex = state->connectionIndex;
+        entry.requestIndex = state->requestIndex;
+        if (state->requestStartNs > 0) {
+            entry.durationUs = (uint64_t) (getMonotonicTimeNs() - state->requestStartNs) / 1000;
+        }
+    }
+    if (req->path.raw.ptr != NULL && req->path.raw.length > 0) {
+        entry.pathLength = req->path.raw.length < ACCESS_LOG_PATH_MAX ? (uint32_t) req->path.raw.length : ACCESS_LOG_PATH_MAX;
+    }
+
+    static const char padding[8] = {0};
+    size_t size = sizeof(entry) + entry.ipLength + entry.pathLength;
+    entry.size = (uint32_t) (size + ENTRY_PADDING(size));
+    struct iovec parts[4] = {
+        {.iov_base = &entry, .iov_len = sizeof(entry)},
+        {.iov_base = (void*) ip, .iov_len = entry.ipLength},
+        {.iov_base = req->path.raw.ptr, .iov_len = entry.pathLength},
+        {.iov_base = (void*) padding, .iov_len = ENTRY_PADDING(size)},
+    };
+    threadRingPush(threadRingOf(&accessRings, &threadRing), parts, 4);
+    if (!atomic_load_explicit(&writerRunning, memory_order_relaxed)) {
+        flushAccessLog();
+    }
+}
+
+long decodeAccessRecord(const unsigned char *data, size_t size, AccessRecord *record) {
+    *record = (AccessRecord) {0};
+    if (size < sizeof(AccessRecordHeader)) {
+        return 0;
+    }
+    memcpy(&record->header, data, sizeof(record->header));
+    if (size - sizeof(AccessRecordHeader) < record->header.length) {
+        return 0;
+    }
+    const unsigned char *cursor = data + sizeof(AccessRecordHeader);
+    const unsigned char *end = cursor + record->header.length;
+    int ok = 1;
+    switch (record->header.type) {
+        case ACCESS_RECORD_REQUEST:
+            ok = getVarint(&cursor, end, &record->routeId)
+                && getVarint(&cursor, end, &record->connectionIndex)
+                && getVarint(&cursor, end, &record->requestIndex)
+                && getVarint(&cursor, end, &record->durationUs)
+                && getVarint(&cursor, end, &record->requestBytes)
+                && getVarint(&cursor, end, &record->responseBytes)
+                && getBytes(&cursor, end, &record->ip)
+                && getBytes(&cursor, end, &record->path);
+            break;
+        case ACCESS_RECORD_ROUTE:
+            ok = getVarint(&cursor, end, &record->routeId) && getBytes(&cursor, end, &record->path);
+            break;
+        default:
+            /* newer record types are skipped */
+            break;
+    }
+    return ok ? (long) (sizeof(AccessRecordHeader) + record->header.length) : -1;
+}
@@ -2,34 +2,15 @@
 // Created by Rescyy on 10/22/2025.
 //
 
-#include <pthread.h>
 #include <logging.h>
+#include <metrics.h>
 
 #include "alloc_entries.h"
 
 DEFINE_ARRAY_FUNCS(AllocEntry, allocate, reallocate)
 
-static pthread_key_t entriesThreadKey;
-
 static size_t ptrHashFunction(const void *ptr);
 
-void initEntries() {
-    pthread_key_create(&entriesThreadKey, NULL);
-}
-
-void deInitEntries() {
-    pthread_key_delete(entriesThreadKey);
-}
-
-AllocEntries *getEntries() {
-    AllocEntries *entries = pthread_getspecific(entriesThreadKey);
-    return entries;
-}
-
-void setEntries(const AllocEntries *entries) {
-    pthread_setspecific(entriesThreadKey, entries);
-}
-
 void destroyEntries(AllocEntries *entries) {
     bundleAndDeallocate(entries);
     deallocate(entries->arr.data);
@@ -66,6 +47,7 @@ void bundleAndDeallocate(const AllocEntries *entries) {
         deallocate(allocPtr[i]);
     }
     free(allocPtr);
+    metricsAdd(METRIC_GC_ENTRIES_FREED, entries->toDeallocate);
 }
 
 void cleanupEntries(AllocEntries *entries) {
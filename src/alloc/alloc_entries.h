@@ -22,12 +22,8 @@ typedef struct {
     int toDeallocate;
 } AllocEntries;
 
-void initEntries();
-void deInitEntries();
 void cleanupEntries(AllocEntries *entries);
 void destroyEntries(AllocEntries *entries);
 void bundleAndDeallocate(const AllocEntries *entries);
-AllocEntries *getEntries();
-void setEntries(const AllocEntries *entries);
 
 #endif //HTTPSERVERC_ALLOC_ENTRIES_H
\ No newline at end of file
@@ -4,30 +4,11 @@
 
 #include "arena.h"
 
-#include <pthread.h>
 #include <logging.h>
+#include <metrics.h>
 
 DEFINE_ARRAY_FUNCS(ArenaChunk, allocate, reallocate)
 
-static pthread_key_t arenaThreadKey;
-
-Arena *getArena() {
-    Arena *arena = pthread_getspecific(arenaThreadKey);
-    return arena;
-}
-
-void initArena() {
-    pthread_key_create(&arenaThreadKey, NULL);
-}
-
-void deInitArena() {
-    pthread_key_delete(arenaThreadKey);
-}
-
-void setArena(const Arena *arena) {
-    pthread_setspecific(arenaThreadKey, arena);
-}
-
 void cleanupArena(Arena *arena) {
     debug("Cleaning up Arena %u Chunks", arena->chunks.length);
     for (size_t i = 1; i < arena->chunks.length; i++) {
@@ -42,6 +23,7 @@ void cleanupArena(Arena *arena) {
 
 ArenaChunk newArenaChunk(size_t capacity) {
     size_t actualCapacity = ((capacity - 1) / ARENA_PAGE_CAP + 1) * ARENA_PAGE_CAP;
+    metricsAdd(METRIC_ARENA_CHUNKS, 1);
     return (ArenaChunk) {
         .ptr = allocate(actualCapacity),
         .size = 0,
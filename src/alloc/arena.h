@@ -29,10 +29,6 @@ typedef struct {
 
 void cleanupArena(Arena *arena);
 void destroyArena(Arena *arena);
-void initArena();
-void deInitArena();
-Arena *getArena();
-void setArena(const Arena *arena);
 ArenaChunk newArenaChunk(size_t capacity);
 void *chunkAlloc(ArenaChunk *chunk, size_t size, unsigned int align);
 int chunkHasEnoughSpace(ArenaChunk *chunk, size_t, unsigned int align);
@@ -3,6 +3,7 @@
 //
 
 #include "destructors.h"
+#include "thread_context.h"
 
 #include <logging.h>
 #include <pthread.h>
@@ -20,15 +21,11 @@ void attachDestructor(destructor_t func, void *ptr) {
     ARRAY_PUSH(Destructor, destructors, destructor);
 }
 
-void setDestructors(const ARRAY_T(Destructor) *destructors) {
+void setDestructors(ARRAY_T(Destructor) *destructors) {
+    threadContext.destructors = destructors;
     pthread_setspecific(destructorsThreadKey, destructors);
 }
 
-ARRAY_T(Destructor) *getDestructors() {
-    ARRAY_T(Destructor) *destructors = pthread_getspecific(destructorsThreadKey);
-    return destructors;
-}
-
 void invokeDestructors(ARRAY_T(Destructor) *destructors) {
     debug("Invoking destructors %u", destructors->length);
     for (int i = (int) destructors->length - 1; i >= 0; i--) {
@@ -39,6 +36,7 @@ void invokeDestructors(ARRAY_T(Destructor) *destructors) {
 }
 
 static void invokeDestructorsWrapper(void *ptr) {
+    threadContext.destructors = NULL;
     invokeDestructors(ptr);
 }
 
@@ -49,6 +47,7 @@ void initDestructors() {
 void deInitDestructors() {
     ARRAY_T(Destructor) *destructors = getDestructors();
     if (destructors != NULL) {
+        setDestructors(NULL);
         invokeDestructors(destructors);
     }
     pthread_key_delete(destructorsThreadKey);
@@ -15,8 +15,8 @@ typedef struct {
 TYPEDEF_ARRAY(Destructor);
 DECLARE_ARRAY_FUNCS(Destructor)
 
-ARRAY_T(Destructor) *getDestructors();
-void setDestructors(const ARRAY_T(Destructor) *destructors);
+/* Also keyed, the thread's destructors are invoked when it exits */
+void setDestructors(ARRAY_T(Destructor) *destructors);
 void invokeDestructors(ARRAY_T(Destructor) *destructors);
 void initDestructors();
 void deInitDestructors();
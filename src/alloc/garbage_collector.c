@@ -10,25 +10,26 @@
 #include "arena.h"
 #include "destructors.h"
 #include "logging.h"
+#include "thread_context.h"
 
+_Thread_local ThreadContext threadContext = {0};
 
 void gcInit() {
-    initEntries();
-    initArena();
     initDestructors();
 }
 
 void gcDestroy() {
     deInitDestructors();
-    deInitArena();
-    deInitEntries();
 }
 
+/* Destructors run on the thread that attached them, later allocations fall back to the heap */
 static void destroyArenaWrapper(void *ptr) {
+    setArena(NULL);
     destroyArena(ptr);
 }
 
 static void destroyEntriesWrapper(void *ptr) {
+    setEntries(NULL);
     destroyEntries(ptr);
 }
 
@@ -72,6 +73,57 @@ void gcCleanup() {
     cleanupArena(getArena());
 }
 
+struct GcContext {
+    Arena *arena;
+    AllocEntries *entries;
+};
+
+GcContext *gcSuspend() {
+    GcContext *context = allocate(sizeof(GcContext));
+    context->arena = NULL;
+    context->entries = NULL;
+    Arena *arena = getArena();
+    if (arena != NULL) {
+        context->arena = allocate(sizeof(Arena));
+        *context->arena = *arena;
+        *arena = (Arena) {
+            .chunks = ARRAY_NEW(ArenaChunk),
+            .openFrom = 0,
+            .firstStackAlloc = 0,
+        };
+        ARRAY_PUSH(ArenaChunk, &arena->chunks, newArenaChunk(ARENA_PAGE_CAP));
+    }
+    AllocEntries *entries = getEntries();
+    if (entries != NULL) {
+        context->entries = allocate(sizeof(AllocEntries));
+        *context->entries = *entries;
+        *entries = (AllocEntries) {
+            .arr = ARRAY_WITH_CAPACITY(AllocEntry, ENTRIES_PAGE_CAP),
+            .toDeallocate = 0,
+        };
+    }
+    return context;
+}
+
+void gcSwapContext(GcContext *context) {
+    Arena *arena = getArena();
+    AllocEntries *entries = getEntries();
+    setArena(context->arena);
+    setEntries(context->entries);
+    context->arena = arena;
+    context->entries = entries;
+}
+
+void gcFreeContext(GcContext *context) {
+    if (context->entries != NULL) {
+        destroyEntries(context->entries);
+    }
+    if (context->arena != NULL) {
+        destroyArena(context->arena);
+    }
+    deallocate(context);
+}
+
 void *gcArenaAllocate(const size_t size, unsigned int align) {
     assert(align != 0);
     if (size == 0) return NULL;
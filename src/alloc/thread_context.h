@@ -0,0 +1,53 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_THREAD_CONTEXT_H
+#define HTTPSERVERC_THREAD_CONTEXT_H
+
+#include "alloc_entries.h"
+#include "arena.h"
+#include "destructors.h"
+
+struct SessionState;
+
+/*
+    What a thread looks up on every allocation and log line, in a single thread local.
+    Reading a field is one load off the thread pointer instead of a pthread_getspecific call.
+    Pthread keys are only kept for what has to be cleaned up when a thread exits.
+*/
+typedef struct ThreadContext {
+    Arena *arena;
+    AllocEntries *entries;
+    ARRAY_T(Destructor) *destructors;
+    struct SessionState *sessionState;
+} ThreadContext;
+
+extern _Thread_local ThreadContext threadContext;
+
+static inline Arena *getArena() {
+    return threadContext.arena;
+}
+
+static inline void setArena(Arena *arena) {
+    threadContext.arena = arena;
+}
+
+static inline AllocEntries *getEntries() {
+    return threadContext.entries;
+}
+
+static inline void setEntries(AllocEntries *entries) {
+    threadContext.entries = entries;
+}
+
+static inline ARRAY_T(Destructor) *getDestructors() {
+    return threadContext.destructors;
+}
+
+/* Set through setSessionState, which also registers the state for cleanup at thread exit */
+static inline struct SessionState *getSessionState() {
+    return threadContext.sessionState;
+}
+
+#endif //HTTPSERVERC_THREAD_CONTEXT_H
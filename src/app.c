@@ -2,38 +2,106 @@
 // Created by Crucerescu Vladislav on 07.03.2025.
 //
 
+#include <access_log.h>
 #include <alloc.h>
 #include <app.h>
 #include <app_state.h>
 #include <connection.h>
 #include <errors.h>
 #include <fcntl.h>
-#include <fcntl.h>
+#include <file_cache.h>
+#include <http_body.h>
+#include <http_range.h>
 #include <http_router.h>
+#include <http_version.h>
+#include <http_writer.h>
 #include <logging.h>
+#include <metrics.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <tcp_stream.h>
-#include <sys/sendfile.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <unistd.h>
 #include <errno.h> // don't delete
 
 #include "helpers/signal_helper.h"
+#include "helpers/thread_helper.h"
+#include "server/idle_parking.h"
+#include "server/reactor.h"
+#include "server/worker_pool.h"
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define IDLE_TIMEOUT_MS (60 * 1000)
+/* Heads of this size are serialized on the stack, bigger ones in the request arena */
+#define RESP_HEAD_STACK_SIZE 2048
 
 static HttpRouter router = {.capacity = -1};
 static pthread_t mainThreadId;
-
+static ServerMode serverMode = SERVER_MODE_THREAD_PER_CONNECTION;
+static int workerThreads = 0;
+static unsigned int acceptQueueCapacity = 1024;
+static HttpResp overloadResponse;
+static int reusePort = 0;
+static int listenBacklog = SOMAXCONN;
+static int pinThreads = 0;
+static Reactor *reactor = NULL;
+static int shutdownFd = -1;
+static WorkerPool *pool = NULL;
+static int idleParking = 1;
+static int idleParkingDelayMs = 10;
+static ParkingLot *parkingLot = NULL;
+static long maxBodySize = 8 * 1024 * 1024;
+static int stageTiming = 0;
+static int serverTimingHeader = 0;
+static RequestTimeouts requestTimeouts = {
+    .headerMs = 30 * 1000,
+    .bodyMs = 60 * 1000,
+    .idleMs = IDLE_TIMEOUT_MS,
+    .writeMs = 10 * 1000,
+};
+
+typedef struct Acceptor {
+    TcpSocket listener;
+    int index;
+} Acceptor;
+
+/* What finishing a producer response needs once a slow reactor client caught up, in the request arena */
+typedef struct PausedResponse {
+    HttpReq request;
+    HttpResp resp;
+    HttpBody body;
+    HttpEndpoint *endpoint;
+    HttpRespWriter writer;
+    long long stageNs[REQUEST_STAGE_COUNT];
+    long long stageStartNs;
+    int connectionKeepAlive;
+} PausedResponse;
+
+void acceptConnections(Acceptor *acceptor);
+void *acceptConnectionsThreadCall(void *arg);
 void *handleConnectionThreadCall(void *arg);
 void handleConnection(SessionState *appState);
+void handlePooledConnection(SessionState *state);
+RequestOutcome serveRequests(SessionState *appState, TcpStream *stream);
+void parkOrCloseConnection(SessionState *state, RequestOutcome outcome);
+void resumeParkedConnection(SessionState *state);
+void rejectConnection(SessionState *state);
 WriteResult sendResponse(HttpResp *resp, TcpSocket *client);
-WriteResult sendContent(HttpResp *resp, TcpSocket *client);
+WriteResult sendResponseHead(HttpResp *resp, TcpSocket *client);
 WriteResult sendFile(HttpResp *resp, TcpSocket *client);
+WriteResult sendRangeParts(HttpResp *resp, TcpSocket *client);
+WriteResult sendProducedResponse(HttpResp *resp, TcpSocket *client, int chunked, HttpRespWriter *writer);
 int handleError(int result, TcpSocket *client, HttpReq *request);
-int handleRequest(SessionState *state, TcpStream *stream);
+RequestOutcome handleRequest(SessionState *state, TcpStream *stream);
+RequestOutcome processRequest(SessionState *state, TcpStream *stream);
+static RequestOutcome resumePausedResponse(SessionState *state);
+static RequestOutcome finishRequest(SessionState *state, HttpReq *request, HttpResp *resp, HttpBody *body,
+                                    HttpEndpoint *endpoint, long long *stageNs, long long stageStartNs,
+                                    int connectionKeepAlive, WriteResult sendResult);
+static WriteResult runProducer(HttpResp *resp, HttpRespWriter *writer);
 
 pthread_t getMainThreadId() {
     return mainThreadId;
@@ -51,6 +119,104 @@ void initApp() {
     debug("Initialising Garbage Collector");
     gcInit();
     setupSignalHandlers();
+    shutdownFd = eventfd(0, EFD_CLOEXEC);
+}
+
+void stopApp() {
+    eventfd_write(shutdownFd, 1);
+}
+
+/* Blocks until stopApp, reads interrupted by a signal are retried */
+static void waitForShutdown() {
+    setupShutdownHandlers(stopApp);
+    eventfd_t count;
+    while (eventfd_read(shutdownFd, &count) == -1) {
+        if (errno != EINTR) {
+            perror("waitForShutdown: eventfd_read");
+            return;
+        }
+    }
+}
+
+void setServerMode(ServerMode mode) {
+    serverMode = mode;
+}
+
+void setWorkerThreads(int count) {
+    workerThreads = count;
+}
+
+void setAcceptQueueCapacity(unsigned int capacity) {
+    acceptQueueCapacity = capacity;
+}
+
+void setReusePort(int enabled) {
+    reusePort = enabled;
+}
+
+void setListenBacklog(int backlog) {
+    listenBacklog = backlog;
+}
+
+void setCpuAffinity(int enabled) {
+    pinThreads = enabled;
+}
+
+void setIdleParking(int enabled) {
+    idleParking = enabled;
+}
+
+void setIdleParkingDelay(int delayMs) {
+    idleParkingDelayMs = delayMs > 0 ? delayMs : 0;
+}
+
+void setMaxBodySize(long bytes) {
+    maxBodySize = bytes;
+}
+
+void setStageTiming(int enabled) {
+    stageTiming = enabled;
+}
+
+void setServerTimingHeader(int enabled) {
+    serverTimingHeader = enabled;
+    if (enabled) {
+        stageTiming = 1;
+    }
+}
+
+void setRequestTimeouts(RequestTimeouts timeouts) {
+    if (timeouts.headerMs > 0) {
+        requestTimeouts.headerMs = timeouts.headerMs;
+    }
+    if (timeouts.bodyMs > 0) {
+        requestTimeouts.bodyMs = timeouts.bodyMs;
+    }
+    if (timeouts.idleMs > 0) {
+        requestTimeouts.idleMs = timeouts.idleMs;
+    }
+    if (timeouts.writeMs > 0) {
+        requestTimeouts.writeMs = timeouts.writeMs;
+    }
+}
+
+/* A handler cannot wait for content on a non blocking socket, see addStreamingEndpoint */
+static int countStreamingEndpoints() {
+    int count = 0;
+    for (int i = 0; i < router.length; i++) {
+        if (router.endpoints[i].streamBody) {
+            fatal("Endpoint %s streams its content, which SERVER_MODE_REACTOR does not support", router.endpoints[i].raw);
+            count++;
+        }
+    }
+    return count;
+}
+
+static int resolveWorkerThreads() {
+    if (workerThreads > 0) {
+        return workerThreads;
+    }
+    return getCoreCount();
 }
 
 void startApp(char *port) {
@@ -60,25 +226,92 @@ void startApp(char *port) {
         router = emptyRouter();
     }
 
-    pthread_t thread1;
+    ListenOptions listenOptions = defaultListenOptions();
+    listenOptions.backlog = listenBacklog;
+    listenOptions.reusePort = reusePort;
+
+    if (serverMode == SERVER_MODE_REACTOR) {
+        if (countStreamingEndpoints() > 0) {
+            exit(1);
+        }
+        reactor = newReactor(resolveWorkerThreads(), pinThreads, handleRequest);
+        if (reactor == NULL) {
+            fatal("Failed starting the reactor");
+            exit(1);
+        }
+        if (reusePort) {
+            if (reactorListen(reactor, port, listenOptions) == -1) {
+                fatal("Failed listening to socket");
+                exit(1);
+            }
+            info("Listening to port %s from every event loop", port);
+            waitForShutdown();
+            reactorStop(reactor);
+            reactor = NULL;
+            info("Stopped listening to port %s", port);
+            return;
+        }
+    } else if (serverMode == SERVER_MODE_WORKER_POOL) {
+        HttpRespBuilder builder = newRespBuilder();
+        respBuilderSetStatus(&builder, SERVICE_UNAVAILABLE);
+        respBuilderAddHeader(&builder, "Connection", "close");
+        overloadResponse = respBuild(&builder);
+        pool = newWorkerPool(resolveWorkerThreads(), acceptQueueCapacity, handlePooledConnection);
+    }
 
-    TcpSocket socket = socketListen(port);
+    /* The reactor already waits for idle connections without holding a thread */
+    if (idleParking && reactor == NULL) {
+        parkingLot = newParkingLot(requestTimeouts.idleMs, resumeParkedConnection);
+        if (parkingLot == NULL) {
+            fatal("Failed starting the idle connection parking");
+            exit(1);
+        }
+    }
 
-    if (socket.closed) {
-        fatal("Failed listening to socket");
-        exit(1);
+    /* With SO_REUSEPORT every acceptor owns a listener, otherwise the main thread accepts alone */
+    int acceptorCount = reusePort ? resolveWorkerThreads() : 1;
+    Acceptor *acceptors = allocate(sizeof(Acceptor) * acceptorCount);
+    for (int i = 0; i < acceptorCount; i++) {
+        acceptors[i].index = i;
+        acceptors[i].listener = socketListenWithOptions(port, listenOptions);
+        if (acceptors[i].listener.closed) {
+            fatal("Failed listening to socket");
+            exit(1);
+        }
     }
     info("Listening to port %s", port);
 
-    int connectionIndex = 1;
+    for (int i = 1; i < acceptorCount; i++) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, acceptConnectionsThreadCall, &acceptors[i]);
+        pthread_detach(thread);
+    }
+    acceptConnections(&acceptors[0]);
+}
+
+void acceptConnections(Acceptor *acceptor) {
+    if (pinThreads) {
+        pinCurrentThreadToCore(acceptor->index);
+    }
+    int acceptFlags = SOCK_CLOEXEC | (reactor != NULL ? SOCK_NONBLOCK : 0);
+    pthread_t thread1;
 
     for (;;) {
-        TcpSocket clientSocket = acceptConnection(socket);
-        info("Connection accepted from client %s with connection index %lu", clientSocket.ip, connectionIndex);
-        SessionState *state = newSessionState(clientSocket, connectionIndex++);
+        TcpSocket clientSocket = acceptConnectionWithFlags(acceptor->listener, acceptFlags);
         if (clientSocket.closed) {
             error("Client connection error: %s", strerror(errno));
-            deallocate(state);
+            continue;
+        }
+        SessionState *state = newSessionState(clientSocket, nextConnectionIndex());
+        info("Connection accepted from client %s with connection index %lu", clientSocket.ip, state->connectionIndex);
+        if (reactor != NULL) {
+            if (reactorAddConnection(reactor, state) == -1) {
+                destroySessionState(state);
+            }
+        } else if (pool != NULL) {
+            if (workerPoolSubmit(pool, state) == -1) {
+                rejectConnection(state);
+            }
         } else {
             pthread_create(&thread1, NULL, handleConnectionThreadCall, state);
             pthread_detach(thread1);
@@ -86,6 +319,26 @@ void startApp(char *port) {
     }
 }
 
+/*
+    Runs on the parking thread once a parked connection has bytes to read.
+*/
+void resumeParkedConnection(SessionState *state) {
+    if (pool != NULL) {
+        if (workerPoolSubmit(pool, state) == -1) {
+            rejectConnection(state);
+        }
+        return;
+    }
+    pthread_t thread;
+    pthread_create(&thread, NULL, handleConnectionThreadCall, state);
+    pthread_detach(thread);
+}
+
+void *acceptConnectionsThreadCall(void *arg) {
+    acceptConnections(arg);
+    return NULL;
+}
+
 void *handleConnectionThreadCall(void *arg) {
     handleConnection(arg);
     pthread_exit(NULL);
@@ -95,35 +348,195 @@ void *handleConnectionThreadCall(void *arg) {
 #define BUFFER_SIZE 3072UL
 #define STACK_ARENA_CHUNK_SIZE 4096UL
 
+/*
+    The stream and arena are released when the thread exits,
+    a parked connection gets a new thread when it becomes readable.
+*/
 void handleConnection(SessionState *appState) {
     setSessionState(appState);
     char stackArenaChunk[STACK_ARENA_CHUNK_SIZE];
     gcTrackWithStackArena(stackArenaChunk, STACK_ARENA_CHUNK_SIZE);
     TcpStream *stream = newTcpStream(&appState->clientSocket);
     attachDestructor((destructor_t) freeTcpStream, stream);
+    RequestOutcome outcome = serveRequests(appState, stream);
+    if (outcome == REQUEST_KEEP_ALIVE) {
+        /* the state is no longer owned by this thread, keep the thread destructor off it */
+        setSessionState(NULL);
+        parkOrCloseConnection(appState, outcome);
+    }
+}
+
+/*
+    Worker threads outlive the connection, so everything the
+    thread destructors would release is released here.
+*/
+void handlePooledConnection(SessionState *state) {
+    setSessionState(state);
+    TcpStream *stream = newTcpStream(&state->clientSocket);
+    RequestOutcome outcome = serveRequests(state, stream);
+    gcCleanup();
+    freeTcpStream(stream);
+    setSessionState(NULL);
+    parkOrCloseConnection(state, outcome);
+}
+
+void parkOrCloseConnection(SessionState *state, RequestOutcome outcome) {
+    if (outcome == REQUEST_KEEP_ALIVE && parkConnection(parkingLot, state) == 0) {
+        metricsAdd(METRIC_CONNECTIONS_PARKED, 1);
+        return;
+    }
+    destroySessionState(state);
+}
+
+/*
+    Called from the acceptor when every worker is busy and the queue is full.
+    The response is built once at startup, serialized on the stack for a current Date and sent without waiting.
+*/
+void rejectConnection(SessionState *state) {
+    warning("Accept queue is full, rejecting connection %lu", state->connectionIndex);
+    char head[RESP_HEAD_STACK_SIZE];
+    size_t headSize = writeRespHead(&overloadResponse, head);
+    transmitOnce(&state->clientSocket, head, headSize);
+    destroySessionState(state);
+}
+
+/*
+    Parking costs an epoll_ctl add and delete and a handover to another thread,
+    so a client that sends its next request right away keeps its thread.
+    A closed or failing socket counts as arriving, the next request reports it.
+*/
+static int nextRequestArrives(SessionState *state) {
+    return idleParkingDelayMs > 0 && canRead(state->clientSocket.fd, idleParkingDelayMs) != READ_TIMEOUT;
+}
+
+/*
+    Returns REQUEST_KEEP_ALIVE when the connection went idle and can be parked,
+    pipelined requests already in the stream are served first.
+*/
+RequestOutcome serveRequests(SessionState *appState, TcpStream *stream) {
     while (1) {
-        int shouldCloseConnection = !handleRequest(appState, stream);
+        int shouldCloseConnection = handleRequest(appState, stream) == REQUEST_CLOSE;
         if (shouldCloseConnection) {
-            break;
+            return REQUEST_CLOSE;
         }
         tcpStreamDrain(stream);
         gcCleanup();
         appState->requestIndex++;
+        if (parkingLot != NULL && tcpStreamPending(stream) == 0 && !nextRequestArrives(appState)) {
+            return REQUEST_KEEP_ALIVE;
+        }
     }
 }
 
-int handleRequest(SessionState *state, TcpStream *stream) {
+/*
+    Every request phase gets its own receive deadline, they are only moved
+    when the phase changes, so a reactor reparsing a partial request cannot extend them.
+    A producer response the reactor paused for a slow client is continued before anything is parsed.
+*/
+RequestOutcome handleRequest(SessionState *state, TcpStream *stream) {
+    TcpSocket *client = &state->clientSocket;
+    RequestOutcome outcome;
+    if (state->pausedResponse != NULL) {
+        outcome = resumePausedResponse(state);
+    } else {
+        if (client->deadline == 0) {
+            setSocketDeadline(client, requestTimeouts.idleMs);
+        }
+        outcome = processRequest(state, stream);
+    }
+    if (outcome == REQUEST_KEEP_ALIVE) {
+        state->phase = REQUEST_PHASE_IDLE;
+        setSocketDeadline(client, requestTimeouts.idleMs);
+    }
+    return outcome;
+}
+
+static int endpointTimeout(int endpointMs, int appMs) {
+    return endpointMs > 0 ? endpointMs : appMs;
+}
+
+static long endpointBodyLimit(HttpEndpoint *endpoint) {
+    return endpoint != NULL && endpoint->maxBodySize != 0 ? endpoint->maxBodySize : maxBodySize;
+}
+
+/* Buffered content was read whole, for a streamed one received counts what the handler pulled */
+static size_t contentBytesRead(HttpBody *body, HttpReq *req) {
+    long bytes = body->framing == BODY_FRAMING_BUFFERED ? req->contentLength : body->received;
+    return bytes > 0 ? (size_t) bytes : 0;
+}
+
+/* Every stage but send, which has not happened yet, durations in milliseconds */
+static void setServerTiming(HttpResp *resp, const long long stageNs[REQUEST_STAGE_COUNT]) {
+    const size_t capacity = 256;
+    char *value = gcArenaAllocate(capacity, alignof(char));
+    size_t length = 0;
+    for (int i = 0; i < REQUEST_STAGE_SEND && length < capacity; i++) {
+        length += snprintf(value + length, capacity - length, "%s%s;dur=%.3f",
+            i > 0 ? ", " : "", stageToStr(i), (double) stageNs[i] / 1e6);
+    }
+    respSetHeader(resp, STRING_LITERAL("Server-Timing"), (string) {.ptr = value, .length = (ssize_t) MIN(length, capacity - 1)});
+}
+
+RequestOutcome processRequest(SessionState *state, TcpStream *stream) {
+    TcpSocket *client = &state->clientSocket;
     HttpReq request = {
         .appState = state
     };
     HttpResp resp;
-    int result = parseRequestStream(&request, stream);
+    HttpBody body = {0};
+    HttpEndpoint *endpoint = NULL;
+    unsigned int allowedMethods = 0;
+    int result = 0;
+
+    if (state->phase == REQUEST_PHASE_IDLE) {
+        tcpStreamFill(stream, stream->cursor + 1);
+        result = stream->error;
+        if (result == 0) {
+            state->phase = REQUEST_PHASE_HEAD;
+            state->requestStartNs = getMonotonicTimeNs();
+            setSocketDeadline(client, requestTimeouts.headerMs);
+        }
+    }
+    if (result == 0) {
+        result = parseRequestHead(&request, stream);
+    }
+    if (result == 0) {
+        /* a reparsed request keeps the stamps of its first parse */
+        int enteringBody = state->phase == REQUEST_PHASE_HEAD;
+        if (enteringBody && stageTiming) {
+            state->headParsedNs = getMonotonicTimeNs();
+        }
+        endpoint = findEndpoint(&router, &request, &allowedMethods);
+        if (enteringBody && stageTiming) {
+            state->routedNs = getMonotonicTimeNs();
+        }
+        RequestTimeouts timeouts = endpoint != NULL ? endpoint->timeouts : (RequestTimeouts) {0};
+        if (enteringBody) {
+            state->phase = REQUEST_PHASE_BODY;
+            setSocketDeadline(client, endpointTimeout(timeouts.bodyMs, requestTimeouts.bodyMs));
+        }
+        client->writeTimeoutMs = endpointTimeout(timeouts.writeMs, requestTimeouts.writeMs);
+        result = prepareRequestBody(&body, &request, stream, endpointBodyLimit(endpoint));
+        int streamBody = endpoint != NULL && endpoint->streamBody;
+        if (result == 0 && !streamBody) {
+            /* a reparsed request is past its head already and got the 100 Continue before */
+            if (enteringBody && body.expectContinue) {
+                result = sendContinue(&body);
+            }
+            if (result == 0) {
+                result = bufferRequestBody(&body, &request);
+            }
+        }
+    }
+    if (result == TCP_STREAM_WOULD_BLOCK) {
+        return REQUEST_INCOMPLETE;
+    }
     int action = handleError(result, &state->clientSocket, &request);
     switch (action) {
         case 1:
-            return 0;
+            return REQUEST_CLOSE;
         case 2:
-            return 1;
+            return REQUEST_KEEP_ALIVE;
         default:
             break;
     }
@@ -131,29 +544,126 @@ int handleRequest(SessionState *state, TcpStream *stream) {
     debug("Connection keep alive");
     int connectionKeepAlive = isConnectionKeepAlive(&request);
 
+    long long stageNs[REQUEST_STAGE_COUNT] = {0};
+    long long stageStartNs = 0;
+    if (stageTiming) {
+        stageStartNs = getMonotonicTimeNs();
+        stageNs[REQUEST_STAGE_PARSE] = state->headParsedNs - state->requestStartNs;
+        stageNs[REQUEST_STAGE_ROUTE] = state->routedNs - state->headParsedNs;
+        stageNs[REQUEST_STAGE_BODY] = stageStartNs - state->routedNs;
+    }
+
     debug("Routing request");
-    resp = routeReq(&router, &request);
+    resp = dispatchReq(&router, endpoint, &request, allowedMethods);
+
+    respNegotiateEncoding(&resp, &request.headers);
+    respApplyConditionals(&resp, request.method, &request.headers);
+    if (stageTiming) {
+        long long handledNs = getMonotonicTimeNs();
+        stageNs[REQUEST_STAGE_HANDLER] = handledNs - stageStartNs;
+        stageStartNs = handledNs;
+    }
+    if (serverTimingHeader) {
+        setServerTiming(&resp, stageNs);
+    }
+
+    /* HTTP/1.0 has no chunked coding, the content ends when the connection closes */
+    int chunked = getVersionNumber(request.version.ptr, (int) request.version.length) >= 11;
+    if (resp.producer != NULL) {
+        if (chunked) {
+            respSetHeader(&resp, STRING_LITERAL("Transfer-Encoding"), STRING_LITERAL("chunked"));
+        } else {
+            connectionKeepAlive = 0;
+            respSetHeader(&resp, STRING_LITERAL("Connection"), STRING_LITERAL("close"));
+        }
+    }
+
+    /* a client still waiting for 100 Continue will not send the content, the connection cannot be reused */
+    if (!body.finished && body.expectContinue) {
+        connectionKeepAlive = 0;
+        respSetHeader(&resp, STRING_LITERAL("Connection"), STRING_LITERAL("close"));
+    }
 
     debug("Logging Response");
     logResponse(&resp, &request);
 
-    WriteResult sendResult = sendResponse(&resp, &state->clientSocket);
+    /* file content of a HEAD response is never opened */
+    WriteResult sendResult;
+    if (request.method == HEAD) {
+        sendResult = sendResponseHead(&resp, &state->clientSocket);
+    } else if (resp.producer != NULL) {
+        HttpRespWriter writer;
+        sendResult = sendProducedResponse(&resp, &state->clientSocket, chunked, &writer);
+        if (sendResult.result == WRITE_WOULD_BLOCK) {
+            PausedResponse *paused = gcArenaAllocate(sizeof(PausedResponse), alignof(PausedResponse));
+            *paused = (PausedResponse) {
+                .request = request,
+                .resp = resp,
+                .body = body,
+                .endpoint = endpoint,
+                .writer = writer,
+                .stageStartNs = stageStartNs,
+                .connectionKeepAlive = connectionKeepAlive,
+            };
+            paused->request.body = &paused->body;
+            memcpy(paused->stageNs, stageNs, sizeof(stageNs));
+            state->pausedResponse = paused;
+            return REQUEST_PAUSED;
+        }
+    } else {
+        sendResult = sendResponse(&resp, &state->clientSocket);
+    }
+    return finishRequest(state, &request, &resp, &body, endpoint, stageNs, stageStartNs, connectionKeepAlive, sendResult);
+}
+
+/* The producer carries on where it backed off, in the allocations the reactor kept for the request */
+static RequestOutcome resumePausedResponse(SessionState *state) {
+    PausedResponse *paused = state->pausedResponse;
+    WriteResult sendResult = runProducer(&paused->resp, &paused->writer);
+    if (sendResult.result == WRITE_WOULD_BLOCK) {
+        return REQUEST_PAUSED;
+    }
+    state->pausedResponse = NULL;
+    return finishRequest(state, &paused->request, &paused->resp, &paused->body, paused->endpoint,
+                         paused->stageNs, paused->stageStartNs, paused->connectionKeepAlive, sendResult);
+}
+
+/* Logging, metrics and the keep alive decision once the response left or failed */
+static RequestOutcome finishRequest(SessionState *state, HttpReq *request, HttpResp *resp, HttpBody *body,
+                                    HttpEndpoint *endpoint, long long *stageNs, long long stageStartNs,
+                                    int connectionKeepAlive, WriteResult sendResult) {
+    logAccess(request, endpoint != NULL ? endpoint->raw : NULL, resp->status, contentBytesRead(body, request), sendResult.sent);
+    int metricsRoute = endpoint != NULL ? endpoint->metricsRoute : 0;
+    long long sentNs = getMonotonicTimeNs();
+    metricsObserveRequest(metricsRoute, resp->status, sentNs - state->requestStartNs);
+    if (stageTiming) {
+        stageNs[REQUEST_STAGE_SEND] = sentNs - stageStartNs;
+        metricsObserveStages(metricsRoute, stageNs);
+    }
+    if (state->requestIndex > 1) {
+        metricsAdd(METRIC_KEEP_ALIVE_REQUESTS, 1);
+    }
+    respRelease(resp);
 
     switch (sendResult.result) {
         case WRITE_OK:
+        case WRITE_WOULD_BLOCK: /* queued past the limit, the reactor flushes it before the next request */
             break;
         case WRITE_CLOSED:
             warning("Peer closed connection while sending");
-            return 0;
+            return REQUEST_CLOSE;
         case WRITE_TIMEOUT:
             warning("Timeout while sending");
-            return 0;
+            return REQUEST_CLOSE;
         default:
             error("Failed sending response");
-            return 0;
+            return REQUEST_CLOSE;
     }
 
-    return connectionKeepAlive;
+    if (connectionKeepAlive && !body->finished && discardRequestBody(body) < 0) {
+        return REQUEST_CLOSE;
+    }
+    return connectionKeepAlive ? REQUEST_KEEP_ALIVE : REQUEST_CLOSE;
 }
 
 /*
@@ -162,6 +672,10 @@ int handleRequest(SessionState *state, TcpStream *stream) {
 int handleError(int result, TcpSocket *client, HttpReq *request) {
     HttpResp resp;
     SessionState *state = request->appState;
+    /* an idle connection closing or timing out is not a failed request */
+    if (result < 0 && state->phase != REQUEST_PHASE_IDLE) {
+        metricsCountError(result);
+    }
     switch (result) {
         case TCP_STREAM_ERROR:
             error("TCP Socket Had An Error.");
@@ -201,82 +715,202 @@ int handleError(int result, TcpSocket *client, HttpReq *request) {
             resp = newResp(URI_TOO_LONG);
             break;
 
+        case EXPECTATION_FAILED_ERROR:
+            error("Received Unsupported Expectation.");
+            resp = newResp(EXPECTATION_FAILED);
+            break;
+
         default:
             return 0;
     }
     logResponse(&resp, request);
-    sendResponse(&resp, client);
+    WriteResult sendResult = sendResponse(&resp, client);
+    logAccess(request, NULL, resp.status, 0, sendResult.sent);
+    metricsObserveRequest(0, resp.status, getMonotonicTimeNs() - state->requestStartNs);
     return 1;
 }
 
-WriteResult sendResponse(HttpResp *resp, TcpSocket *client) {
-    char *buffer;
+static size_t serializeRespHead(HttpResp *resp, char *stackBuffer, char **head) {
     TRACE("%s", "Building response");
-    size_t responseSize = buildRespStringUntilContent(resp, &buffer);
-
-    WriteResult respResult = transmit(client, buffer, responseSize);
-
-    if (respResult.result != WRITE_OK) {
-        return respResult;
-    }
+    size_t size = respHeadSize(resp);
+    *head = size <= RESP_HEAD_STACK_SIZE ? stackBuffer : gcArenaAllocate(size, alignof(char));
+    return writeRespHead(resp, *head);
+}
 
-    WriteResult contentResult = sendContent(resp, client);
-    if (contentResult.result != WRITE_OK) {
-        contentResult.sent += respResult.sent;
-        return contentResult;
-    }
+/* Status line and headers only, HEAD responses keep the Content-Length of the GET they mirror */
+WriteResult sendResponseHead(HttpResp *resp, TcpSocket *client) {
+    char stackBuffer[RESP_HEAD_STACK_SIZE];
+    char *head;
+    size_t headSize = serializeRespHead(resp, stackBuffer, &head);
 
-    return (WriteResult) {.result = WRITE_OK, .sent = contentResult.sent + respResult.sent};
+    return transmit(client, head, headSize);
 }
 
-WriteResult sendContent(HttpResp *resp, TcpSocket *client) {
-    if (resp->contentLength == 0) {
-        return (WriteResult) {.result = WRITE_OK, .sent = 0};
+/* In memory content leaves with the head in a single sendmsg */
+WriteResult sendResponse(HttpResp *resp, TcpSocket *client) {
+    if (resp->parts != NULL) {
+        return sendRangeParts(resp, client);
     }
-    if (resp->isContentFile) {
+    if (resp->isContentFile && resp->contentLength > 0) {
         return sendFile(resp, client);
     }
-    return transmit(client, resp->content, resp->contentLength);
+    char stackBuffer[RESP_HEAD_STACK_SIZE];
+    char *head;
+    size_t headSize = serializeRespHead(resp, stackBuffer, &head);
+
+    struct iovec iov[2] = {
+        {.iov_base = head, .iov_len = headSize},
+        {.iov_base = (void*) resp->content, .iov_len = resp->contentLength},
+    };
+    return transmitVector(client, iov, resp->contentLength > 0 ? 2 : 1);
 }
 
+/*
+    Files come open from the file cache, so a missing file does not leave a head without its body.
+    The socket stays corked until sendfile returns, the head and the first file bytes share a segment.
+    sendfile with an explicit offset leaves the shared descriptor's position alone.
+*/
 WriteResult sendFile(HttpResp *resp, TcpSocket *client) {
-    int fd = open(resp->content, O_RDONLY);
-    if (fd < 0) {
-        char errorBuffer[256];
-        snprintf(errorBuffer, sizeof(errorBuffer), "Error opening file %s for sendFile", (char*) resp->content);
-        perror(errorBuffer);
+    if (resp->file == NULL) {
+        error("File response for %s has no open file", (const char*) resp->content);
         return (WriteResult) {.result = WRITE_OPEN_ERROR, .sent = 0};
     }
 
-    off_t offset = 0;
-    off_t remaining = resp->contentLength;
+    setSocketCork(client, 1);
+    WriteResult result = sendResponseHead(resp, client);
+    if (writeAccepted(result.result)) {
+        WriteResult fileResult = transmitFile(client, resp->file->fd, resp->contentOffset, resp->contentLength);
+        fileResult.sent += result.sent;
+        result = fileResult;
+    }
+    setSocketCork(client, 0);
+    return result;
+}
 
-    while (remaining > 0) {
-        WriteEnum writable = canWrite(client->fd, 10 * 1000);
-        if (writable != WRITE_OK) {
-            return (WriteResult) {.result = writable, .sent = offset};
+static WriteResult addSent(WriteResult total, WriteResult step) {
+    step.sent += total.sent;
+    return step;
+}
+
+/* multipart/byteranges, one sendmsg for resident content, corked sendfile per part for files */
+WriteResult sendRangeParts(HttpResp *resp, TcpSocket *client) {
+    HttpRangeParts *parts = resp->parts;
+    char stackBuffer[RESP_HEAD_STACK_SIZE];
+    char *head;
+    size_t headSize = serializeRespHead(resp, stackBuffer, &head);
+
+    if (!resp->isContentFile) {
+        int iovCount = parts->count * 2 + 2;
+        struct iovec *iov = gcArenaAllocate(sizeof(struct iovec) * iovCount, alignof(struct iovec));
+        iov[0] = (struct iovec) {.iov_base = head, .iov_len = headSize};
+        for (int i = 0; i < parts->count; i++) {
+            iov[i * 2 + 1] = (struct iovec) {.iov_base = parts->items[i].head.ptr, .iov_len = parts->items[i].head.length};
+            iov[i * 2 + 2] = (struct iovec) {
+                .iov_base = (char*) resp->content + parts->items[i].start,
+                .iov_len = parts->items[i].length,
+            };
         }
-        off_t tempOffset = offset;
-        ssize_t sent = sendfile(client->fd, fd, &offset, remaining);
-        debug("sendfile(%d, %d, %ld, %zu) returned %zd and changed offset to %ld", client->fd, fd, tempOffset, remaining, sent, offset);
-        if (sent <= 0) {
-            perror("sendfile");
-            return (WriteResult) {.result = WRITE_SENDFILE_ERROR, .sent = offset};
+        iov[iovCount - 1] = (struct iovec) {.iov_base = parts->tail.ptr, .iov_len = parts->tail.length};
+        return transmitVector(client, iov, iovCount);
+    }
+
+    setSocketCork(client, 1);
+    WriteResult result = transmit(client, head, headSize);
+    for (int i = 0; i < parts->count && writeAccepted(result.result); i++) {
+        result = addSent(result, transmit(client, parts->items[i].head.ptr, parts->items[i].head.length));
+        if (writeAccepted(result.result)) {
+            result = addSent(result, transmitFile(client, resp->file->fd, parts->items[i].start, parts->items[i].length));
         }
-        remaining -= sent;
     }
-    return (WriteResult) {.result = WRITE_OK, .sent = resp->contentLength};
+    if (writeAccepted(result.result)) {
+        result = addSent(result, transmit(client, parts->tail.ptr, parts->tail.length));
+    }
+    setSocketCork(client, 0);
+    return result;
 }
 
-void addEndpoint(char *path, HttpReqHandler handler) {
-    info("Adding Endpoint %s", path);
+/*
+    Calls the producer again for RESP_PRODUCER_MORE, until a slow reactor client makes it back off.
+    WRITE_WOULD_BLOCK then means the response is unfinished, everything written so far is queued.
+*/
+static WriteResult runProducer(HttpResp *resp, HttpRespWriter *writer) {
+    for (;;) {
+        writer->backedOff = 0;
+        int produced = resp->producer(writer, resp->producerState);
+        if (produced < 0) {
+            if (writer->result == WRITE_OK) {
+                warning("Producer aborted the response");
+                writer->result = WRITE_SEND_ERROR;
+            }
+            return (WriteResult) {.result = writer->result, .sent = writer->sent};
+        }
+        if (produced != RESP_PRODUCER_MORE) {
+            return finishRespWriter(writer);
+        }
+        if (writer->backedOff) {
+            return (WriteResult) {.result = WRITE_WOULD_BLOCK, .sent = writer->sent};
+        }
+    }
+}
+
+/*
+    The chunk buffer lives on this stack, the producer runs before the handler's arena is cleaned up.
+    A producer that backs off keeps writer, its buffered bytes move to the request arena.
+*/
+WriteResult sendProducedResponse(HttpResp *resp, TcpSocket *client, int chunked, HttpRespWriter *writer) {
+    char stackBuffer[RESP_HEAD_STACK_SIZE];
+    char *head;
+    size_t headSize = serializeRespHead(resp, stackBuffer, &head);
+    char chunk[RESP_WRITER_CHUNK_SIZE];
+    initRespWriter(writer, client, head, headSize, chunk, sizeof(chunk), chunked);
+
+    WriteResult result = runProducer(resp, writer);
+    if (result.result == WRITE_WOULD_BLOCK) {
+        writer->buffer = gcArenaAllocate(sizeof(chunk), alignof(char));
+        memcpy(writer->buffer, chunk, writer->length);
+    }
+    return result;
+}
+
+/* Endpoints sharing a pattern share its metrics */
+static void registerEndpoint(HttpEndpoint endpoint) {
+    info("Adding Endpoint %s", endpoint.raw);
     if (router.capacity == -1) {
         router = emptyRouter();
     }
-    HttpEndpoint endpoint = newEndpoint(path, handler);
+    endpoint.metricsRoute = addMetricsRoute(endpoint.raw);
     routerAddEndpoint(&router, endpoint);
 }
 
+void addEndpoint(char *path, HttpReqHandler handler) {
+    registerEndpoint(newEndpoint(path, handler));
+}
+
+void addEndpointWithTimeouts(char *path, HttpReqHandler handler, RequestTimeouts timeouts) {
+    HttpEndpoint endpoint = newEndpoint(path, handler);
+    endpoint.timeouts = timeouts;
+    registerEndpoint(endpoint);
+}
+
+void addEndpointForMethods(char *path, unsigned int methods, HttpReqHandler handler) {
+    HttpEndpoint endpoint = newEndpoint(path, handler);
+    endpoint.methods = methods;
+    registerEndpoint(endpoint);
+}
+
+void addEndpointWithBodyLimit(char *path, HttpReqHandler handler, long maxBodySize) {
+    HttpEndpoint endpoint = newEndpoint(path, handler);
+    endpoint.maxBodySize = maxBodySize;
+    registerEndpoint(endpoint);
+}
+
+void addStreamingEndpoint(char *path, HttpReqHandler handler, long maxBodySize) {
+    HttpEndpoint endpoint = newEndpoint(path, handler);
+    endpoint.maxBodySize = maxBodySize;
+    endpoint.streamBody = 1;
+    registerEndpoint(endpoint);
+}
+
 void setNotFoundCallback(HttpReqHandler handler) {
     router.notFoundCallback = handler;
 }
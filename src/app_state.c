@@ -5,37 +5,50 @@
 #include <alloc.h>
 #include <app_state.h>
 #include <logging.h>
+#include <metrics.h>
 #include <pthread.h>
+#include <stdatomic.h>
+
+#include "alloc/thread_context.h"
 
-static int keyIsCreated = 0;
 static pthread_key_t sessionStateKey;
+static atomic_ulong connectionCounter = 1;
+
+unsigned long nextConnectionIndex() {
+    return atomic_fetch_add_explicit(&connectionCounter, 1, memory_order_relaxed);
+}
 
 SessionState *newSessionState(TcpSocket socket, unsigned long connectionIndex) {
     SessionState *state = allocate(sizeof(SessionState));
     state->clientSocket = socket;
     state->connectionIndex = connectionIndex;
     state->requestIndex = 1;
+    state->phase = REQUEST_PHASE_IDLE;
+    state->pausedResponse = NULL;
+    metricsAdd(METRIC_CONNECTIONS_OPENED, 1);
     return state;
 }
 
-static void freeSessionState(void *ptr) {
-    SessionState *state = ptr;
-    info("Closing connection %d with %s", state->connectionIndex, state->clientSocket.ip);
+void destroySessionState(SessionState *state) {
+    info("Closing connection %lu with %s", state->connectionIndex, state->clientSocket.ip);
     closeSocket(&state->clientSocket);
-    deallocate(ptr);
+    metricsAdd(METRIC_CONNECTIONS_CLOSED, 1);
+    deallocate(state);
+}
+
+/* The key only closes what a thread still holds when it exits */
+static void freeSessionState(void *ptr) {
+    threadContext.sessionState = NULL;
+    destroySessionState(ptr);
 }
 
 void initSessionStateFactory() {
     pthread_key_create(&sessionStateKey, freeSessionState);
-    keyIsCreated = 1;
 }
 
 void setSessionState(SessionState *state) {
+    threadContext.sessionState = state;
     pthread_setspecific(sessionStateKey, state);
 }
 
-SessionState *getSessionState() {
-    return keyIsCreated ? pthread_getspecific(sessionStateKey) : NULL;
-}
-
 
@@ -2,11 +2,13 @@
 // Created by Crucerescu Vladislav on 07.03.2025.
 //
 
+#define _GNU_SOURCE
 #include <alloc.h>
 #include <assert.h>
 #include <connection.h>
 #include <errno.h>
 #include <logging.h>
+#include <metrics.h>
 #include <netdb.h>
 #include <poll.h>
 #include <pthread.h>
@@ -14,10 +16,36 @@
 #include <string.h>
 #include <unistd.h>
 #include <utils.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 
+#include "io/io_backend.h"
+
+static const IoBackend *ioBackend = &directIoBackend;
+/* Responses leave in one write or corked, so Nagle only delays them */
+static int tcpNoDelay = 1;
+
+typedef struct OutboundSegment {
+    struct OutboundSegment *next;
+    int fd; /* -1 for the bytes in data, a duplicate of the queued file otherwise */
+    off_t offset; /* into data or into the file */
+    size_t remaining;
+    char data[];
+} OutboundSegment;
+
+struct OutboundQueue {
+    OutboundSegment *head;
+    OutboundSegment *tail;
+    size_t bufferedBytes; /* queued bytes held in memory, files are not counted */
+};
+
+static void freeOutboundQueue(TcpSocket *sock);
+
 /*
     return TcpSocket;
     error = 0: SUCCESS;
@@ -25,12 +53,31 @@
     error > 0: errno specific;
 */
 TcpSocket socketListen(const port_t port)
+{
+    return socketListenWithOptions(port, defaultListenOptions());
+}
+
+ListenOptions defaultListenOptions()
+{
+    return (ListenOptions) {
+        .backlog = SOMAXCONN,
+        .reusePort = 0,
+        .nonBlocking = 0,
+    };
+}
+
+/*
+    Same as socketListen.
+    With reusePort several sockets can listen on the same port and
+    the kernel balances incoming connections between them.
+*/
+TcpSocket socketListenWithOptions(const port_t port, ListenOptions options)
 {
     int status, sockfd;
     socklen_t addrSize = sizeof(struct sockaddr_storage);
     struct addrinfo hints, *res;
     TcpSocket sock = {
-        .fd = 0,
+        .fd = -1,
         .closed = 0,
     };
 
@@ -49,7 +96,8 @@ TcpSocket socketListen(const port_t port)
     }
 
     res->ai_flags = 0;
-    if ((sockfd = socket(res->ai_family, res->ai_socktype, res->ai_flags)) == -1)
+    int socketType = res->ai_socktype | SOCK_CLOEXEC | (options.nonBlocking ? SOCK_NONBLOCK : 0);
+    if ((sockfd = socket(res->ai_family, socketType, res->ai_flags)) == -1)
     {
         freeaddrinfo(res);
         sock.closed = 1;
@@ -73,6 +121,14 @@ TcpSocket socketListen(const port_t port)
         perror("socketListen: setsockopt");
         return sock;
     }
+    if (options.reusePort && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &(int){1}, sizeof(int)) == -1)
+    {
+        freeaddrinfo(res);
+        close(sockfd);
+        sock.closed = 1;
+        perror("socketListen: setsockopt");
+        return sock;
+    }
 
     if ((status = bind(sockfd, res->ai_addr, res->ai_addrlen)) == -1)
     {
@@ -85,7 +141,7 @@ TcpSocket socketListen(const port_t port)
 
     freeaddrinfo(res);
 
-    if ((status = listen(sockfd, 20)) == -1)
+    if ((status = listen(sockfd, options.backlog)) == -1)
     {
         close(sockfd);
         sock.closed = 1;
@@ -94,6 +150,7 @@ TcpSocket socketListen(const port_t port)
     }
 
     sock.fd = sockfd;
+    sock.nonBlocking = options.nonBlocking;
     return sock;
 }
 
@@ -103,22 +160,42 @@ TcpSocket socketListen(const port_t port)
     error = errno: errno specific;
 */
 TcpSocket acceptConnection(TcpSocket sock)
+{
+    return acceptConnectionWithFlags(sock, SOCK_CLOEXEC);
+}
+
+int acceptSocket(int listenFd, int flags)
+{
+    return accept4(listenFd, NULL, NULL, flags);
+}
+
+/*
+    flags are passed to accept4.
+    With SOCK_NONBLOCK the client socket is created non blocking
+    and receive reports READ_WOULD_BLOCK.
+*/
+TcpSocket acceptConnectionWithFlags(TcpSocket sock, int flags)
 {
     TcpSocket conn = {
-        .fd = 0,
+        .fd = -1,
         .closed = 0,
     };
     int clientfd, sockfd = sock.fd;
 
-    if ((clientfd = accept(sockfd, NULL, NULL)) == -1)
+    if ((clientfd = ioBackend->accept(sockfd, flags)) == -1)
     {
         conn.closed = 1;
         return conn;
     }
 
     conn.fd = clientfd;
+    conn.nonBlocking = (flags & SOCK_NONBLOCK) != 0;
 
     getClientIp(clientfd, conn.ip);
+    if (tcpNoDelay && setsockopt(clientfd, IPPROTO_TCP, TCP_NODELAY, &tcpNoDelay, sizeof(tcpNoDelay)) == -1) {
+        perror("acceptConnection: setsockopt TCP_NODELAY");
+    }
+    ioBackend->prepare(&conn);
 
     return conn;
 }
@@ -134,7 +211,7 @@ TcpSocket socketConnect(const char *host, const port_t port)
     struct addrinfo hints, *res;
     int sockfd, status;
     TcpSocket conn = {
-        .fd = 0,
+        .fd = -1,
         .closed = 0,
     };
 
@@ -168,12 +245,60 @@ TcpSocket socketConnect(const char *host, const port_t port)
     return conn;
 }
 
+/*
+    receive and transmit only mark the socket as closed when the peer goes away,
+    the descriptor is released here.
+*/
 void closeSocket(TcpSocket *sock)
 {
-    if (!sock->closed) {
-        sock->closed = 1;
+    sock->closed = 1;
+    freeOutboundQueue(sock);
+    if (sock->fd >= 0) {
         close(sock->fd);
+        sock->fd = -1;
+    }
+}
+
+/*
+    Switches the socket to O_NONBLOCK.
+    receive will then return READ_WOULD_BLOCK instead of waiting for data.
+*/
+int setSocketNonBlocking(TcpSocket *sock)
+{
+    int flags = fcntl(sock->fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(sock->fd, F_SETFL, flags | O_NONBLOCK) == -1)
+    {
+        perror("setSocketNonBlocking: fcntl");
+        return -1;
+    }
+    sock->nonBlocking = 1;
+    return 0;
+}
+
+/*
+    Receive gives up once the deadline passes, no matter how often bytes trickle in.
+    timeoutMs <= 0 removes the deadline.
+*/
+void setSocketDeadline(TcpSocket *sock, int timeoutMs)
+{
+    sock->deadline = timeoutMs > 0 ? getMonotonicTimeMs() + timeoutMs : 0;
+}
+
+int socketReceiveWait(const TcpSocket *sock)
+{
+    if (sock->deadline == 0) {
+        return RECEIVE_TIMEOUT_MS;
+    }
+    long long remaining = sock->deadline - getMonotonicTimeMs();
+    if (remaining <= 0) {
+        return 0;
     }
+    return remaining > INT_MAX ? INT_MAX : (int) remaining;
+}
+
+int socketTransmitWait(const TcpSocket *sock)
+{
+    return sock->writeTimeoutMs > 0 ? sock->writeTimeoutMs : TRANSMIT_TIMEOUT_MS;
 }
 
 ReadEnum canRead(int fd, int timeoutMs) {
@@ -196,59 +321,64 @@ ReadEnum canRead(int fd, int timeoutMs) {
     return READ_OK;
 }
 
-pthread_mutex_t socketLogMutex = PTHREAD_MUTEX_INITIALIZER;
-
-ReadResult receive(TcpSocket *sock, void *buffer, size_t size) {
-    if (sock->closed) {
-        return (ReadResult) {
-            .result = READ_CLOSED,
-            .received = 0,
-        };
+/*
+    Not thread safe, call before the server starts accepting connections.
+*/
+void setIoBackend(IoBackendType type) {
+    switch (type) {
+        case IO_BACKEND_POLL:
+            ioBackend = &pollIoBackend;
+            break;
+        case IO_BACKEND_URING:
+            if (uringAvailable()) {
+                ioBackend = &uringIoBackend;
+                break;
+            }
+            warning("io_uring is not available (%s), falling back to the poll backend", strerror(errno));
+            ioBackend = &pollIoBackend;
+            break;
+        case IO_BACKEND_DIRECT:
+        default:
+            ioBackend = &directIoBackend;
+            break;
     }
+    info("Using %s socket I/O backend", ioBackend->name);
+}
 
-    ReadEnum readable = canRead(sock->fd, 60 * 1000);
+/*
+    Not thread safe, call before the server starts accepting connections.
+    Accepted sockets get TCP_NODELAY unless disabled here, default on.
+*/
+void setTcpNoDelay(int enabled) {
+    tcpNoDelay = enabled != 0;
+}
 
-    if (readable != READ_OK) {
-        sock->closed = 1;
-        return (ReadResult) {
-            .result = readable,
-            .received = -1,
-        };
+/*
+    While corked the kernel only sends full segments, uncorking flushes the rest.
+    Fails quietly on sockets that are not TCP.
+*/
+void setSocketCork(TcpSocket *sock, int corked) {
+    if (sock->closed) {
+        return;
     }
+    int value = corked != 0;
+    int ret = setsockopt(sock->fd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value));
+    debug("setsockopt(%d, IPPROTO_TCP, TCP_CORK, %d) returned %d", sock->fd, value, ret);
+}
 
-    ssize_t recvd = recv(sock->fd, buffer, size, 0);
-    debug("recv(%d, %p, %zu, 0) returned %zd", sock->fd, buffer, size, recvd);
-
-    if (recvd == 0) {
-        sock->closed = 1;
+ReadResult receive(TcpSocket *sock, void *buffer, size_t size) {
+    if (sock->closed) {
         return (ReadResult) {
             .result = READ_CLOSED,
             .received = 0,
         };
     }
-
-    if (recvd == -1) {
-        perror("receive: recv");
-        sock->closed = 1;
-        return (ReadResult) {
-            .result = READ_RECV_ERROR,
-            .received = -1,
-        };
+    ReadResult result = ioBackend->receive(sock, buffer, size);
+    /* received is -1 on timeouts and errors */
+    if (result.result == READ_OK) {
+        metricsAdd(METRIC_BYTES_RECEIVED, result.received);
     }
-
-    DECLARE_CURRENT_TIME(time);
-    pthread_mutex_lock(&socketLogMutex);
-    FILE *socketFile = fopen("socketLog.txt", "ab");
-    fprintf(socketFile, "\n%s Received %zd bytes from %s\nbegin:\n", time, recvd, sock->ip);
-    fwrite(buffer, 1, recvd, socketFile);
-    fprintf(socketFile, ":stop");
-    fclose(socketFile);
-    pthread_mutex_unlock(&socketLogMutex);
-
-    return (ReadResult) {
-        .result = READ_OK,
-        .received = recvd,
-    };
+    return result;
 }
 
 WriteEnum canWrite(int fd, int timeoutMs) {
@@ -271,6 +401,146 @@ WriteEnum canWrite(int fd, int timeoutMs) {
     return WRITE_OK;
 }
 
+void enableOutboundQueue(TcpSocket *sock) {
+    if (sock->outbound == NULL) {
+        sock->outbound = allocate(sizeof(OutboundQueue));
+        *sock->outbound = (OutboundQueue) {
+            .head = NULL,
+            .tail = NULL,
+            .bufferedBytes = 0,
+        };
+    }
+}
+
+int outboundPending(const TcpSocket *sock) {
+    return sock->outbound != NULL && sock->outbound->head != NULL;
+}
+
+static void appendOutbound(OutboundQueue *queue, OutboundSegment *segment) {
+    segment->next = NULL;
+    if (queue->tail != NULL) {
+        queue->tail->next = segment;
+    } else {
+        queue->head = segment;
+    }
+    queue->tail = segment;
+}
+
+static void queueOutboundBytes(OutboundQueue *queue, const void *buffer, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    OutboundSegment *segment = allocate(sizeof(OutboundSegment) + size);
+    segment->fd = -1;
+    segment->offset = 0;
+    segment->remaining = size;
+    memcpy(segment->data, buffer, size);
+    queue->bufferedBytes += size;
+    appendOutbound(queue, segment);
+}
+
+/* The caller may close fd, the queue sends from its own descriptor */
+static int queueOutboundFile(OutboundQueue *queue, int fd, off_t offset, size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy == -1) {
+        perror("queueOutboundFile: fcntl");
+        return -1;
+    }
+    OutboundSegment *segment = allocate(sizeof(OutboundSegment));
+    segment->fd = copy;
+    segment->offset = offset;
+    segment->remaining = count;
+    appendOutbound(queue, segment);
+    return 0;
+}
+
+static void popOutbound(OutboundQueue *queue) {
+    OutboundSegment *segment = queue->head;
+    queue->head = segment->next;
+    if (queue->head == NULL) {
+        queue->tail = NULL;
+    }
+    if (segment->fd != -1) {
+        close(segment->fd);
+    } else {
+        queue->bufferedBytes -= segment->remaining;
+    }
+    deallocate(segment);
+}
+
+static void freeOutboundQueue(TcpSocket *sock) {
+    if (sock->outbound == NULL) {
+        return;
+    }
+    while (sock->outbound->head != NULL) {
+        popOutbound(sock->outbound);
+    }
+    deallocate(sock->outbound);
+    sock->outbound = NULL;
+}
+
+WriteEnum flushOutbound(TcpSocket *sock) {
+    OutboundQueue *queue = sock->outbound;
+    while (outboundPending(sock)) {
+        if (sock->closed) {
+            return WRITE_CLOSED;
+        }
+        OutboundSegment *segment = queue->head;
+        WriteResult result;
+        if (segment->fd == -1) {
+            result = ioBackend->transmit(sock, segment->data + segment->offset, segment->remaining);
+            queue->bufferedBytes -= result.sent;
+        } else {
+            result = ioBackend->transmitFile(sock, segment->fd, segment->offset, segment->remaining);
+            metricsAdd(METRIC_SENDFILE_BYTES, result.sent);
+        }
+        metricsAdd(METRIC_BYTES_SENT, result.sent);
+        segment->offset += (off_t) result.sent;
+        segment->remaining -= result.sent;
+        if (result.result != WRITE_OK) {
+            sock->closed = result.result != WRITE_WOULD_BLOCK;
+            return result.result;
+        }
+        popOutbound(queue);
+    }
+    return WRITE_OK;
+}
+
+int writeAccepted(WriteEnum result) {
+    return result == WRITE_OK || result == WRITE_WOULD_BLOCK;
+}
+
+/* Without an outbound queue a non-blocking socket waits for room like a blocking one */
+static WriteEnum awaitWritable(TcpSocket *sock) {
+    WriteEnum writable = canWrite(sock->fd, socketTransmitWait(sock));
+    if (writable != WRITE_OK) {
+        sock->closed = 1;
+    }
+    return writable;
+}
+
+/*
+    Past OUTBOUND_QUEUE_MAX_BYTES the writer is told to back off with WRITE_WOULD_BLOCK,
+    the loop thread never waits for a slow reader to make room.
+*/
+static WriteEnum boundOutbound(TcpSocket *sock) {
+    if (sock->outbound->bufferedBytes <= OUTBOUND_QUEUE_MAX_BYTES) {
+        return WRITE_OK;
+    }
+    WriteEnum flushed = flushOutbound(sock);
+    if (flushed == WRITE_WOULD_BLOCK && sock->outbound->bufferedBytes <= OUTBOUND_QUEUE_MAX_BYTES) {
+        return WRITE_OK;
+    }
+    return flushed;
+}
+
+/*
+    Queued bytes go out before anything written after them, so once the queue holds
+    something every write is queued until flushOutbound empties it.
+*/
 WriteResult transmit(TcpSocket *sock, const void *buffer, size_t size) {
     if (sock->closed) {
         return (WriteResult) {
@@ -278,59 +548,146 @@ WriteResult transmit(TcpSocket *sock, const void *buffer, size_t size) {
             .sent = 0,
         };
     }
-    size_t totalSent = 0;
-
-    while (totalSent < size) {
-        // Wait until writable (10s timeout per chunk)
-        WriteEnum writable = canWrite(sock->fd, 10 * 1000);
-        if (writable != WRITE_OK) {
-            sock->closed = 1;
-            return (WriteResult) {
-                .result = writable,
-                .sent = totalSent, // return how much was actually sent
-            };
+    size_t sent = 0;
+    WriteEnum status = WRITE_WOULD_BLOCK;
+    while (!outboundPending(sock)) {
+        WriteResult result = ioBackend->transmit(sock, (const char *) buffer + sent, size - sent);
+        metricsAdd(METRIC_BYTES_SENT, result.sent);
+        sent += result.sent;
+        status = result.result;
+        if (status != WRITE_WOULD_BLOCK || sock->outbound != NULL) {
+            break;
         }
-
-        // Send up to 1 MB at a time
-        size_t packetSize = (size - totalSent) > (1 << 20) ? (1 << 20) : (size - totalSent);
-        ssize_t sent = send(sock->fd, (char*)buffer + totalSent, packetSize, 0);
-        debug("send(%d, %p, %zu, 0) return %zd", sock->fd, buffer, packetSize, sent);
-
-        if (sent == -1) {
-            perror("transmit: send");
-            sock->closed = 1;
-            return (WriteResult) {
-                .result = WRITE_SEND_ERROR,
-                .sent = totalSent,
-            };
+        if ((status = awaitWritable(sock)) != WRITE_OK) {
+            break;
         }
+    }
+    if (status == WRITE_WOULD_BLOCK) {
+        queueOutboundBytes(sock->outbound, (const char *) buffer + sent, size - sent);
+        return (WriteResult) {
+            .result = boundOutbound(sock),
+            .sent = size,
+        };
+    }
+    return (WriteResult) {
+        .result = status,
+        .sent = sent,
+    };
+}
 
-        if (sent == 0) {
-            sock->closed = 1;
-            return (WriteResult) {
-                .result = WRITE_CLOSED,
-                .sent = totalSent,
-            };
+/*
+    Sends count bytes of fd starting at offset, without copying them to user space.
+    fd is left open.
+*/
+WriteResult transmitFile(TcpSocket *sock, int fd, off_t offset, size_t count) {
+    if (sock->closed) {
+        return (WriteResult) {
+            .result = WRITE_CLOSED,
+            .sent = 0,
+        };
+    }
+    size_t sent = 0;
+    WriteEnum status = WRITE_WOULD_BLOCK;
+    while (!outboundPending(sock)) {
+        WriteResult result = ioBackend->transmitFile(sock, fd, offset + (off_t) sent, count - sent);
+        metricsAdd(METRIC_BYTES_SENT, result.sent);
+        metricsAdd(METRIC_SENDFILE_BYTES, result.sent);
+        sent += result.sent;
+        status = result.result;
+        if (status != WRITE_WOULD_BLOCK || sock->outbound != NULL) {
+            break;
+        }
+        if ((status = awaitWritable(sock)) != WRITE_OK) {
+            break;
         }
+    }
+    if (status == WRITE_WOULD_BLOCK) {
+        if (queueOutboundFile(sock->outbound, fd, offset + (off_t) sent, count - sent) == -1) {
+            return (WriteResult) {.result = WRITE_SENDFILE_ERROR, .sent = sent};
+        }
+        return (WriteResult) {.result = WRITE_OK, .sent = count};
+    }
+    return (WriteResult) {.result = status, .sent = sent};
+}
 
-        DECLARE_CURRENT_TIME(time);
-        pthread_mutex_lock(&socketLogMutex);
-        FILE *socketFile = fopen("socketLog.txt", "ab");
-        fprintf(socketFile, "\n%s Sent %zd bytes to %s\nbegin:\n", time, sent, sock->ip);
-        fwrite(buffer + totalSent, 1, sent, socketFile);
-        fclose(socketFile);
-        pthread_mutex_unlock(&socketLogMutex);
+/*
+    Sends every iov entry with as few syscalls as the socket allows.
+    iov is modified when a write is short.
+*/
+WriteResult transmitVector(TcpSocket *sock, struct iovec *iov, int iovCount) {
+    if (sock->closed) {
+        return (WriteResult) {
+            .result = WRITE_CLOSED,
+            .sent = 0,
+        };
+    }
+    size_t sent = 0;
+    WriteEnum status = WRITE_WOULD_BLOCK;
+    while (!outboundPending(sock)) {
+        WriteResult result = ioBackend->transmitVector(sock, &iov, &iovCount);
+        metricsAdd(METRIC_BYTES_SENT, result.sent);
+        sent += result.sent;
+        status = result.result;
+        if (status != WRITE_WOULD_BLOCK || sock->outbound != NULL) {
+            break;
+        }
+        if ((status = awaitWritable(sock)) != WRITE_OK) {
+            break;
+        }
+    }
+    if (status == WRITE_WOULD_BLOCK) {
+        for (int i = 0; i < iovCount; i++) {
+            queueOutboundBytes(sock->outbound, iov[i].iov_base, iov[i].iov_len);
+            sent += iov[i].iov_len;
+        }
+        return (WriteResult) {.result = boundOutbound(sock), .sent = sent};
+    }
+    return (WriteResult) {.result = status, .sent = sent};
+}
 
-        totalSent += sent;
+int consumeSentVector(TcpSocket *sock, struct iovec **iov, int iovCount, size_t sent) {
+    struct iovec *current = *iov;
+    while (iovCount > 0 && sent >= current->iov_len) {
+        logSocketTraffic(sock, 1, current->iov_base, (ssize_t) current->iov_len);
+        sent -= current->iov_len;
+        current++;
+        iovCount--;
+    }
+    if (iovCount > 0 && sent > 0) {
+        logSocketTraffic(sock, 1, current->iov_base, (ssize_t) sent);
+        current->iov_base = (char*) current->iov_base + sent;
+        current->iov_len -= sent;
     }
+    *iov = current;
+    return iovCount;
+}
 
+/*
+    Single send attempt that never waits for the socket to become writable.
+    Used where blocking would stall other connections, like the acceptor.
+*/
+WriteResult transmitOnce(TcpSocket *sock, const void *buffer, size_t size) {
+    if (sock->closed) {
+        return (WriteResult) {
+            .result = WRITE_CLOSED,
+            .sent = 0,
+        };
+    }
+    ssize_t sent = send(sock->fd, buffer, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+    debug("send(%d, %p, %zu, MSG_DONTWAIT) return %zd", sock->fd, buffer, size, sent);
+    if (sent == -1) {
+        return (WriteResult) {
+            .result = errno == EAGAIN || errno == EWOULDBLOCK ? WRITE_TIMEOUT : WRITE_SEND_ERROR,
+            .sent = 0,
+        };
+    }
+    metricsAdd(METRIC_BYTES_SENT, (size_t) sent);
     return (WriteResult) {
         .result = WRITE_OK,
-        .sent = totalSent,
+        .sent = sent,
     };
 }
 
-
 int getClientIp(int fd, char *str)
 {
     struct sockaddr_in addr;
@@ -22,6 +22,10 @@ const char* errToStr(int error) {
             return "TCP stream closed";
         case TCP_STREAM_TIMEOUT:
             return "TCP stream timeout";
+        case TCP_STREAM_WOULD_BLOCK:
+            return "TCP stream would block";
+        case EXPECTATION_FAILED_ERROR:
+            return "Expectation failed";
         default:
             return "Unknown error";
     }
@@ -0,0 +1,325 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include <file_cache.h>
+#include <alloc.h>
+#include <file_handler.h>
+#include <logging.h>
+#include <utils.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "helpers/compression_helper.h"
+
+/*
+    Chained hash table of paths plus a recency list for eviction, both behind one mutex.
+    Hits only take the mutex and read the monotonic clock, stat runs once per
+    revalidation interval and open only on a miss or after the file changed.
+    Loading, reading and compressing a file happen outside the mutex.
+*/
+
+#define DEFAULT_FILE_CACHE_CAPACITY 128
+#define DEFAULT_REVALIDATE_MS 1000
+#define DEFAULT_RESIDENT_LIMIT (64 * 1024)
+
+static pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static CachedFile **buckets = NULL;
+static unsigned int bucketCount = 0;
+static CachedFile *newest = NULL;
+static CachedFile *oldest = NULL;
+static int entryCount = 0;
+static int capacity = DEFAULT_FILE_CACHE_CAPACITY;
+static int revalidateMs = DEFAULT_REVALIDATE_MS;
+static size_t residentLimit = DEFAULT_RESIDENT_LIMIT;
+
+const char *contentEncodingToStr(ContentEncoding encoding) {
+    switch (encoding) {
+        case CONTENT_ENCODING_GZIP:
+            return "gzip";
+        case CONTENT_ENCODING_BROTLI:
+            return "br";
+        default:
+            return "identity";
+    }
+}
+
+/* Encoded representations get their own strong ETag, the identity one is the file's */
+static void setVariant(CachedFile *file, ContentEncoding encoding, char *data, size_t length) {
+    EncodedContent *variant = &file->variants[encoding];
+    variant->data = data;
+    variant->length = length;
+    if (encoding == CONTENT_ENCODING_IDENTITY) {
+        memcpy(variant->etag, file->etag, file->etagLength + 1);
+        variant->etagLength = file->etagLength;
+    } else {
+        variant->etagLength = snprintf(variant->etag, sizeof(variant->etag), "%.*s-%s\"",
+                                       (int) file->etagLength - 1, file->etag, contentEncodingToStr(encoding));
+    }
+}
+
+static void loadResident(CachedFile *file) {
+    char *data = allocate(file->size > 0 ? file->size : 1);
+    size_t loaded = 0;
+    while (loaded < (size_t) file->size) {
+        ssize_t got = pread(file->fd, data + loaded, file->size - loaded, (off_t) loaded);
+        if (got <= 0) {
+            deallocate(data);
+            return;
+        }
+        loaded += got;
+    }
+    setVariant(file, CONTENT_ENCODING_IDENTITY, data, loaded);
+    if (!isCompressibleMimeType(file->mimeType)) {
+        return;
+    }
+    size_t encodedLength;
+    char *encoded = gzipEncode(data, loaded, &encodedLength);
+    if (encoded != NULL) {
+        setVariant(file, CONTENT_ENCODING_GZIP, encoded, encodedLength);
+    }
+    encoded = brotliEncode(data, loaded, isTextMimeType(file->mimeType), &encodedLength);
+    if (encoded != NULL) {
+        setVariant(file, CONTENT_ENCODING_BROTLI, encoded, encodedLength);
+    }
+}
+
+static int sameFile(const CachedFile *file, const struct stat *st) {
+    return file->device == st->st_dev
+        && file->inode == st->st_ino
+        && file->size == st->st_size
+        && file->modified.tv_sec == st->st_mtim.tv_sec
+        && file->modified.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+static CachedFile *openCachedFile(const char *path, int resident) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int statErrno = errno;
+        close(fd);
+        errno = statErrno;
+        return NULL;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        errno = EISDIR;
+        return NULL;
+    }
+
+    size_t pathLength = strlen(path);
+    CachedFile *file = allocate(sizeof(CachedFile) + pathLength + 1);
+    file->path = (char*) (file + 1);
+    memcpy(file->path, path, pathLength + 1);
+    file->fd = fd;
+    file->size = st.st_size;
+    file->device = st.st_dev;
+    file->inode = st.st_ino;
+    file->modified = st.st_mtim;
+    long long modifiedNs = (long long) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    file->etagLength = snprintf(file->etag, sizeof(file->etag), "\"%lx-%llx-%llx\"",
+                                (unsigned long) st.st_ino, (unsigned long long) st.st_size, (unsigned long long) modifiedNs);
+    struct tm modifiedTm;
+    gmtime_r(&st.st_mtim.tv_sec, &modifiedTm);
+    strftime(file->lastModified, sizeof(file->lastModified), "%a, %d %b %Y %H:%M:%S GMT", &modifiedTm);
+    file->mimeType = getMimeType(getExtension(file->path));
+    memset(file->variants, 0, sizeof(file->variants));
+    if (resident && (size_t) st.st_size <= residentLimit) {
+        loadResident(file);
+    }
+    atomic_init(&file->refs, 1);
+    atomic_init(&file->checkedAtMs, getMonotonicTimeMs());
+    file->nextInBucket = NULL;
+    file->newer = NULL;
+    file->older = NULL;
+    return file;
+}
+
+void releaseCachedFile(CachedFile *file) {
+    if (file == NULL) {
+        return;
+    }
+    if (atomic_fetch_sub_explicit(&file->refs, 1, memory_order_acq_rel) == 1) {
+        debug("Closing cached file %s", file->path);
+        for (int i = 0; i < CONTENT_ENCODING_COUNT; i++) {
+            deallocate(file->variants[i].data);
+        }
+        close(file->fd);
+        deallocate(file);
+    }
+}
+
+static unsigned int bucketOf(const char *path) {
+    return hash((void*) path, (int) strlen(path)) & (bucketCount - 1);
+}
+
+static void unlinkRecency(CachedFile *file) {
+    if (file->newer != NULL) {
+        file->newer->older = file->older;
+    } else {
+        newest = file->older;
+    }
+    if (file->older != NULL) {
+        file->older->newer = file->newer;
+    } else {
+        oldest = file->newer;
+    }
+    file->newer = NULL;
+    file->older = NULL;
+}
+
+static void pushNewest(CachedFile *file) {
+    file->older = newest;
+    file->newer = NULL;
+    if (newest != NULL) {
+        newest->newer = file;
+    }
+    newest = file;
+    if (oldest == NULL) {
+        oldest = file;
+    }
+}
+
+/* Unlinks the entry and drops the cache's reference */
+static void removeEntry(CachedFile *file) {
+    CachedFile **link = &buckets[bucketOf(file->path)];
+    while (*link != file) {
+        link = &(*link)->nextInBucket;
+    }
+    *link = file->nextInBucket;
+    unlinkRecency(file);
+    entryCount--;
+    releaseCachedFile(file);
+}
+
+static void insertEntry(CachedFile *file) {
+    if (buckets == NULL) {
+        bucketCount = 16;
+        while (bucketCount < (unsigned int) capacity * 2) {
+            bucketCount *= 2;
+        }
+        buckets = allocate(sizeof(CachedFile*) * bucketCount);
+        memset(buckets, 0, sizeof(CachedFile*) * bucketCount);
+    }
+    while (entryCount >= capacity && oldest != NULL) {
+        removeEntry(oldest);
+    }
+    unsigned int bucket = bucketOf(file->path);
+    file->nextInBucket = buckets[bucket];
+    buckets[bucket] = file;
+    pushNewest(file);
+    entryCount++;
+    atomic_fetch_add_explicit(&file->refs, 1, memory_order_relaxed);
+}
+
+static CachedFile *lookupEntry(const char *path) {
+    if (buckets == NULL) {
+        return NULL;
+    }
+    for (CachedFile *file = buckets[bucketOf(path)]; file != NULL; file = file->nextInBucket) {
+        if (strcmp(file->path, path) == 0) {
+            return file;
+        }
+    }
+    return NULL;
+}
+
+/* Takes a reference for the caller, the mutex is held */
+static CachedFile *touchEntry(CachedFile *file) {
+    unlinkRecency(file);
+    pushNewest(file);
+    atomic_fetch_add_explicit(&file->refs, 1, memory_order_relaxed);
+    return file;
+}
+
+CachedFile *acquireCachedFile(const char *path) {
+    if (capacity <= 0) {
+        return openCachedFile(path, 0);
+    }
+
+    pthread_mutex_lock(&cacheMutex);
+    CachedFile *file = lookupEntry(path);
+    if (file != NULL) {
+        long long now = getMonotonicTimeMs();
+        if (now - atomic_load_explicit(&file->checkedAtMs, memory_order_relaxed) < revalidateMs) {
+            touchEntry(file);
+            pthread_mutex_unlock(&cacheMutex);
+            return file;
+        }
+        struct stat st;
+        if (stat(path, &st) == 0 && sameFile(file, &st)) {
+            atomic_store_explicit(&file->checkedAtMs, now, memory_order_relaxed);
+            touchEntry(file);
+            pthread_mutex_unlock(&cacheMutex);
+            return file;
+        }
+        debug("Cached file %s changed, reopening", path);
+        removeEntry(file);
+    }
+    pthread_mutex_unlock(&cacheMutex);
+
+    CachedFile *loaded = openCachedFile(path, 1);
+    if (loaded == NULL) {
+        return NULL;
+    }
+
+    /* another thread may have loaded the same path meanwhile */
+    pthread_mutex_lock(&cacheMutex);
+    CachedFile *existing = lookupEntry(path);
+    if (existing != NULL) {
+        struct stat st = {
+            .st_dev = loaded->device,
+            .st_ino = loaded->inode,
+            .st_size = loaded->size,
+            .st_mtim = loaded->modified,
+        };
+        if (sameFile(existing, &st)) {
+            touchEntry(existing);
+            pthread_mutex_unlock(&cacheMutex);
+            releaseCachedFile(loaded);
+            return existing;
+        }
+        removeEntry(existing);
+    }
+    insertEntry(loaded);
+    pthread_mutex_unlock(&cacheMutex);
+    return loaded;
+}
+
+void clearFileCache() {
+    pthread_mutex_lock(&cacheMutex);
+    while (oldest != NULL) {
+        removeEntry(oldest);
+    }
+    pthread_mutex_unlock(&cacheMutex);
+}
+
+/* Not thread safe with senders, call before the server starts */
+void setFileCacheCapacity(int entries) {
+    clearFileCache();
+    pthread_mutex_lock(&cacheMutex);
+    deallocate(buckets);
+    buckets = NULL;
+    bucketCount = 0;
+    capacity = entries;
+    pthread_mutex_unlock(&cacheMutex);
+}
+
+void setFileCacheRevalidateMs(int ms) {
+    revalidateMs = ms;
+}
+
+/* Entries already loaded keep their bytes */
+void setFileCacheResidentLimit(size_t bytes) {
+    residentLimit = bytes;
+}
@@ -10,69 +10,70 @@
 typedef struct {
     const char *ext;
     const char *mime;
+    int compressible;
 } MimeMapping;
 
 static const MimeMapping mime_mappings[] = {
     // Documents
-    { "txt",  "text/plain" },
-    { "html", "text/html" },
-    { "htm",  "text/html" },
-    { "css",  "text/css" },
-    { "csv",  "text/csv" },
-    { "xml",  "application/xml" },
-    { "json", "application/json" },
-    { "pdf",  "application/pdf" },
-    { "doc",  "application/msword" },
-    { "docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document" },
-    { "xls",  "application/vnd.ms-excel" },
-    { "xlsx", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet" },
-    { "ppt",  "application/vnd.ms-powerpoint" },
-    { "pptx", "application/vnd.openxmlformats-officedocument.presentationml.presentation" },
+    { "txt",  "text/plain", 1 },
+    { "html", "text/html", 1 },
+    { "htm",  "text/html", 1 },
+    { "css",  "text/css", 1 },
+    { "csv",  "text/csv", 1 },
+    { "xml",  "application/xml", 1 },
+    { "json", "application/json", 1 },
+    { "pdf",  "application/pdf", 0 },
+    { "doc",  "application/msword", 0 },
+    { "docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document", 0 },
+    { "xls",  "application/vnd.ms-excel", 0 },
+    { "xlsx", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet", 0 },
+    { "ppt",  "application/vnd.ms-powerpoint", 0 },
+    { "pptx", "application/vnd.openxmlformats-officedocument.presentationml.presentation", 0 },
 
     // Images
-    { "jpg",  "image/jpeg" },
-    { "jpeg", "image/jpeg" },
-    { "png",  "image/png" },
-    { "gif",  "image/gif" },
-    { "bmp",  "image/bmp" },
-    { "webp", "image/webp" },
-    { "tif",  "image/tiff" },
-    { "tiff", "image/tiff" },
-    { "svg",  "image/svg+xml" },
-    { "ico",  "image/x-icon" },
+    { "jpg",  "image/jpeg", 0 },
+    { "jpeg", "image/jpeg", 0 },
+    { "png",  "image/png", 0 },
+    { "gif",  "image/gif", 0 },
+    { "bmp",  "image/bmp", 1 },
+    { "webp", "image/webp", 0 },
+    { "tif",  "image/tiff", 0 },
+    { "tiff", "image/tiff", 0 },
+    { "svg",  "image/svg+xml", 1 },
+    { "ico",  "image/x-icon", 1 },
 
     // Audio
-    { "mp3",  "audio/mpeg" },
-    { "wav",  "audio/wav" },
-    { "ogg",  "audio/ogg" },
-    { "flac", "audio/flac" },
-    { "aac",  "audio/aac" },
-    { "m4a",  "audio/mp4" },
+    { "mp3",  "audio/mpeg", 0 },
+    { "wav",  "audio/wav", 0 },
+    { "ogg",  "audio/ogg", 0 },
+    { "flac", "audio/flac", 0 },
+    { "aac",  "audio/aac", 0 },
+    { "m4a",  "audio/mp4", 0 },
 
     // Video
-    { "mp4",  "video/mp4" },
-    { "webm", "video/webm" },
-    { "ogv",  "video/ogg" },
-    { "mov",  "video/quicktime" },
-    { "avi",  "video/x-msvideo" },
-    { "mkv",  "video/x-matroska" },
-    { "flv",  "video/x-flv" },
-    { "wmv",  "video/x-ms-wmv" },
+    { "mp4",  "video/mp4", 0 },
+    { "webm", "video/webm", 0 },
+    { "ogv",  "video/ogg", 0 },
+    { "mov",  "video/quicktime", 0 },
+    { "avi",  "video/x-msvideo", 0 },
+    { "mkv",  "video/x-matroska", 0 },
+    { "flv",  "video/x-flv", 0 },
+    { "wmv",  "video/x-ms-wmv", 0 },
 
     // Archives / Binary
-    { "zip",  "application/zip" },
-    { "tar",  "application/x-tar" },
-    { "gz",   "application/gzip" },
-    { "rar",  "application/vnd.rar" },
-    { "7z",   "application/x-7z-compressed" },
-    { "exe",  "application/vnd.microsoft.portable-executable" },
-    { "bin",  "application/octet-stream" },
-    { "iso",  "application/x-iso9660-image" },
+    { "zip",  "application/zip", 0 },
+    { "tar",  "application/x-tar", 0 },
+    { "gz",   "application/gzip", 0 },
+    { "rar",  "application/vnd.rar", 0 },
+    { "7z",   "application/x-7z-compressed", 0 },
+    { "exe",  "application/vnd.microsoft.portable-executable", 0 },
+    { "bin",  "application/octet-stream", 0 },
+    { "iso",  "application/x-iso9660-image", 0 },
 
     // Web / Scripts
-    { "js",   "application/javascript" },
-    { "mjs",  "text/javascript" },
-    { "wasm", "application/wasm" }
+    { "js",   "application/javascript", 1 },
+    { "mjs",  "text/javascript", 1 },
+    { "wasm", "application/wasm", 1 }
 };
 
 static const size_t mime_mappings_count = sizeof(mime_mappings) / sizeof(mime_mappings[0]);
@@ -104,3 +105,29 @@ const char* getMimeType(const char *extension) {
 
     return defaultMimeType;
 }
+
+/* Text formats shrink under gzip and brotli, media and archives are already compressed */
+int isCompressibleMimeType(const char *mimeType) {
+    if (mimeType == NULL) {
+        return 0;
+    }
+    for (size_t i = 0; i < mime_mappings_count; i++) {
+        if (strcmp(mimeType, mime_mappings[i].mime) == 0) {
+            return mime_mappings[i].compressible;
+        }
+    }
+    return 0;
+}
+
+/* Types under text/, scripts and the json and xml families, including suffixes like image/svg+xml */
+int isTextMimeType(const char *mimeType) {
+    if (mimeType == NULL) {
+        return 0;
+    }
+    if (strncmp(mimeType, "text/", 5) == 0) {
+        return 1;
+    }
+    return strstr(mimeType, "json") != NULL
+        || strstr(mimeType, "xml") != NULL
+        || strstr(mimeType, "javascript") != NULL;
+}
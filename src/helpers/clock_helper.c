@@ -0,0 +1,101 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#define _GNU_SOURCE
+#include "clock_helper.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+/*
+    Time strings only change once per second, so they are formatted by the first
+    thread that notices a new second and published with an atomic pointer swap.
+    Everyone else copies the published strings, the clock read is a vDSO call.
+*/
+
+#define CLOCK_SECOND_SLOTS 4
+#define LOG_SECOND_LENGTH 19
+
+typedef struct ClockSecond {
+    time_t second;
+    char httpDate[HTTP_DATE_LENGTH + 1];
+    char logSecond[LOG_SECOND_LENGTH + 1];
+} ClockSecond;
+
+/* Readers copy out of a slot right away, a slot is only rewritten CLOCK_SECOND_SLOTS seconds after it was published */
+static ClockSecond slots[CLOCK_SECOND_SLOTS];
+static unsigned int nextSlot = 0;
+static _Atomic(ClockSecond *) published = NULL;
+static atomic_flag refreshing = ATOMIC_FLAG_INIT;
+/* Used when the first second of the process is being formatted by another thread */
+static _Thread_local ClockSecond startupSecond;
+
+static void formatSecond(ClockSecond *clockSecond, time_t second) {
+    struct tm tm;
+    gmtime_r(&second, &tm);
+    strftime(clockSecond->httpDate, sizeof(clockSecond->httpDate), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    strftime(clockSecond->logSecond, sizeof(clockSecond->logSecond), "%Y-%m-%d %H:%M:%S", &tm);
+    clockSecond->second = second;
+}
+
+static const ClockSecond *currentSecond(struct timespec *now) {
+    clock_gettime(CLOCK_REALTIME_COARSE, now);
+    ClockSecond *clockSecond = atomic_load_explicit(&published, memory_order_acquire);
+    if (clockSecond != NULL && clockSecond->second == now->tv_sec) {
+        return clockSecond;
+    }
+    if (atomic_flag_test_and_set_explicit(&refreshing, memory_order_acquire)) {
+        if (clockSecond != NULL) {
+            /* a second old for the few calls racing the refresh */
+            return clockSecond;
+        }
+        formatSecond(&startupSecond, now->tv_sec);
+        return &startupSecond;
+    }
+    ClockSecond *next = &slots[nextSlot];
+    nextSlot = (nextSlot + 1) % CLOCK_SECOND_SLOTS;
+    formatSecond(next, now->tv_sec);
+    atomic_store_explicit(&published, next, memory_order_release);
+    atomic_flag_clear_explicit(&refreshing, memory_order_release);
+    return next;
+}
+
+void getHttpDate(char *out) {
+    struct timespec now;
+    memcpy(out, currentSecond(&now)->httpDate, HTTP_DATE_LENGTH);
+}
+
+static size_t writeLogTime(const char *logSecond, long nanoseconds, char *out, size_t size) {
+    if (size < LOG_TIME_LENGTH + 1) {
+        if (size > 0) {
+            out[0] = '\0';
+        }
+        return 0;
+    }
+    memcpy(out, logSecond, LOG_SECOND_LENGTH);
+    long milliseconds = nanoseconds / 1000000;
+    out[LOG_SECOND_LENGTH] = '.';
+    out[LOG_SECOND_LENGTH + 1] = (char) ('0' + milliseconds / 100);
+    out[LOG_SECOND_LENGTH + 2] = (char) ('0' + milliseconds / 10 % 10);
+    out[LOG_SECOND_LENGTH + 3] = (char) ('0' + milliseconds % 10);
+    out[LOG_TIME_LENGTH] = '\0';
+    return LOG_TIME_LENGTH;
+}
+
+size_t getLogTime(char *out, size_t size) {
+    struct timespec now;
+    const ClockSecond *clockSecond = currentSecond(&now);
+    return writeLogTime(clockSecond->logSecond, now.tv_nsec, out, size);
+}
+
+size_t formatLogTime(const struct timespec *time, char *out, size_t size) {
+    ClockSecond *clockSecond = atomic_load_explicit(&published, memory_order_acquire);
+    if (clockSecond != NULL && clockSecond->second == time->tv_sec) {
+        return writeLogTime(clockSecond->logSecond, time->tv_nsec, out, size);
+    }
+    ClockSecond other;
+    formatSecond(&other, time->tv_sec);
+    return writeLogTime(other.logSecond, time->tv_nsec, out, size);
+}
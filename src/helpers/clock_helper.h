@@ -0,0 +1,23 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_CLOCK_HELPER_H
+#define HTTPSERVERC_CLOCK_HELPER_H
+
+#include <stddef.h>
+#include <time.h>
+
+/* "Sun, 06 Nov 1994 08:49:37 GMT" */
+#define HTTP_DATE_LENGTH 29
+/* "1994-11-06 08:49:37.123" */
+#define LOG_TIME_LENGTH 23
+
+/* IMF-fixdate of the current second for the Date header, out needs HTTP_DATE_LENGTH bytes and is not terminated */
+void getHttpDate(char *out);
+/* UTC log timestamp with milliseconds, returns 0 if size is below LOG_TIME_LENGTH + 1 */
+size_t getLogTime(char *out, size_t size);
+/* The same for a timestamp taken earlier, for records formatted after the fact */
+size_t formatLogTime(const struct timespec *time, char *out, size_t size);
+
+#endif //HTTPSERVERC_CLOCK_HELPER_H
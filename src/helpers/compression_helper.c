@@ -0,0 +1,71 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "compression_helper.h"
+
+#include <alloc.h>
+
+#ifdef HTTPSERVERC_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HTTPSERVERC_WITH_BROTLI
+#include <brotli/encode.h>
+#endif
+
+/* Encoding runs once per cached file, so both use their best ratio */
+
+char *gzipEncode(const char *data, size_t length, size_t *encodedLength) {
+#ifdef HTTPSERVERC_WITH_ZLIB
+    z_stream stream = {0};
+    /* 16 added to the window bits writes a gzip wrapper instead of zlib */
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+    size_t bound = deflateBound(&stream, length);
+    char *encoded = allocate(bound);
+    stream.next_in = (Bytef*) data;
+    stream.avail_in = (uInt) length;
+    stream.next_out = (Bytef*) encoded;
+    stream.avail_out = (uInt) bound;
+    int status = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END || stream.total_out >= length) {
+        deallocate(encoded);
+        return NULL;
+    }
+    *encodedLength = stream.total_out;
+    return encoded;
+#else
+    (void) data;
+    (void) length;
+    (void) encodedLength;
+    return NULL;
+#endif
+}
+
+char *brotliEncode(const char *data, size_t length, int text, size_t *encodedLength) {
+#ifdef HTTPSERVERC_WITH_BROTLI
+    size_t bound = BrotliEncoderMaxCompressedSize(length);
+    if (bound == 0) {
+        return NULL;
+    }
+    char *encoded = allocate(bound);
+    size_t written = bound;
+    BrotliEncoderMode mode = text ? BROTLI_MODE_TEXT : BROTLI_MODE_GENERIC;
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, mode,
+                               length, (const uint8_t*) data, &written, (uint8_t*) encoded)
+        || written >= length) {
+        deallocate(encoded);
+        return NULL;
+    }
+    *encodedLength = written;
+    return encoded;
+#else
+    (void) data;
+    (void) length;
+    (void) text;
+    (void) encodedLength;
+    return NULL;
+#endif
+}
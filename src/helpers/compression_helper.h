@@ -0,0 +1,18 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_COMPRESSION_HELPER_H
+#define HTTPSERVERC_COMPRESSION_HELPER_H
+
+#include <stddef.h>
+
+/*
+    Both return a buffer from allocate() the caller deallocates, or NULL when the
+    encoder was not built in, failed, or the result would not be smaller than data.
+    Brotli tunes its context modeling for UTF-8 when text is set, binary data is encoded generically.
+*/
+char *gzipEncode(const char *data, size_t length, size_t *encodedLength);
+char *brotliEncode(const char *data, size_t length, int text, size_t *encodedLength);
+
+#endif //HTTPSERVERC_COMPRESSION_HELPER_H
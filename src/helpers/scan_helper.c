@@ -0,0 +1,152 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "scan_helper.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCAN_HAS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+typedef size_t (*ScanFunction)(const char *data, size_t length, const char *set, size_t setSize);
+
+static size_t scanTail(const char *data, size_t offset, size_t length, const char *set, size_t setSize) {
+    for (; offset < length; offset++) {
+        for (size_t i = 0; i < setSize; i++) {
+            if (data[offset] == set[i]) {
+                return offset;
+            }
+        }
+    }
+    return length;
+}
+
+static size_t scanScalar(const char *data, size_t length, const char *set, size_t setSize) {
+    if (setSize == 1) {
+        const char *found = memchr(data, set[0], length);
+        return found == NULL ? length : (size_t) (found - data);
+    }
+    return scanTail(data, 0, length, set, setSize);
+}
+
+#ifdef SCAN_HAS_X86_KERNELS
+
+/* One pcmpestri per 16 bytes, the set is matched as a list of bytes like picohttpparser matches ranges */
+__attribute__((target("sse4.2")))
+static size_t scanSse42(const char *data, size_t length, const char *set, size_t setSize) {
+    char setBytes[16] = {0};
+    memcpy(setBytes, set, setSize);
+    const __m128i setVector = _mm_loadu_si128((const __m128i *) setBytes);
+    size_t offset = 0;
+    for (; offset + 16 <= length; offset += 16) {
+        const __m128i block = _mm_loadu_si128((const __m128i *) (data + offset));
+        int index = _mm_cmpestri(setVector, (int) setSize, block, 16,
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+        if (index != 16) {
+            return offset + index;
+        }
+    }
+    return scanTail(data, offset, length, set, setSize);
+}
+
+/* Delimiter sets are a few bytes, one compare per set byte over 32 bytes is cheaper than pcmpestri */
+__attribute__((target("avx2")))
+static size_t scanAvx2(const char *data, size_t length, const char *set, size_t setSize) {
+    __m256i setVectors[SCAN_MAX_SET_SIZE];
+    for (size_t i = 0; i < setSize; i++) {
+        setVectors[i] = _mm256_set1_epi8(set[i]);
+    }
+    size_t offset = 0;
+    for (; offset + 32 <= length; offset += 32) {
+        const __m256i block = _mm256_loadu_si256((const __m256i *) (data + offset));
+        __m256i matches = _mm256_cmpeq_epi8(block, setVectors[0]);
+        for (size_t i = 1; i < setSize; i++) {
+            matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(block, setVectors[i]));
+        }
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8(matches);
+        if (mask != 0) {
+            return offset + __builtin_ctz(mask);
+        }
+    }
+    return scanTail(data, offset, length, set, setSize);
+}
+
+#endif
+
+static ScanKernel kernel = SCAN_KERNEL_SCALAR;
+static ScanFunction scanFunction = scanScalar;
+static pthread_once_t detectOnce = PTHREAD_ONCE_INIT;
+
+static int kernelSupported(ScanKernel candidate) {
+    switch (candidate) {
+        case SCAN_KERNEL_SCALAR:
+            return 1;
+#ifdef SCAN_HAS_X86_KERNELS
+        case SCAN_KERNEL_SSE42:
+            return __builtin_cpu_supports("sse4.2");
+        case SCAN_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return 0;
+    }
+}
+
+static void useKernel(ScanKernel selected) {
+    kernel = selected;
+    switch (selected) {
+#ifdef SCAN_HAS_X86_KERNELS
+        case SCAN_KERNEL_SSE42:
+            scanFunction = scanSse42;
+            break;
+        case SCAN_KERNEL_AVX2:
+            scanFunction = scanAvx2;
+            break;
+#endif
+        default:
+            scanFunction = scanScalar;
+            break;
+    }
+}
+
+static void detectKernel() {
+#ifdef SCAN_HAS_X86_KERNELS
+    __builtin_cpu_init();
+#endif
+    if (kernelSupported(SCAN_KERNEL_AVX2)) {
+        useKernel(SCAN_KERNEL_AVX2);
+    } else if (kernelSupported(SCAN_KERNEL_SSE42)) {
+        useKernel(SCAN_KERNEL_SSE42);
+    } else {
+        useKernel(SCAN_KERNEL_SCALAR);
+    }
+}
+
+size_t scanForAny(const char *data, size_t length, const char *set, size_t setSize) {
+    pthread_once(&detectOnce, detectKernel);
+    if (setSize == 0) {
+        return length;
+    }
+    if (setSize > SCAN_MAX_SET_SIZE) {
+        return scanTail(data, 0, length, set, setSize);
+    }
+    return scanFunction(data, length, set, setSize);
+}
+
+ScanKernel getScanKernel() {
+    pthread_once(&detectOnce, detectKernel);
+    return kernel;
+}
+
+int selectScanKernel(ScanKernel selected) {
+    pthread_once(&detectOnce, detectKernel);
+    if (!kernelSupported(selected)) {
+        return -1;
+    }
+    useKernel(selected);
+    return 0;
+}
@@ -0,0 +1,29 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_SCAN_HELPER_H
+#define HTTPSERVERC_SCAN_HELPER_H
+
+#include <stddef.h>
+
+/* Largest delimiter set a vector kernel compares at once, bigger sets are scanned byte by byte */
+#define SCAN_MAX_SET_SIZE 16
+
+typedef enum ScanKernel {
+    SCAN_KERNEL_SCALAR,
+    SCAN_KERNEL_SSE42,
+    SCAN_KERNEL_AVX2,
+} ScanKernel;
+
+/*
+    Returns the offset of the first byte of data equal to any byte of set, or length if there is none.
+    The kernel is picked from the CPU features on first use.
+*/
+size_t scanForAny(const char *data, size_t length, const char *set, size_t setSize);
+/* Kernel used by scanForAny */
+ScanKernel getScanKernel();
+/* Forces a kernel, returns -1 if the CPU does not support it */
+int selectScanKernel(ScanKernel kernel);
+
+#endif //HTTPSERVERC_SCAN_HELPER_H
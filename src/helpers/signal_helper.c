@@ -4,6 +4,7 @@
 
 #include "signal_helper.h"
 
+#include <errno.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,3 +33,23 @@ void setupSignalHandlers() {
     setupSegfaultHandler();
     signal(SIGPIPE, SIG_IGN);
 }
+
+static void (*shutdownCallback)();
+
+static void shutdownHandler(int sig) {
+    (void) sig;
+    int savedErrno = errno;
+    shutdownCallback();
+    errno = savedErrno;
+}
+
+void setupShutdownHandlers(void (*onShutdown)()) {
+    shutdownCallback = onShutdown;
+    struct sigaction sa;
+    sa.sa_handler = shutdownHandler;
+    sa.sa_flags = 0;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGINT, &sa, NULL) == -1 || sigaction(SIGTERM, &sa, NULL) == -1) {
+        perror("sigaction");
+    }
+}
@@ -6,5 +6,7 @@
 #define HTTPSERVERC_SIGNAL_HELPER_H
 
 void setupSignalHandlers();
+/* SIGINT and SIGTERM call onShutdown, which must be async signal safe */
+void setupShutdownHandlers(void (*onShutdown)());
 
 #endif //HTTPSERVERC_SIGNAL_HELPER_H
\ No newline at end of file
@@ -0,0 +1,29 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#define _GNU_SOURCE
+#include "thread_helper.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+int getCoreCount() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int) cores : 1;
+}
+
+int pinCurrentThreadToCore(int index) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % getCoreCount(), &set);
+    int status = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (status != 0) {
+        fprintf(stderr, "pinCurrentThreadToCore: pthread_setaffinity_np; %s\n", strerror(status));
+        return -1;
+    }
+    return 0;
+}
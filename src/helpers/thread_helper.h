@@ -0,0 +1,12 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_THREAD_HELPER_H
+#define HTTPSERVERC_THREAD_HELPER_H
+
+int getCoreCount();
+/* Pins the calling thread to core index % getCoreCount() */
+int pinCurrentThreadToCore(int index);
+
+#endif //HTTPSERVERC_THREAD_HELPER_H
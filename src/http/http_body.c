@@ -0,0 +1,305 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include <errors.h>
+#include <http_body.h>
+#include <http_version.h>
+#include <limits.h>
+#include <logging.h>
+#include <string.h>
+#include <strings.h>
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define DISCARD_BUFFER_SIZE 4096
+
+long findContentLength(HttpHeaders *headers);
+
+static int headerIs(const HttpHeader *header, const char *value) {
+    size_t length = strlen(value);
+    return header->value.length == (ssize_t) length && strncasecmp(header->value.ptr, value, length) == 0;
+}
+
+/* Hex digits up to the end of the line or a chunk extension, -1 for anything else or an overflow */
+static long parseChunkSize(const char *line, size_t length) {
+    long size = 0;
+    size_t i = 0;
+    for (; i < length; i++) {
+        char c = line[i];
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            digit = (c | 0x20) - 'a' + 10;
+        } else {
+            break;
+        }
+        if (size > (LONG_MAX - digit) / 16) {
+            return -1;
+        }
+        size = size * 16 + digit;
+    }
+    if (i == 0) {
+        return -1;
+    }
+    while (i < length && (line[i] == ' ' || line[i] == '\t')) {
+        i++;
+    }
+    return i == length || line[i] == ';' ? size : -1;
+}
+
+/* Too long framing lines are malformed requests, not large entities */
+static int framingError(ssize_t error) {
+    return error == ENTITY_TOO_LARGE_ERROR ? BAD_REQUEST_ERROR : (int) error;
+}
+
+static long readChunkSize(TcpStream *stream) {
+    string line = tcpStreamReadUntilCRLF(stream, CHUNK_LINE_MAX, 0);
+    if (line.length < 0) {
+        return framingError(line.length);
+    }
+    long size = parseChunkSize(line.ptr, line.length);
+    return size < 0 ? BAD_REQUEST_ERROR : size;
+}
+
+static int readChunkEnd(TcpStream *stream) {
+    string line = tcpStreamReadUntilCRLF(stream, 0, 0);
+    return line.length < 0 ? framingError(line.length) : 0;
+}
+
+static int skipTrailers(TcpStream *stream) {
+    for (int i = 0; i <= CHUNK_TRAILERS_MAX; i++) {
+        string line = tcpStreamReadUntilCRLF(stream, CHUNK_LINE_MAX, 0);
+        if (line.length <= 0) {
+            return framingError(line.length);
+        }
+    }
+    return BAD_REQUEST_ERROR;
+}
+
+int prepareRequestBody(HttpBody *body, HttpReq *req, TcpStream *stream, long maxSize) {
+    *body = (HttpBody) {
+        .stream = stream,
+        .framing = BODY_FRAMING_NONE,
+        .maxSize = maxSize,
+        .base = stream->cursor,
+        .finished = 1,
+    };
+    req->body = body;
+    req->content = NULL;
+    req->contentLength = 0;
+    req->raw = stream->buffer + stream->start;
+    req->rawLength = stream->cursor - stream->start;
+
+    HttpHeader *transferEncoding = getHeader(&req->headers, HEADER_TRANSFER_ENCODING);
+    if (transferEncoding != NULL) {
+        /* both headers at once is how requests are smuggled past proxies */
+        if (getHeader(&req->headers, HEADER_CONTENT_LENGTH) != NULL || !headerIs(transferEncoding, "chunked")) {
+            return BAD_REQUEST_ERROR;
+        }
+        body->framing = BODY_FRAMING_CHUNKED;
+        body->finished = 0;
+        req->contentLength = -1;
+    } else {
+        long contentLength = findContentLength(&req->headers);
+        if (contentLength < 0) {
+            return BAD_REQUEST_ERROR;
+        }
+        if (maxSize > 0 && contentLength > maxSize) {
+            return ENTITY_TOO_LARGE_ERROR;
+        }
+        if (contentLength > 0) {
+            body->framing = BODY_FRAMING_LENGTH;
+            body->remaining = contentLength;
+            body->finished = 0;
+            req->contentLength = contentLength;
+        }
+    }
+
+    HttpHeader *expect = getHeader(&req->headers, HEADER_EXPECT);
+    if (expect != NULL) {
+        if (!headerIs(expect, "100-continue")) {
+            return EXPECTATION_FAILED_ERROR;
+        }
+        body->expectContinue = !body->finished && getVersionNumber(req->version.ptr, (int) req->version.length) >= 11;
+    }
+    return 0;
+}
+
+/*
+    The chunks are only validated until the last one arrived, a non blocking stream
+    may still rewind and reparse the request. Then the data is moved over the framing.
+*/
+static int bufferChunkedBody(HttpBody *body, HttpReq *req) {
+    TcpStream *stream = body->stream;
+    long total = 0;
+    for (;;) {
+        long size = readChunkSize(stream);
+        if (size < 0) {
+            return (int) size;
+        }
+        if (size == 0) {
+            break;
+        }
+        if (body->maxSize > 0 && size > body->maxSize - total) {
+            return ENTITY_TOO_LARGE_ERROR;
+        }
+        if (tcpStreamReadSlice(stream, size) == NULL) {
+            return stream->error;
+        }
+        int result = readChunkEnd(stream);
+        if (result < 0) {
+            return result;
+        }
+        total += size;
+    }
+    int result = skipTrailers(stream);
+    if (result < 0) {
+        return result;
+    }
+
+    char *buffer = stream->buffer;
+    size_t read = body->base;
+    size_t write = body->base;
+    for (;;) {
+        const char *lineEnd = memchr(buffer + read, '\r', stream->cursor - read);
+        long size = parseChunkSize(buffer + read, lineEnd - (buffer + read));
+        read = lineEnd - buffer + 2;
+        if (size == 0) {
+            break;
+        }
+        memmove(buffer + write, buffer + read, size);
+        write += size;
+        read += size + 2;
+    }
+    body->content = total > 0 ? buffer + body->base : NULL;
+    req->contentLength = total;
+    return 0;
+}
+
+int bufferRequestBody(HttpBody *body, HttpReq *req) {
+    TcpStream *stream = body->stream;
+    if (body->framing == BODY_FRAMING_LENGTH) {
+        body->content = tcpStreamReadSlice(stream, body->remaining);
+        if (body->content == NULL) {
+            if (stream->error == TCP_STREAM_ERROR) {
+                error("Error Fetching Content: %s\n", errToStr(stream->error));
+            }
+            return stream->error;
+        }
+        req->rawLength = stream->cursor - stream->start;
+    } else if (body->framing == BODY_FRAMING_CHUNKED) {
+        int result = bufferChunkedBody(body, req);
+        if (result < 0) {
+            return result;
+        }
+    }
+    body->framing = BODY_FRAMING_BUFFERED;
+    body->remaining = req->contentLength;
+    body->expectContinue = 0;
+    body->finished = 1;
+    req->content = (void*) body->content;
+    return 0;
+}
+
+int sendContinue(HttpBody *body) {
+    static const char continueResponse[] = "HTTP/1.1 100 Continue\r\n\r\n";
+    body->expectContinue = 0;
+    WriteResult result = transmit(body->stream->socket, continueResponse, sizeof(continueResponse) - 1);
+    if (writeAccepted(result.result)) {
+        return 0;
+    }
+    return result.result == WRITE_TIMEOUT ? TCP_STREAM_TIMEOUT : TCP_STREAM_CLOSED;
+}
+
+/* Moves to the next chunk once the current one was read, the last one finishes the body */
+static int nextChunk(HttpBody *body) {
+    TcpStream *stream = body->stream;
+    tcpStreamTruncate(stream, body->base);
+    if (body->chunkEnded) {
+        int result = readChunkEnd(stream);
+        if (result < 0) {
+            return result;
+        }
+        body->chunkEnded = 0;
+    }
+    long size = readChunkSize(stream);
+    if (size < 0) {
+        return (int) size;
+    }
+    if (size == 0) {
+        int result = skipTrailers(stream);
+        if (result < 0) {
+            return result;
+        }
+        body->finished = 1;
+        return 0;
+    }
+    if (body->maxSize > 0 && size > body->maxSize - body->received) {
+        return ENTITY_TOO_LARGE_ERROR;
+    }
+    body->remaining = size;
+    return 0;
+}
+
+static ssize_t receiveBody(HttpBody *body, void *buffer, size_t size) {
+    if (body->expectContinue) {
+        int result = sendContinue(body);
+        if (result < 0) {
+            return result;
+        }
+    }
+    if (body->framing == BODY_FRAMING_CHUNKED && body->remaining == 0) {
+        int result = nextChunk(body);
+        if (result < 0 || body->finished) {
+            return result;
+        }
+    }
+
+    tcpStreamTruncate(body->stream, body->base);
+    ssize_t got = tcpStreamReadInto(body->stream, buffer, MIN(size, (size_t) body->remaining));
+    if (got < 0) {
+        return got;
+    }
+    body->received += got;
+    body->remaining -= got;
+    if (body->remaining == 0) {
+        body->chunkEnded = body->framing == BODY_FRAMING_CHUNKED;
+        body->finished = body->framing == BODY_FRAMING_LENGTH;
+    }
+    return got;
+}
+
+/* A failed read leaves the framing unknown, every later read fails the same way */
+ssize_t readRequestBody(HttpBody *body, void *buffer, size_t size) {
+    if (body->framing == BODY_FRAMING_BUFFERED) {
+        size_t copied = MIN(size, (size_t) body->remaining);
+        memcpy(buffer, body->content + body->received, copied);
+        body->received += (long) copied;
+        body->remaining -= (long) copied;
+        return (ssize_t) copied;
+    }
+    if (body->error < 0) {
+        return body->error;
+    }
+    if (body->finished || size == 0) {
+        return 0;
+    }
+    ssize_t got = receiveBody(body, buffer, size);
+    if (got < 0) {
+        body->error = (int) got;
+    }
+    return got;
+}
+
+int discardRequestBody(HttpBody *body) {
+    char buffer[DISCARD_BUFFER_SIZE];
+    ssize_t got;
+    while ((got = readRequestBody(body, buffer, sizeof(buffer))) > 0) {
+    }
+    return (int) got;
+}
+
+ssize_t reqReadBody(HttpReq *req, void *buffer, size_t size) {
+    return req->body != NULL ? readRequestBody(req->body, buffer, size) : 0;
+}
@@ -3,17 +3,98 @@
 //
 
 #include <alloc.h>
+#include <errors.h>
 #include <http_header.h>
 #include <string.h>
 #include <utils.h>
 
 #define INITIAL_HEADER_CAP 8
 #define MAX_HEADER_SIZE 8192
+/* More headers would not fit the known slot indices */
+#define MAX_HEADER_COUNT 1024
+
+#define KNOWN_HEADER_TABLE_SIZE 32
+
+typedef struct KnownHeaderName {
+    const char *name;
+    size_t length;
+    KnownHeader header;
+} KnownHeaderName;
+
+#define KNOWN_HEADER_NAME(str, id) {.name = (str), .length = sizeof(str) - 1, .header = (id)}
+
+/*
+    Perfect hash over the lowercased names, no two of them share a slot.
+    Indices come from knownHeaderHash, the test checks every name still maps to itself.
+*/
+static const KnownHeaderName knownHeaderTable[KNOWN_HEADER_TABLE_SIZE] = {
+    [0] = KNOWN_HEADER_NAME("accept-encoding", HEADER_ACCEPT_ENCODING),
+    [1] = KNOWN_HEADER_NAME("content-length", HEADER_CONTENT_LENGTH),
+    [3] = KNOWN_HEADER_NAME("content-encoding", HEADER_CONTENT_ENCODING),
+    [5] = KNOWN_HEADER_NAME("transfer-encoding", HEADER_TRANSFER_ENCODING),
+    [7] = KNOWN_HEADER_NAME("range", HEADER_RANGE),
+    [11] = KNOWN_HEADER_NAME("expect", HEADER_EXPECT),
+    [15] = KNOWN_HEADER_NAME("user-agent", HEADER_USER_AGENT),
+    [17] = KNOWN_HEADER_NAME("if-range", HEADER_IF_RANGE),
+    [22] = KNOWN_HEADER_NAME("if-none-match", HEADER_IF_NONE_MATCH),
+    [23] = KNOWN_HEADER_NAME("accept", HEADER_ACCEPT),
+    [25] = KNOWN_HEADER_NAME("cookie", HEADER_COOKIE),
+    [26] = KNOWN_HEADER_NAME("if-modified-since", HEADER_IF_MODIFIED_SINCE),
+    [28] = KNOWN_HEADER_NAME("host", HEADER_HOST),
+    [29] = KNOWN_HEADER_NAME("connection", HEADER_CONNECTION),
+    [30] = KNOWN_HEADER_NAME("authorization", HEADER_AUTHORIZATION),
+    [31] = KNOWN_HEADER_NAME("content-type", HEADER_CONTENT_TYPE),
+};
+
+static inline unsigned char lowerAscii(char c)
+{
+    return (unsigned char) (c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+}
+
+static unsigned int knownHeaderHash(const char *name, size_t length)
+{
+    return (unsigned int) (length + lowerAscii(name[0]) + lowerAscii(name[1]) * 16) & (KNOWN_HEADER_TABLE_SIZE - 1);
+}
+
+KnownHeader classifyHeader(const char *name, size_t length)
+{
+    if (length < 2) {
+        return HEADER_UNKNOWN;
+    }
+    const KnownHeaderName *candidate = &knownHeaderTable[knownHeaderHash(name, length)];
+    if (candidate->length != length) {
+        return HEADER_UNKNOWN;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (lowerAscii(name[i]) != (unsigned char) candidate->name[i]) {
+            return HEADER_UNKNOWN;
+        }
+    }
+    return candidate->header;
+}
+
+void indexHeader(HttpHeaders *headers, int index)
+{
+    HttpHeader *header = &headers->arr[index];
+    KnownHeader known = classifyHeader(header->key.ptr, header->key.length);
+    if (known != HEADER_UNKNOWN && headers->known[known] == 0) {
+        headers->known[known] = (unsigned short) (index + 1);
+    }
+}
+
+/* Repeated Host or Content-Length headers are how requests get smuggled, they are rejected */
+static int isRepeatedSingletonHeader(HttpHeaders *headers, string key)
+{
+    KnownHeader header = classifyHeader(key.ptr, key.length);
+    return (header == HEADER_HOST || header == HEADER_CONTENT_LENGTH) && headers->known[header] != 0;
+}
 
 int parseHeadersStream(HttpHeaders *headers, TcpStream *stream)
 {
     int headerCap = INITIAL_HEADER_CAP;
-    headers->arr = gcAllocate(sizeof(HttpHeader) * headerCap);
+    headers->arr = gcArenaAllocate(sizeof(HttpHeader) * headerCap, alignof(HttpHeader));
+    headers->count = 0;
+    memset(headers->known, 0, sizeof(headers->known));
     for (;;)
     {
         tcpStreamFill(stream, stream->cursor + 2);
@@ -21,38 +102,62 @@ int parseHeadersStream(HttpHeaders *headers, TcpStream *stream)
         {
             return stream->error;
         }
-        if(strncmp(stream->buffer + stream->cursor, "\r\n", 2) == 0) {
+        if (memcmp(stream->buffer + stream->cursor, "\r\n", 2) == 0) {
             break;
         }
         string headerKey = tcpStreamReadUntilString(stream, MAX_HEADER_SIZE, ": ", 2);
         if (headerKey.length < 0)
         {
-            return headerKey.length;
+            return (int) headerKey.length;
         }
         string headerValue = tcpStreamReadUntilCRLF(stream, MAX_HEADER_SIZE, 0);
-        if (headerKey.length < 0)
+        if (headerValue.length < 0)
         {
-            return headerValue.length;
+            return (int) headerValue.length;
+        }
+        if (headers->count >= MAX_HEADER_COUNT)
+        {
+            return ENTITY_TOO_LARGE_ERROR;
+        }
+        if (isRepeatedSingletonHeader(headers, headerKey))
+        {
+            return BAD_REQUEST_ERROR;
         }
         if (headers->count >= headerCap)
         {
             headerCap *= 2;
-            headers->arr = gcReallocate(headers->arr, headerCap * sizeof(HttpHeader));
+            HttpHeader *arr = gcArenaAllocate(sizeof(HttpHeader) * headerCap, alignof(HttpHeader));
+            memcpy(arr, headers->arr, sizeof(HttpHeader) * headers->count);
+            headers->arr = arr;
         }
-        headers->arr[headers->count].key = copyString(headerKey);
-        headers->arr[headers->count].value = copyString(headerValue);
+        headers->arr[headers->count].key = headerKey;
+        headers->arr[headers->count].value = headerValue;
+        indexHeader(headers, headers->count);
         headers->count++;
     }
     stream->cursor += 2;
     return 0;
 }
 
+HttpHeader *getHeader(HttpHeaders *headers, KnownHeader header)
+{
+    if (header == HEADER_UNKNOWN || headers->known[header] == 0) {
+        return NULL;
+    }
+    return &headers->arr[headers->known[header] - 1];
+}
+
+/* Known names are answered from the slot table, others scan arr */
 HttpHeader *findHeader(HttpHeaders *headers, const char *key)
 {
+    KnownHeader header = classifyHeader(key, strlen(key));
+    if (header != HEADER_UNKNOWN) {
+        return getHeader(headers, header);
+    }
     return (void*) findKeyValue((void *) headers->arr, headers->count, key);
 }
 
 HttpHeaders emptyHeaders()
 {
-    return (HttpHeaders){NULL, 0};
+    return (HttpHeaders){NULL, 0, {0}};
 }
@@ -8,53 +8,54 @@
 
 #include "logging.h"
 
+#define INITIAL_ELEMENT_CAP 8
+
+static void pushElement(HttpPath *path, int *capacity, const char *ptr, size_t length)
+{
+    if (path->elCount >= *capacity) {
+        int newCapacity = *capacity == 0 ? INITIAL_ELEMENT_CAP : *capacity * 2;
+        string *elements = gcArenaAllocate(sizeof(string) * newCapacity, alignof(string));
+        if (path->elCount > 0) {
+            memcpy(elements, path->elements, sizeof(string) * path->elCount);
+        }
+        path->elements = elements;
+        *capacity = newCapacity;
+    }
+    path->elements[path->elCount++] = (string) {.ptr = (char *) ptr, .length = (ssize_t) length};
+}
+
+/*
+    Splits the path in one pass, the elements are slices of str.
+    An empty element is kept between two slashes but not after the last one.
+*/
 int parsePathTrackQueryParameterStart(HttpPath *path, const char *str, size_t n, ssize_t *queryParameterStart)
 {
-    int offset, prevOffset = 0;
-    path->elCount = 0;
+    path->raw = (string) {.ptr = (char *) str, .length = (ssize_t) n};
     path->elements = NULL;
-    path->raw = gcArenaAllocate(n + 1, alignof(char));
-    snprintf(path->raw, n + 1, "%.*s", (int) n, str);
-    char *element;
-    int slashes = 0;
+    path->elCount = 0;
     if (queryParameterStart != NULL) {
         *queryParameterStart = -1;
     }
-    for (size_t i = 0; i < n; i++) {
-        if (str[i] == '?') {
+    if (n == 0 || str[0] != '/') {
+        return -1;
+    }
+
+    int capacity = 0;
+    size_t elementStart = 1;
+    for (size_t i = 1; i < n; i++) {
+        if (str[i] == '/') {
+            pushElement(path, &capacity, str + elementStart, i - elementStart);
+            elementStart = i + 1;
+        } else if (str[i] == '?') {
             if (queryParameterStart != NULL) {
                 *queryParameterStart = (ssize_t) i + 1;
             }
             n = i;
             break;
         }
-        slashes += str[i] == '/';
-    }
-    if (str[prevOffset++] != '/') {
-        return -1;
-    }
-    if (n == 1) {
-        return 0;
-    }
-
-    path->elements = gcArenaAllocate(sizeof(char *) * slashes, alignof(char *));
-
-    while ((offset = strnindex(str + prevOffset, (int) n - prevOffset, "/")) != -1)
-    {
-        element = gcArenaAllocate(offset + 1, alignof(char));
-        path->elements[path->elCount++] = element;
-        snprintf(element, offset + 1, "%.*s", offset, str + prevOffset);
-
-        prevOffset += offset + 1;
     }
-
-    int elCap = n - prevOffset + 1;
-
-    if (elCap > 1)
-    {
-        element = gcArenaAllocate(elCap, alignof(char));
-        path->elements[path->elCount++] = element;
-        snprintf(element, elCap, "%.*s", elCap - 1, str + prevOffset);
+    if (n > elementStart) {
+        pushElement(path, &capacity, str + elementStart, n - elementStart);
     }
 
     return 0;
@@ -64,6 +65,24 @@ int parsePath(HttpPath *path, const char *str, size_t n) {
     return parsePathTrackQueryParameterStart(path, str, n, NULL);
 }
 
+/* Same acceptance as strtol, an optional sign and leading digits, zero only when written as 0 */
+static int elementIsInteger(const string *element)
+{
+    ssize_t i = 0;
+    if (i < element->length && (element->ptr[i] == '-' || element->ptr[i] == '+')) {
+        i++;
+    }
+    ssize_t digitsStart = i;
+    int nonZero = 0;
+    for (; i < element->length && element->ptr[i] >= '0' && element->ptr[i] <= '9'; i++) {
+        nonZero |= element->ptr[i] != '0';
+    }
+    if (i == digitsStart) {
+        return 0;
+    }
+    return nonZero || stringEquals(element, "0");
+}
+
 /*
     Matches path to endpoint path of form
     /object/<str>/<int> to match /object/hi/123
@@ -78,22 +97,33 @@ int pathMatches(HttpPath *endpointPath, HttpPath *reqPath)
     for (int i = 0; i < endpointPath->elCount; i++)
     {
         TRACE("pathMatches i=%d", i);
-        if (strcmp(endpointPath->elements[i], "<str>") == 0)
+        string *pattern = &endpointPath->elements[i];
+        string *element = &reqPath->elements[i];
+        if (stringEquals(pattern, "<str>"))
         {
             continue;
         }
-        else if (strcmp(endpointPath->elements[i], "<int>") == 0)
+        else if (stringEquals(pattern, "<int>"))
         {
-            long result = strtol(reqPath->elements[i], NULL, 10);
-            if (result == 0 && strcmp(reqPath->elements[i], "0") != 0)
+            if (!elementIsInteger(element))
             {
                 return 0;
             }
         }
-        else if (strcmp(endpointPath->elements[i], reqPath->elements[i]) != 0)
+        else if (stringCompare(pattern, element) != 0)
         {
             return 0;
         }
     }
     return 1;
-}
\ No newline at end of file
+}
+
+HttpPathParam *findPathParam(HttpPathParams *params, const char *name)
+{
+    for (int i = 0; i < params->count; i++) {
+        if (stringEquals(&params->items[i].name, name)) {
+            return &params->items[i];
+        }
+    }
+    return NULL;
+}
@@ -7,51 +7,62 @@
 
 #include "logging.h"
 
+#define INITIAL_PARAMETER_CAP 8
+
+static HttpQueryParameter *pushParameter(HttpQuery *query, size_t *capacity)
+{
+    if (query->count >= *capacity) {
+        size_t newCapacity = *capacity == 0 ? INITIAL_PARAMETER_CAP : *capacity * 2;
+        HttpQueryParameter *parameters = gcArenaAllocate(sizeof(HttpQueryParameter) * newCapacity, alignof(HttpQueryParameter));
+        if (query->count > 0) {
+            memcpy(parameters, query->parameters, sizeof(HttpQueryParameter) * query->count);
+        }
+        query->parameters = parameters;
+        *capacity = newCapacity;
+    }
+    return &query->parameters[query->count++];
+}
+
+/*
+    Splits the query in one pass, keys and values are slices of str.
+    Empty parameters and parameters without a key are skipped,
+    a parameter without '=' gets a value of length -1.
+*/
 int parseQuery(HttpQuery *query, const char *str, size_t len) {
 
     TRACE("%zu %.*s", len, (int) len, str);
 
-    int ampersands = 0;
-    for (size_t i = 0; i < len; i++) {
-        ampersands += str[i] == '&';
-    }
-
     query->count = 0;
-    query->parameters = gcArenaAllocate(sizeof(HttpQueryParameter) * (ampersands + 1), alignof(HttpQueryParameter));
-
-    size_t prevOffset = 0;
-    for (int i = 0; i < ampersands + 1; i++) {
-
-        ssize_t parameterEnd;
-        if (i == ampersands) {
-            parameterEnd = (ssize_t) (len - prevOffset);
-        } else {
-            parameterEnd = strnindex(str + prevOffset, (int) (len - prevOffset), "&");
-            if (parameterEnd == 0) {
-                goto loop_end;
-            }
-        }
+    query->parameters = NULL;
+    size_t capacity = 0;
 
-        ssize_t equalOffset = strnindex(str + prevOffset, (int) parameterEnd, "=");
-        if (equalOffset == 0) {
-            goto loop_end;
+    size_t parameterStart = 0;
+    ssize_t equalOffset = -1;
+    for (size_t i = 0; i <= len; i++) {
+        if (i < len && str[i] != '&') {
+            if (str[i] == '=' && equalOffset == -1) {
+                equalOffset = (ssize_t) (i - parameterStart);
+            }
+            continue;
         }
 
-        HttpQueryParameter *param = &query->parameters[query->count++];
-        string *key = &param->key;
-        string *value = &param->value;
-
-        if (equalOffset == -1) {
-            *key = copyStringFromSlice(str + prevOffset, parameterEnd);
-            *value = copyStringFromSlice(NULL, -1);
-        } else {
-            *key = copyStringFromSlice(str + prevOffset, equalOffset);
-            *value = copyStringFromSlice(str + prevOffset + equalOffset + 1,
-                parameterEnd - equalOffset - 1);
+        size_t parameterLength = i - parameterStart;
+        if (parameterLength > 0 && equalOffset != 0) {
+            HttpQueryParameter *param = pushParameter(query, &capacity);
+            const char *parameter = str + parameterStart;
+            if (equalOffset == -1) {
+                param->key = (string) {.ptr = (char *) parameter, .length = (ssize_t) parameterLength};
+                param->value = (string) {.ptr = NULL, .length = -1};
+            } else {
+                param->key = (string) {.ptr = (char *) parameter, .length = equalOffset};
+                param->value = (string) {
+                    .ptr = (char *) parameter + equalOffset + 1,
+                    .length = (ssize_t) parameterLength - equalOffset - 1,
+                };
+            }
         }
-
-        loop_end:
-        prevOffset += parameterEnd + 1;
+        parameterStart = i + 1;
+        equalOffset = -1;
     }
 
     return 0;
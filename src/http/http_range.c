@@ -0,0 +1,294 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#define _GNU_SOURCE
+#include <http_range.h>
+#include <alloc.h>
+#include <file_cache.h>
+#include <logging.h>
+#include <utils.h>
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define RANGE_UNIT "bytes="
+
+static int isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static void skipSpaces(const string *value, ssize_t *i) {
+    while (*i < value->length && (value->ptr[*i] == ' ' || value->ptr[*i] == '\t')) {
+        (*i)++;
+    }
+}
+
+/* Returns -1 without digits or on overflow */
+static off_t parsePosition(const string *value, ssize_t *i) {
+    if (*i >= value->length || !isDigit(value->ptr[*i])) {
+        return -1;
+    }
+    off_t position = 0;
+    while (*i < value->length && isDigit(value->ptr[*i])) {
+        int digit = value->ptr[*i] - '0';
+        if (position > (LLONG_MAX - digit) / 10) {
+            return -1;
+        }
+        position = position * 10 + digit;
+        (*i)++;
+    }
+    return position;
+}
+
+int parseByteRanges(const string *value, off_t size, ByteRange *ranges, int maxRanges) {
+    const ssize_t unitLength = sizeof(RANGE_UNIT) - 1;
+    if (value->length <= unitLength || strncasecmp(value->ptr, RANGE_UNIT, unitLength) != 0) {
+        return -1;
+    }
+    int count = 0;
+    int specs = 0;
+    ssize_t i = unitLength;
+    while (i < value->length) {
+        skipSpaces(value, &i);
+        if (i < value->length && value->ptr[i] == ',') {
+            i++;
+            continue;
+        }
+        if (++specs > maxRanges) {
+            return -1;
+        }
+        ByteRange range;
+        if (i < value->length && value->ptr[i] == '-') {
+            i++;
+            off_t suffix = parsePosition(value, &i);
+            if (suffix < 0) {
+                return -1;
+            }
+            /* "-0" asks for nothing and is unsatisfiable */
+            range.start = suffix == 0 ? size : (suffix >= size ? 0 : size - suffix);
+            range.end = size - 1;
+        } else {
+            range.start = parsePosition(value, &i);
+            if (range.start < 0 || i >= value->length || value->ptr[i] != '-') {
+                return -1;
+            }
+            i++;
+            if (i < value->length && isDigit(value->ptr[i])) {
+                range.end = parsePosition(value, &i);
+                if (range.end < range.start) {
+                    return -1;
+                }
+            } else {
+                range.end = size - 1;
+            }
+            if (range.end >= size) {
+                range.end = size - 1;
+            }
+        }
+        skipSpaces(value, &i);
+        if (i < value->length && value->ptr[i] != ',') {
+            return -1;
+        }
+        if (range.start < size && range.start <= range.end) {
+            ranges[count++] = range;
+        }
+    }
+    return specs == 0 ? -1 : count;
+}
+
+/* W/"x" and "x" are equal under weak comparison */
+static string opaqueTag(string tag, int *weak) {
+    *weak = tag.length > 2 && tag.ptr[0] == 'W' && tag.ptr[1] == '/';
+    if (*weak) {
+        tag.ptr += 2;
+        tag.length -= 2;
+    }
+    return tag;
+}
+
+static int noneMatchHits(const string *value, const string *etag) {
+    int weak;
+    string current = opaqueTag(*etag, &weak);
+    ssize_t i = 0;
+    while (i < value->length) {
+        while (i < value->length && (value->ptr[i] == ' ' || value->ptr[i] == '\t' || value->ptr[i] == ',')) {
+            i++;
+        }
+        ssize_t start = i;
+        while (i < value->length && value->ptr[i] != ',' && value->ptr[i] != ' ' && value->ptr[i] != '\t') {
+            i++;
+        }
+        string tag = {value->ptr + start, i - start};
+        if (tag.length == 1 && tag.ptr[0] == '*') {
+            return 1;
+        }
+        tag = opaqueTag(tag, &weak);
+        if (tag.length > 0 && stringCompare(&tag, &current) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Returns -1 for anything but an IMF-fixdate */
+static time_t parseHttpDate(const string *value) {
+    char buffer[64];
+    if (value->length <= 0 || (size_t) value->length >= sizeof(buffer)) {
+        return -1;
+    }
+    memcpy(buffer, value->ptr, value->length);
+    buffer[value->length] = '\0';
+    struct tm tm = {0};
+    const char *end = strptime(buffer, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (end == NULL || *end != '\0') {
+        return -1;
+    }
+    return timegm(&tm);
+}
+
+/* If-Range needs a strong match of the ETag or the exact Last-Modified date */
+static int ifRangeHolds(const string *value, const CachedFile *file, const string *etag) {
+    if (value->length >= 2 && value->ptr[0] == 'W' && value->ptr[1] == '/') {
+        return 0;
+    }
+    if (value->length > 0 && value->ptr[0] == '"') {
+        return stringCompare((string*) value, (string*) etag) == 0;
+    }
+    return stringEquals(value, file->lastModified);
+}
+
+static void dropContent(HttpResp *resp) {
+    resp->content = NULL;
+    resp->contentLength = 0;
+    resp->isContentFile = 0;
+}
+
+static string formatArena(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+static string formatArena(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    va_list sizing;
+    va_copy(sizing, args);
+    int length = vsnprintf(NULL, 0, format, sizing);
+    va_end(sizing);
+    char *buffer = gcArenaAllocate(length + 1, alignof(char));
+    vsnprintf(buffer, length + 1, format, args);
+    va_end(args);
+    return (string) {buffer, length};
+}
+
+static void setContentLength(HttpResp *resp, size_t length) {
+    char *digits = gcArenaAllocate(UNSIGNED_DIGITS_MAX, alignof(char));
+    respSetHeader(resp, STRING_LITERAL("Content-Length"), (string) {digits, formatUnsigned(length, digits)});
+}
+
+static void selectSingleRange(HttpResp *resp, ByteRange range, size_t size) {
+    size_t length = range.end - range.start + 1;
+    if (resp->isContentFile) {
+        resp->contentOffset = range.start;
+    } else {
+        resp->content = (const char*) resp->content + range.start;
+    }
+    resp->contentLength = length;
+    setContentLength(resp, length);
+    respSetHeader(resp, STRING_LITERAL("Content-Range"),
+                  formatArena("bytes %lld-%lld/%zu", (long long) range.start, (long long) range.end, size));
+}
+
+/* Boundaries only have to be unlikely inside the content, not secret */
+static unsigned long long nextBoundary() {
+    static _Thread_local unsigned long long state = 0;
+    if (state == 0) {
+        state = (unsigned long long) getMonotonicTimeMs() * 0x9E3779B97F4A7C15ULL | 1;
+    }
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static void selectRangeParts(HttpResp *resp, const ByteRange *ranges, int count, size_t size) {
+    HttpHeader *contentType = getHeader(&resp->headers, HEADER_CONTENT_TYPE);
+    string type = contentType != NULL ? contentType->value : STRING_LITERAL("application/octet-stream");
+    unsigned long long boundary = nextBoundary();
+
+    HttpRangeParts *parts = gcArenaAllocate(sizeof(HttpRangeParts), alignof(HttpRangeParts));
+    parts->items = gcArenaAllocate(sizeof(HttpRangePart) * count, alignof(HttpRangePart));
+    parts->count = count;
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        HttpRangePart *part = &parts->items[i];
+        part->start = ranges[i].start;
+        part->length = ranges[i].end - ranges[i].start + 1;
+        part->head = formatArena("\r\n--%016llx\r\nContent-Type: %.*s\r\nContent-Range: bytes %lld-%lld/%zu\r\n\r\n",
+                                 boundary, (int) type.length, type.ptr,
+                                 (long long) ranges[i].start, (long long) ranges[i].end, size);
+        total += part->head.length + part->length;
+    }
+    parts->tail = formatArena("\r\n--%016llx--\r\n", boundary);
+    total += parts->tail.length;
+
+    resp->parts = parts;
+    resp->contentLength = total;
+    setContentLength(resp, total);
+    respSetHeader(resp, STRING_LITERAL("Content-Type"), formatArena("multipart/byteranges; boundary=%016llx", boundary));
+}
+
+void respApplyConditionals(HttpResp *resp, HttpMethod method, HttpHeaders *requestHeaders) {
+    CachedFile *file = resp->file;
+    if (file == NULL || resp->status != OK || (method != GET && method != HEAD)) {
+        return;
+    }
+    HttpHeader *etagHeader = findHeader(&resp->headers, "ETag");
+    string etag = etagHeader != NULL ? etagHeader->value : (string) {file->etag, file->etagLength};
+
+    HttpHeader *ifNoneMatch = getHeader(requestHeaders, HEADER_IF_NONE_MATCH);
+    HttpHeader *ifModifiedSince = getHeader(requestHeaders, HEADER_IF_MODIFIED_SINCE);
+    int notModified = 0;
+    if (ifNoneMatch != NULL) {
+        notModified = noneMatchHits(&ifNoneMatch->value, &etag);
+    } else if (ifModifiedSince != NULL) {
+        time_t since = parseHttpDate(&ifModifiedSince->value);
+        notModified = since != -1 && file->modified.tv_sec <= since;
+    }
+    if (notModified) {
+        debug("Not modified %s", file->path);
+        resp->status = NOT_MODIFIED;
+        dropContent(resp);
+        return;
+    }
+
+    HttpHeader *range = getHeader(requestHeaders, HEADER_RANGE);
+    if (method != GET || range == NULL) {
+        return;
+    }
+    HttpHeader *ifRange = getHeader(requestHeaders, HEADER_IF_RANGE);
+    if (ifRange != NULL && !ifRangeHolds(&ifRange->value, file, &etag)) {
+        return;
+    }
+
+    size_t size = resp->contentLength;
+    ByteRange ranges[MAX_BYTE_RANGES];
+    int count = parseByteRanges(&range->value, (off_t) size, ranges, MAX_BYTE_RANGES);
+    if (count < 0) {
+        return;
+    }
+    if (count == 0) {
+        resp->status = RANGE_NOT_SATISFIABLE;
+        dropContent(resp);
+        setContentLength(resp, 0);
+        respSetHeader(resp, STRING_LITERAL("Content-Range"), formatArena("bytes */%zu", size));
+        return;
+    }
+    resp->status = PARTIAL_CONTENT;
+    if (count == 1) {
+        selectSingleRange(resp, ranges[0], size);
+    } else {
+        selectRangeParts(resp, ranges, count, size);
+    }
+}
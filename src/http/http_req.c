@@ -3,8 +3,9 @@
 //
 
 #include <alloc.h>
-#include <errno.h>
+#include <limits.h>
 #include <errors.h>
+#include <http_body.h>
 #include <http_req.h>
 #include <http_version.h>
 #include <logging.h>
@@ -16,21 +17,41 @@
 
 long findContentLength(HttpHeaders *headers);
 
+/* Closed, timed out or not yet received streams are not parsing errors */
+static int isStreamInterruption(ssize_t error)
+{
+    return error == TCP_STREAM_CLOSED || error == TCP_STREAM_TIMEOUT || error == TCP_STREAM_WOULD_BLOCK;
+}
+
 HttpReq newRequest()
 {
     return (HttpReq){
         .method = METHOD_UNKNOWN,
-        .path = {NULL, 0},
-        .version = NULL,
+        .path = {EMPTY_STRING, NULL, 0},
+        .params = {NULL, 0},
+        .query = {NULL, 0},
+        .version = EMPTY_STRING,
         .headers = emptyHeaders(),
         .content = NULL,
         .contentLength = 0,
+        .body = NULL,
         .appState = NULL,
     };
 }
 
 /* Parse HTTP request, returns the amount of bytes needed additionally read from the TCP socket based on the Content-Length header */
 int parseRequestStream(HttpReq *req, TcpStream *stream)
+{
+    int result = parseRequestHead(req, stream);
+    if (result < 0)
+    {
+        return result;
+    }
+    return parseRequestContent(req, stream);
+}
+
+/* Parses the request line and headers, the stream cursor is left at the content */
+int parseRequestHead(HttpReq *req, TcpStream *stream)
 {
     /* Parse method */
     {
@@ -38,7 +59,7 @@ int parseRequestStream(HttpReq *req, TcpStream *stream)
         string method = tcpStreamReadUntilSpace(stream, 7);
         if (method.length < 0)
         {
-            if (method.length != TCP_STREAM_CLOSED && method.length != TCP_STREAM_TIMEOUT) {
+            if (!isStreamInterruption(method.length)) {
                 error("Error Parsing Method: %s", errToStr((int) method.length));
             }
             return (int) method.length;
@@ -59,13 +80,11 @@ int parseRequestStream(HttpReq *req, TcpStream *stream)
         string path = tcpStreamReadUntilSpace(stream, 1024);
         if (path.length < 0)
         {
-            if (path.length != TCP_STREAM_CLOSED && path.length != TCP_STREAM_TIMEOUT) {
+            if (!isStreamInterruption(path.length)) {
                 error("Error Parsing Path: %s", errToStr((int) path.length));
             }
             return (int) path.length;
         }
-        char *pathStart = path.ptr;
-        size_t pathLength = path.length;
         if (parsePathTrackQueryParameterStart(&req->path, path.ptr, path.length, &queryParameterStart) == -1)
         {
             return BAD_REQUEST_ERROR;
@@ -76,7 +95,7 @@ int parseRequestStream(HttpReq *req, TcpStream *stream)
         TRACE("path count %d; queryStart: %zd", req->path.elCount, queryParameterStart);
         if (queryParameterStart == -1) {
             req->query = (HttpQuery){.parameters = NULL, .count = 0};
-        } else if (parseQuery(&req->query, pathStart + queryParameterStart, pathLength - queryParameterStart) == -1) {
+        } else if (parseQuery(&req->query, path.ptr + queryParameterStart, path.length - queryParameterStart) == -1) {
             return BAD_REQUEST_ERROR;
         }
     }
@@ -88,7 +107,7 @@ int parseRequestStream(HttpReq *req, TcpStream *stream)
         TRACE("versionLength: %zd", version.length);
         if (version.length < 0 && version.length != ENTITY_TOO_LARGE_ERROR)
         {
-            if (version.length != TCP_STREAM_CLOSED && version.length != TCP_STREAM_TIMEOUT) {
+            if (!isStreamInterruption(version.length)) {
                 error("Error Parsing Version: %s\n", errToStr((int) version.length));
             }
             return (int) version.length;
@@ -98,8 +117,7 @@ int parseRequestStream(HttpReq *req, TcpStream *stream)
             error("Error Parsing Version TOO LARGE\n");
             return UNKNOWN_VERSION;
         }
-        req->version = gcArenaAllocate(9, alignof(char));
-        snprintf(req->version, 9, "%.*s", 8, version.ptr);
+        req->version = version;
     }
 
     /* Parse headers */
@@ -108,54 +126,48 @@ int parseRequestStream(HttpReq *req, TcpStream *stream)
         int result = parseHeadersStream(&req->headers, stream);
         if (result < 0)
         {
-            if (result != TCP_STREAM_CLOSED && result != TCP_STREAM_TIMEOUT) {
+            if (!isStreamInterruption(result)) {
                 error("Error Parsing Headers %s\n", errToStr(result));
             }
             return result;
         }
     }
 
-    /* Fetch content */
+    return 0;
+}
+
+/* Reads the whole content without a size limit, call after parseRequestHead */
+int parseRequestContent(HttpReq *req, TcpStream *stream)
+{
+    debug("Parsing Content");
+    HttpBody *body = gcArenaAllocate(sizeof(HttpBody), alignof(HttpBody));
+    int result = prepareRequestBody(body, req, stream, 0);
+    if (result < 0)
     {
-        debug("Parsing Content");
-        req->contentLength = findContentLength(&req->headers);
-        if (req->contentLength > 0)
-        {
-            req->content = tcpStreamReadSlice(stream, req->contentLength);
-            if (stream->error < 0)
-            {
-                if (stream->error != TCP_STREAM_CLOSED && stream->error != TCP_STREAM_TIMEOUT) {
-                    error("Error Fetching Content: %s\n", errToStr(stream->error));
-                }
-                return stream->error;
-            }
-        }
-        else if (req->contentLength == 0)
-        {
-            req->content = NULL;
-        }
-        else
-        {
-            return BAD_REQUEST_ERROR;
-        }
+        return result;
     }
-
-    req->raw = stream->buffer;
-    req->rawLength = stream->cursor;
-
-    return 0;
+    return bufferRequestBody(body, req);
 }
 
+/* Digits only, -1 for anything else or an overflow */
 long findContentLength(HttpHeaders *headers)
 {
-    HttpHeader *contentLengthHeader = findHeader(headers, "Content-Length");
+    HttpHeader *contentLengthHeader = getHeader(headers, HEADER_CONTENT_LENGTH);
     if (contentLengthHeader == NULL) {
         return 0;
     }
-    long contentLength = strtol(contentLengthHeader->value.ptr, NULL, 10);
-    if (errno == ERANGE || contentLength < 0) {
+    const string *value = &contentLengthHeader->value;
+    if (value->length <= 0) {
         return -1;
     }
+    long contentLength = 0;
+    for (ssize_t i = 0; i < value->length; i++) {
+        char c = value->ptr[i];
+        if (c < '0' || c > '9' || contentLength > (LONG_MAX - (c - '0')) / 10) {
+            return -1;
+        }
+        contentLength = contentLength * 10 + (c - '0');
+    }
 
     return contentLength;
 }
@@ -212,16 +224,18 @@ HttpMethod strnToMethod(const char *str, int n)
 
 int isConnectionKeepAlive(HttpReq *req)
 {
-    HttpHeader *header = findHeader(&req->headers, "Connection");
+    HttpHeader *header = getHeader(&req->headers, HEADER_CONNECTION);
     if (header == NULL)
     {
-        if (getVersionNumber(req->version, 8) >= 11)
+        if (getVersionNumber(req->version.ptr, (int) req->version.length) >= 11)
         {
             return 1;
         }
         return 0;
     }
-    return strcasecmp(header->value.ptr, "keep-alive") == 0;
+    static const char keepAlive[] = "keep-alive";
+    return header->value.length == sizeof(keepAlive) - 1 &&
+           strncasecmp(header->value.ptr, keepAlive, sizeof(keepAlive) - 1) == 0;
 }
 
 JObject httpReqToJObject(HttpReq *req) {
@@ -231,9 +245,9 @@ JObject httpReqToJObject(HttpReq *req) {
     static const char headersKey[] = "headers";
     static const char contentKey[] = "content";
 
-    char *path = gcArenaAllocate(1024, alignof(char));
-    TRACE("%s", "httpReqToObject");
-    snprintf(path, 1024, "%.*s", 1024, req->path.raw);
+    /* the request only holds slices, the json needs null terminated copies */
+    char *path = copyString(req->path.raw).ptr;
+    char *version = copyString(req->version).ptr;
     TRACE("%s", "httpReqToObject");
     JObject headersObj = {
         .properties = gcArenaAllocate(sizeof(JProperty) * req->headers.count, alignof(JProperty)),
@@ -241,7 +255,7 @@ JObject httpReqToJObject(HttpReq *req) {
     };
     HttpHeader *headers = req->headers.arr;
     for (int i = 0; i < req->headers.count; i++) {
-        headersObj.properties[i] = _JProperty(headers[i].key.ptr, toJToken_cstring(headers[i].value.ptr));
+        headersObj.properties[i] = _JProperty(copyString(headers[i].key).ptr, toJToken_cstring(copyString(headers[i].value).ptr));
     }
     TRACE("%s", "httpReqToObject");
 
@@ -249,17 +263,17 @@ JObject httpReqToJObject(HttpReq *req) {
     if (req->content == NULL) {
         contentToken = _JNull();
     } else {
-        contentToken = toJToken_cstring(req->content);
+        contentToken = toJToken_cstring(copyStringFromSlice(req->content, req->contentLength).ptr);
     }
     TRACE("%s", "httpReqToObject");
 
     TRACE("%p", path);
     TRACE("%s", methodToStr(req->method));
-    TRACE("%s", req->version);
+    TRACE("%s", version);
     JObject reqObject = _JObject(
         _JProperty(methodKey, toJToken_cstring(methodToStr(req->method))),
         _JProperty(pathKey, toJToken_cstring(path)),
-        _JProperty(versionKey, toJToken_cstring(req->version)),
+        _JProperty(versionKey, toJToken_cstring(version)),
         _JProperty(headersKey, toJToken_JObject(headersObj)),
         _JProperty(contentKey, contentToken)
     );
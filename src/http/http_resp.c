@@ -4,213 +4,118 @@
 
 #include <http_resp.h>
 #include <file_handler.h>
+#include <file_cache.h>
 #include <alloc.h>
 #include <utils.h>
 
 #include <string.h>
+#include <strings.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include <sys/stat.h>
 #include <errno.h>
 
 #include "../../includes/logging.h"
+#include "../helpers/clock_helper.h"
+
+#define STATUS_TABLE_FIRST 100
+#define STATUS_TABLE_LAST 511
+#define HTTP_1_1_STATUS_LINE(code, phrase) "HTTP/1.1 " #code " " phrase "\r\n"
+#define STATUS_LINE(code, phrase) [(code) - STATUS_TABLE_FIRST] = { \
+        .reason = phrase, \
+        .line = HTTP_1_1_STATUS_LINE(code, phrase), \
+        .lineLength = sizeof(HTTP_1_1_STATUS_LINE(code, phrase)) - 1, \
+    }
 
-const char *statusToStr(HttpStatus status)
+/* Whole HTTP/1.1 status lines, a response head starts with a single memcpy */
+typedef struct StatusLine {
+    const char *reason;
+    const char *line;
+    size_t lineLength;
+} StatusLine;
+
+static const StatusLine statusLines[STATUS_TABLE_LAST - STATUS_TABLE_FIRST + 1] = {
+    STATUS_LINE(100, "Continue"),
+    STATUS_LINE(101, "Switching Protocols"),
+    STATUS_LINE(102, "Processing"),
+    STATUS_LINE(103, "Early Hints"),
+    STATUS_LINE(200, "OK"),
+    STATUS_LINE(201, "Created"),
+    STATUS_LINE(202, "Accepted"),
+    STATUS_LINE(203, "Non-Authoritative Information"),
+    STATUS_LINE(204, "No Content"),
+    STATUS_LINE(205, "Reset Content"),
+    STATUS_LINE(206, "Partial Content"),
+    STATUS_LINE(207, "Multi-Status"),
+    STATUS_LINE(208, "Already Reported"),
+    STATUS_LINE(226, "IM Used"),
+    STATUS_LINE(300, "Multiple Choices"),
+    STATUS_LINE(301, "Moved Permanently"),
+    STATUS_LINE(302, "Found"),
+    STATUS_LINE(303, "See Other"),
+    STATUS_LINE(304, "Not Modified"),
+    STATUS_LINE(305, "Use Proxy"),
+    STATUS_LINE(307, "Temporary Redirect"),
+    STATUS_LINE(308, "Permanent Redirect"),
+    STATUS_LINE(400, "Bad Request"),
+    STATUS_LINE(401, "Unauthorized"),
+    STATUS_LINE(402, "Payment Required"),
+    STATUS_LINE(403, "Forbidden"),
+    STATUS_LINE(404, "Not Found"),
+    STATUS_LINE(405, "Method Not Allowed"),
+    STATUS_LINE(406, "Not Acceptable"),
+    STATUS_LINE(407, "Proxy Authentication Required"),
+    STATUS_LINE(408, "Request Timeout"),
+    STATUS_LINE(409, "Conflict"),
+    STATUS_LINE(410, "Gone"),
+    STATUS_LINE(411, "Length Required"),
+    STATUS_LINE(412, "Precondition Failed"),
+    STATUS_LINE(413, "Payload Too Large"),
+    STATUS_LINE(414, "URI Too Long"),
+    STATUS_LINE(415, "Unsupported Media Type"),
+    STATUS_LINE(416, "Range Not Satisfiable"),
+    STATUS_LINE(417, "Expectation Failed"),
+    STATUS_LINE(418, "I'm a teapot"),
+    STATUS_LINE(421, "Misdirected Request"),
+    STATUS_LINE(422, "Unprocessable Entity"),
+    STATUS_LINE(423, "Locked"),
+    STATUS_LINE(424, "Failed Dependency"),
+    STATUS_LINE(425, "Too Early"),
+    STATUS_LINE(426, "Upgrade Required"),
+    STATUS_LINE(428, "Precondition Required"),
+    STATUS_LINE(429, "Too Many Requests"),
+    STATUS_LINE(431, "Request Header Fields Too Large"),
+    STATUS_LINE(451, "Unavailable For Legal Reasons"),
+    STATUS_LINE(500, "Internal Server Error"),
+    STATUS_LINE(501, "Not Implemented"),
+    STATUS_LINE(502, "Bad Gateway"),
+    STATUS_LINE(503, "Service Unavailable"),
+    STATUS_LINE(504, "Gateway Timeout"),
+    STATUS_LINE(505, "HTTP Version Not Supported"),
+    STATUS_LINE(506, "Variant Also Negotiates"),
+    STATUS_LINE(507, "Insufficient Storage"),
+    STATUS_LINE(508, "Loop Detected"),
+    STATUS_LINE(510, "Not Extended"),
+    STATUS_LINE(511, "Network Authentication Required"),
+};
+
+#undef STATUS_LINE
+#undef HTTP_1_1_STATUS_LINE
+
+static const StatusLine *findStatusLine(HttpStatus status)
 {
-    static const char ok[] = "OK";
-    static const char continueStr[] = "Continue";
-    static const char switchingProtocols[] = "Switching Protocols";
-    static const char processing[] = "Processing";
-    static const char earlyHints[] = "Early Hints";
-    static const char created[] = "Created";
-    static const char accepted[] = "Accepted";
-    static const char nonAuthoritativeInformation[] = "Non-Authoritative Information";
-    static const char noContent[] = "No Content";
-    static const char resetContent[] = "Reset Content";
-    static const char partialContent[] = "Partial Content";
-    static const char multiStatus[] = "Multi-Status";
-    static const char alreadyReported[] = "Already Reported";
-    static const char imUsed[] = "IM Used";
-    static const char multipleChoices[] = "Multiple Choices";
-    static const char movedPermanently[] = "Moved Permanently";
-    static const char found[] = "Found";
-    static const char seeOther[] = "See Other";
-    static const char notModified[] = "Not Modified";
-    static const char useProxy[] = "Use Proxy";
-    static const char temporaryRedirect[] = "Temporary Redirect";
-    static const char permanentRedirect[] = "Permanent Redirect";
-    static const char badRequest[] = "Bad Request";
-    static const char unauthorized[] = "Unauthorized";
-    static const char paymentRequired[] = "Payment Required";
-    static const char forbidden[] = "Forbidden";
-    static const char notFound[] = "Not Found";
-    static const char methodNotAllowed[] = "Method Not Allowed";
-    static const char notAcceptable[] = "Not Acceptable";
-    static const char proxyAuthenticationRequired[] = "Proxy Authentication Required";
-    static const char requestTimeout[] = "Request Timeout";
-    static const char conflict[] = "Conflict";
-    static const char gone[] = "Gone";
-    static const char lengthRequired[] = "Length Required";
-    static const char preconditionFailed[] = "Precondition Failed";
-    static const char payloadTooLarge[] = "Payload Too Large";
-    static const char uriTooLong[] = "URI Too Long";
-    static const char unsupportedMediaType[] = "Unsupported Media Type";
-    static const char rangeNotSatisfiable[] = "Range Not Satisfiable";
-    static const char expectationFailed[] = "Expectation Failed";
-    static const char imATeapot[] = "I'm a teapot";
-    static const char misdirectedRequest[] = "Misdirected Request";
-    static const char unprocessableEntity[] = "Unprocessable Entity";
-    static const char locked[] = "Locked";
-    static const char failedDependency[] = "Failed Dependency";
-    static const char tooEarly[] = "Too Early";
-    static const char upgradeRequired[] = "Upgrade Required";
-    static const char preconditionRequired[] = "Precondition Required";
-    static const char tooManyRequests[] = "Too Many Requests";
-    static const char requestHeaderFieldsTooLarge[] = "Request Header Fields Too Large";
-    static const char unavailableForLegalReasons[] = "Unavailable For Legal Reasons";
-    static const char internalServerError[] = "Internal Server Error";
-    static const char notImplemented[] = "Not Implemented";
-    static const char badGateway[] = "Bad Gateway";
-    static const char serviceUnavailable[] = "Service Unavailable";
-    static const char gatewayTimeout[] = "Gateway Timeout";
-    static const char httpVersionNotSupported[] = "HTTP Version Not Supported";
-    static const char variantAlsoNegotiates[] = "Variant Also Negotiates";
-    static const char insufficientStorage[] = "Insufficient Storage";
-    static const char loopDetected[] = "Loop Detected";
-    static const char notExtended[] = "Not Extended";
-    static const char networkAuthenticationRequired[] = "Network Authentication Required";
-
-    switch (status)
+    if (status < STATUS_TABLE_FIRST || status > STATUS_TABLE_LAST || statusLines[status - STATUS_TABLE_FIRST].line == NULL)
     {
-    case CONTINUE:
-        return continueStr;
-    case SWITCHING_PROTOCOLS:
-        return switchingProtocols;
-    case PROCESSING:
-        return processing;
-    case EARLY_HINTS:
-        return earlyHints;
-    case OK:
-        return ok;
-    case CREATED:
-        return created;
-    case ACCEPTED:
-        return accepted;
-    case NON_AUTHORITATIVE_INFORMATION:
-        return nonAuthoritativeInformation;
-    case NO_CONTENT:
-        return noContent;
-    case RESET_CONTENT:
-        return resetContent;
-    case PARTIAL_CONTENT:
-        return partialContent;
-    case MULTI_STATUS:
-        return multiStatus;
-    case ALREADY_REPORTED:
-        return alreadyReported;
-    case IM_USED:
-        return imUsed;
-    case MULTIPLE_CHOICES:
-        return multipleChoices;
-    case MOVED_PERMANENTLY:
-        return movedPermanently;
-    case FOUND:
-        return found;
-    case SEE_OTHER:
-        return seeOther;
-    case NOT_MODIFIED:
-        return notModified;
-    case USE_PROXY:
-        return useProxy;
-    case TEMPORARY_REDIRECT:
-        return temporaryRedirect;
-    case PERMANENT_REDIRECT:
-        return permanentRedirect;
-    case BAD_REQUEST:
-        return badRequest;
-    case UNAUTHORIZED:
-        return unauthorized;
-    case PAYMENT_REQUIRED:
-        return paymentRequired;
-    case FORBIDDEN:
-        return forbidden;
-    case NOT_FOUND:
-        return notFound;
-    case METHOD_NOT_ALLOWED:
-        return methodNotAllowed;
-    case NOT_ACCEPTABLE:
-        return notAcceptable;
-    case PROXY_AUTHENTICATION_REQUIRED:
-        return proxyAuthenticationRequired;
-    case REQUEST_TIMEOUT:
-        return requestTimeout;
-    case CONFLICT:
-        return conflict;
-    case GONE:
-        return gone;
-    case LENGTH_REQUIRED:
-        return lengthRequired;
-    case PRECONDITION_FAILED:
-        return preconditionFailed;
-    case PAYLOAD_TOO_LARGE:
-        return payloadTooLarge;
-    case URI_TOO_LONG:
-        return uriTooLong;
-    case UNSUPPORTED_MEDIA_TYPE:
-        return unsupportedMediaType;
-    case RANGE_NOT_SATISFIABLE:
-        return rangeNotSatisfiable;
-    case EXPECTATION_FAILED:
-        return expectationFailed;
-    case IM_A_TEAPOT:
-        return imATeapot;
-    case MISDIRECTED_REQUEST:
-        return misdirectedRequest;
-    case UNPROCESSABLE_ENTITY:
-        return unprocessableEntity;
-    case LOCKED:
-        return locked;
-    case FAILED_DEPENDENCY:
-        return failedDependency;
-    case TOO_EARLY:
-        return tooEarly;
-    case UPGRADE_REQUIRED:
-        return upgradeRequired;
-    case PRECONDITION_REQUIRED:
-        return preconditionRequired;
-    case TOO_MANY_REQUESTS:
-        return tooManyRequests;
-    case REQUEST_HEADER_FIELDS_TOO_LARGE:
-        return requestHeaderFieldsTooLarge;
-    case UNAVAILABLE_FOR_LEGAL_REASONS:
-        return unavailableForLegalReasons;
-    case INTERNAL_SERVER_ERROR:
-        return internalServerError;
-    case NOT_IMPLEMENTED:
-        return notImplemented;
-    case BAD_GATEWAY:
-        return badGateway;
-    case SERVICE_UNAVAILABLE:
-        return serviceUnavailable;
-    case GATEWAY_TIMEOUT:
-        return gatewayTimeout;
-    case HTTP_VERSION_NOT_SUPPORTED:
-        return httpVersionNotSupported;
-    case VARIANT_ALSO_NEGOTIATES:
-        return variantAlsoNegotiates;
-    case INSUFFICIENT_STORAGE:
-        return insufficientStorage;
-    case LOOP_DETECTED:
-        return loopDetected;
-    case NOT_EXTENDED:
-        return notExtended;
-    case NETWORK_AUTHENTICATION_REQUIRED:
-        return networkAuthenticationRequired;
-    default:
-        return "Unknown status";
+        return NULL;
     }
+    return &statusLines[status - STATUS_TABLE_FIRST];
+}
+
+const char *statusToStr(HttpStatus status)
+{
+    const StatusLine *statusLine = findStatusLine(status);
+    return statusLine == NULL ? "Unknown status" : statusLine->reason;
 }
 
 HttpStatus strnToStatus(const char *str, int n)
@@ -234,33 +139,109 @@ HttpResp newResp(HttpStatus status)
         .headers = emptyHeaders(),
         .content = NULL,
         .contentLength = 0,
+        .isContentFile = 0,
+        .file = NULL,
+        .contentOffset = 0,
+        .parts = NULL,
+        .producer = NULL,
+        .producerState = NULL,
     };
 }
 
-/* returns size of string */
-size_t buildRespStringFirstLineStr(HttpResp *resp, char *str, size_t size)
+#define DATE_HEADER_PREFIX "Date: "
+
+static int dateHeaderEnabled = 1;
+
+void respSetDateHeaderEnabled(int enabled)
+{
+    dateHeaderEnabled = enabled;
+}
+
+/* A Date set by the handler is sent as is */
+static int needsDateHeader(const HttpResp *resp)
+{
+    return dateHeaderEnabled && findHeader((HttpHeaders*) &resp->headers, "Date") == NULL;
+}
+
+static int usesDefaultVersion(const HttpResp *resp)
+{
+    return resp->version == NULL || strcmp(resp->version, "HTTP/1.1") == 0;
+}
+
+size_t respHeadSize(const HttpResp *resp)
 {
-    const char *version = resp->version;
-    if (version == NULL)
+    const StatusLine *statusLine = findStatusLine(resp->status);
+    size_t size;
+    if (statusLine != NULL && usesDefaultVersion(resp))
+    {
+        size = statusLine->lineLength;
+    }
+    else
     {
-        version = "HTTP/1.1";
+        const char *version = resp->version == NULL ? "HTTP/1.1" : resp->version;
+        size = strlen(version) + 1 + UNSIGNED_DIGITS_MAX + 1 + strlen(statusToStr(resp->status)) + 2;
     }
-    return snprintf(str, size, "%s %d %s\r\n", version, resp->status, statusToStr(resp->status));
+    for (int i = 0; i < resp->headers.count; i++)
+    {
+        size += resp->headers.arr[i].key.length + 2 + resp->headers.arr[i].value.length + 2;
+    }
+    if (needsDateHeader(resp))
+    {
+        size += sizeof(DATE_HEADER_PREFIX) - 1 + HTTP_DATE_LENGTH + 2;
+    }
+    return size + 2;
 }
 
-/* returns size of string */
-size_t buildRespStringUntilContent(HttpResp *resp, char **str)
+static char *appendBytes(char *out, const char *bytes, size_t length)
 {
-    ARRAY_T(char) buf = ARRAY_WITH_CAPACITY(char, 1024);
-    size_t bytes = buildRespStringFirstLineStr(resp, buf.data, 1024);
+    memcpy(out, bytes, length);
+    return out + length;
+}
+
+size_t writeRespHead(const HttpResp *resp, char *out)
+{
+    char *cursor = out;
+    const StatusLine *statusLine = findStatusLine(resp->status);
+    if (statusLine != NULL && usesDefaultVersion(resp))
+    {
+        cursor = appendBytes(cursor, statusLine->line, statusLine->lineLength);
+    }
+    else
+    {
+        const char *version = resp->version == NULL ? "HTTP/1.1" : resp->version;
+        const char *reason = statusToStr(resp->status);
+        cursor = appendBytes(cursor, version, strlen(version));
+        *cursor++ = ' ';
+        unsigned int code = resp->status < 0 ? 0 : (unsigned int) resp->status;
+        cursor += formatUnsigned(code, cursor);
+        *cursor++ = ' ';
+        cursor = appendBytes(cursor, reason, strlen(reason));
+        cursor = appendBytes(cursor, "\r\n", 2);
+    }
     for (int i = 0; i < resp->headers.count; i++)
     {
-        ARRAY_ENSURE_CAPACITY(char, &buf, buf.length + resp->headers.arr[i].key.length + resp->headers.arr[i].value.length + 4 + 2);
-        bytes += sprintf(buf.data + bytes, "%s: %s\r\n", resp->headers.arr[i].key.ptr, resp->headers.arr[i].value.ptr);
+        const HttpHeader *header = &resp->headers.arr[i];
+        cursor = appendBytes(cursor, header->key.ptr, header->key.length);
+        cursor = appendBytes(cursor, ": ", 2);
+        cursor = appendBytes(cursor, header->value.ptr, header->value.length);
+        cursor = appendBytes(cursor, "\r\n", 2);
+    }
+    if (needsDateHeader(resp))
+    {
+        cursor = appendBytes(cursor, DATE_HEADER_PREFIX, sizeof(DATE_HEADER_PREFIX) - 1);
+        getHttpDate(cursor);
+        cursor = appendBytes(cursor + HTTP_DATE_LENGTH, "\r\n", 2);
     }
-    bytes += sprintf(buf.data + bytes, "\r\n");
-    *str = buf.data;
-    return bytes;
+    cursor = appendBytes(cursor, "\r\n", 2);
+    return cursor - out;
+}
+
+/* returns size of string */
+size_t buildRespStringUntilContent(HttpResp *resp, char **str)
+{
+    char *buffer = gcArenaAllocate(respHeadSize(resp), alignof(char));
+    *str = buffer;
+    return writeRespHead(resp, buffer);
 }
 
 void respBuilderSetVersion(HttpRespBuilder *builder, const char *version, int shouldCopy)
@@ -330,18 +311,20 @@ void verifyHeader(HttpHeader header)
 #undef CANT_HAVE_HEADER
 }
 
-void addHeader(HttpRespBuilder *builder, const char *key, const char *value)
+/* key and value are not copied, they have to outlive the response */
+static void addHeader(HttpRespBuilder *builder, string key, string value)
 {
     HttpHeaders *headers = &builder->resp.headers;
+    KnownHeader known = classifyHeader(key.ptr, key.length);
 
-    if (findHeader(headers, key) != NULL) {
+    if (known != HEADER_UNKNOWN ? getHeader(headers, known) != NULL : findHeader(headers, key.ptr) != NULL) {
         return;
     }
 
     int *capacity = &builder->headersCapacity;
     if (headers->count == 0)
     {
-        *capacity = 1;
+        *capacity = 4;
         headers->arr = gcAllocate(sizeof(HttpHeader) * (*capacity));
     }
     else if (headers->count >= *capacity)
@@ -350,21 +333,9 @@ void addHeader(HttpRespBuilder *builder, const char *key, const char *value)
         headers->arr = gcReallocate(headers->arr, sizeof(HttpHeader) * (*capacity));
     }
 
-    string keyCopy = {
-        .ptr = gcArenaAllocate(strlen(key) + 1, alignof(char)),
-        .length = strlen(key)
-    };
-    strcpy(keyCopy.ptr, key);
-
-    string valueCopy = {
-        .ptr = gcArenaAllocate(strlen(value) + 1, alignof(char)),
-        .length = strlen(value)
-    };
-    strcpy(valueCopy.ptr, value);
-
-    HttpHeader header = {keyCopy, valueCopy};
-
-    headers->arr[headers->count++] = header;
+    headers->arr[headers->count] = (HttpHeader) {key, value};
+    indexHeader(headers, headers->count);
+    headers->count++;
 }
 
 void respBuilderAddHeader(HttpRespBuilder *builder, char *key, char *value)
@@ -392,7 +363,9 @@ void respBuilderAddHeader(HttpRespBuilder *builder, char *key, char *value)
         headers->arr = gcReallocate(headers->arr, sizeof(HttpHeader) * (*capacity));
     }
 
-    headers->arr[headers->count++] = header;
+    headers->arr[headers->count] = header;
+    indexHeader(headers, headers->count);
+    headers->count++;
 }
 
 void respBuilderSetContent(HttpRespBuilder *builder, const void *content, size_t contentLength, int shouldCopy)
@@ -409,11 +382,11 @@ void respBuilderSetContent(HttpRespBuilder *builder, const void *content, size_t
 }
 
 /* Read only files please */
-void respBuilderSetFileContent(HttpRespBuilder *builder, const char *filePath, int shouldCopy)
+void respBuilderSetFileContent(HttpRespBuilder *builder, const char *filePath, int)
 {
     assert(builder->resp.content == NULL && "The builder already has some content set");
-    struct stat st;
-    if (stat(filePath, &st))
+    CachedFile *file = acquireCachedFile(filePath);
+    if (file == NULL)
     {
         if (errno == ENOENT)
         {
@@ -423,21 +396,140 @@ void respBuilderSetFileContent(HttpRespBuilder *builder, const char *filePath, i
         {
             respBuilderSetStatus(builder, INTERNAL_SERVER_ERROR);
         }
+        return;
     }
-    else
+    builder->resp.file = file;
+    builder->resp.content = file->path;
+    builder->resp.isContentFile = 1;
+    builder->resp.contentLength = file->size;
+}
+
+void respBuilderSetProducer(HttpRespBuilder *builder, HttpRespProducer producer, void *state)
+{
+    assert(builder->resp.content == NULL && "The builder already has some content set");
+    builder->resp.producer = producer;
+    builder->resp.producerState = state;
+}
+
+/* Bit per ContentEncoding with a non zero quality, a "*" accepts every coding not listed */
+static unsigned int parseAcceptEncoding(const string *value)
+{
+    unsigned int accepted = 0;
+    unsigned int listed = 0;
+    int wildcard = 0;
+    ssize_t i = 0;
+    while (i < value->length)
     {
-        size_t size = st.st_size;
-        if (shouldCopy) {
-            size_t pathSize = strlen(filePath);
-            char *content = gcArenaAllocate(pathSize + 1, 1);
-            snprintf(content, pathSize + 1, "%.*s", (int) pathSize, filePath);
-            builder->resp.content = content;
-        } else {
-            builder->resp.content = filePath;
+        while (i < value->length && (value->ptr[i] == ' ' || value->ptr[i] == '\t' || value->ptr[i] == ','))
+        {
+            i++;
+        }
+        ssize_t start = i;
+        while (i < value->length && value->ptr[i] != ',' && value->ptr[i] != ';' && value->ptr[i] != ' ' && value->ptr[i] != '\t')
+        {
+            i++;
         }
-        builder->resp.isContentFile = 1;
-        builder->resp.contentLength = size;
+        string coding = {value->ptr + start, i - start};
+        int quality = 1;
+        while (i < value->length && value->ptr[i] != ',')
+        {
+            /* "q=0", "q=0.0" and so on refuse the coding */
+            if ((value->ptr[i] == 'q' || value->ptr[i] == 'Q') && i + 1 < value->length && value->ptr[i + 1] == '=')
+            {
+                quality = 0;
+                for (ssize_t q = i + 2; q < value->length && value->ptr[q] != ',' && value->ptr[q] != ';'; q++)
+                {
+                    if (value->ptr[q] >= '1' && value->ptr[q] <= '9')
+                    {
+                        quality = 1;
+                    }
+                }
+            }
+            i++;
+        }
+        unsigned int bit = 0;
+        if (coding.length == 4 && strncasecmp(coding.ptr, "gzip", 4) == 0)
+        {
+            bit = 1u << CONTENT_ENCODING_GZIP;
+        }
+        else if (coding.length == 2 && strncasecmp(coding.ptr, "br", 2) == 0)
+        {
+            bit = 1u << CONTENT_ENCODING_BROTLI;
+        }
+        else if (coding.length == 1 && coding.ptr[0] == '*')
+        {
+            wildcard = quality;
+            continue;
+        }
+        listed |= bit;
+        if (quality)
+        {
+            accepted |= bit;
+        }
+    }
+    if (wildcard)
+    {
+        accepted |= ~listed & ((1u << CONTENT_ENCODING_GZIP) | (1u << CONTENT_ENCODING_BROTLI));
+    }
+    return accepted;
+}
+
+void respSetHeader(HttpResp *resp, string key, string value)
+{
+    HttpHeaders *headers = &resp->headers;
+    for (int i = 0; i < headers->count; i++)
+    {
+        if (stringCompareIgnoreCase(&headers->arr[i].key, &key) == 0)
+        {
+            headers->arr[i].value = value;
+            return;
+        }
+    }
+    headers->arr = gcReallocate(headers->arr, sizeof(HttpHeader) * (headers->count + 1));
+    headers->arr[headers->count] = (HttpHeader) {key, value};
+    indexHeader(headers, headers->count);
+    headers->count++;
+}
+
+void respNegotiateEncoding(HttpResp *resp, HttpHeaders *requestHeaders)
+{
+    CachedFile *file = resp->file;
+    if (file == NULL || !resp->isContentFile || file->variants[CONTENT_ENCODING_IDENTITY].data == NULL)
+    {
+        return;
+    }
+    HttpHeader *acceptEncoding = getHeader(requestHeaders, HEADER_ACCEPT_ENCODING);
+    unsigned int accepted = acceptEncoding == NULL ? 0 : parseAcceptEncoding(&acceptEncoding->value);
+    ContentEncoding encoding = CONTENT_ENCODING_IDENTITY;
+    if ((accepted & (1u << CONTENT_ENCODING_BROTLI)) && file->variants[CONTENT_ENCODING_BROTLI].data != NULL)
+    {
+        encoding = CONTENT_ENCODING_BROTLI;
     }
+    else if ((accepted & (1u << CONTENT_ENCODING_GZIP)) && file->variants[CONTENT_ENCODING_GZIP].data != NULL)
+    {
+        encoding = CONTENT_ENCODING_GZIP;
+    }
+
+    EncodedContent *variant = &file->variants[encoding];
+    resp->content = variant->data;
+    resp->contentLength = variant->length;
+    resp->isContentFile = 0;
+    if (encoding == CONTENT_ENCODING_IDENTITY)
+    {
+        return;
+    }
+
+    char *digits = gcArenaAllocate(UNSIGNED_DIGITS_MAX, alignof(char));
+    respSetHeader(resp, STRING_LITERAL("Content-Length"), (string) {digits, formatUnsigned(variant->length, digits)});
+    respSetHeader(resp, STRING_LITERAL("ETag"), (string) {variant->etag, variant->etagLength});
+    const char *name = contentEncodingToStr(encoding);
+    respSetHeader(resp, STRING_LITERAL("Content-Encoding"), (string) {(char*) name, strlen(name)});
+}
+
+void respRelease(HttpResp *resp)
+{
+    releaseCachedFile(resp->file);
+    resp->file = NULL;
 }
 
 void respBuilderSetFlags(HttpRespBuilder *builder, unsigned int flags, int behaviour) {
@@ -461,12 +553,15 @@ static bool hasFlagsSet(HttpRespBuilder *builder, unsigned int flags) {
 }
 
 static const char *determineContentType(HttpRespBuilder *builder) {
+    if (builder->resp.file != NULL) {
+        return builder->resp.file->mimeType;
+    }
     if (builder->resp.isContentFile) {
         const char *extension = getExtension(builder->resp.content);
         const char *mimeType = getMimeType(extension);
         return mimeType;
     }
-    if (builder->resp.contentLength > 0) {
+    if (builder->resp.contentLength > 0 || builder->resp.producer != NULL || builder->contentSkipped) {
         return defaultMimeType;
     }
     return NULL;
@@ -477,28 +572,53 @@ static void setRespStatus(HttpRespBuilder *builder) {
     {
         return;
     }
-    if (builder->resp.contentLength == 0 && hasFlagsSet(builder, USE_NO_CONTENT_RESPONSE_FLAG)) {
+    if (builder->resp.contentLength == 0 && builder->resp.producer == NULL && !builder->contentSkipped
+        && hasFlagsSet(builder, USE_NO_CONTENT_RESPONSE_FLAG)) {
         builder->resp.status = NO_CONTENT;
         return;
     }
     builder->resp.status = OK;
 }
 
+void respBuilderSkipContent(HttpRespBuilder *builder)
+{
+    assert(builder->resp.content == NULL && "The builder already has some content set");
+    builder->contentSkipped = 1;
+}
+
 HttpResp respBuild(HttpRespBuilder *builder)
 {
     const size_t contentLength = builder->resp.contentLength;
-    if (contentLength > 0 || !hasFlagsSet(builder, USE_NO_CONTENT_RESPONSE_FLAG))
+    if (builder->resp.producer != NULL || builder->contentSkipped)
+    {
+        /* the length is unknown, a producer gets its Transfer-Encoding picked for the request's version when sending */
+        const char *contentType = determineContentType(builder);
+        addHeader(builder, STRING_LITERAL("Content-Type"), (string) {(char*) contentType, strlen(contentType)});
+    }
+    else if (contentLength > 0 || !hasFlagsSet(builder, USE_NO_CONTENT_RESPONSE_FLAG))
     {
-        char contentLengthStr[16];
-        snprintf(contentLengthStr, 16, "%zu", contentLength);
-        addHeader(builder, "Content-Length", contentLengthStr);
+        char *contentLengthStr = gcArenaAllocate(UNSIGNED_DIGITS_MAX, alignof(char));
+        string contentLengthValue = {
+            .ptr = contentLengthStr,
+            .length = formatUnsigned(contentLength, contentLengthStr),
+        };
+        addHeader(builder, STRING_LITERAL("Content-Length"), contentLengthValue);
         const char *contentType = determineContentType(builder);
         if (contentType != NULL) {
-            addHeader(builder, "Content-Type", contentType);
+            addHeader(builder, STRING_LITERAL("Content-Type"), (string) {(char*) contentType, strlen(contentType)});
+        }
+    }
+    if (builder->resp.file != NULL) {
+        CachedFile *file = builder->resp.file;
+        addHeader(builder, STRING_LITERAL("ETag"), (string) {file->etag, file->etagLength});
+        addHeader(builder, STRING_LITERAL("Last-Modified"), (string) {file->lastModified, strlen(file->lastModified)});
+        addHeader(builder, STRING_LITERAL("Accept-Ranges"), STRING_LITERAL("bytes"));
+        if (file->variants[CONTENT_ENCODING_GZIP].data != NULL || file->variants[CONTENT_ENCODING_BROTLI].data != NULL) {
+            addHeader(builder, STRING_LITERAL("Vary"), STRING_LITERAL("Accept-Encoding"));
         }
     }
     if (hasFlagsSet(builder, USE_DEFAULT_SERVER_HEADER_FLAG)) {
-        addHeader(builder, "Server", "http-server-c");
+        addHeader(builder, STRING_LITERAL("Server"), STRING_LITERAL("http-server-c"));
     }
     setRespStatus(builder);
     return builder->resp;
@@ -510,13 +630,19 @@ HttpRespBuilder newRespBuilder() {
         .resp = {
             .version = NULL,
             .status = STATUS_UNKNOWN,
-            .headers = (HttpHeaders){NULL, 0},
+            .headers = emptyHeaders(),
             .content = NULL,
             .contentLength = 0,
             .isContentFile = 0,
+            .file = NULL,
+            .contentOffset = 0,
+            .parts = NULL,
+            .producer = NULL,
+            .producerState = NULL,
         },
         .headersCapacity = 0,
         .flags = defaultRespBuilderFlags,
+        .contentSkipped = 0,
     };
     return builder;
 }
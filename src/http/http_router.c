@@ -4,6 +4,7 @@
 
 #include <alloc.h>
 #include <assert.h>
+#include <limits.h>
 #include <http_resp.h>
 #include <http_router.h>
 #include <stdio.h>
@@ -11,6 +12,25 @@
 
 #include "logging.h"
 
+#define INITIAL_CHILD_CAP 4
+#define WILDCARD_CHILD_COUNT PATH_PARAM_PATH
+
+/*
+    One node per path segment. Static children are sorted for a binary search,
+    <int>, <uuid> and <str> children are indexed by their PathParamType,
+    <path...> endpoints are kept on the node their remaining segments start from.
+    Both tables hold an endpoint index per method, -1 when the method has none.
+*/
+struct RouteNode {
+    string segment;
+    RouteNode **children;
+    int childCount;
+    int childCapacity;
+    RouteNode *wildcards[WILDCARD_CHILD_COUNT];
+    int endpoints[METHOD_COUNT];
+    int catchAll[METHOD_COUNT];
+};
+
 static HttpResp defaultNotFoundCallback(HttpReq)
 {
     HttpRespBuilder builder = newRespBuilder();
@@ -31,17 +51,323 @@ HttpResp htmlNotFoundCallback(HttpReq) {
 
 HttpResp routeReq(HttpRouter *router, HttpReq *req)
 {
-    for (int i = 0; i < router->length; i++)
+    unsigned int allowedMethods;
+    HttpEndpoint *endpoint = findEndpoint(router, req, &allowedMethods);
+    return dispatchReq(router, endpoint, req, allowedMethods);
+}
+
+/* Parses <type> or <type:name>, returns 0 for a static segment */
+static int parseWildcard(const string *element, PathParamType *type, string *name)
+{
+    if (element->length < 2 || element->ptr[0] != '<' || element->ptr[element->length - 1] != '>') {
+        return 0;
+    }
+    string inner = {.ptr = element->ptr + 1, .length = element->length - 2};
+    *name = EMPTY_STRING;
+    for (ssize_t i = 0; i < inner.length; i++) {
+        if (inner.ptr[i] == ':') {
+            *name = (string) {.ptr = inner.ptr + i + 1, .length = inner.length - i - 1};
+            inner.length = i;
+            break;
+        }
+    }
+    if (stringEquals(&inner, "int")) {
+        *type = PATH_PARAM_INT;
+    } else if (stringEquals(&inner, "uuid")) {
+        *type = PATH_PARAM_UUID;
+    } else if (stringEquals(&inner, "str")) {
+        *type = PATH_PARAM_STR;
+    } else if (stringEquals(&inner, "path...")) {
+        *type = PATH_PARAM_PATH;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/* Optional sign and digits only, no overflow */
+static int parseIntSegment(const string *element, long *value)
+{
+    ssize_t i = 0;
+    int negative = 0;
+    if (element->length > 0 && (element->ptr[0] == '-' || element->ptr[0] == '+')) {
+        negative = element->ptr[0] == '-';
+        i++;
+    }
+    if (i == element->length) {
+        return 0;
+    }
+    unsigned long magnitude = 0;
+    const unsigned long limit = negative ? (unsigned long) LONG_MAX + 1 : (unsigned long) LONG_MAX;
+    for (; i < element->length; i++) {
+        char c = element->ptr[i];
+        if (c < '0' || c > '9' || magnitude > (limit - (unsigned long) (c - '0')) / 10) {
+            return 0;
+        }
+        magnitude = magnitude * 10 + (unsigned long) (c - '0');
+    }
+    *value = negative ? (long) (0 - magnitude) : (long) magnitude;
+    return 1;
+}
+
+static int isHexDigit(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static int isUuidSegment(const string *element)
+{
+    if (element->length != 36) {
+        return 0;
+    }
+    for (int i = 0; i < 36; i++) {
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            if (element->ptr[i] != '-') {
+                return 0;
+            }
+        } else if (!isHexDigit(element->ptr[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static RouteNode *newRouteNode(string segment)
+{
+    RouteNode *node = gcAllocate(sizeof(RouteNode));
+    memset(node, 0, sizeof(RouteNode));
+    node->segment = segment;
+    for (int i = 0; i < METHOD_COUNT; i++) {
+        node->endpoints[i] = -1;
+        node->catchAll[i] = -1;
+    }
+    return node;
+}
+
+/* Index of the child with that segment, or of where it would be inserted, negated minus one */
+static int findStaticChild(const RouteNode *node, const string *segment)
+{
+    int low = 0, high = node->childCount - 1;
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        ssize_t diff = stringCompare(&node->children[middle]->segment, (string *) segment);
+        if (diff == 0) {
+            return middle;
+        }
+        if (diff < 0) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return -low - 1;
+}
+
+static RouteNode *addStaticChild(RouteNode *node, string segment)
+{
+    int index = findStaticChild(node, &segment);
+    if (index >= 0) {
+        return node->children[index];
+    }
+    index = -index - 1;
+    if (node->childCount >= node->childCapacity) {
+        node->childCapacity = node->childCapacity == 0 ? INITIAL_CHILD_CAP : node->childCapacity * 2;
+        node->children = gcReallocate(node->children, sizeof(RouteNode *) * node->childCapacity);
+    }
+    memmove(&node->children[index + 1], &node->children[index], sizeof(RouteNode *) * (node->childCount - index));
+    node->children[index] = newRouteNode(segment);
+    node->childCount++;
+    return node->children[index];
+}
+
+/* The first endpoint added for a path and method keeps it, like the first match of a linear search */
+static void setMethodEndpoints(int table[METHOD_COUNT], unsigned int methods, int endpointIndex)
+{
+    for (int method = 0; method < METHOD_COUNT; method++) {
+        if ((methods & METHOD_BIT(method)) && table[method] == -1) {
+            table[method] = endpointIndex;
+        }
+    }
+}
+
+static void insertRoute(HttpRouter *router, int endpointIndex)
+{
+    if (router->root == NULL) {
+        router->root = newRouteNode(EMPTY_STRING);
+    }
+    HttpPath *path = &router->endpoints[endpointIndex].path;
+    unsigned int methods = router->endpoints[endpointIndex].methods;
+    RouteNode *node = router->root;
+    for (int i = 0; i < path->elCount; i++) {
+        PathParamType type;
+        string name;
+        if (!parseWildcard(&path->elements[i], &type, &name)) {
+            node = addStaticChild(node, path->elements[i]);
+            continue;
+        }
+        if (type == PATH_PARAM_PATH) {
+            assert(i == path->elCount - 1 && "Programmer error: <path...> must be the last segment");
+            setMethodEndpoints(node->catchAll, methods, endpointIndex);
+            return;
+        }
+        if (node->wildcards[type] == NULL) {
+            node->wildcards[type] = newRouteNode(path->elements[i]);
+        }
+        node = node->wildcards[type];
+    }
+    setMethodEndpoints(node->endpoints, methods, endpointIndex);
+}
+
+static int selectMethodEndpoint(const int table[METHOD_COUNT], HttpMethod method)
+{
+    if (method < 0 || method >= METHOD_COUNT) {
+        return -1;
+    }
+    if (table[method] == -1 && method == HEAD) {
+        return table[GET];
+    }
+    return table[method];
+}
+
+/* HEAD comes with GET and OPTIONS is answered for any path with an endpoint */
+static unsigned int tableMethods(const int table[METHOD_COUNT])
+{
+    unsigned int methods = 0;
+    for (int method = 0; method < METHOD_COUNT; method++) {
+        if (table[method] != -1) {
+            methods |= METHOD_BIT(method);
+        }
+    }
+    if (methods & METHOD_BIT(GET)) {
+        methods |= METHOD_BIT(HEAD);
+    }
+    if (methods != 0) {
+        methods |= METHOD_BIT(OPTIONS);
+    }
+    return methods;
+}
+
+static int matchMethod(const int table[METHOD_COUNT], HttpMethod method, unsigned int *allowedMethods)
+{
+    int found = selectMethodEndpoint(table, method);
+    if (found == -1) {
+        *allowedMethods |= tableMethods(table);
+    }
+    return found;
+}
+
+/*
+    Depth first, a more specific branch that fails further down falls back to the next one.
+    Paths matched without an endpoint for the method add their methods to allowedMethods.
+*/
+static int matchRoute(const RouteNode *node, const HttpPath *path, int depth, HttpMethod method, unsigned int *allowedMethods)
+{
+    if (depth == path->elCount) {
+        return matchMethod(node->endpoints, method, allowedMethods);
+    }
+    const string *element = &path->elements[depth];
+    int found = -1;
+
+    int index = findStaticChild(node, element);
+    if (index >= 0) {
+        found = matchRoute(node->children[index], path, depth + 1, method, allowedMethods);
+    }
+    long intValue;
+    if (found == -1 && node->wildcards[PATH_PARAM_INT] != NULL && parseIntSegment(element, &intValue)) {
+        found = matchRoute(node->wildcards[PATH_PARAM_INT], path, depth + 1, method, allowedMethods);
+    }
+    if (found == -1 && node->wildcards[PATH_PARAM_UUID] != NULL && isUuidSegment(element)) {
+        found = matchRoute(node->wildcards[PATH_PARAM_UUID], path, depth + 1, method, allowedMethods);
+    }
+    if (found == -1 && node->wildcards[PATH_PARAM_STR] != NULL) {
+        found = matchRoute(node->wildcards[PATH_PARAM_STR], path, depth + 1, method, allowedMethods);
+    }
+    if (found == -1) {
+        found = matchMethod(node->catchAll, method, allowedMethods);
+    }
+    return found;
+}
+
+/* Captures are read back from the matched endpoint path, wildcards sit at the same element index */
+static void captureParams(HttpEndpoint *endpoint, HttpReq *req)
+{
+    HttpPath *pattern = &endpoint->path;
+    HttpPath *path = &req->path;
+    req->params = (HttpPathParams) {NULL, 0};
+    for (int i = 0; i < pattern->elCount; i++) {
+        PathParamType type;
+        string name;
+        if (!parseWildcard(&pattern->elements[i], &type, &name)) {
+            continue;
+        }
+        if (req->params.items == NULL) {
+            req->params.items = gcArenaAllocate(sizeof(HttpPathParam) * pattern->elCount, alignof(HttpPathParam));
+        }
+        HttpPathParam *param = &req->params.items[req->params.count++];
+        *param = (HttpPathParam) {.name = name, .type = type, .value = path->elements[i], .intValue = 0};
+        if (type == PATH_PARAM_INT) {
+            parseIntSegment(&param->value, &param->intValue);
+        } else if (type == PATH_PARAM_PATH) {
+            const string *last = &path->elements[path->elCount - 1];
+            param->value.length = last->ptr + last->length - param->value.ptr;
+        }
+    }
+}
+
+HttpEndpoint *findEndpoint(HttpRouter *router, HttpReq *req, unsigned int *allowedMethods)
+{
+    *allowedMethods = 0;
+    if (router->root == NULL) {
+        return NULL;
+    }
+    int index = matchRoute(router->root, &req->path, 0, req->method, allowedMethods);
+    if (index == -1) {
+        return NULL;
+    }
+    HttpEndpoint *endpoint = &router->endpoints[index];
+    captureParams(endpoint, req);
+    return endpoint;
+}
+
+/* Comma separated method names for the Allow header */
+static char *formatAllowedMethods(unsigned int methods)
+{
+    static const size_t maxLength = sizeof("CONNECT, ") * METHOD_COUNT;
+    char *allow = gcArenaAllocate(maxLength, alignof(char));
+    size_t length = 0;
+    allow[0] = '\0';
+    for (int method = 0; method < METHOD_COUNT; method++) {
+        if (methods & METHOD_BIT(method)) {
+            length += snprintf(allow + length, maxLength - length, "%s%s", length == 0 ? "" : ", ", methodToStr(method));
+        }
+    }
+    return allow;
+}
+
+static HttpResp allowResp(HttpStatus status, unsigned int allowedMethods)
+{
+    HttpRespBuilder builder = newRespBuilder();
+    respBuilderSetStatus(&builder, status);
+    respBuilderAddHeader(&builder, "Allow", formatAllowedMethods(allowedMethods));
+    return respBuild(&builder);
+}
+
+HttpResp dispatchReq(HttpRouter *router, HttpEndpoint *endpoint, HttpReq *req, unsigned int allowedMethods)
+{
+    if (endpoint == NULL)
     {
-        HttpEndpoint *endpoint = &router->endpoints[i];
-        TRACE("routeReq i=%d", i);
-        if (pathMatches(&endpoint->path, &req->path))
+        if (allowedMethods == 0)
         {
-            TRACE("routeReq calling handler %p %s", endpoint->handler, endpoint->raw);
-            return endpoint->handler(*req);
+            return router->notFoundCallback(*req);
         }
+        if (req->method == OPTIONS)
+        {
+            return allowResp(NO_CONTENT, allowedMethods);
+        }
+        return allowResp(METHOD_NOT_ALLOWED, allowedMethods);
     }
-    return router->notFoundCallback(*req);
+    TRACE("dispatchReq calling handler %p %s", endpoint->handler, endpoint->raw);
+    return endpoint->handler(*req);
 }
 
 HttpEndpoint newEndpoint(const char *str, HttpReqHandler handler)
@@ -53,6 +379,11 @@ HttpEndpoint newEndpoint(const char *str, HttpReqHandler handler)
         .path = path,
         .handler = handler,
         .raw = str,
+        .timeouts = {0},
+        .methods = ANY_METHOD,
+        .maxBodySize = 0,
+        .streamBody = 0,
+        .metricsRoute = 0,
     };
 }
 
@@ -63,12 +394,16 @@ HttpEndpoint newEndpoint(const char *str, HttpReqHandler handler)
 HttpRouter newRouter(HttpEndpoint *endpoints, int length)
 {
     assert(endpoints != NULL || (endpoints == NULL && length == 0));
-    return (HttpRouter){endpoints, defaultNotFoundCallback, length, -1};
+    HttpRouter router = {endpoints, defaultNotFoundCallback, length, -1, NULL};
+    for (int i = 0; i < length; i++) {
+        insertRoute(&router, i);
+    }
+    return router;
 }
 
 HttpRouter emptyRouter()
 {
-    return (HttpRouter){NULL, defaultNotFoundCallback, 0, 0};
+    return (HttpRouter){NULL, defaultNotFoundCallback, 0, 0, NULL};
 }
 
 void routerAddEndpoint(HttpRouter *router, HttpEndpoint endpoint)
@@ -85,4 +420,5 @@ void routerAddEndpoint(HttpRouter *router, HttpEndpoint endpoint)
         router->endpoints = gcReallocate(router->endpoints, router->capacity * sizeof(HttpEndpoint));
     }
     router->endpoints[router->length++] = endpoint;
+    insertRoute(router, router->length - 1);
 }
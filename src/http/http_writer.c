@@ -0,0 +1,116 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include <http_writer.h>
+#include <string.h>
+
+/* Longest chunk size line, 16 hex digits and CRLF */
+#define CHUNK_SIZE_LINE_MAX 18
+
+static size_t formatChunkSize(size_t size, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    char reversed[16];
+    size_t length = 0;
+    do {
+        reversed[length++] = digits[size & 0xf];
+        size >>= 4;
+    } while (size > 0);
+    for (size_t i = 0; i < length; i++) {
+        out[i] = reversed[length - 1 - i];
+    }
+    out[length] = '\r';
+    out[length + 1] = '\n';
+    return length + 2;
+}
+
+void initRespWriter(HttpRespWriter *writer, TcpSocket *socket, const char *head, size_t headSize,
+                    char *buffer, size_t capacity, int chunked) {
+    *writer = (HttpRespWriter) {
+        .socket = socket,
+        .head = head,
+        .headSize = headSize,
+        .buffer = buffer,
+        .length = 0,
+        .capacity = capacity,
+        .chunked = chunked,
+        .sent = 0,
+        .result = WRITE_OK,
+        .backedOff = 0,
+    };
+}
+
+/* The pending head, the chunk framing and the data go out in one sendmsg, terminator ends the content */
+static int sendChunk(HttpRespWriter *writer, const void *data, size_t size, int terminator) {
+    if (writer->result != WRITE_OK) {
+        return -1;
+    }
+    static const char crlf[] = "\r\n";
+    static const char lastChunk[] = "0\r\n\r\n";
+    char sizeLine[CHUNK_SIZE_LINE_MAX];
+    struct iovec iov[5];
+    int iovCount = 0;
+    if (writer->head != NULL) {
+        iov[iovCount++] = (struct iovec) {.iov_base = (void*) writer->head, .iov_len = writer->headSize};
+    }
+    if (size > 0) {
+        if (writer->chunked) {
+            iov[iovCount++] = (struct iovec) {.iov_base = sizeLine, .iov_len = formatChunkSize(size, sizeLine)};
+        }
+        iov[iovCount++] = (struct iovec) {.iov_base = (void*) data, .iov_len = size};
+        if (writer->chunked) {
+            iov[iovCount++] = (struct iovec) {.iov_base = (void*) crlf, .iov_len = 2};
+        }
+    }
+    if (terminator && writer->chunked) {
+        iov[iovCount++] = (struct iovec) {.iov_base = (void*) lastChunk, .iov_len = sizeof(lastChunk) - 1};
+    }
+    if (iovCount == 0) {
+        return writer->backedOff ? RESP_PRODUCER_MORE : 0;
+    }
+    WriteResult result = transmitVector(writer->socket, iov, iovCount);
+    writer->head = NULL;
+    writer->sent += result.sent;
+    if (result.result == WRITE_WOULD_BLOCK) {
+        /* queued past the connection's limit, the bytes are taken */
+        writer->backedOff = 1;
+        return RESP_PRODUCER_MORE;
+    }
+    writer->result = result.result;
+    if (result.result != WRITE_OK) {
+        return -1;
+    }
+    return writer->backedOff ? RESP_PRODUCER_MORE : 0;
+}
+
+int respFlush(HttpRespWriter *writer) {
+    int result = sendChunk(writer, writer->buffer, writer->length, 0);
+    writer->length = 0;
+    return result;
+}
+
+int respWrite(HttpRespWriter *writer, const void *data, size_t size) {
+    if (writer->result != WRITE_OK) {
+        return -1;
+    }
+    if (writer->length + size <= writer->capacity) {
+        memcpy(writer->buffer + writer->length, data, size);
+        writer->length += size;
+        return writer->backedOff ? RESP_PRODUCER_MORE : 0;
+    }
+    if (writer->length > 0 && respFlush(writer) < 0) {
+        return -1;
+    }
+    if (size >= writer->capacity) {
+        return sendChunk(writer, data, size, 0);
+    }
+    memcpy(writer->buffer, data, size);
+    writer->length = size;
+    return writer->backedOff ? RESP_PRODUCER_MORE : 0;
+}
+
+WriteResult finishRespWriter(HttpRespWriter *writer) {
+    sendChunk(writer, writer->buffer, writer->length, 1);
+    writer->length = 0;
+    return (WriteResult) {.result = writer->result, .sent = writer->sent};
+}
@@ -0,0 +1,263 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "io_backend.h"
+
+#include <errno.h>
+#include <logging.h>
+#include <stdio.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+/*
+    Calls recv, send and sendfile straight away.
+    Blocking sockets get their timeouts from SO_RCVTIMEO and SO_SNDTIMEO,
+    so the kernel reports EAGAIN where poll would have timed out.
+    Non blocking sockets only wait for writability after a short write.
+*/
+
+/* Small overshoots of the deadline are cheaper than a setsockopt before every recv */
+#define DEADLINE_SLACK_MS 1000
+
+static int applyTimeout(TcpSocket *sock, int option, int timeoutMs) {
+    struct timeval timeout = {
+        .tv_sec = timeoutMs / 1000,
+        .tv_usec = (timeoutMs % 1000) * 1000,
+    };
+    if (setsockopt(sock->fd, SOL_SOCKET, option, &timeout, sizeof(timeout)) == -1) {
+        perror("applyTimeout: setsockopt");
+        return -1;
+    }
+    if (option == SO_RCVTIMEO) {
+        sock->receiveTimeoutMs = timeoutMs;
+    } else {
+        sock->transmitTimeoutMs = timeoutMs;
+    }
+    return 0;
+}
+
+static void directPrepare(TcpSocket *sock) {
+    if (sock->nonBlocking) {
+        return;
+    }
+    applyTimeout(sock, SO_RCVTIMEO, RECEIVE_TIMEOUT_MS);
+    applyTimeout(sock, SO_SNDTIMEO, TRANSMIT_TIMEOUT_MS);
+}
+
+/*
+    The kernel timeout is only lowered when the deadline is clearly closer,
+    and raised again when it expires before the deadline.
+*/
+static ReadResult directReceive(TcpSocket *sock, void *buffer, size_t size) {
+    ssize_t recvd;
+    int recvErrno;
+    for (;;) {
+        if (!sock->nonBlocking) {
+            int wait = socketReceiveWait(sock);
+            if (wait == 0) {
+                sock->closed = 1;
+                return (ReadResult) {
+                    .result = READ_TIMEOUT,
+                    .received = -1,
+                };
+            }
+            int applied = sock->receiveTimeoutMs;
+            if (applied == 0 || wait + DEADLINE_SLACK_MS < applied || (sock->deadline == 0 && wait != applied)) {
+                applyTimeout(sock, SO_RCVTIMEO, wait);
+            }
+        }
+        recvd = recv(sock->fd, buffer, size, 0);
+        recvErrno = errno;
+        if (recvd != -1) {
+            break;
+        }
+        if (recvErrno == EINTR) {
+            continue;
+        }
+        if (recvErrno != EAGAIN && recvErrno != EWOULDBLOCK) {
+            break;
+        }
+        if (sock->nonBlocking) {
+            return (ReadResult) {
+                .result = READ_WOULD_BLOCK,
+                .received = 0,
+            };
+        }
+        int wait = socketReceiveWait(sock);
+        if (wait == 0 || sock->deadline == 0) {
+            sock->closed = 1;
+            return (ReadResult) {
+                .result = READ_TIMEOUT,
+                .received = -1,
+            };
+        }
+        applyTimeout(sock, SO_RCVTIMEO, wait);
+    }
+    debug("recv(%d, %p, %zu, 0) returned %zd", sock->fd, buffer, size, recvd);
+
+    if (recvd == 0) {
+        sock->closed = 1;
+        return (ReadResult) {
+            .result = READ_CLOSED,
+            .received = 0,
+        };
+    }
+
+    if (recvd == -1) {
+        errno = recvErrno;
+        perror("receive: recv");
+        sock->closed = 1;
+        return (ReadResult) {
+            .result = READ_RECV_ERROR,
+            .received = -1,
+        };
+    }
+
+    logSocketTraffic(sock, 0, buffer, recvd);
+
+    return (ReadResult) {
+        .result = READ_OK,
+        .received = recvd,
+    };
+}
+
+/*
+    Returns WRITE_OK when the caller should try again.
+*/
+static WriteEnum directWriteFailure(TcpSocket *sock, int sendErrno) {
+    if (sendErrno == EINTR) {
+        return WRITE_OK;
+    }
+    if (sendErrno != EAGAIN && sendErrno != EWOULDBLOCK) {
+        return WRITE_SEND_ERROR;
+    }
+    return sock->nonBlocking ? WRITE_WOULD_BLOCK : WRITE_TIMEOUT;
+}
+
+static void applyTransmitTimeout(TcpSocket *sock) {
+    int timeoutMs = socketTransmitWait(sock);
+    if (!sock->nonBlocking && timeoutMs != sock->transmitTimeoutMs) {
+        applyTimeout(sock, SO_SNDTIMEO, timeoutMs);
+    }
+}
+
+static WriteResult directTransmit(TcpSocket *sock, const void *buffer, size_t size) {
+    size_t totalSent = 0;
+    applyTransmitTimeout(sock);
+
+    while (totalSent < size) {
+        size_t packetSize = (size - totalSent) > TRANSMIT_PACKET_SIZE ? TRANSMIT_PACKET_SIZE : (size - totalSent);
+        ssize_t sent = send(sock->fd, (char*)buffer + totalSent, packetSize, MSG_NOSIGNAL);
+        int sendErrno = errno;
+        debug("send(%d, %p, %zu, MSG_NOSIGNAL) return %zd", sock->fd, buffer, packetSize, sent);
+
+        if (sent == -1) {
+            WriteEnum retry = directWriteFailure(sock, sendErrno);
+            if (retry == WRITE_OK) {
+                continue;
+            }
+            if (retry == WRITE_SEND_ERROR) {
+                errno = sendErrno;
+                perror("transmit: send");
+            }
+            sock->closed = retry != WRITE_WOULD_BLOCK;
+            return (WriteResult) {
+                .result = retry,
+                .sent = totalSent,
+            };
+        }
+
+        if (sent == 0) {
+            sock->closed = 1;
+            return (WriteResult) {
+                .result = WRITE_CLOSED,
+                .sent = totalSent,
+            };
+        }
+
+        logSocketTraffic(sock, 1, (char*)buffer + totalSent, sent);
+
+        totalSent += sent;
+    }
+
+    return (WriteResult) {
+        .result = WRITE_OK,
+        .sent = totalSent,
+    };
+}
+
+static WriteResult directTransmitVector(TcpSocket *sock, struct iovec **iov, int *iovCount) {
+    size_t totalSent = 0;
+    applyTransmitTimeout(sock);
+
+    while (*iovCount > 0) {
+        struct msghdr message = {.msg_iov = *iov, .msg_iovlen = *iovCount};
+        ssize_t sent = sendmsg(sock->fd, &message, MSG_NOSIGNAL);
+        int sendErrno = errno;
+        debug("sendmsg(%d, {.msg_iovlen = %d}, MSG_NOSIGNAL) returned %zd", sock->fd, *iovCount, sent);
+
+        if (sent == -1) {
+            WriteEnum retry = directWriteFailure(sock, sendErrno);
+            if (retry == WRITE_OK) {
+                continue;
+            }
+            if (retry == WRITE_SEND_ERROR) {
+                errno = sendErrno;
+                perror("transmitVector: sendmsg");
+            }
+            sock->closed = retry != WRITE_WOULD_BLOCK;
+            return (WriteResult) {.result = retry, .sent = totalSent};
+        }
+
+        if (sent == 0 && (*iov)->iov_len > 0) {
+            sock->closed = 1;
+            return (WriteResult) {.result = WRITE_CLOSED, .sent = totalSent};
+        }
+
+        *iovCount = consumeSentVector(sock, iov, *iovCount, sent);
+        totalSent += sent;
+    }
+
+    return (WriteResult) {.result = WRITE_OK, .sent = totalSent};
+}
+
+static WriteResult directTransmitFile(TcpSocket *sock, int fd, off_t offset, size_t count) {
+    size_t remaining = count;
+    applyTransmitTimeout(sock);
+
+    while (remaining > 0) {
+        off_t tempOffset = offset;
+        ssize_t sent = sendfile(sock->fd, fd, &offset, remaining);
+        int sendErrno = errno;
+        debug("sendfile(%d, %d, %ld, %zu) returned %zd and changed offset to %ld", sock->fd, fd, tempOffset, remaining, sent, offset);
+        if (sent == -1) {
+            WriteEnum retry = directWriteFailure(sock, sendErrno);
+            if (retry == WRITE_OK) {
+                continue;
+            }
+            if (retry == WRITE_SEND_ERROR) {
+                errno = sendErrno;
+                perror("sendfile");
+                retry = WRITE_SENDFILE_ERROR;
+            }
+            return (WriteResult) {.result = retry, .sent = count - remaining};
+        }
+        if (sent == 0) {
+            return (WriteResult) {.result = WRITE_SENDFILE_ERROR, .sent = count - remaining};
+        }
+        remaining -= sent;
+    }
+    return (WriteResult) {.result = WRITE_OK, .sent = count};
+}
+
+const IoBackend directIoBackend = {
+    .name = "direct",
+    .prepare = directPrepare,
+    .accept = acceptSocket,
+    .receive = directReceive,
+    .transmit = directTransmit,
+    .transmitFile = directTransmitFile,
+    .transmitVector = directTransmitVector,
+};
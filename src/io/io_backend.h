@@ -0,0 +1,48 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_IO_BACKEND_H
+#define HTTPSERVERC_IO_BACKEND_H
+
+#include <connection.h>
+
+#define RECEIVE_TIMEOUT_MS (60 * 1000)
+#define TRANSMIT_TIMEOUT_MS (10 * 1000)
+#define TRANSMIT_PACKET_SIZE (1 << 20)
+
+/*
+    Syscall strategy behind accept, receive, transmit, transmitVector and transmitFile.
+    accept returns the client descriptor or -1 with errno, prepare runs once for every accepted socket. Writes to a full non-blocking socket
+    return WRITE_WOULD_BLOCK with what was sent so far, connection.c decides whether to wait.
+*/
+typedef struct IoBackend {
+    const char *name;
+    void (*prepare)(TcpSocket *sock);
+    int (*accept)(int listenFd, int flags);
+    ReadResult (*receive)(TcpSocket *sock, void *buffer, size_t size);
+    WriteResult (*transmit)(TcpSocket *sock, const void *buffer, size_t size);
+    WriteResult (*transmitFile)(TcpSocket *sock, int fd, off_t offset, size_t count);
+    /* iov and iovCount are moved past the sent bytes, entries are consumed in place when a write is short */
+    WriteResult (*transmitVector)(TcpSocket *sock, struct iovec **iov, int *iovCount);
+} IoBackend;
+
+extern const IoBackend pollIoBackend;
+extern const IoBackend directIoBackend;
+extern const IoBackend uringIoBackend;
+
+/* 1 when the kernel lets this process set up an io_uring */
+int uringAvailable();
+/* accept4 with the given flags, the accept of the backends that do not queue accepts */
+int acceptSocket(int listenFd, int flags);
+
+/* Milliseconds receive may still wait, RECEIVE_TIMEOUT_MS without a deadline, 0 once it passed */
+int socketReceiveWait(const TcpSocket *sock);
+/* Milliseconds a transmit may stall */
+int socketTransmitWait(const TcpSocket *sock);
+/* Queues the bytes for the wire capture when it is enabled, outgoing is 1 for sent data. See setWireCapture */
+void logSocketTraffic(TcpSocket *sock, int outgoing, const void *buffer, ssize_t size);
+/* Logs the sent bytes and skips them in iov, returns the remaining entry count */
+int consumeSentVector(TcpSocket *sock, struct iovec **iov, int iovCount, size_t sent);
+
+#endif //HTTPSERVERC_IO_BACKEND_H
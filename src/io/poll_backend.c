@@ -0,0 +1,201 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "io_backend.h"
+
+#include <errno.h>
+#include <logging.h>
+#include <stdio.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+
+/*
+    Waits with poll before every recv, send and sendfile.
+    Two syscalls per operation, but works the same for any socket.
+    Non-blocking sockets are never waited on, they report READ_WOULD_BLOCK and WRITE_WOULD_BLOCK.
+*/
+
+static void pollPrepare(TcpSocket *sock) {
+    (void) sock;
+}
+
+static WriteEnum pollWaitWritable(TcpSocket *sock) {
+    return sock->nonBlocking ? WRITE_OK : canWrite(sock->fd, socketTransmitWait(sock));
+}
+
+static ReadResult pollReceive(TcpSocket *sock, void *buffer, size_t size) {
+    if (!sock->nonBlocking) {
+        int wait = socketReceiveWait(sock);
+        ReadEnum readable = wait > 0 ? canRead(sock->fd, wait) : READ_TIMEOUT;
+
+        if (readable != READ_OK) {
+            sock->closed = 1;
+            return (ReadResult) {
+                .result = readable,
+                .received = -1,
+            };
+        }
+    }
+
+    ssize_t recvd = recv(sock->fd, buffer, size, 0);
+    debug("recv(%d, %p, %zu, 0) returned %zd", sock->fd, buffer, size, recvd);
+
+    if (recvd == -1 && sock->nonBlocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return (ReadResult) {
+            .result = READ_WOULD_BLOCK,
+            .received = 0,
+        };
+    }
+
+    if (recvd == 0) {
+        sock->closed = 1;
+        return (ReadResult) {
+            .result = READ_CLOSED,
+            .received = 0,
+        };
+    }
+
+    if (recvd == -1) {
+        perror("receive: recv");
+        sock->closed = 1;
+        return (ReadResult) {
+            .result = READ_RECV_ERROR,
+            .received = -1,
+        };
+    }
+
+    logSocketTraffic(sock, 0, buffer, recvd);
+
+    return (ReadResult) {
+        .result = READ_OK,
+        .received = recvd,
+    };
+}
+
+static WriteResult pollTransmit(TcpSocket *sock, const void *buffer, size_t size) {
+    size_t totalSent = 0;
+
+    while (totalSent < size) {
+        // Wait until writable (10s timeout per chunk by default)
+        WriteEnum writable = pollWaitWritable(sock);
+        if (writable != WRITE_OK) {
+            sock->closed = 1;
+            return (WriteResult) {
+                .result = writable,
+                .sent = totalSent, // return how much was actually sent
+            };
+        }
+
+        // Send up to 1 MB at a time
+        size_t packetSize = (size - totalSent) > TRANSMIT_PACKET_SIZE ? TRANSMIT_PACKET_SIZE : (size - totalSent);
+        ssize_t sent = send(sock->fd, (char*)buffer + totalSent, packetSize, 0);
+        debug("send(%d, %p, %zu, 0) return %zd", sock->fd, buffer, packetSize, sent);
+
+        if (sent == -1 && sock->nonBlocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return (WriteResult) {
+                .result = WRITE_WOULD_BLOCK,
+                .sent = totalSent,
+            };
+        }
+
+        if (sent == -1) {
+            perror("transmit: send");
+            sock->closed = 1;
+            return (WriteResult) {
+                .result = WRITE_SEND_ERROR,
+                .sent = totalSent,
+            };
+        }
+
+        if (sent == 0) {
+            sock->closed = 1;
+            return (WriteResult) {
+                .result = WRITE_CLOSED,
+                .sent = totalSent,
+            };
+        }
+
+        logSocketTraffic(sock, 1, (char*)buffer + totalSent, sent);
+
+        totalSent += sent;
+    }
+
+    return (WriteResult) {
+        .result = WRITE_OK,
+        .sent = totalSent,
+    };
+}
+
+static WriteResult pollTransmitVector(TcpSocket *sock, struct iovec **iov, int *iovCount) {
+    size_t totalSent = 0;
+
+    while (*iovCount > 0) {
+        WriteEnum writable = pollWaitWritable(sock);
+        if (writable != WRITE_OK) {
+            sock->closed = 1;
+            return (WriteResult) {.result = writable, .sent = totalSent};
+        }
+
+        struct msghdr message = {.msg_iov = *iov, .msg_iovlen = *iovCount};
+        ssize_t sent = sendmsg(sock->fd, &message, MSG_NOSIGNAL);
+        debug("sendmsg(%d, {.msg_iovlen = %d}, MSG_NOSIGNAL) returned %zd", sock->fd, *iovCount, sent);
+
+        if (sent == -1 && errno == EINTR) {
+            continue;
+        }
+
+        if (sent == -1 && sock->nonBlocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return (WriteResult) {.result = WRITE_WOULD_BLOCK, .sent = totalSent};
+        }
+
+        if (sent == -1) {
+            perror("transmitVector: sendmsg");
+            sock->closed = 1;
+            return (WriteResult) {.result = WRITE_SEND_ERROR, .sent = totalSent};
+        }
+
+        if (sent == 0 && (*iov)->iov_len > 0) {
+            sock->closed = 1;
+            return (WriteResult) {.result = WRITE_CLOSED, .sent = totalSent};
+        }
+
+        *iovCount = consumeSentVector(sock, iov, *iovCount, sent);
+        totalSent += sent;
+    }
+
+    return (WriteResult) {.result = WRITE_OK, .sent = totalSent};
+}
+
+static WriteResult pollTransmitFile(TcpSocket *sock, int fd, off_t offset, size_t count) {
+    size_t remaining = count;
+
+    while (remaining > 0) {
+        WriteEnum writable = pollWaitWritable(sock);
+        if (writable != WRITE_OK) {
+            return (WriteResult) {.result = writable, .sent = count - remaining};
+        }
+        off_t tempOffset = offset;
+        ssize_t sent = sendfile(sock->fd, fd, &offset, remaining);
+        debug("sendfile(%d, %d, %ld, %zu) returned %zd and changed offset to %ld", sock->fd, fd, tempOffset, remaining, sent, offset);
+        if (sent == -1 && sock->nonBlocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return (WriteResult) {.result = WRITE_WOULD_BLOCK, .sent = count - remaining};
+        }
+        if (sent <= 0) {
+            perror("sendfile");
+            return (WriteResult) {.result = WRITE_SENDFILE_ERROR, .sent = count - remaining};
+        }
+        remaining -= sent;
+    }
+    return (WriteResult) {.result = WRITE_OK, .sent = count};
+}
+
+const IoBackend pollIoBackend = {
+    .name = "poll",
+    .prepare = pollPrepare,
+    .accept = acceptSocket,
+    .receive = pollReceive,
+    .transmit = pollTransmit,
+    .transmitFile = pollTransmitFile,
+    .transmitVector = pollTransmitVector,
+};
@@ -0,0 +1,686 @@
+//
+// Created by Rescyy on 10/18/2026.
+//
+
+#define _GNU_SOURCE
+
+#include "io_backend.h"
+
+#include <alloc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <logging.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+    Submits recv, send, sendmsg and splice through an io_uring owned by the calling thread.
+    Blocking sockets get their deadline from a linked timeout instead of a setsockopt or a poll,
+    so a receive or a send costs one io_uring_enter. Files go through a pipe as chains of
+    file to pipe and pipe to socket splices, several pipe sized windows per submission.
+    Operations on non-blocking sockets carry MSG_DONTWAIT and complete right away with -EAGAIN,
+    reported as READ_WOULD_BLOCK and WRITE_WOULD_BLOCK. A blocking listener keeps a multishot accept armed, so accept only reaps.
+    Threads that can not set up a ring use the poll backend.
+
+    The callers expect every operation to be done when it returns, so only the batching and
+    the linking of io_uring are used here, completions are always waited for right away.
+*/
+
+#define URING_ENTRIES 64
+/* file to pipe and pipe to socket splices submitted at once, each moves at most a pipe */
+#define URING_SPLICE_WINDOWS 4
+#define URING_PIPE_SIZE (1 << 20)
+#define URING_ACCEPT_TAG UINT64_MAX
+
+typedef struct UringRing {
+    int fd;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned sqMask;
+    unsigned sqLocalTail;
+    struct io_uring_sqe *sqes;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe *cqes;
+    void *sqMemory;
+    size_t sqMemorySize;
+    void *cqMemory;
+    size_t cqMemorySize;
+    size_t sqesSize;
+    /* user_data is the generation in the high half and the index in the batch in the low half */
+    unsigned generation;
+    unsigned batched;
+    int pipe[2];
+    size_t pipeSize;
+    int multishotAccept; /* 0 once the kernel refused IORING_ACCEPT_MULTISHOT */
+    int acceptListener; /* listener with an armed multishot accept, -1 when none */
+    int acceptFlags;
+    /* accepted descriptors reaped while waiting for something else */
+    int *accepted;
+    size_t acceptedHead;
+    size_t acceptedCount;
+    size_t acceptedCapacity;
+} UringRing;
+
+static _Thread_local UringRing *threadRing = NULL;
+static _Thread_local int threadRingFailed = 0;
+static pthread_key_t ringKey;
+static pthread_once_t ringKeyOnce = PTHREAD_ONCE_INIT;
+
+static int uringSetup(unsigned entries, struct io_uring_params *params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static void closeAccepted(UringRing *ring) {
+    for (size_t i = ring->acceptedHead; i < ring->acceptedCount; i++) {
+        if (ring->accepted[i] >= 0) {
+            close(ring->accepted[i]);
+        }
+    }
+    ring->acceptedHead = ring->acceptedCount = 0;
+}
+
+static void destroyRing(UringRing *ring) {
+    /* connections the multishot accept took after the last reap */
+    unsigned head = *ring->cqHead;
+    unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        const struct io_uring_cqe *cqe = &ring->cqes[head & ring->cqMask];
+        if (cqe->user_data == URING_ACCEPT_TAG && cqe->res >= 0) {
+            close(cqe->res);
+        }
+    }
+    closeAccepted(ring);
+    deallocate(ring->accepted);
+    munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqMemory != ring->sqMemory) {
+        munmap(ring->cqMemory, ring->cqMemorySize);
+    }
+    munmap(ring->sqMemory, ring->sqMemorySize);
+    if (ring->pipe[0] != -1) {
+        close(ring->pipe[0]);
+        close(ring->pipe[1]);
+    }
+    close(ring->fd);
+    deallocate(ring);
+}
+
+static void releaseThreadRing(void *arg) {
+    destroyRing(arg);
+    threadRing = NULL;
+}
+
+static void createRingKey() {
+    pthread_key_create(&ringKey, releaseThreadRing);
+}
+
+/* IORING_SETUP_SUBMIT_ALL keeps submitting past a failed entry, older kernels refuse the flag */
+static int setupRingFd(struct io_uring_params *params) {
+    memset(params, 0, sizeof(*params));
+    params->flags = IORING_SETUP_SUBMIT_ALL;
+    int fd = uringSetup(URING_ENTRIES, params);
+    if (fd == -1 && errno == EINVAL) {
+        memset(params, 0, sizeof(*params));
+        fd = uringSetup(URING_ENTRIES, params);
+    }
+    return fd;
+}
+
+static UringRing *createRing() {
+    struct io_uring_params params;
+    int fd = setupRingFd(&params);
+    if (fd == -1) {
+        return NULL;
+    }
+    UringRing *ring = allocate(sizeof(UringRing));
+    memset(ring, 0, sizeof(UringRing));
+    ring->fd = fd;
+    ring->pipe[0] = ring->pipe[1] = -1;
+    ring->multishotAccept = 1;
+    ring->acceptListener = -1;
+
+    ring->sqMemorySize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqMemorySize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap && ring->cqMemorySize > ring->sqMemorySize) {
+        ring->sqMemorySize = ring->cqMemorySize;
+    }
+    ring->sqMemory = mmap(NULL, ring->sqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sqMemory == MAP_FAILED) {
+        close(fd);
+        deallocate(ring);
+        return NULL;
+    }
+    ring->cqMemory = ring->sqMemory;
+    if (!singleMmap) {
+        ring->cqMemory = mmap(NULL, ring->cqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cqMemory == MAP_FAILED) {
+            munmap(ring->sqMemory, ring->sqMemorySize);
+            close(fd);
+            deallocate(ring);
+            return NULL;
+        }
+    }
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cqMemory != ring->sqMemory) {
+            munmap(ring->cqMemory, ring->cqMemorySize);
+        }
+        munmap(ring->sqMemory, ring->sqMemorySize);
+        close(fd);
+        deallocate(ring);
+        return NULL;
+    }
+
+    char *sq = ring->sqMemory;
+    char *cq = ring->cqMemory;
+    ring->sqHead = (unsigned *) (sq + params.sq_off.head);
+    ring->sqTail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sqMask = *(unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sqLocalTail = *ring->sqTail;
+    /* entries are always used in ring order, so the index array maps every slot to itself */
+    unsigned *array = (unsigned *) (sq + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; i++) {
+        array[i] = i;
+    }
+    ring->cqHead = (unsigned *) (cq + params.cq_off.head);
+    ring->cqTail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cqMask = *(unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return ring;
+}
+
+/* NULL when the thread can not have a ring, the caller falls back to the poll backend */
+static UringRing *getRing() {
+    if (threadRing != NULL || threadRingFailed) {
+        return threadRing;
+    }
+    threadRing = createRing();
+    if (threadRing == NULL) {
+        threadRingFailed = 1;
+        warning("io_uring_setup failed (%s), this thread uses the poll backend", strerror(errno));
+        return NULL;
+    }
+    pthread_once(&ringKeyOnce, createRingKey);
+    pthread_setspecific(ringKey, threadRing);
+    return threadRing;
+}
+
+int uringAvailable() {
+    struct io_uring_params params;
+    int fd = setupRingFd(&params);
+    if (fd == -1) {
+        return 0;
+    }
+    close(fd);
+    return 1;
+}
+
+/* Batches never outgrow the ring, so a free entry is always there */
+static struct io_uring_sqe *queueEntry(UringRing *ring, int opcode, int fd, unsigned char flags) {
+    struct io_uring_sqe *sqe = &ring->sqes[ring->sqLocalTail & ring->sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (unsigned char) opcode;
+    sqe->fd = fd;
+    sqe->flags = flags;
+    sqe->user_data = ((uint64_t) ring->generation << 32) | ++ring->batched;
+    ring->sqLocalTail++;
+    return sqe;
+}
+
+static void queueLinkTimeout(UringRing *ring, struct __kernel_timespec *timeout, int timeoutMs) {
+    timeout->tv_sec = timeoutMs / 1000;
+    timeout->tv_nsec = (long long) (timeoutMs % 1000) * 1000000;
+    struct io_uring_sqe *sqe = queueEntry(ring, IORING_OP_LINK_TIMEOUT, -1, 0);
+    sqe->addr = (uint64_t) (uintptr_t) timeout;
+    sqe->len = 1;
+}
+
+static void stashAccepted(UringRing *ring, const struct io_uring_cqe *cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        ring->acceptListener = -1;
+    }
+    if (cqe->res == -EINVAL) {
+        ring->multishotAccept = 0;
+        return;
+    }
+    if (ring->acceptedCount == ring->acceptedCapacity) {
+        ring->acceptedCapacity = ring->acceptedCapacity ? ring->acceptedCapacity * 2 : URING_ENTRIES;
+        ring->accepted = reallocate(ring->accepted, ring->acceptedCapacity * sizeof(int));
+    }
+    /* failed accepts are kept as negative errno, uringAccept reports them in order */
+    ring->accepted[ring->acceptedCount++] = cqe->res;
+}
+
+static void reapCompletions(UringRing *ring, int *results, unsigned *completed) {
+    unsigned head = *ring->cqHead;
+    unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        const struct io_uring_cqe *cqe = &ring->cqes[head & ring->cqMask];
+        if (cqe->user_data == URING_ACCEPT_TAG) {
+            stashAccepted(ring, cqe);
+            continue;
+        }
+        unsigned index = (unsigned) (cqe->user_data & UINT32_MAX);
+        if ((unsigned) (cqe->user_data >> 32) == ring->generation && index >= 1 && index <= ring->batched) {
+            results[index - 1] = cqe->res;
+            (*completed)++;
+        }
+    }
+    __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+}
+
+/*
+    Submits everything queued since the last call in one io_uring_enter and waits until all of it completed.
+    results gets the res of every entry in queue order. Entries the kernel did not take get -errno.
+*/
+static void submitAndWait(UringRing *ring, int *results) {
+    unsigned expected = ring->batched;
+    unsigned completed = 0;
+    __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+    while (completed < expected) {
+        unsigned toSubmit = ring->sqLocalTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+        int entered = uringEnter(ring->fd, toSubmit, 1, IORING_ENTER_GETEVENTS);
+        if (entered == -1 && errno != EINTR) {
+            int enterErrno = errno;
+            perror("submitAndWait: io_uring_enter");
+            for (unsigned i = expected - toSubmit; i < expected; i++) {
+                results[i] = -enterErrno;
+            }
+            expected -= toSubmit;
+            ring->sqLocalTail -= toSubmit;
+            __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+        }
+        reapCompletions(ring, results, &completed);
+    }
+    ring->generation++;
+    ring->batched = 0;
+}
+
+/*
+    Runs one socket operation, linked to a timeout for blocking sockets.
+    A timed out operation completes with -ECANCELED.
+*/
+static int runTimed(UringRing *ring, TcpSocket *sock, int timeoutMs) {
+    int results[2];
+    struct __kernel_timespec timeout;
+    if (!sock->nonBlocking) {
+        ring->sqes[(ring->sqLocalTail - 1) & ring->sqMask].flags |= IOSQE_IO_LINK;
+        queueLinkTimeout(ring, &timeout, timeoutMs);
+    }
+    submitAndWait(ring, results);
+    return results[0];
+}
+
+/* io_uring waits on O_NONBLOCK sockets as well, only MSG_DONTWAIT makes it complete with -EAGAIN */
+static unsigned socketFlags(const TcpSocket *sock, unsigned flags) {
+    return sock->nonBlocking ? flags | MSG_DONTWAIT : flags;
+}
+
+static void uringPrepare(TcpSocket *sock) {
+    (void) sock;
+}
+
+static ReadResult uringReceive(TcpSocket *sock, void *buffer, size_t size) {
+    UringRing *ring = getRing();
+    if (ring == NULL) {
+        return pollIoBackend.receive(sock, buffer, size);
+    }
+    int recvd;
+    do {
+        int wait = sock->nonBlocking ? 0 : socketReceiveWait(sock);
+        if (!sock->nonBlocking && wait == 0) {
+            recvd = -ECANCELED;
+            break;
+        }
+        struct io_uring_sqe *sqe = queueEntry(ring, IORING_OP_RECV, sock->fd, 0);
+        sqe->addr = (uint64_t) (uintptr_t) buffer;
+        sqe->len = (unsigned) (size > UINT32_MAX ? UINT32_MAX : size);
+        sqe->msg_flags = socketFlags(sock, 0);
+        recvd = runTimed(ring, sock, wait);
+    } while (recvd == -EINTR);
+    debug("io_uring recv(%d, %p, %zu) returned %d", sock->fd, buffer, size, recvd);
+
+    if (recvd == -EAGAIN && sock->nonBlocking) {
+        return (ReadResult) {
+            .result = READ_WOULD_BLOCK,
+            .received = 0,
+        };
+    }
+
+    if (recvd == -ECANCELED) {
+        sock->closed = 1;
+        return (ReadResult) {
+            .result = READ_TIMEOUT,
+            .received = -1,
+        };
+    }
+
+    if (recvd == 0) {
+        sock->closed = 1;
+        return (ReadResult) {
+            .result = READ_CLOSED,
+            .received = 0,
+        };
+    }
+
+    if (recvd < 0) {
+        errno = -recvd;
+        perror("receive: io_uring recv");
+        sock->closed = 1;
+        return (ReadResult) {
+            .result = READ_RECV_ERROR,
+            .received = -1,
+        };
+    }
+
+    logSocketTraffic(sock, 0, buffer, recvd);
+
+    return (ReadResult) {
+        .result = READ_OK,
+        .received = recvd,
+    };
+}
+
+/*
+    Returns WRITE_OK when the caller should try again.
+*/
+static WriteEnum uringWriteFailure(TcpSocket *sock, int res) {
+    if (res == -EINTR) {
+        return WRITE_OK;
+    }
+    if (res == -EAGAIN && sock->nonBlocking) {
+        return WRITE_WOULD_BLOCK;
+    }
+    if (res == -ECANCELED) {
+        return WRITE_TIMEOUT;
+    }
+    return WRITE_SEND_ERROR;
+}
+
+static WriteResult uringTransmit(TcpSocket *sock, const void *buffer, size_t size) {
+    UringRing *ring = getRing();
+    if (ring == NULL) {
+        return pollIoBackend.transmit(sock, buffer, size);
+    }
+    size_t totalSent = 0;
+    int wait = socketTransmitWait(sock);
+
+    while (totalSent < size) {
+        size_t packetSize = (size - totalSent) > TRANSMIT_PACKET_SIZE ? TRANSMIT_PACKET_SIZE : (size - totalSent);
+        struct io_uring_sqe *sqe = queueEntry(ring, IORING_OP_SEND, sock->fd, 0);
+        sqe->addr = (uint64_t) (uintptr_t) ((const char *) buffer + totalSent);
+        sqe->len = (unsigned) packetSize;
+        sqe->msg_flags = socketFlags(sock, MSG_NOSIGNAL);
+        int sent = runTimed(ring, sock, wait);
+        debug("io_uring send(%d, %p, %zu, MSG_NOSIGNAL) returned %d", sock->fd, buffer, packetSize, sent);
+
+        if (sent < 0) {
+            WriteEnum retry = uringWriteFailure(sock, sent);
+            if (retry == WRITE_OK) {
+                continue;
+            }
+            if (retry == WRITE_SEND_ERROR) {
+                errno = -sent;
+                perror("transmit: io_uring send");
+            }
+            sock->closed = retry != WRITE_WOULD_BLOCK;
+            return (WriteResult) {
+                .result = retry,
+                .sent = totalSent,
+            };
+        }
+
+        if (sent == 0) {
+            sock->closed = 1;
+            return (WriteResult) {
+                .result = WRITE_CLOSED,
+                .sent = totalSent,
+            };
+        }
+
+        logSocketTraffic(sock, 1, (const char *) buffer + totalSent, sent);
+
+        totalSent += sent;
+    }
+
+    return (WriteResult) {
+        .result = WRITE_OK,
+        .sent = totalSent,
+    };
+}
+
+static WriteResult uringTransmitVector(TcpSocket *sock, struct iovec **iov, int *iovCount) {
+    UringRing *ring = getRing();
+    if (ring == NULL) {
+        return pollIoBackend.transmitVector(sock, iov, iovCount);
+    }
+    size_t totalSent = 0;
+    int wait = socketTransmitWait(sock);
+
+    while (*iovCount > 0) {
+        struct msghdr message = {.msg_iov = *iov, .msg_iovlen = *iovCount};
+        struct io_uring_sqe *sqe = queueEntry(ring, IORING_OP_SENDMSG, sock->fd, 0);
+        sqe->addr = (uint64_t) (uintptr_t) &message;
+        sqe->len = 1;
+        sqe->msg_flags = socketFlags(sock, MSG_NOSIGNAL);
+        int sent = runTimed(ring, sock, wait);
+        debug("io_uring sendmsg(%d, {.msg_iovlen = %d}, MSG_NOSIGNAL) returned %d", sock->fd, *iovCount, sent);
+
+        if (sent < 0) {
+            WriteEnum retry = uringWriteFailure(sock, sent);
+            if (retry == WRITE_OK) {
+                continue;
+            }
+            if (retry == WRITE_SEND_ERROR) {
+                errno = -sent;
+                perror("transmitVector: io_uring sendmsg");
+            }
+            sock->closed = retry != WRITE_WOULD_BLOCK;
+            return (WriteResult) {.result = retry, .sent = totalSent};
+        }
+
+        if (sent == 0 && (*iov)->iov_len > 0) {
+            sock->closed = 1;
+            return (WriteResult) {.result = WRITE_CLOSED, .sent = totalSent};
+        }
+
+        *iovCount = consumeSentVector(sock, iov, *iovCount, sent);
+        totalSent += sent;
+    }
+
+    return (WriteResult) {.result = WRITE_OK, .sent = totalSent};
+}
+
+static int openSplicePipe(UringRing *ring) {
+    if (ring->pipe[0] != -1) {
+        return 0;
+    }
+    if (pipe2(ring->pipe, O_CLOEXEC) == -1) {
+        perror("openSplicePipe: pipe2");
+        ring->pipe[0] = ring->pipe[1] = -1;
+        return -1;
+    }
+    /* a bigger pipe moves more per splice, the default size is kept when the limit is lower */
+    int size = fcntl(ring->pipe[1], F_SETPIPE_SZ, URING_PIPE_SIZE);
+    ring->pipeSize = size > 0 ? (size_t) size : (size_t) fcntl(ring->pipe[1], F_GETPIPE_SZ);
+    return 0;
+}
+
+/* Bytes left behind in the pipe would be sent ahead of the next file */
+static void discardSplicePipe(UringRing *ring) {
+    close(ring->pipe[0]);
+    close(ring->pipe[1]);
+    ring->pipe[0] = ring->pipe[1] = -1;
+}
+
+typedef enum SpliceStep {
+    SPLICE_FILL,
+    SPLICE_DRAIN,
+    SPLICE_TIMEOUT,
+} SpliceStep;
+
+static void queueSplice(UringRing *ring, int in, long long inOffset, int out, size_t length) {
+    struct io_uring_sqe *sqe = queueEntry(ring, IORING_OP_SPLICE, out, IOSQE_IO_LINK);
+    sqe->splice_fd_in = in;
+    sqe->splice_off_in = (uint64_t) inOffset;
+    sqe->off = (uint64_t) -1;
+    sqe->len = (unsigned) length;
+}
+
+/* Drains the pipe into the socket, the timeout links on to whatever comes next */
+static void queueDrain(UringRing *ring, TcpSocket *sock, size_t length, struct __kernel_timespec *timeout, int timeoutMs) {
+    queueSplice(ring, ring->pipe[0], -1, sock->fd, length);
+    queueLinkTimeout(ring, timeout, timeoutMs);
+    ring->sqes[(ring->sqLocalTail - 1) & ring->sqMask].flags |= IOSQE_IO_LINK;
+}
+
+/*
+    Every window is a file to pipe splice linked to a pipe to socket splice and its timeout,
+    the windows of one submission are linked too. A short splice cancels the rest of the chain,
+    the bytes still in the pipe go out first on the next round.
+    Non-blocking sockets use sendfile, bytes the socket refuses could not be taken back out of the pipe.
+*/
+static WriteResult uringTransmitFile(TcpSocket *sock, int fd, off_t offset, size_t count) {
+    UringRing *ring = getRing();
+    if (ring == NULL) {
+        return pollIoBackend.transmitFile(sock, fd, offset, count);
+    }
+    if (sock->nonBlocking || openSplicePipe(ring) == -1) {
+        return directIoBackend.transmitFile(sock, fd, offset, count);
+    }
+    int wait = socketTransmitWait(sock);
+    size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    size_t filled = 0;
+    size_t sent = 0;
+    SpliceStep steps[URING_SPLICE_WINDOWS * 3 + 2];
+    int results[URING_SPLICE_WINDOWS * 3 + 2];
+    struct __kernel_timespec timeouts[URING_SPLICE_WINDOWS + 1];
+
+    while (sent < count) {
+        unsigned queued = 0;
+        int windows = 0;
+        if (filled > sent) {
+            queueDrain(ring, sock, filled - sent, &timeouts[windows++], wait);
+            steps[queued++] = SPLICE_DRAIN;
+            steps[queued++] = SPLICE_TIMEOUT;
+        }
+        for (size_t planned = filled; windows < URING_SPLICE_WINDOWS + 1 && planned < count; windows++) {
+            /* the pipe holds whole pages, a window starting mid page ends one page short */
+            size_t window = ring->pipeSize - (size_t) (offset + (off_t) planned) % pageSize;
+            size_t length = count - planned < window ? count - planned : window;
+            queueSplice(ring, fd, (long long) (offset + (off_t) planned), ring->pipe[1], length);
+            queueDrain(ring, sock, length, &timeouts[windows], wait);
+            steps[queued++] = SPLICE_FILL;
+            steps[queued++] = SPLICE_DRAIN;
+            steps[queued++] = SPLICE_TIMEOUT;
+            planned += length;
+        }
+        /* the last timeout ends the chain */
+        ring->sqes[(ring->sqLocalTail - 1) & ring->sqMask].flags &= ~IOSQE_IO_LINK;
+        submitAndWait(ring, results);
+
+        size_t previous = sent;
+        int failure = 0;
+        WriteEnum result = WRITE_SENDFILE_ERROR;
+        for (unsigned i = 0; i < queued; i++) {
+            int res = results[i];
+            if (steps[i] == SPLICE_TIMEOUT) {
+                if (res == -ETIME) {
+                    result = WRITE_TIMEOUT;
+                }
+            } else if (res > 0) {
+                *(steps[i] == SPLICE_FILL ? &filled : &sent) += res;
+            } else if (res != -ECANCELED && failure == 0) {
+                /* 0 from the file is an early end of file, from the socket a closed peer */
+                failure = res == 0 ? EIO : -res;
+            }
+        }
+        debug("io_uring splice chain of %u entries for (%d, %d) moved %zu bytes, %zu of %zu sent", queued, sock->fd, fd, sent - previous, sent, count);
+
+        if (result == WRITE_TIMEOUT || failure != 0 || (sent == previous && filled == sent)) {
+            if (result != WRITE_TIMEOUT) {
+                errno = failure != 0 ? failure : EIO;
+                perror("transmitFile: io_uring splice");
+            }
+            if (filled > sent) {
+                discardSplicePipe(ring);
+            }
+            return (WriteResult) {.result = result, .sent = sent};
+        }
+    }
+    return (WriteResult) {.result = WRITE_OK, .sent = count};
+}
+
+/*
+    The first accept on a blocking listener arms a multishot accept, later calls reap its completions.
+    Only one listener per thread is armed, non-blocking listeners are left to accept4 so their
+    readiness keeps being reported to the event loop.
+*/
+static int uringAccept(int listenFd, int flags) {
+    UringRing *ring = getRing();
+    if (ring == NULL || !ring->multishotAccept || (fcntl(listenFd, F_GETFL) & O_NONBLOCK)) {
+        return acceptSocket(listenFd, flags);
+    }
+    if (ring->acceptListener != -1 && (ring->acceptListener != listenFd || ring->acceptFlags != flags)) {
+        return acceptSocket(listenFd, flags);
+    }
+    int results[1];
+    unsigned completed = 0;
+    while (ring->acceptedHead == ring->acceptedCount) {
+        if (ring->acceptListener == -1) {
+            struct io_uring_sqe *sqe = &ring->sqes[ring->sqLocalTail & ring->sqMask];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->fd = listenFd;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            sqe->accept_flags = (unsigned) flags;
+            sqe->user_data = URING_ACCEPT_TAG;
+            ring->sqLocalTail++;
+            __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+            ring->acceptListener = listenFd;
+            ring->acceptFlags = flags;
+        }
+        unsigned toSubmit = ring->sqLocalTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+        if (uringEnter(ring->fd, toSubmit, 1, IORING_ENTER_GETEVENTS) == -1 && errno != EINTR) {
+            return -1;
+        }
+        reapCompletions(ring, results, &completed);
+        if (!ring->multishotAccept) {
+            return acceptSocket(listenFd, flags);
+        }
+    }
+    int clientFd = ring->accepted[ring->acceptedHead++];
+    if (ring->acceptedHead == ring->acceptedCount) {
+        ring->acceptedHead = ring->acceptedCount = 0;
+    }
+    debug("io_uring multishot accept(%d) returned %d", listenFd, clientFd);
+    if (clientFd < 0) {
+        errno = -clientFd;
+        return -1;
+    }
+    return clientFd;
+}
+
+const IoBackend uringIoBackend = {
+    .name = "io_uring",
+    .prepare = uringPrepare,
+    .accept = uringAccept,
+    .receive = uringReceive,
+    .transmit = uringTransmit,
+    .transmitFile = uringTransmitFile,
+    .transmitVector = uringTransmitVector,
+};
@@ -0,0 +1,145 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "io_backend.h"
+
+#include <logging.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../server/thread_rings.h"
+
+#define CAPTURE_RING_SIZE (256 * 1024)
+/* A single record never takes more than this share of a ring, the payload is cut instead */
+#define CAPTURE_RECORD_MAX (CAPTURE_RING_SIZE / 4)
+#define CAPTURE_DRAIN_INTERVAL_MS 10
+#define CAPTURE_DEFAULT_PATH "socketLog.txt"
+
+static atomic_int captureEnabled = 0;
+static WireCaptureOptions captureOptions = {.path = CAPTURE_DEFAULT_PATH, .sampleEvery = 1, .maxBytesPerConnection = 0};
+static atomic_uint connectionsSeen = 0;
+
+static ThreadRingSet captureRings = THREAD_RING_SET_INITIALIZER(CAPTURE_RING_SIZE);
+static _Thread_local ThreadRing *threadRing = NULL;
+static pthread_mutex_t startMutex = PTHREAD_MUTEX_INITIALIZER;
+static int drainStarted = 0;
+static FILE *captureFile = NULL;
+
+/* Records are appended as they are, the ring holds them already serialized */
+static size_t writeRing(SpscRing *ring, void *) {
+    struct iovec spans[2];
+    size_t size = spscRingPeek(ring, spans);
+    fwrite(spans[0].iov_base, 1, spans[0].iov_len, captureFile);
+    fwrite(spans[1].iov_base, 1, spans[1].iov_len, captureFile);
+    return size;
+}
+
+static void *drainCapture(void *) {
+    const struct timespec interval = {.tv_sec = 0, .tv_nsec = CAPTURE_DRAIN_INTERVAL_MS * 1000000L};
+    for (;;) {
+        long position = ftell(captureFile);
+        size_t dropped = drainThreadRings(&captureRings, writeRing, NULL);
+        if (dropped > 0) {
+            warning("Wire capture dropped %zu records, the drain thread fell behind", dropped);
+        }
+        if (ftell(captureFile) != position) {
+            fflush(captureFile);
+        } else {
+            nanosleep(&interval, NULL);
+        }
+    }
+    return NULL;
+}
+
+/* The file and the drain thread are only created the first time capture is enabled */
+static int startDrain() {
+    pthread_mutex_lock(&startMutex);
+    int started = drainStarted;
+    if (!started) {
+        captureFile = fopen(captureOptions.path, "ab");
+        if (captureFile != NULL) {
+            if (ftell(captureFile) == 0) {
+                fwrite(WIRE_CAPTURE_MAGIC, 1, sizeof(WIRE_CAPTURE_MAGIC) - 1, captureFile);
+            }
+            pthread_t thread;
+            started = drainStarted = pthread_create(&thread, NULL, drainCapture, NULL) == 0;
+            if (started) {
+                pthread_detach(thread);
+            }
+        }
+    }
+    pthread_mutex_unlock(&startMutex);
+    if (!started) {
+        error("Failed starting wire capture to %s", captureOptions.path);
+    }
+    return started;
+}
+
+void setWireCaptureOptions(WireCaptureOptions options) {
+    if (options.path == NULL) {
+        options.path = CAPTURE_DEFAULT_PATH;
+    }
+    captureOptions = options;
+}
+
+void setWireCapture(int enabled) {
+    if (enabled && !startDrain()) {
+        return;
+    }
+    atomic_store_explicit(&captureEnabled, enabled != 0, memory_order_relaxed);
+}
+
+static int isSampled(TcpSocket *sock) {
+    if (sock->captureSampled == 0) {
+        unsigned int every = captureOptions.sampleEvery > 1 ? captureOptions.sampleEvery : 1;
+        unsigned int seen = atomic_fetch_add_explicit(&connectionsSeen, 1, memory_order_relaxed);
+        sock->captureSampled = seen % every == 0 ? 1 : -1;
+    }
+    return sock->captureSampled == 1;
+}
+
+static void captureTraffic(TcpSocket *sock, int outgoing, const void *buffer, size_t size) {
+    if (!isSampled(sock)) {
+        return;
+    }
+    size_t length = size;
+    if (captureOptions.maxBytesPerConnection > 0) {
+        size_t left = captureOptions.maxBytesPerConnection - sock->capturedBytes;
+        if (left == 0) {
+            return;
+        }
+        length = length < left ? length : left;
+    }
+    if (length > CAPTURE_RECORD_MAX - sizeof(WireRecordHeader)) {
+        length = CAPTURE_RECORD_MAX - sizeof(WireRecordHeader);
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    WireRecordHeader header = {
+        .timeNs = (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec,
+        .length = (uint32_t) length,
+        .originalLength = (uint32_t) (size < UINT32_MAX ? size : UINT32_MAX),
+        .fd = sock->fd,
+        .outgoing = (uint8_t) (outgoing != 0),
+    };
+    memcpy(header.ip, sock->ip, sizeof(header.ip));
+    struct iovec parts[2] = {
+        {.iov_base = &header, .iov_len = sizeof(header)},
+        {.iov_base = (void*) buffer, .iov_len = length},
+    };
+    if (threadRingPush(threadRingOf(&captureRings, &threadRing), parts, 2)) {
+        sock->capturedBytes += length;
+    }
+}
+
+void logSocketTraffic(TcpSocket *sock, int outgoing, const void *buffer, ssize_t size) {
+    if (size <= 0 || !atomic_load_explicit(&captureEnabled, memory_order_relaxed)) {
+        return;
+    }
+    captureTraffic(sock, outgoing, buffer, (size_t) size);
+}
@@ -2,16 +2,23 @@
 // Created by Crucerescu Vladislav on 13.08.2025.
 //
 
-
+#define _GNU_SOURCE
 #include <logging.h>
 #include <utils.h>
 #include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <pthread.h>
 #include <time.h>
 #include <stdarg.h>
 
+#include "alloc/thread_context.h"
+#include "helpers/clock_helper.h"
+#include "server/thread_rings.h"
+
 #define COLOR_RESET "\e[m\033[0m"
 #define COLOR_COUNT sizeof(colorCodes) / sizeof(*colorCodes)
 #define CONNECTION_NAME_FORMAT "Request %lu.%lu"
@@ -34,11 +41,10 @@ static char *colorCodes[] = {
     "\e[1m\x1B[35m",
     "\e[1m\x1B[36m",
 };
-static const char *logFilePath = NULL;
-static const char *jsonLogFilePath = NULL;
 static int logFlags = PRINT_LOG;
 
-#if LOG_BY_LEVEL
+atomic_int logLevelThreshold = DEBUG;
+
 static const char *logLevelToStr(LogLevel logLevel) {
     switch (logLevel) {
         case DEBUG:
@@ -58,63 +64,527 @@ static const char *logLevelToStr(LogLevel logLevel) {
     }
 }
 
-static void _log(LogLevel logLevel, const char *format, va_list args) {
-    fflush(stdout);
-    DECLARE_CURRENT_TIME(time);
+/*
+    Producers never format. A log call copies the level, a coarse timestamp, the session
+    indexes, the format pointer and its arguments into a binary record on its thread's ring.
+    The writer thread formats the records and hands the text to stdio in large writes.
+    Strings are copied, everything else is kept as the raw argument value.
+*/
+
+#define LOG_RING_SIZE (256 * 1024)
+#define LOG_RECORD_MAX 8192
+/* Longest string argument kept, longer ones are cut */
+#define LOG_STRING_MAX 1024
+#define LOG_LINE_MAX 4096
+#define LOG_OUTPUT_SIZE (64 * 1024)
+#define LOG_SPEC_MAX 32
+#define LOG_DRAIN_INTERVAL_MS 10
+
+#define RECORD_SESSION 1 /* connectionIndex and requestIndex are set */
+#define RECORD_PLAIN 2 /* written without the level prefix */
+#define RECORD_FILE 4 /* goes to the text log file instead of the log stream */
+
+/* Arguments follow in 8 byte slots, strings as their length followed by the padded bytes */
+typedef struct LogRecord {
+    uint32_t size; /* the header included, always a multiple of 8 */
+    uint8_t level;
+    uint8_t flags;
+    uint16_t reserved;
+    struct timespec time;
+    unsigned long connectionIndex;
+    unsigned long requestIndex;
+    const char *format;
+} LogRecord;
+
+#define NULL_STRING UINT64_MAX
+#define SLOT_SIZE(size) (((size) + 7) & ~(size_t) 7)
+
+typedef enum ArgKind {
+    ARG_NONE, /* %% */
+    ARG_INT,
+    ARG_LONG,
+    ARG_LONG_LONG,
+    ARG_INTMAX,
+    ARG_SIZE,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LONG_DOUBLE,
+    ARG_POINTER,
+    ARG_STRING,
+    /* %n, %m, wide strings, formatted by the producer instead */
+    ARG_UNSUPPORTED,
+} ArgKind;
+
+typedef struct Conversion {
+    const char *start; /* the % */
+    const char *precision; /* the '.', or what follows the width */
+    const char *end; /* past the conversion character */
+    int widthStar;
+    int precisionStar;
+    int precisionValue; /* -1 when missing or given as * */
+    ArgKind kind;
+} Conversion;
+
+typedef struct LogOutput {
+    FILE *file;
+    size_t length;
+    char buffer[LOG_OUTPUT_SIZE];
+} LogOutput;
+
+static ThreadRingSet logRings = THREAD_RING_SET_INITIALIZER(LOG_RING_SIZE);
+static _Thread_local ThreadRing *threadRing = NULL;
+static pthread_once_t writerOnce = PTHREAD_ONCE_INIT;
+static atomic_int writerRunning = 0;
+/* Held by whoever drains, the writer thread or flushLogs */
+static pthread_mutex_t writerMutex = PTHREAD_MUTEX_INITIALIZER;
+static LogOutput streamOutput;
+static LogOutput fileOutput;
+static alignas(16) unsigned char wrappedRecord[LOG_RECORD_MAX];
+
+/* percent points at the %, shared by the producer and the writer so they agree on the slots */
+static void parseConversion(const char *percent, Conversion *conversion) {
+    const char *p = percent + 1;
+    conversion->start = percent;
+    while (*p != '\0' && strchr("-+ #0'", *p) != NULL) {
+        p++;
+    }
+    conversion->widthStar = *p == '*';
+    if (conversion->widthStar) {
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+        p++;
+    }
+    conversion->precision = p;
+    conversion->precisionStar = 0;
+    conversion->precisionValue = -1;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            conversion->precisionStar = 1;
+            p++;
+        } else {
+            conversion->precisionValue = 0;
+            while (*p >= '0' && *p <= '9') {
+                conversion->precisionValue = conversion->precisionValue * 10 + (*p++ - '0');
+            }
+        }
+    }
+
+    ArgKind integer = ARG_INT;
+    int longDouble = 0;
+    int wide = 0;
+    switch (*p) {
+        case 'h':
+            p += p[1] == 'h' ? 2 : 1;
+            break;
+        case 'l':
+            integer = p[1] == 'l' ? ARG_LONG_LONG : ARG_LONG;
+            wide = p[1] != 'l';
+            p += p[1] == 'l' ? 2 : 1;
+            break;
+        case 'j':
+            integer = ARG_INTMAX;
+            p++;
+            break;
+        case 'z':
+            integer = ARG_SIZE;
+            p++;
+            break;
+        case 't':
+            integer = ARG_PTRDIFF;
+            p++;
+            break;
+        case 'L':
+            longDouble = 1;
+            p++;
+            break;
+        default:
+            break;
+    }
+
+    switch (*p) {
+        case '%':
+            conversion->kind = ARG_NONE;
+            break;
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+            conversion->kind = longDouble ? ARG_UNSUPPORTED : integer;
+            break;
+        case 'c':
+            /* wint_t is promoted like an unsigned int */
+            conversion->kind = ARG_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            conversion->kind = longDouble ? ARG_LONG_DOUBLE : ARG_DOUBLE;
+            break;
+        case 'p':
+            conversion->kind = ARG_POINTER;
+            break;
+        case 's':
+            conversion->kind = wide ? ARG_UNSUPPORTED : ARG_STRING;
+            break;
+        default:
+            conversion->kind = ARG_UNSUPPORTED;
+            break;
+    }
+    conversion->end = *p != '\0' ? p + 1 : p;
+    if (conversion->end - percent >= LOG_SPEC_MAX - 3) {
+        conversion->kind = ARG_UNSUPPORTED;
+    }
+}
+
+static int putSlot(unsigned char *record, size_t *length, const void *value, size_t size) {
+    if (*length + SLOT_SIZE(size) > LOG_RECORD_MAX) {
+        return 0;
+    }
+    memcpy(record + *length, value, size);
+    *length += SLOT_SIZE(size);
+    return 1;
+}
+
+static int putString(unsigned char *record, size_t *length, const char *str, size_t limit) {
+    uint64_t stringLength = str != NULL ? strnlen(str, limit) : NULL_STRING;
+    if (!putSlot(record, length, &stringLength, sizeof(stringLength))) {
+        return 0;
+    }
+    return str == NULL || putSlot(record, length, str, stringLength);
+}
+
+#define PUT_ARG(type) do { \
+    type value = va_arg(args, type); \
+    if (!putSlot(record, length, &value, sizeof(value))) { \
+        return 0; \
+    } \
+} while (0)
+
+/* Returns 0 when the record would not fit or a conversion cannot be deferred */
+static int encodeArguments(unsigned char *record, size_t *length, const char *format, va_list args) {
+    for (const char *p = strchr(format, '%'); p != NULL; p = strchr(p, '%')) {
+        Conversion conversion;
+        parseConversion(p, &conversion);
+        p = conversion.end;
+        if (conversion.widthStar) {
+            PUT_ARG(int);
+        }
+        int precision = conversion.precisionValue;
+        if (conversion.precisionStar) {
+            precision = va_arg(args, int);
+            if (!putSlot(record, length, &precision, sizeof(precision))) {
+                return 0;
+            }
+        }
+        switch (conversion.kind) {
+            case ARG_NONE:
+                break;
+            case ARG_INT:
+                PUT_ARG(int);
+                break;
+            case ARG_LONG:
+                PUT_ARG(long);
+                break;
+            case ARG_LONG_LONG:
+                PUT_ARG(long long);
+                break;
+            case ARG_INTMAX:
+                PUT_ARG(intmax_t);
+                break;
+            case ARG_SIZE:
+                PUT_ARG(size_t);
+                break;
+            case ARG_PTRDIFF:
+                PUT_ARG(ptrdiff_t);
+                break;
+            case ARG_DOUBLE:
+                PUT_ARG(double);
+                break;
+            case ARG_LONG_DOUBLE:
+                PUT_ARG(long double);
+                break;
+            case ARG_POINTER:
+                PUT_ARG(void*);
+                break;
+            case ARG_STRING: {
+                size_t limit = precision >= 0 && precision < LOG_STRING_MAX ? (size_t) precision : LOG_STRING_MAX;
+                if (!putString(record, length, va_arg(args, const char*), limit)) {
+                    return 0;
+                }
+                break;
+            }
+            default:
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static void startWriter();
+
+static void pushRecord(LogLevel level, int flags, const char *format, va_list args) {
+    if (threadRing == NULL) {
+        pthread_once(&writerOnce, startWriter);
+    }
+    alignas(16) unsigned char record[LOG_RECORD_MAX];
+    LogRecord header = {.level = (uint8_t) level, .flags = (uint8_t) flags, .format = format};
+    clock_gettime(CLOCK_REALTIME_COARSE, &header.time);
     SessionState *state = getSessionState();
-    if (state == NULL) {
-        printf("[%s|%s|MAIN] ", logLevelToStr(logLevel), time);
-    } else {
-        printf("[%s|%s|%lu.%lu] ", logLevelToStr(logLevel), time, state->connectionIndex, state->requestIndex);
+    if (state != NULL) {
+        header.flags |= RECORD_SESSION;
+        header.connectionIndex = state->connectionIndex;
+        header.requestIndex = state->requestIndex;
     }
-    vprintf(format, args);
-    putchar('\n');
-    fflush(stdout);
+
+    size_t length = sizeof(LogRecord);
+    va_list copy;
+    va_copy(copy, args);
+    if (!encodeArguments(record, &length, format, args)) {
+        /* formatted here, the record carries the text */
+        char text[LOG_RECORD_MAX - sizeof(LogRecord) - sizeof(uint64_t)];
+        vsnprintf(text, sizeof(text), format, copy);
+        header.format = "%s";
+        length = sizeof(LogRecord);
+        putString(record, &length, text, sizeof(text));
+    }
+    va_end(copy);
+
+    header.size = (uint32_t) length;
+    memcpy(record, &header, sizeof(header));
+    struct iovec part = {.iov_base = record, .iov_len = length};
+    threadRingPush(threadRingOf(&logRings, &threadRing), &part, 1);
 }
 
-void debug(const char *format, ...) {
+/* Pushes without flushing, for the writer itself and the response lines */
+__attribute__((format(printf, 3, 4)))
+static void pushFormatted(LogLevel level, int flags, const char *format, ...) {
     va_list args;
     va_start(args, format);
-    _log(DEBUG, format, args);
+    pushRecord(level, flags, format, args);
     va_end(args);
 }
 
-void info(const char *format, ...) {
+void logMessage(LogLevel level, const char *format, ...) {
     va_list args;
     va_start(args, format);
-    _log(INFO, format, args);
+    pushRecord(level, 0, format, args);
     va_end(args);
+    if (level >= FATAL || !atomic_load_explicit(&writerRunning, memory_order_relaxed)) {
+        flushLogs();
+    }
 }
 
-void warning(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    _log(WARNING, format, args);
-    va_end(args);
+static void takeSlot(const unsigned char **cursor, void *value, size_t size) {
+    memcpy(value, *cursor, size);
+    *cursor += SLOT_SIZE(size);
 }
 
-void error(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    _log(ERROR, format, args);
-    va_end(args);
+#define FORMAT_ARG(type) do { \
+    type value; \
+    takeSlot(&cursor, &value, sizeof(value)); \
+    if (conversion.widthStar && conversion.precisionStar) { \
+        written = snprintf(out + used, size - used, spec, width, precision, value); \
+    } else if (conversion.widthStar) { \
+        written = snprintf(out + used, size - used, spec, width, value); \
+    } else if (conversion.precisionStar) { \
+        written = snprintf(out + used, size - used, spec, precision, value); \
+    } else { \
+        written = snprintf(out + used, size - used, spec, value); \
+    } \
+} while (0)
+
+/* Replays the format with the recorded arguments, returns the length written to out */
+static size_t formatRecord(const LogRecord *header, const unsigned char *arguments, char *out, size_t size) {
+    const unsigned char *cursor = arguments;
+    const char *p = header->format;
+    size_t used = 0;
+    while (*p != '\0' && used + 1 < size) {
+        const char *percent = strchr(p, '%');
+        size_t literal = percent != NULL ? (size_t) (percent - p) : strlen(p);
+        if (literal > size - 1 - used) {
+            literal = size - 1 - used;
+        }
+        memcpy(out + used, p, literal);
+        used += literal;
+        if (percent == NULL || used + 1 >= size) {
+            break;
+        }
+
+        Conversion conversion;
+        parseConversion(percent, &conversion);
+        p = conversion.end;
+        int width = 0;
+        int precision = 0;
+        if (conversion.widthStar) {
+            takeSlot(&cursor, &width, sizeof(width));
+        }
+        if (conversion.precisionStar) {
+            takeSlot(&cursor, &precision, sizeof(precision));
+        }
+        char spec[LOG_SPEC_MAX];
+        size_t specLength = (size_t) (conversion.end - conversion.start);
+        if (specLength >= sizeof(spec) - 3) {
+            continue;
+        }
+        memcpy(spec, conversion.start, specLength);
+        spec[specLength] = '\0';
+
+        int written = 0;
+        switch (conversion.kind) {
+            case ARG_NONE:
+                out[used] = '%';
+                written = 1;
+                break;
+            case ARG_INT:
+                FORMAT_ARG(int);
+                break;
+            case ARG_LONG:
+                FORMAT_ARG(long);
+                break;
+            case ARG_LONG_LONG:
+                FORMAT_ARG(long long);
+                break;
+            case ARG_INTMAX:
+                FORMAT_ARG(intmax_t);
+                break;
+            case ARG_SIZE:
+                FORMAT_ARG(size_t);
+                break;
+            case ARG_PTRDIFF:
+                FORMAT_ARG(ptrdiff_t);
+                break;
+            case ARG_DOUBLE:
+                FORMAT_ARG(double);
+                break;
+            case ARG_LONG_DOUBLE:
+                FORMAT_ARG(long double);
+                break;
+            case ARG_POINTER:
+                FORMAT_ARG(void*);
+                break;
+            case ARG_STRING: {
+                uint64_t stringLength;
+                takeSlot(&cursor, &stringLength, sizeof(stringLength));
+                const char *str = (const char*) cursor;
+                if (stringLength == NULL_STRING) {
+                    str = "(null)";
+                    stringLength = 6;
+                } else {
+                    cursor += SLOT_SIZE(stringLength);
+                }
+                /* the copy is not terminated, its length becomes the precision */
+                specLength = (size_t) (conversion.precision - conversion.start);
+                memcpy(spec + specLength, ".*s", 4);
+                if (conversion.widthStar) {
+                    written = snprintf(out + used, size - used, spec, width, (int) stringLength, str);
+                } else {
+                    written = snprintf(out + used, size - used, spec, (int) stringLength, str);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        if (written > 0) {
+            used += (size_t) written < size - used ? (size_t) written : size - 1 - used;
+        }
+    }
+    return used;
 }
 
-void fatal(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    _log(FATAL, format, args);
-    va_end(args);
+static void flushOutput(LogOutput *output) {
+    FILE *file = output == &streamOutput && output->file == NULL ? stdout : output->file;
+    if (output->length > 0 && file != NULL) {
+        fwrite(output->buffer, 1, output->length, file);
+        fflush(file);
+    }
+    output->length = 0;
 }
-#else
 
-void debug(const char *format, ...) {}
-void info(const char *format, ...) {}
-void warning(const char *format, ...) {}
-void error(const char *format, ...) {}
-void fatal(const char *format, ...) {}
+/* Called by drainThreadRings with the writer mutex held, takes one record */
+static size_t writeRecord(SpscRing *ring, void *arg) {
+    size_t *written = arg;
+    uint32_t size;
+    const unsigned char *record = peekSizedRecord(ring, wrappedRecord, &size);
+    LogRecord header;
+    memcpy(&header, record, sizeof(header));
 
-#endif
+    LogOutput *output = header.flags & RECORD_FILE ? &fileOutput : &streamOutput;
+    if (output == &fileOutput && output->file == NULL) {
+        return size;
+    }
+    if (output->length + LOG_LINE_MAX > LOG_OUTPUT_SIZE) {
+        flushOutput(output);
+    }
+    char *line = output->buffer + output->length;
+    size_t length = 0;
+    if (!(header.flags & RECORD_PLAIN)) {
+        char time[LOG_TIME_LENGTH + 1];
+        formatLogTime(&header.time, time, sizeof(time));
+        int prefix;
+        if (header.flags & RECORD_SESSION) {
+            prefix = snprintf(line, LOG_LINE_MAX, "[%s|%s|%lu.%lu] ", logLevelToStr(header.level), time, header.connectionIndex, header.requestIndex);
+        } else {
+            prefix = snprintf(line, LOG_LINE_MAX, "[%s|%s|MAIN] ", logLevelToStr(header.level), time);
+        }
+        length = prefix > 0 ? (size_t) prefix : 0;
+    }
+    length += formatRecord(&header, record + sizeof(LogRecord), line + length, LOG_LINE_MAX - length);
+    line[length++] = '\n';
+    output->length += length;
+    (*written)++;
+    return size;
+}
+
+/* Call with writerMutex held, returns how many records were written */
+static size_t drainLogs() {
+    size_t written = 0;
+    size_t dropped = drainThreadRings(&logRings, writeRecord, &written);
+    flushOutput(&streamOutput);
+    flushOutput(&fileOutput);
+    if (dropped > 0) {
+        /* lands in this thread's ring, written on the next pass */
+        pushFormatted(WARNING, 0, "Dropped %zu log records, the log writer fell behind", dropped);
+    }
+    return written;
+}
+
+void flushLogs() {
+    pthread_mutex_lock(&writerMutex);
+    drainLogs();
+    pthread_mutex_unlock(&writerMutex);
+}
+
+static void *writeLogs(void *) {
+    const struct timespec interval = {.tv_sec = 0, .tv_nsec = LOG_DRAIN_INTERVAL_MS * 1000000L};
+    for (;;) {
+        pthread_mutex_lock(&writerMutex);
+        size_t written = drainLogs();
+        pthread_mutex_unlock(&writerMutex);
+        if (written == 0) {
+            nanosleep(&interval, NULL);
+        }
+    }
+    return NULL;
+}
+
+/* Without the thread every log call drains synchronously */
+static void startWriter() {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, writeLogs, NULL) == 0) {
+        pthread_detach(thread);
+        atomic_store(&writerRunning, 1);
+    }
+    atexit(flushLogs);
+}
+
+void setLogLevel(LogLevel level) {
+    atomic_store_explicit(&logLevelThreshold, level, memory_order_relaxed);
+}
+
+void setLogStream(FILE *stream) {
+    pthread_mutex_lock(&writerMutex);
+    drainLogs();
+    streamOutput.file = stream;
+    pthread_mutex_unlock(&writerMutex);
+}
 
 #if LOG_TRACES
 
@@ -150,22 +620,14 @@ void setLogFile(const char *path)
         fprintf(stderr, "Could not open log file %s\n", path);
         return;
     }
-    fclose(file);
-    logFilePath = path;
-    logFlags |= FILE_LOG;
-#endif
-}
-
-void setJsonLogFile(const char *path) {
-#if LOG_JSON_FILE
-    FILE *file = fopen(path, "a");
-    if (file == NULL) {
-        fprintf(stderr, "Could not open log file %s\n", path);
-        return;
+    pthread_mutex_lock(&writerMutex);
+    drainLogs();
+    if (fileOutput.file != NULL) {
+        fclose(fileOutput.file);
     }
-    fclose(file);
-    jsonLogFilePath = path;
-    logFlags |= JSON_LOG;
+    fileOutput.file = file;
+    logFlags |= FILE_LOG;
+    pthread_mutex_unlock(&writerMutex);
 #endif
 }
 
@@ -184,71 +646,33 @@ void logResponse(HttpResp *resp, HttpReq *req)
 #if LOG_REQUESTS
     if (logFlags & PRINT_LOG)
     {
-        printf(CONNECTION_NAME_FORMAT " " THREAD_NAME_FORMAT " %-16s %-7s %-50s | %d %s\n",
+        pushFormatted(INFO, RECORD_PLAIN, CONNECTION_NAME_FORMAT " " THREAD_NAME_FORMAT " %-16s %-7s %-50.*s | %d %s",
             connectionIndex,
             requestIndex,
             THREAD_NAME_ARGS(threadId),
             clientIp,
             methodToStr(req->method),
-            req->path.raw,
+            (int) req->path.raw.length,
+            req->path.raw.ptr,
             resp->status,
             statusToStr(resp->status)
         );
     }
 #endif
-#if LOG_JSON_FILE
-    TRACE("%s", "Logging response json");
-    if (logFlags & JSON_LOG && jsonLogFilePath != NULL) {
-        FILE *file = fopen(jsonLogFilePath, "a");
-        if (file == NULL) {
-            return;
-        }
-        char *buffer;
-
-        DECLARE_CURRENT_TIME(currentTime);
-
-        TRACE("%s", "Building req object");
-        JObject reqObj = httpReqToJObject(req);
-        TRACE("%s", "Req object built");
-        JToken reqToken = toJToken_JObject(reqObj);
-        JToken timestampToken = toJToken_long(time(NULL));
-        JToken formattedTimeToken = toJToken_cstring(currentTime);
-        JToken clientIpToken = toJToken_cstring(clientIp);
-
-        JObject logObj = _JObject(
-            _JProperty("request", reqToken),
-            _JProperty("timestamp", timestampToken),
-            _JProperty("formattedTime", formattedTimeToken),
-            _JProperty("clientIp", clientIpToken)
-        );
-        JToken logToken = toJToken_JObject(logObj);
-
-        TRACE("%s", "Serializing json");
-        unsigned int size = serializeJson(logToken, &buffer, 4);
-        fwrite(buffer, size, 1, file);
-        char entrySeparator[] = ",\n";
-        fwrite(entrySeparator, strlen(entrySeparator), 1, file);
-        fclose(file);
-    }
-#endif
 #if LOG_TXT_FILE
     TRACE("%s", "Logging response logfile");
-    if (logFlags & FILE_LOG && logFilePath != NULL) {
-        FILE *file = fopen(logFilePath, "a");
-        if (file == NULL) {
-            return;
-        }
-        fprintf(file, CONNECTION_NAME_FORMAT " Thread %ld %-16s %-7s %-50s | %d %s\n",
+    if (logFlags & FILE_LOG) {
+        pushFormatted(INFO, RECORD_PLAIN | RECORD_FILE, CONNECTION_NAME_FORMAT " Thread %lu %-16s %-7s %-50.*s | %d %s",
             connectionIndex,
             requestIndex,
             threadId,
             clientIp,
             methodToStr(req->method),
-            req->path.raw,
+            (int) req->path.raw.length,
+            req->path.raw.ptr,
             resp->status,
             statusToStr(resp->status)
         );
-        fclose(file);
     }
 #endif
 }
@@ -260,25 +684,19 @@ void logErrorResponse(HttpReq *req, const char *error)
     unsigned long connectionIndex = req->appState->connectionIndex;
     unsigned long requestIndex = req->appState->requestIndex;
 #if LOG_BY_LEVEL || LOG_TXT_FILE
-    char path[1024];
-    strncpy(path, req->path.raw, 1024);
+    int pathLength = (int) req->path.raw.length;
+    const char *path = req->path.raw.ptr;
 #endif
 #if LOG_BY_LEVEL
     if (logFlags & PRINT_LOG)
     {
-        printf(CONNECTION_NAME_FORMAT " " THREAD_NAME_FORMAT " %-16s %-7s %-50s | Error: %s\n", connectionIndex, requestIndex, THREAD_NAME_ARGS(threadId), clientIp, methodToStr(req->method), path, error);
+        pushFormatted(ERROR, RECORD_PLAIN, CONNECTION_NAME_FORMAT " " THREAD_NAME_FORMAT " %-16s %-7s %-50.*s | Error: %s", connectionIndex, requestIndex, THREAD_NAME_ARGS(threadId), clientIp, methodToStr(req->method), pathLength, path, error);
     }
 #endif
 #if LOG_TXT_FILE
     if (logFlags & FILE_LOG)
     {
-        FILE *file = fopen(logFilePath, "a");
-        if (file == NULL)
-        {
-            return;
-        }
-        fprintf(file, CONNECTION_NAME_FORMAT " Thread %ld %-16s %-7s %-50s | Error: %s\n", connectionIndex, requestIndex, threadId, clientIp, methodToStr(req->method), path, error);
-        fclose(file);
+        pushFormatted(ERROR, RECORD_PLAIN | RECORD_FILE, CONNECTION_NAME_FORMAT " Thread %lu %-16s %-7s %-50.*s | Error: %s", connectionIndex, requestIndex, threadId, clientIp, methodToStr(req->method), pathLength, path, error);
     }
 #endif
 }
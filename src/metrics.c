@@ -0,0 +1,488 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#define _GNU_SOURCE
+#include <alloc.h>
+#include <errors.h>
+#include <metrics.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    Latencies are counted in microseconds in log linear buckets: values under 8 get a bucket each,
+    every power of two above is split in 8 buckets, about 12% wide. The last bucket holds 2^32 us and over.
+*/
+#define LATENCY_SUB_BITS 3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_MSB 31
+#define LATENCY_BUCKETS ((LATENCY_MAX_MSB - LATENCY_SUB_BITS + 2) * LATENCY_SUB_BUCKETS)
+
+#define STATUS_MIN 100
+#define STATUS_COUNT 500
+#define METRICS_ERRORS_MAX 16
+
+typedef struct Latencies {
+    atomic_ulong buckets[LATENCY_BUCKETS];
+    atomic_ulong sumUs;
+} Latencies;
+
+typedef struct RouteMetrics {
+    atomic_ulong requests[STATUS_COUNT]; /* by status - STATUS_MIN */
+    Latencies total;
+    Latencies stages[REQUEST_STAGE_COUNT]; /* empty unless stages are observed */
+} RouteMetrics;
+
+/* Written only by its thread, read by scrapes under shardsMutex */
+typedef struct MetricsShard {
+    atomic_ulong counters[METRIC_COUNTER_COUNT];
+    atomic_ulong errors[METRICS_ERRORS_MAX]; /* by -code */
+    _Atomic(RouteMetrics*) routes[METRICS_ROUTES_MAX];
+    struct MetricsShard *next;
+} MetricsShard;
+
+static pthread_mutex_t shardsMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t shardKey;
+static int keyCreated = 0;
+static MetricsShard *shards = NULL;
+/* what exited threads counted */
+static MetricsShard retired;
+static _Thread_local MetricsShard *threadShard = NULL;
+
+static pthread_mutex_t routesMutex = PTHREAD_MUTEX_INITIALIZER;
+static const char *routePatterns[METRICS_ROUTES_MAX] = {"unmatched"};
+static atomic_int routeCount = 1;
+
+static const char *errorNames[METRICS_ERRORS_MAX] = {
+    [-TCP_STREAM_ERROR] = "tcp_stream_error",
+    [-ENTITY_TOO_LARGE_ERROR] = "entity_too_large",
+    [-UNKNOWN_METHOD] = "unknown_method",
+    [-UNKNOWN_VERSION] = "unknown_version",
+    [-BAD_REQUEST_ERROR] = "bad_request",
+    [-URI_TOO_LARGE_ERROR] = "uri_too_large",
+    [-TCP_STREAM_CLOSED] = "tcp_stream_closed",
+    [-TCP_STREAM_TIMEOUT] = "tcp_stream_timeout",
+    [-TCP_STREAM_WOULD_BLOCK] = "tcp_stream_would_block",
+    [-EXPECTATION_FAILED_ERROR] = "expectation_failed",
+};
+
+static const char *counterNames[METRIC_COUNTER_COUNT] = {
+    [METRIC_BYTES_RECEIVED] = "received_bytes_total",
+    [METRIC_BYTES_SENT] = "sent_bytes_total",
+    [METRIC_SENDFILE_BYTES] = "sendfile_bytes_total",
+    [METRIC_CONNECTIONS_OPENED] = "connections_total",
+    [METRIC_CONNECTIONS_CLOSED] = "connections_closed_total",
+    [METRIC_KEEP_ALIVE_REQUESTS] = "keep_alive_requests_total",
+    [METRIC_CONNECTIONS_PARKED] = "parked_connections_total",
+    [METRIC_ARENA_CHUNKS] = "arena_chunks_allocated_total",
+    [METRIC_GC_ENTRIES_FREED] = "gc_entries_freed_total",
+};
+
+static const char *stageNames[REQUEST_STAGE_COUNT] = {
+    [REQUEST_STAGE_PARSE] = "parse",
+    [REQUEST_STAGE_ROUTE] = "route",
+    [REQUEST_STAGE_BODY] = "body",
+    [REQUEST_STAGE_HANDLER] = "handler",
+    [REQUEST_STAGE_SEND] = "send",
+};
+
+/* Single writer, a plain add without a locked instruction is enough */
+static void bump(atomic_ulong *counter, unsigned long value) {
+    unsigned long current = atomic_load_explicit(counter, memory_order_relaxed);
+    atomic_store_explicit(counter, current + value, memory_order_relaxed);
+}
+
+static unsigned long readCounter(const atomic_ulong *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static void addLatencies(Latencies *into, const Latencies *from) {
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        bump(&into->buckets[b], readCounter(&from->buckets[b]));
+    }
+    bump(&into->sumUs, readCounter(&from->sumUs));
+}
+
+static void addRouteMetrics(RouteMetrics *into, const RouteMetrics *from) {
+    for (int s = 0; s < STATUS_COUNT; s++) {
+        bump(&into->requests[s], readCounter(&from->requests[s]));
+    }
+    addLatencies(&into->total, &from->total);
+    for (int i = 0; i < REQUEST_STAGE_COUNT; i++) {
+        addLatencies(&into->stages[i], &from->stages[i]);
+    }
+}
+
+static void foldShard(MetricsShard *into, MetricsShard *shard) {
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        bump(&into->counters[i], readCounter(&shard->counters[i]));
+    }
+    for (int i = 0; i < METRICS_ERRORS_MAX; i++) {
+        bump(&into->errors[i], readCounter(&shard->errors[i]));
+    }
+    for (int i = 0; i < METRICS_ROUTES_MAX; i++) {
+        RouteMetrics *route = atomic_load_explicit(&shard->routes[i], memory_order_acquire);
+        if (route == NULL) {
+            continue;
+        }
+        RouteMetrics *target = atomic_load_explicit(&into->routes[i], memory_order_relaxed);
+        if (target == NULL) {
+            atomic_store_explicit(&into->routes[i], route, memory_order_release);
+            atomic_store_explicit(&shard->routes[i], NULL, memory_order_relaxed);
+            continue;
+        }
+        addRouteMetrics(target, route);
+    }
+}
+
+static void destroyShard(MetricsShard *shard) {
+    for (int i = 0; i < METRICS_ROUTES_MAX; i++) {
+        deallocate(atomic_load_explicit(&shard->routes[i], memory_order_relaxed));
+    }
+    deallocate(shard);
+}
+
+/* Runs in the exiting thread, later destructors counting anything get a new shard */
+static void retireShard(void *arg) {
+    MetricsShard *shard = arg;
+    pthread_mutex_lock(&shardsMutex);
+    MetricsShard **link = &shards;
+    while (*link != shard) {
+        link = &(*link)->next;
+    }
+    *link = shard->next;
+    foldShard(&retired, shard);
+    pthread_mutex_unlock(&shardsMutex);
+    threadShard = NULL;
+    destroyShard(shard);
+}
+
+static MetricsShard *getShard() {
+    if (threadShard != NULL) {
+        return threadShard;
+    }
+    MetricsShard *shard = allocate(sizeof(MetricsShard));
+    memset(shard, 0, sizeof(MetricsShard));
+
+    pthread_mutex_lock(&shardsMutex);
+    if (!keyCreated) {
+        pthread_key_create(&shardKey, retireShard);
+        keyCreated = 1;
+    }
+    shard->next = shards;
+    shards = shard;
+    pthread_mutex_unlock(&shardsMutex);
+
+    pthread_setspecific(shardKey, shard);
+    threadShard = shard;
+    return shard;
+}
+
+static int latencyBucket(unsigned long long us) {
+    if (us < LATENCY_SUB_BUCKETS) {
+        return (int) us;
+    }
+    int msb = 63 - __builtin_clzll(us);
+    if (msb > LATENCY_MAX_MSB) {
+        return LATENCY_BUCKETS - 1;
+    }
+    int shift = msb - LATENCY_SUB_BITS;
+    return (shift + 1) * LATENCY_SUB_BUCKETS + (int) ((us >> shift) - LATENCY_SUB_BUCKETS);
+}
+
+/* Exclusive upper bound of a bucket in microseconds */
+static unsigned long long latencyBucketEnd(int bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return (unsigned long long) bucket + 1;
+    }
+    int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    unsigned long long sub = bucket % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+    return (sub + 1) << shift;
+}
+
+void metricsAdd(MetricCounter counter, size_t value) {
+    bump(&getShard()->counters[counter], value);
+}
+
+void metricsCountError(int code) {
+    if (code < 0 && -code < METRICS_ERRORS_MAX) {
+        bump(&getShard()->errors[-code], 1);
+    }
+}
+
+int addMetricsRoute(const char *pattern) {
+    pthread_mutex_lock(&routesMutex);
+    int count = atomic_load_explicit(&routeCount, memory_order_relaxed);
+    int route = 0;
+    for (int i = 1; i < count && route == 0; i++) {
+        if (strcmp(routePatterns[i], pattern) == 0) {
+            route = i;
+        }
+    }
+    if (route == 0 && count < METRICS_ROUTES_MAX) {
+        routePatterns[count] = strdup(pattern);
+        route = count;
+        atomic_store_explicit(&routeCount, count + 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&routesMutex);
+    return route;
+}
+
+static RouteMetrics *getRouteMetrics(int route) {
+    if (route < 0 || route >= METRICS_ROUTES_MAX) {
+        route = 0;
+    }
+    MetricsShard *shard = getShard();
+    RouteMetrics *metrics = atomic_load_explicit(&shard->routes[route], memory_order_relaxed);
+    if (metrics == NULL) {
+        metrics = allocate(sizeof(RouteMetrics));
+        memset(metrics, 0, sizeof(RouteMetrics));
+        atomic_store_explicit(&shard->routes[route], metrics, memory_order_release);
+    }
+    return metrics;
+}
+
+const char *stageToStr(RequestStage stage) {
+    return stage < REQUEST_STAGE_COUNT ? stageNames[stage] : "unknown";
+}
+
+static void observeLatency(Latencies *latencies, long long durationNs) {
+    unsigned long long us = durationNs > 0 ? (unsigned long long) durationNs / 1000 : 0;
+    bump(&latencies->buckets[latencyBucket(us)], 1);
+    bump(&latencies->sumUs, us);
+}
+
+void metricsObserveRequest(int route, int status, long long durationNs) {
+    RouteMetrics *metrics = getRouteMetrics(route);
+    if (status >= STATUS_MIN && status < STATUS_MIN + STATUS_COUNT) {
+        bump(&metrics->requests[status - STATUS_MIN], 1);
+    }
+    observeLatency(&metrics->total, durationNs);
+}
+
+void metricsObserveStages(int route, const long long stageNs[REQUEST_STAGE_COUNT]) {
+    RouteMetrics *metrics = getRouteMetrics(route);
+    for (int i = 0; i < REQUEST_STAGE_COUNT; i++) {
+        observeLatency(&metrics->stages[i], stageNs[i]);
+    }
+}
+
+/* Label values escape backslash, quote and newline */
+static void writeLabel(FILE *out, const char *value) {
+    for (; *value != '\0'; value++) {
+        switch (*value) {
+            case '\\':
+                fputs("\\\\", out);
+                break;
+            case '"':
+                fputs("\\\"", out);
+                break;
+            case '\n':
+                fputs("\\n", out);
+                break;
+            default:
+                fputc(*value, out);
+        }
+    }
+}
+
+static void writeRouteLabel(FILE *out, int route) {
+    fputs("route=\"", out);
+    writeLabel(out, routePatterns[route]);
+    fputc('"', out);
+}
+
+static const double histogramBounds[] = {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+static const double summaryQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+static unsigned long latencyCount(const Latencies *latencies) {
+    unsigned long count = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        count += latencies->buckets[b];
+    }
+    return count;
+}
+
+/* Highest value of the bucket holding the quantile, in seconds */
+static double latencyQuantile(const Latencies *latencies, unsigned long count, double quantile) {
+    unsigned long rank = (unsigned long) (quantile * (double) count + 0.999999);
+    unsigned long seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += latencies->buckets[b];
+        if (seen >= rank && seen > 0) {
+            return (double) (latencyBucketEnd(b) - 1) / 1e6;
+        }
+    }
+    return 0;
+}
+
+/* Opens a series, the caller adds its own labels and the value */
+static void writeSeries(FILE *out, const char *name, const char *suffix, int route, const char *stage) {
+    fprintf(out, "%s%s{", name, suffix);
+    writeRouteLabel(out, route);
+    if (stage != NULL) {
+        fprintf(out, ",stage=\"%s\"", stage);
+    }
+}
+
+static void writeRouteRequests(FILE *out, const RouteMetrics *routes, int count) {
+    fputs("# HELP httpserverc_requests_total Responses sent by route and status.\n"
+          "# TYPE httpserverc_requests_total counter\n", out);
+    for (int r = 0; r < count; r++) {
+        for (int s = 0; s < STATUS_COUNT; s++) {
+            if (routes[r].requests[s] == 0) {
+                continue;
+            }
+            writeSeries(out, "httpserverc_requests_total", "", r, NULL);
+            fprintf(out, ",status=\"%d\"} %lu\n", s + STATUS_MIN, (unsigned long) routes[r].requests[s]);
+        }
+    }
+}
+
+/* Bounds between buckets count a bucket once all of it is under the bound */
+static void writeHistogram(FILE *out, const char *name, int route, const char *stage, const Latencies *latencies) {
+    unsigned long total = latencyCount(latencies);
+    if (total == 0) {
+        return;
+    }
+    int b = 0;
+    unsigned long cumulative = 0;
+    for (size_t i = 0; i < sizeof(histogramBounds) / sizeof(*histogramBounds); i++) {
+        unsigned long long boundUs = (unsigned long long) (histogramBounds[i] * 1e6 + 0.5);
+        while (b < LATENCY_BUCKETS && latencyBucketEnd(b) <= boundUs + 1) {
+            cumulative += latencies->buckets[b++];
+        }
+        writeSeries(out, name, "_bucket", route, stage);
+        fprintf(out, ",le=\"%g\"} %lu\n", histogramBounds[i], cumulative);
+    }
+    writeSeries(out, name, "_bucket", route, stage);
+    fprintf(out, ",le=\"+Inf\"} %lu\n", total);
+    writeSeries(out, name, "_sum", route, stage);
+    fprintf(out, "} %.6f\n", (double) latencies->sumUs / 1e6);
+    writeSeries(out, name, "_count", route, stage);
+    fprintf(out, "} %lu\n", total);
+}
+
+static void writeSummary(FILE *out, const char *name, int route, const char *stage, const Latencies *latencies) {
+    unsigned long total = latencyCount(latencies);
+    if (total == 0) {
+        return;
+    }
+    for (size_t i = 0; i < sizeof(summaryQuantiles) / sizeof(*summaryQuantiles); i++) {
+        writeSeries(out, name, "", route, stage);
+        fprintf(out, ",quantile=\"%g\"} %.6f\n", summaryQuantiles[i], latencyQuantile(latencies, total, summaryQuantiles[i]));
+    }
+    writeSeries(out, name, "_sum", route, stage);
+    fprintf(out, "} %.6f\n", (double) latencies->sumUs / 1e6);
+    writeSeries(out, name, "_count", route, stage);
+    fprintf(out, "} %lu\n", total);
+}
+
+static void writeRouteLatencies(FILE *out, const RouteMetrics *routes, int count) {
+    fputs("# HELP httpserverc_request_duration_seconds Time from the first request byte to the response sent.\n"
+          "# TYPE httpserverc_request_duration_seconds histogram\n", out);
+    for (int r = 0; r < count; r++) {
+        writeHistogram(out, "httpserverc_request_duration_seconds", r, NULL, &routes[r].total);
+    }
+    fputs("# HELP httpserverc_request_latency_seconds Request duration quantiles, within 12.5%.\n"
+          "# TYPE httpserverc_request_latency_seconds summary\n", out);
+    for (int r = 0; r < count; r++) {
+        writeSummary(out, "httpserverc_request_latency_seconds", r, NULL, &routes[r].total);
+    }
+
+    fputs("# HELP httpserverc_request_stage_duration_seconds Time spent in each stage of a request.\n"
+          "# TYPE httpserverc_request_stage_duration_seconds histogram\n", out);
+    for (int r = 0; r < count; r++) {
+        for (int i = 0; i < REQUEST_STAGE_COUNT; i++) {
+            writeHistogram(out, "httpserverc_request_stage_duration_seconds", r, stageNames[i], &routes[r].stages[i]);
+        }
+    }
+    fputs("# HELP httpserverc_request_stage_latency_seconds Request stage duration quantiles, within 12.5%.\n"
+          "# TYPE httpserverc_request_stage_latency_seconds summary\n", out);
+    for (int r = 0; r < count; r++) {
+        for (int i = 0; i < REQUEST_STAGE_COUNT; i++) {
+            writeSummary(out, "httpserverc_request_stage_latency_seconds", r, stageNames[i], &routes[r].stages[i]);
+        }
+    }
+}
+
+static void writeCounters(FILE *out, const MetricsShard *sum) {
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        fprintf(out, "# TYPE httpserverc_%s counter\nhttpserverc_%s %lu\n",
+            counterNames[i], counterNames[i], (unsigned long) sum->counters[i]);
+    }
+    unsigned long opened = sum->counters[METRIC_CONNECTIONS_OPENED];
+    unsigned long closed = sum->counters[METRIC_CONNECTIONS_CLOSED];
+    fprintf(out, "# TYPE httpserverc_connections_active gauge\nhttpserverc_connections_active %lu\n",
+        opened > closed ? opened - closed : 0);
+
+    fputs("# HELP httpserverc_request_errors_total Requests ended by an error before reaching a handler.\n"
+          "# TYPE httpserverc_request_errors_total counter\n", out);
+    for (int i = 1; i < METRICS_ERRORS_MAX; i++) {
+        if (errorNames[i] != NULL) {
+            fprintf(out, "httpserverc_request_errors_total{error=\"%s\"} %lu\n", errorNames[i], (unsigned long) sum->errors[i]);
+        }
+    }
+}
+
+static void addRoutes(RouteMetrics *routes, const MetricsShard *shard, int count) {
+    for (int r = 0; r < count; r++) {
+        RouteMetrics *route = atomic_load_explicit(&shard->routes[r], memory_order_acquire);
+        if (route != NULL) {
+            addRouteMetrics(&routes[r], route);
+        }
+    }
+}
+
+static void addShard(MetricsShard *sum, RouteMetrics *routes, const MetricsShard *shard, int count) {
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        bump(&sum->counters[i], readCounter(&shard->counters[i]));
+    }
+    for (int i = 0; i < METRICS_ERRORS_MAX; i++) {
+        bump(&sum->errors[i], readCounter(&shard->errors[i]));
+    }
+    addRoutes(routes, shard, count);
+}
+
+size_t formatMetrics(char **out) {
+    int count = atomic_load_explicit(&routeCount, memory_order_acquire);
+    /* the sums are only touched by this thread */
+    MetricsShard *sum = allocate(sizeof(MetricsShard));
+    memset(sum, 0, sizeof(MetricsShard));
+    RouteMetrics *routes = allocate(sizeof(RouteMetrics) * count);
+    memset(routes, 0, sizeof(RouteMetrics) * count);
+
+    pthread_mutex_lock(&shardsMutex);
+    addShard(sum, routes, &retired, count);
+    for (MetricsShard *shard = shards; shard != NULL; shard = shard->next) {
+        addShard(sum, routes, shard, count);
+    }
+    pthread_mutex_unlock(&shardsMutex);
+
+    char *text = NULL;
+    size_t length = 0;
+    FILE *stream = open_memstream(&text, &length);
+    writeRouteRequests(stream, routes, count);
+    writeRouteLatencies(stream, routes, count);
+    writeCounters(stream, sum);
+    fclose(stream);
+    deallocate(routes);
+    deallocate(sum);
+
+    *out = gcArenaAllocate(length + 1, alignof(char));
+    memcpy(*out, text, length + 1);
+    free(text);
+    return length;
+}
+
+HttpResp metricsH(HttpReq) {
+    char *text;
+    size_t length = formatMetrics(&text);
+    HttpRespBuilder builder = newRespBuilder();
+    respBuilderAddHeader(&builder, "Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+    respBuilderSetContent(&builder, text, length, 0);
+    return respBuild(&builder);
+}
@@ -0,0 +1,153 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "idle_parking.h"
+#include "timer_wheel.h"
+
+#include <alloc.h>
+#include <errno.h>
+#include <logging.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <utils.h>
+
+#define PARKING_MAX_EVENTS 64
+#define PARKING_TIMER_TICK_MS 100
+/* Upper bound for a single wait, so newly parked connections get their timer in time */
+#define PARKING_MAX_WAIT_MS 1000
+
+typedef struct ParkedConnection {
+    ParkingLot *lot;
+    SessionState *state;
+    Timer timer;
+    struct ParkedConnection *nextIncoming;
+} ParkedConnection;
+
+/*
+    The wheel belongs to the parking thread,
+    other threads only push to the incoming list.
+*/
+struct ParkingLot {
+    int epollFd;
+    int idleTimeoutMs;
+    ParkedConnectionHandler onReadable;
+    TimerWheel wheel;
+    pthread_mutex_t incomingMutex;
+    ParkedConnection *incoming;
+};
+
+static void *runParkingLot(void *arg);
+
+ParkingLot *newParkingLot(int idleTimeoutMs, ParkedConnectionHandler onReadable) {
+    ParkingLot *lot = allocate(sizeof(ParkingLot));
+    lot->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    lot->idleTimeoutMs = idleTimeoutMs;
+    lot->onReadable = onReadable;
+    lot->incoming = NULL;
+    if (lot->epollFd == -1) {
+        perror("newParkingLot: epoll_create1");
+        deallocate(lot);
+        return NULL;
+    }
+    initTimerWheel(&lot->wheel, getMonotonicTimeMs(), PARKING_TIMER_TICK_MS);
+    pthread_mutex_init(&lot->incomingMutex, NULL);
+    pthread_t thread;
+    pthread_create(&thread, NULL, runParkingLot, lot);
+    pthread_detach(thread);
+    return lot;
+}
+
+static void expireParked(Timer *timer) {
+    ParkedConnection *parked = timer->arg;
+    epoll_ctl(parked->lot->epollFd, EPOLL_CTL_DEL, parked->state->clientSocket.fd, NULL);
+    info("Idle connection %lu timed out", parked->state->connectionIndex);
+    destroySessionState(parked->state);
+    deallocate(parked);
+}
+
+/*
+    The socket is added to the epoll while holding the incoming mutex,
+    the parking thread drains the incoming list before handling events,
+    so a connection always has its timer before its first event is handled.
+*/
+int parkConnection(ParkingLot *lot, SessionState *state) {
+    ParkedConnection *parked = allocate(sizeof(ParkedConnection));
+    parked->lot = lot;
+    parked->state = state;
+    initTimer(&parked->timer, expireParked, parked);
+
+    /* One shot, the parking thread removes the socket as soon as it reports anything */
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT,
+        .data.ptr = parked,
+    };
+    pthread_mutex_lock(&lot->incomingMutex);
+    if (epoll_ctl(lot->epollFd, EPOLL_CTL_ADD, state->clientSocket.fd, &event) == -1) {
+        pthread_mutex_unlock(&lot->incomingMutex);
+        perror("parkConnection: epoll_ctl");
+        deallocate(parked);
+        return -1;
+    }
+    parked->nextIncoming = lot->incoming;
+    lot->incoming = parked;
+    pthread_mutex_unlock(&lot->incomingMutex);
+    return 0;
+}
+
+static void scheduleIncoming(ParkingLot *lot) {
+    pthread_mutex_lock(&lot->incomingMutex);
+    ParkedConnection *parked = lot->incoming;
+    lot->incoming = NULL;
+    pthread_mutex_unlock(&lot->incomingMutex);
+
+    while (parked != NULL) {
+        ParkedConnection *next = parked->nextIncoming;
+        long long deadline = parked->state->clientSocket.deadline;
+        if (deadline == 0) {
+            deadline = getMonotonicTimeMs() + lot->idleTimeoutMs;
+        }
+        timerWheelSchedule(&lot->wheel, &parked->timer, deadline);
+        parked = next;
+    }
+}
+
+static void unparkReady(ParkingLot *lot, ParkedConnection *parked, unsigned int events) {
+    SessionState *state = parked->state;
+    timerWheelCancel(&lot->wheel, &parked->timer);
+    deallocate(parked);
+    epoll_ctl(lot->epollFd, EPOLL_CTL_DEL, state->clientSocket.fd, NULL);
+
+    if (!(events & EPOLLIN)) {
+        destroySessionState(state);
+        return;
+    }
+    lot->onReadable(state);
+}
+
+static void *runParkingLot(void *arg) {
+    ParkingLot *lot = arg;
+    struct epoll_event events[PARKING_MAX_EVENTS];
+
+    for (;;) {
+        int timeoutMs = timerWheelNextTimeout(&lot->wheel, getMonotonicTimeMs());
+        if (timeoutMs == -1 || timeoutMs > PARKING_MAX_WAIT_MS) {
+            timeoutMs = PARKING_MAX_WAIT_MS;
+        }
+        int ready = epoll_wait(lot->epollFd, events, PARKING_MAX_EVENTS, timeoutMs);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("runParkingLot: epoll_wait");
+            break;
+        }
+        scheduleIncoming(lot);
+        for (int i = 0; i < ready; i++) {
+            unparkReady(lot, events[i].data.ptr, events[i].events);
+        }
+        timerWheelAdvance(&lot->wheel, getMonotonicTimeMs());
+    }
+    return NULL;
+}
@@ -0,0 +1,24 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_IDLE_PARKING_H
+#define HTTPSERVERC_IDLE_PARKING_H
+
+#include <app_state.h>
+
+typedef void (*ParkedConnectionHandler)(SessionState *state);
+
+typedef struct ParkingLot ParkingLot;
+
+/*
+    Single thread watching idle keep alive connections with epoll.
+    Only the session state is kept while parked, no thread, arena or stream buffer.
+    onReadable runs on the parking thread and takes back ownership of the state.
+    Connections are closed once their socket deadline passes, after idleTimeoutMs without one.
+*/
+ParkingLot *newParkingLot(int idleTimeoutMs, ParkedConnectionHandler onReadable);
+/* Returns -1 without taking ownership of state if the socket could not be watched. */
+int parkConnection(ParkingLot *lot, SessionState *state);
+
+#endif //HTTPSERVERC_IDLE_PARKING_H
@@ -0,0 +1,69 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "mpmc_queue.h"
+
+#include <alloc.h>
+
+void initMpmcQueue(MpmcQueue *queue, size_t capacity) {
+    size_t actualCapacity = 2;
+    while (actualCapacity < capacity) {
+        actualCapacity *= 2;
+    }
+    queue->cells = allocate(sizeof(MpmcCell) * actualCapacity);
+    queue->mask = actualCapacity - 1;
+    for (size_t i = 0; i < actualCapacity; i++) {
+        atomic_init(&queue->cells[i].sequence, i);
+        queue->cells[i].data = NULL;
+    }
+    atomic_init(&queue->enqueuePos, 0);
+    atomic_init(&queue->dequeuePos, 0);
+}
+
+void destroyMpmcQueue(MpmcQueue *queue) {
+    deallocate(queue->cells);
+    queue->cells = NULL;
+}
+
+int mpmcQueuePush(MpmcQueue *queue, void *data) {
+    size_t pos = atomic_load_explicit(&queue->enqueuePos, memory_order_relaxed);
+    for (;;) {
+        MpmcCell *cell = &queue->cells[pos & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t) sequence - (ptrdiff_t) pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueuePos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->data = data;
+                atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&queue->enqueuePos, memory_order_relaxed);
+        }
+    }
+}
+
+int mpmcQueuePop(MpmcQueue *queue, void **data) {
+    size_t pos = atomic_load_explicit(&queue->dequeuePos, memory_order_relaxed);
+    for (;;) {
+        MpmcCell *cell = &queue->cells[pos & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t) sequence - (ptrdiff_t) (pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeuePos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *data = cell->data;
+                atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&queue->dequeuePos, memory_order_relaxed);
+        }
+    }
+}
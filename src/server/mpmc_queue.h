@@ -0,0 +1,36 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_MPMC_QUEUE_H
+#define HTTPSERVERC_MPMC_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define MPMC_CACHE_LINE 64
+
+typedef struct {
+    atomic_size_t sequence;
+    void *data;
+} MpmcCell;
+
+/*
+    Bounded lock free multi producer multi consumer queue (Vyukov).
+    Capacity is rounded up to a power of two.
+*/
+typedef struct MpmcQueue {
+    MpmcCell *cells;
+    size_t mask;
+    alignas(MPMC_CACHE_LINE) atomic_size_t enqueuePos;
+    alignas(MPMC_CACHE_LINE) atomic_size_t dequeuePos;
+} MpmcQueue;
+
+void initMpmcQueue(MpmcQueue *queue, size_t capacity);
+void destroyMpmcQueue(MpmcQueue *queue);
+/* Returns 0 if the queue is full */
+int mpmcQueuePush(MpmcQueue *queue, void *data);
+/* Returns 0 if the queue is empty */
+int mpmcQueuePop(MpmcQueue *queue, void **data);
+
+#endif //HTTPSERVERC_MPMC_QUEUE_H
@@ -0,0 +1,466 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "reactor.h"
+#include "timer_wheel.h"
+#include "helpers/thread_helper.h"
+#include "io/io_backend.h"
+
+#include <alloc.h>
+#include <errno.h>
+#include <logging.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utils.h>
+
+#define REACTOR_MAX_EVENTS 64
+#define REACTOR_TIMER_TICK_MS 100
+
+typedef struct EventLoop EventLoop;
+
+/*
+    The timer follows the socket deadline, which the handler moves between request phases.
+    While a response waits in the outbound queue the connection reads nothing, the deadline
+    is the write timeout and the receive deadline left is kept in pausedDeadlineMs.
+*/
+typedef struct ReactorConnection {
+    EventLoop *loop;
+    SessionState *state;
+    TcpStream *stream;
+    Timer timer;
+    long long scheduledDeadline;
+    int flushing;
+    int closeWhenFlushed;
+    long long pausedDeadlineMs;
+    GcContext *pausedRequest; /* allocations of a REQUEST_PAUSED handler, kept from the loop's gcCleanup */
+    struct ReactorConnection *nextIncoming;
+    struct ReactorConnection *previous; /* live connections of the loop, closed when it stops */
+    struct ReactorConnection *next;
+} ReactorConnection;
+
+/*
+    Listener readiness is reported with the loop itself as epoll data,
+    connections handed over by the acceptor with &wakeFd.
+    The wheel is only touched by the loop thread.
+*/
+struct EventLoop {
+    Reactor *reactor;
+    pthread_t thread;
+    int epollFd;
+    int wakeFd;
+    int index;
+    TcpSocket listener;
+    TimerWheel wheel;
+    pthread_mutex_t incomingMutex;
+    ReactorConnection *incoming;
+    ReactorConnection *connections;
+    atomic_int stopping;
+};
+
+struct Reactor {
+    ConnectionRequestHandler handler;
+    EventLoop *loops;
+    int loopCount;
+    int pinLoops;
+    unsigned int nextLoop;
+};
+
+static void *runEventLoop(void *arg);
+
+Reactor *newReactor(int loopCount, int pinLoops, ConnectionRequestHandler handler) {
+    Reactor *reactor = allocate(sizeof(Reactor));
+    *reactor = (Reactor) {
+        .handler = handler,
+        .loops = allocate(sizeof(EventLoop) * loopCount),
+        .loopCount = loopCount,
+        .pinLoops = pinLoops,
+        .nextLoop = 0,
+    };
+    for (int i = 0; i < loopCount; i++) {
+        EventLoop *loop = &reactor->loops[i];
+        loop->reactor = reactor;
+        loop->index = i;
+        loop->listener = (TcpSocket) {.fd = -1, .closed = 1};
+        loop->incoming = NULL;
+        loop->connections = NULL;
+        atomic_init(&loop->stopping, 0);
+        pthread_mutex_init(&loop->incomingMutex, NULL);
+        initTimerWheel(&loop->wheel, getMonotonicTimeMs(), REACTOR_TIMER_TICK_MS);
+        loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epollFd == -1) {
+            perror("newReactor: epoll_create1");
+            return NULL;
+        }
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        struct epoll_event wakeEvent = {
+            .events = EPOLLIN | EPOLLET,
+            .data.ptr = &loop->wakeFd,
+        };
+        if (loop->wakeFd == -1 || epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &wakeEvent) == -1) {
+            perror("newReactor: eventfd");
+            return NULL;
+        }
+        pthread_create(&loop->thread, NULL, runEventLoop, loop);
+    }
+    info("Started %d event loops", loopCount);
+    return reactor;
+}
+
+int reactorListen(Reactor *reactor, const port_t port, ListenOptions options) {
+    options.reusePort = 1;
+    options.nonBlocking = 1;
+    for (int i = 0; i < reactor->loopCount; i++) {
+        EventLoop *loop = &reactor->loops[i];
+        loop->listener = socketListenWithOptions(port, options);
+        if (loop->listener.closed) {
+            return -1;
+        }
+        struct epoll_event event = {
+            .events = EPOLLIN | EPOLLET,
+            .data.ptr = loop,
+        };
+        if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->listener.fd, &event) == -1) {
+            perror("reactorListen: epoll_ctl");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void reactorStop(Reactor *reactor) {
+    for (int i = 0; i < reactor->loopCount; i++) {
+        EventLoop *loop = &reactor->loops[i];
+        atomic_store(&loop->stopping, 1);
+        if (eventfd_write(loop->wakeFd, 1) == -1) {
+            perror("reactorStop: eventfd_write");
+        }
+    }
+    for (int i = 0; i < reactor->loopCount; i++) {
+        EventLoop *loop = &reactor->loops[i];
+        pthread_join(loop->thread, NULL);
+        close(loop->wakeFd);
+        close(loop->epollFd);
+        pthread_mutex_destroy(&loop->incomingMutex);
+    }
+    info("Stopped %d event loops", reactor->loopCount);
+    deallocate(reactor->loops);
+    deallocate(reactor);
+}
+
+static void serveConnection(EventLoop *loop, ReactorConnection *connection, unsigned int events);
+static void closeReactorConnection(EventLoop *loop, ReactorConnection *connection);
+
+static void expireConnection(Timer *timer) {
+    ReactorConnection *connection = timer->arg;
+    info("Connection %lu timed out", connection->state->connectionIndex);
+    closeReactorConnection(connection->loop, connection);
+}
+
+static ReactorConnection *newReactorConnection(EventLoop *loop, SessionState *state) {
+    ReactorConnection *connection = allocate(sizeof(ReactorConnection));
+    connection->loop = loop;
+    connection->state = state;
+    connection->stream = newTcpStream(&state->clientSocket);
+    connection->scheduledDeadline = 0;
+    connection->flushing = 0;
+    connection->closeWhenFlushed = 0;
+    connection->pausedDeadlineMs = 0;
+    connection->pausedRequest = NULL;
+    enableOutboundQueue(&state->clientSocket);
+    connection->nextIncoming = NULL;
+    connection->previous = NULL;
+    connection->next = NULL;
+    initTimer(&connection->timer, expireConnection, connection);
+    return connection;
+}
+
+/*
+    Runs on the loop thread. The first read is attempted right away,
+    it usually finds the request and it arms the idle deadline otherwise.
+    Edge triggered EPOLLOUT only fires once a socket that filled up drains.
+*/
+static void registerConnection(EventLoop *loop, ReactorConnection *connection) {
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+        .data.ptr = connection,
+    };
+    if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, connection->state->clientSocket.fd, &event) == -1) {
+        perror("registerConnection: epoll_ctl");
+        freeTcpStream(connection->stream);
+        destroySessionState(connection->state);
+        deallocate(connection);
+        return;
+    }
+    connection->next = loop->connections;
+    if (loop->connections != NULL) {
+        loop->connections->previous = connection;
+    }
+    loop->connections = connection;
+    serveConnection(loop, connection, EPOLLIN);
+}
+
+/*
+    Called only from the acceptor thread, round robin is enough
+    as every loop serves connections of similar cost.
+*/
+int reactorAddConnection(Reactor *reactor, SessionState *state) {
+    if (!state->clientSocket.nonBlocking && setSocketNonBlocking(&state->clientSocket) == -1) {
+        return -1;
+    }
+    EventLoop *loop = &reactor->loops[reactor->nextLoop++ % reactor->loopCount];
+    ReactorConnection *connection = newReactorConnection(loop, state);
+    pthread_mutex_lock(&loop->incomingMutex);
+    connection->nextIncoming = loop->incoming;
+    loop->incoming = connection;
+    pthread_mutex_unlock(&loop->incomingMutex);
+    if (eventfd_write(loop->wakeFd, 1) == -1) {
+        perror("reactorAddConnection: eventfd_write");
+    }
+    return 0;
+}
+
+static void registerIncoming(EventLoop *loop) {
+    eventfd_t count;
+    eventfd_read(loop->wakeFd, &count);
+    pthread_mutex_lock(&loop->incomingMutex);
+    ReactorConnection *connection = loop->incoming;
+    loop->incoming = NULL;
+    pthread_mutex_unlock(&loop->incomingMutex);
+
+    while (connection != NULL) {
+        ReactorConnection *next = connection->nextIncoming;
+        registerConnection(loop, connection);
+        connection = next;
+    }
+}
+
+static void acceptPending(EventLoop *loop) {
+    for (;;) {
+        TcpSocket clientSocket = acceptConnectionWithFlags(loop->listener, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientSocket.closed) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                error("Client connection error: %s", strerror(errno));
+            }
+            return;
+        }
+        SessionState *state = newSessionState(clientSocket, nextConnectionIndex());
+        info("Connection accepted from client %s with connection index %lu", clientSocket.ip, state->connectionIndex);
+        registerConnection(loop, newReactorConnection(loop, state));
+    }
+}
+
+static void closeReactorConnection(EventLoop *loop, ReactorConnection *connection) {
+    if (connection->previous != NULL) {
+        connection->previous->next = connection->next;
+    } else {
+        loop->connections = connection->next;
+    }
+    if (connection->next != NULL) {
+        connection->next->previous = connection->previous;
+    }
+    timerWheelCancel(&loop->wheel, &connection->timer);
+    if (connection->pausedRequest != NULL) {
+        gcFreeContext(connection->pausedRequest);
+    }
+    epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, connection->state->clientSocket.fd, NULL);
+    freeTcpStream(connection->stream);
+    destroySessionState(connection->state);
+    deallocate(connection);
+}
+
+static void armConnectionTimer(EventLoop *loop, ReactorConnection *connection) {
+    long long deadline = connection->state->clientSocket.deadline;
+    if (deadline == connection->scheduledDeadline && timerIsPending(&connection->timer)) {
+        return;
+    }
+    connection->scheduledDeadline = deadline;
+    if (deadline == 0) {
+        timerWheelCancel(&loop->wheel, &connection->timer);
+        return;
+    }
+    timerWheelSchedule(&loop->wheel, &connection->timer, deadline);
+}
+
+/* Every EPOLLOUT means the peer read something, so the write timeout starts over */
+static void awaitWritable(EventLoop *loop, ReactorConnection *connection) {
+    TcpSocket *client = &connection->state->clientSocket;
+    if (!connection->flushing) {
+        connection->flushing = 1;
+        long long remaining = client->deadline - getMonotonicTimeMs();
+        connection->pausedDeadlineMs = client->deadline == 0 ? 0 : remaining > 0 ? remaining : 1;
+    }
+    setSocketDeadline(client, socketTransmitWait(client));
+    armConnectionTimer(loop, connection);
+}
+
+static void resumeReading(ReactorConnection *connection) {
+    connection->flushing = 0;
+    setSocketDeadline(&connection->state->clientSocket, (int) connection->pausedDeadlineMs);
+}
+
+/*
+    A paused request runs in its own allocations, the loop's are only for requests
+    that finish within one call, so gcCleanup never frees memory of a paused one.
+*/
+static RequestOutcome runHandler(EventLoop *loop, ReactorConnection *connection) {
+    GcContext *paused = connection->pausedRequest;
+    if (paused != NULL) {
+        gcSwapContext(paused);
+    }
+    RequestOutcome outcome = loop->reactor->handler(connection->state, connection->stream);
+    if (paused != NULL) {
+        gcSwapContext(paused);
+        if (outcome != REQUEST_PAUSED) {
+            gcFreeContext(paused);
+            connection->pausedRequest = NULL;
+        }
+    } else if (outcome == REQUEST_PAUSED) {
+        connection->pausedRequest = gcSuspend();
+    }
+    return outcome;
+}
+
+/*
+    Edge triggered: keep serving requests until the socket reports EAGAIN,
+    otherwise the next edge never comes. A response the socket did not take is
+    left in the outbound queue and the loop moves on, pipelined requests stay
+    in the stream until it is flushed. A producer that filled the queue past its
+    limit is paused the same way and resumed by the flush.
+*/
+static void serveConnection(EventLoop *loop, ReactorConnection *connection, unsigned int events) {
+    SessionState *state = connection->state;
+    TcpStream *stream = connection->stream;
+    TcpSocket *client = &state->clientSocket;
+    setSessionState(state);
+
+    if ((events & EPOLLERR) && !(events & EPOLLIN)) {
+        closeReactorConnection(loop, connection);
+        setSessionState(NULL);
+        return;
+    }
+
+    if (connection->flushing) {
+        WriteEnum flushed = flushOutbound(client);
+        if (flushed == WRITE_WOULD_BLOCK) {
+            awaitWritable(loop, connection);
+            setSessionState(NULL);
+            return;
+        }
+        if (flushed != WRITE_OK || connection->closeWhenFlushed) {
+            closeReactorConnection(loop, connection);
+            setSessionState(NULL);
+            return;
+        }
+        resumeReading(connection);
+    } else if (events == EPOLLOUT) {
+        setSessionState(NULL);
+        return;
+    }
+
+    for (;;) {
+        RequestOutcome outcome = runHandler(loop, connection);
+        if (outcome == REQUEST_PAUSED) {
+            /* nothing is drained or cleaned up, the same request goes on once the queue is flushed */
+            if (outboundPending(client)) {
+                awaitWritable(loop, connection);
+                break;
+            }
+            continue;
+        }
+        if (outcome == REQUEST_INCOMPLETE) {
+            tcpStreamRewind(stream);
+            /* idle connections keep no buffer until the next bytes arrive */
+            tcpStreamRelease(stream);
+            gcCleanup();
+            if (outboundPending(client)) {
+                awaitWritable(loop, connection);
+            } else {
+                armConnectionTimer(loop, connection);
+            }
+            break;
+        }
+        gcCleanup();
+        if (outcome == REQUEST_CLOSE) {
+            if (outboundPending(client) && !client->closed) {
+                connection->closeWhenFlushed = 1;
+                awaitWritable(loop, connection);
+            } else {
+                closeReactorConnection(loop, connection);
+            }
+            break;
+        }
+        tcpStreamDrain(stream);
+        state->requestIndex++;
+        if (outboundPending(client)) {
+            awaitWritable(loop, connection);
+            break;
+        }
+    }
+    setSessionState(NULL);
+}
+
+/* Runs on the loop thread once it stopped, connections handed over too late are closed unregistered */
+static void closeLoopConnections(EventLoop *loop) {
+    if (!loop->listener.closed) {
+        closeSocket(&loop->listener);
+    }
+    while (loop->connections != NULL) {
+        setSessionState(loop->connections->state);
+        closeReactorConnection(loop, loop->connections);
+        setSessionState(NULL);
+    }
+    pthread_mutex_lock(&loop->incomingMutex);
+    ReactorConnection *connection = loop->incoming;
+    loop->incoming = NULL;
+    pthread_mutex_unlock(&loop->incomingMutex);
+    while (connection != NULL) {
+        ReactorConnection *next = connection->nextIncoming;
+        freeTcpStream(connection->stream);
+        destroySessionState(connection->state);
+        deallocate(connection);
+        connection = next;
+    }
+    gcCleanup();
+}
+
+static void *runEventLoop(void *arg) {
+    EventLoop *loop = arg;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    if (loop->reactor->pinLoops) {
+        pinCurrentThreadToCore(loop->index);
+    }
+    gcTrack();
+
+    while (!atomic_load(&loop->stopping)) {
+        int timeoutMs = timerWheelNextTimeout(&loop->wheel, getMonotonicTimeMs());
+        int ready = epoll_wait(loop->epollFd, events, REACTOR_MAX_EVENTS, timeoutMs);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("runEventLoop: epoll_wait");
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.ptr == loop) {
+                acceptPending(loop);
+                continue;
+            }
+            if (events[i].data.ptr == &loop->wakeFd) {
+                registerIncoming(loop);
+                continue;
+            }
+            serveConnection(loop, events[i].data.ptr, events[i].events);
+        }
+        timerWheelAdvance(&loop->wheel, getMonotonicTimeMs());
+    }
+    closeLoopConnections(loop);
+    return NULL;
+}
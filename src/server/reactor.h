@@ -0,0 +1,42 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_REACTOR_H
+#define HTTPSERVERC_REACTOR_H
+
+#include <app_state.h>
+#include <tcp_stream.h>
+
+typedef enum RequestOutcome {
+    REQUEST_CLOSE = 0,
+    REQUEST_KEEP_ALIVE = 1,
+    REQUEST_INCOMPLETE = 2, /* the socket ran out of data, retry the request on the next readiness */
+    REQUEST_PAUSED = 3, /* the response is unfinished, call the handler again once the outbound queue is flushed */
+} RequestOutcome;
+
+typedef RequestOutcome (*ConnectionRequestHandler)(SessionState *state, TcpStream *stream);
+
+typedef struct Reactor Reactor;
+
+/*
+    Starts loopCount event loop threads, each with its own edge-triggered epoll instance.
+    Every request is parsed from scratch on each readiness until it is complete,
+    so handler must be restartable for REQUEST_INCOMPLETE. What a handler allocated
+    before REQUEST_PAUSED is kept until it returns anything else.
+*/
+Reactor *newReactor(int loopCount, int pinLoops, ConnectionRequestHandler handler);
+/* Hands the connection to one of the loops. The socket is switched to non blocking. */
+int reactorAddConnection(Reactor *reactor, SessionState *state);
+/*
+    Gives every loop its own SO_REUSEPORT listener so the loops accept by themselves
+    and no connection is handed between threads. Returns -1 if any listener failed.
+*/
+int reactorListen(Reactor *reactor, const port_t port, ListenOptions options);
+/*
+    Closes the listeners and every connection and joins the loops, then frees the reactor.
+    Must not be called from a loop thread.
+*/
+void reactorStop(Reactor *reactor);
+
+#endif //HTTPSERVERC_REACTOR_H
@@ -0,0 +1,71 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "spsc_ring.h"
+
+#include <alloc.h>
+#include <string.h>
+
+void initSpscRing(SpscRing *ring, size_t capacity) {
+    size_t actualCapacity = 2;
+    while (actualCapacity < capacity) {
+        actualCapacity *= 2;
+    }
+    ring->buffer = allocate(actualCapacity);
+    ring->mask = actualCapacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+}
+
+void destroySpscRing(SpscRing *ring) {
+    deallocate(ring->buffer);
+    ring->buffer = NULL;
+}
+
+int spscRingPush(SpscRing *ring, const struct iovec *parts, int count) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t size = 0;
+    for (int i = 0; i < count; i++) {
+        size += parts[i].iov_len;
+    }
+    if (size > ring->mask + 1 - (head - tail)) {
+        return 0;
+    }
+    size_t position = head;
+    for (int i = 0; i < count; i++) {
+        const char *data = parts[i].iov_base;
+        size_t remaining = parts[i].iov_len;
+        while (remaining > 0) {
+            size_t offset = position & ring->mask;
+            size_t span = ring->mask + 1 - offset;
+            size_t copied = remaining < span ? remaining : span;
+            memcpy(ring->buffer + offset, data, copied);
+            data += copied;
+            remaining -= copied;
+            position += copied;
+        }
+    }
+    atomic_store_explicit(&ring->head, head + size, memory_order_release);
+    return 1;
+}
+
+size_t spscRingPeek(SpscRing *ring, struct iovec spans[2]) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t size = head - tail;
+    size_t offset = tail & ring->mask;
+    size_t first = ring->mask + 1 - offset;
+    if (first > size) {
+        first = size;
+    }
+    spans[0] = (struct iovec) {.iov_base = ring->buffer + offset, .iov_len = first};
+    spans[1] = (struct iovec) {.iov_base = ring->buffer, .iov_len = size - first};
+    return size;
+}
+
+void spscRingConsume(SpscRing *ring, size_t size) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + size, memory_order_release);
+}
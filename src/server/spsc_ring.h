@@ -0,0 +1,35 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_SPSC_RING_H
+#define HTTPSERVERC_SPSC_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include "mpmc_queue.h"
+
+/*
+    Lock free byte ring with one producer and one consumer thread.
+    Records are pushed whole or not at all, framing them is up to the caller.
+    Capacity is rounded up to a power of two.
+*/
+typedef struct SpscRing {
+    char *buffer;
+    size_t mask;
+    alignas(MPMC_CACHE_LINE) atomic_size_t head; /* advanced by the producer */
+    alignas(MPMC_CACHE_LINE) atomic_size_t tail; /* advanced by the consumer */
+} SpscRing;
+
+void initSpscRing(SpscRing *ring, size_t capacity);
+void destroySpscRing(SpscRing *ring);
+/* Copies the parts back to back, returns 0 without writing anything if they do not fit */
+int spscRingPush(SpscRing *ring, const struct iovec *parts, int count);
+/* Points spans at the readable bytes, the second one is used when they wrap. Returns their total */
+size_t spscRingPeek(SpscRing *ring, struct iovec spans[2]);
+/* Frees size bytes of what spscRingPeek returned */
+void spscRingConsume(SpscRing *ring, size_t size);
+
+#endif //HTTPSERVERC_SPSC_RING_H
@@ -0,0 +1,85 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "thread_rings.h"
+
+#include <alloc.h>
+#include <string.h>
+
+/* Runs in the exiting thread, which may still log from later destructors into a new ring */
+static void abandonThreadRing(void *arg) {
+    ThreadRing *ring = arg;
+    *ring->owner = NULL;
+    atomic_store_explicit(&ring->abandoned, 1, memory_order_release);
+}
+
+ThreadRing *addThreadRing(ThreadRingSet *set, ThreadRing **slot) {
+    ThreadRing *ring = allocate(sizeof(ThreadRing));
+    initSpscRing(&ring->ring, set->capacity);
+    atomic_init(&ring->abandoned, 0);
+    atomic_init(&ring->dropped, 0);
+    ring->owner = slot;
+
+    pthread_mutex_lock(&set->mutex);
+    if (!set->keyCreated) {
+        pthread_key_create(&set->key, abandonThreadRing);
+        set->keyCreated = 1;
+    }
+    ring->next = set->rings;
+    set->rings = ring;
+    pthread_mutex_unlock(&set->mutex);
+
+    pthread_setspecific(set->key, ring);
+    *slot = ring;
+    return ring;
+}
+
+int threadRingPush(ThreadRing *ring, const struct iovec *parts, int count) {
+    if (spscRingPush(&ring->ring, parts, count)) {
+        return 1;
+    }
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    return 0;
+}
+
+size_t drainThreadRings(ThreadRingSet *set, size_t (*drain)(SpscRing *ring, void *arg), void *arg) {
+    size_t dropped = 0;
+    pthread_mutex_lock(&set->mutex);
+    ThreadRing **link = &set->rings;
+    while (*link != NULL) {
+        ThreadRing *ring = *link;
+        /* read before draining, the owner may have pushed right before exiting */
+        int abandoned = atomic_load_explicit(&ring->abandoned, memory_order_acquire);
+        struct iovec spans[2];
+        while (spscRingPeek(&ring->ring, spans) > 0) {
+            size_t consumed = drain(&ring->ring, arg);
+            if (consumed == 0) {
+                break;
+            }
+            spscRingConsume(&ring->ring, consumed);
+        }
+        dropped += atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+        if (abandoned) {
+            *link = ring->next;
+            destroySpscRing(&ring->ring);
+            deallocate(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+    pthread_mutex_unlock(&set->mutex);
+    return dropped;
+}
+
+const void *peekSizedRecord(SpscRing *ring, void *scratch, uint32_t *size) {
+    struct iovec spans[2];
+    spscRingPeek(ring, spans);
+    memcpy(size, spans[0].iov_base, sizeof(*size));
+    if (spans[0].iov_len >= *size) {
+        return spans[0].iov_base;
+    }
+    memcpy(scratch, spans[0].iov_base, spans[0].iov_len);
+    memcpy((char*) scratch + spans[0].iov_len, spans[1].iov_base, *size - spans[0].iov_len);
+    return scratch;
+}
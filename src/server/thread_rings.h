@@ -0,0 +1,58 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_THREAD_RINGS_H
+#define HTTPSERVERC_THREAD_RINGS_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "spsc_ring.h"
+
+typedef struct ThreadRing {
+    SpscRing ring;
+    atomic_int abandoned; /* the owning thread exited */
+    atomic_size_t dropped; /* pushes that did not fit */
+    struct ThreadRing **owner; /* the owning thread's _Thread_local slot */
+    struct ThreadRing *next;
+} ThreadRing;
+
+/*
+    One SpscRing per producing thread, created on its first push. The thread
+    produces without locks, consumers take the set's mutex and drain every ring,
+    rings of exited threads are freed once they are empty.
+*/
+typedef struct ThreadRingSet {
+    pthread_mutex_t mutex;
+    ThreadRing *rings;
+    size_t capacity;
+    int keyCreated;
+    pthread_key_t key;
+} ThreadRingSet;
+
+#define THREAD_RING_SET_INITIALIZER(ringCapacity) \
+    {.mutex = PTHREAD_MUTEX_INITIALIZER, .rings = NULL, .capacity = (ringCapacity), .keyCreated = 0}
+
+ThreadRing *addThreadRing(ThreadRingSet *set, ThreadRing **slot);
+
+/* slot is a _Thread_local of the caller, it is cleared when the thread exits */
+static inline ThreadRing *threadRingOf(ThreadRingSet *set, ThreadRing **slot) {
+    return *slot != NULL ? *slot : addThreadRing(set, slot);
+}
+
+/* Pushes the parts as one record, counts it as dropped when it does not fit */
+int threadRingPush(ThreadRing *ring, const struct iovec *parts, int count);
+/*
+    Calls drain with every ring holding bytes, it returns how many it consumed.
+    Returns the records dropped since the previous call.
+*/
+size_t drainThreadRings(ThreadRingSet *set, size_t (*drain)(SpscRing *ring, void *arg), void *arg);
+
+/*
+    For drain callbacks of rings whose records start with their uint32_t size and are multiples
+    of 8 bytes, so the size never wraps. Returns the next record, copied to scratch when it wraps.
+*/
+const void *peekSizedRecord(SpscRing *ring, void *scratch, uint32_t *size);
+
+#endif //HTTPSERVERC_THREAD_RINGS_H
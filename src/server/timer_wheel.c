@@ -0,0 +1,157 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "timer_wheel.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level) ((level) * TIMER_WHEEL_SLOT_BITS)
+#define WHEEL_RANGE (1ULL << LEVEL_SHIFT(TIMER_WHEEL_LEVELS))
+
+void initTimerWheel(TimerWheel *wheel, long long nowMs, unsigned int tickMs) {
+    assert(tickMs > 0);
+    memset(wheel->slots, 0, sizeof(wheel->slots));
+    wheel->currentTick = 0;
+    wheel->originMs = nowMs;
+    wheel->tickMs = tickMs;
+    wheel->pending = 0;
+}
+
+void initTimer(Timer *timer, TimerCallback callback, void *arg) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->arg = arg;
+}
+
+int timerIsPending(const Timer *timer) {
+    return timer->pprev != NULL;
+}
+
+static void linkTimer(Timer **slot, Timer *timer) {
+    timer->next = *slot;
+    if (*slot != NULL) {
+        (*slot)->pprev = &timer->next;
+    }
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+static void unlinkTimer(Timer *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/*
+    A timer goes to the lowest level whose range covers it,
+    the slot is picked from the bits of the expiry tick at that level.
+    Timers past the last level wait in its farthest slot and are placed again when it cascades.
+*/
+static void placeTimer(TimerWheel *wheel, Timer *timer) {
+    unsigned long long expires = timer->expires;
+    if (expires < wheel->currentTick) {
+        expires = wheel->currentTick;
+    }
+    unsigned long long delta = expires - wheel->currentTick;
+    if (delta >= WHEEL_RANGE) {
+        expires = wheel->currentTick + WHEEL_RANGE - 1;
+        delta = WHEEL_RANGE - 1;
+    }
+    int level = 0;
+    while (delta >= 1ULL << LEVEL_SHIFT(level + 1)) {
+        level++;
+    }
+    linkTimer(&wheel->slots[level][(expires >> LEVEL_SHIFT(level)) & SLOT_MASK], timer);
+}
+
+void timerWheelSchedule(TimerWheel *wheel, Timer *timer, long long deadlineMs) {
+    if (timerIsPending(timer)) {
+        unlinkTimer(timer);
+    } else {
+        wheel->pending++;
+    }
+    long long offsetMs = deadlineMs - wheel->originMs;
+    /* rounded up, a timer never fires before its deadline */
+    timer->expires = offsetMs <= 0 ? 0 : (offsetMs + wheel->tickMs - 1) / wheel->tickMs;
+    placeTimer(wheel, timer);
+}
+
+void timerWheelCancel(TimerWheel *wheel, Timer *timer) {
+    if (!timerIsPending(timer)) {
+        return;
+    }
+    unlinkTimer(timer);
+    wheel->pending--;
+}
+
+/* Moves every timer of the slot one level down */
+static int cascade(TimerWheel *wheel, int level) {
+    int index = (int) ((wheel->currentTick >> LEVEL_SHIFT(level)) & SLOT_MASK);
+    Timer *timer = wheel->slots[level][index];
+    wheel->slots[level][index] = NULL;
+    while (timer != NULL) {
+        Timer *next = timer->next;
+        timer->next = NULL;
+        timer->pprev = NULL;
+        placeTimer(wheel, timer);
+        timer = next;
+    }
+    return index;
+}
+
+void timerWheelAdvance(TimerWheel *wheel, long long nowMs) {
+    if (nowMs < wheel->originMs) {
+        return;
+    }
+    unsigned long long targetTick = (unsigned long long) (nowMs - wheel->originMs) / wheel->tickMs;
+
+    while (wheel->currentTick <= targetTick) {
+        int index = (int) (wheel->currentTick & SLOT_MASK);
+        if (index == 0) {
+            for (int level = 1; level < TIMER_WHEEL_LEVELS && cascade(wheel, level) == 0; level++) {
+            }
+        }
+
+        /* detached first, timers scheduled by the callbacks land in later ticks */
+        Timer *expired = wheel->slots[0][index];
+        wheel->slots[0][index] = NULL;
+        if (expired != NULL) {
+            expired->pprev = &expired;
+        }
+        wheel->currentTick++;
+
+        while (expired != NULL) {
+            Timer *timer = expired;
+            unlinkTimer(timer);
+            wheel->pending--;
+            timer->callback(timer);
+        }
+    }
+}
+
+int timerWheelNextTimeout(const TimerWheel *wheel, long long nowMs) {
+    if (wheel->pending == 0) {
+        return -1;
+    }
+    /* the next tick that has to be processed, either a level 0 timer or a cascade */
+    unsigned long long tick = wheel->currentTick;
+    int index = (int) (tick & SLOT_MASK);
+    int ticks = 0;
+    while (ticks < TIMER_WHEEL_SLOTS - index && wheel->slots[0][index + ticks] == NULL) {
+        ticks++;
+    }
+    long long dueMs = wheel->originMs + (long long) (tick + ticks) * wheel->tickMs;
+    long long waitMs = dueMs - nowMs;
+    if (waitMs <= 0) {
+        return 0;
+    }
+    return waitMs > 0x7fffffff ? 0x7fffffff : (int) waitMs;
+}
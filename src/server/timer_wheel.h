@@ -0,0 +1,50 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_TIMER_WHEEL_H
+#define HTTPSERVERC_TIMER_WHEEL_H
+
+#include <stddef.h>
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+typedef struct Timer Timer;
+typedef void (*TimerCallback)(Timer *timer);
+
+/* Embedded in the owner, arg is passed back untouched */
+struct Timer {
+    Timer *next;
+    Timer **pprev;
+    unsigned long long expires;
+    TimerCallback callback;
+    void *arg;
+};
+
+/*
+    Hierarchical timing wheel, 4 levels of 64 slots.
+    Not thread safe, every thread owns its wheel.
+    Schedule and cancel are O(1), timers fire at tick granularity, never early.
+*/
+typedef struct TimerWheel {
+    Timer *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    unsigned long long currentTick;
+    long long originMs;
+    unsigned int tickMs;
+    size_t pending;
+} TimerWheel;
+
+void initTimerWheel(TimerWheel *wheel, long long nowMs, unsigned int tickMs);
+void initTimer(Timer *timer, TimerCallback callback, void *arg);
+/* Reschedules the timer if it is already pending. */
+void timerWheelSchedule(TimerWheel *wheel, Timer *timer, long long deadlineMs);
+void timerWheelCancel(TimerWheel *wheel, Timer *timer);
+int timerIsPending(const Timer *timer);
+/* Fires every timer due by nowMs. Callbacks may schedule and cancel timers. */
+void timerWheelAdvance(TimerWheel *wheel, long long nowMs);
+/* Milliseconds until the next timer could fire, -1 without pending timers. */
+int timerWheelNextTimeout(const TimerWheel *wheel, long long nowMs);
+
+#endif //HTTPSERVERC_TIMER_WHEEL_H
@@ -0,0 +1,64 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "worker_pool.h"
+#include "mpmc_queue.h"
+
+#include <alloc.h>
+#include <errno.h>
+#include <logging.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+struct WorkerPool {
+    MpmcQueue queue;
+    sem_t available;
+    ConnectionHandler handler;
+    int workerCount;
+};
+
+static void *runWorker(void *arg);
+
+WorkerPool *newWorkerPool(int workerCount, unsigned int queueCapacity, ConnectionHandler handler) {
+    WorkerPool *pool = allocate(sizeof(WorkerPool));
+    initMpmcQueue(&pool->queue, queueCapacity);
+    sem_init(&pool->available, 0, 0);
+    pool->handler = handler;
+    pool->workerCount = workerCount;
+
+    for (int i = 0; i < workerCount; i++) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, runWorker, pool);
+        pthread_detach(thread);
+    }
+    info("Started %d workers with a queue of %zu connections", workerCount, pool->queue.mask + 1);
+    return pool;
+}
+
+int workerPoolSubmit(WorkerPool *pool, SessionState *state) {
+    if (!mpmcQueuePush(&pool->queue, state)) {
+        return -1;
+    }
+    sem_post(&pool->available);
+    return 0;
+}
+
+static void *runWorker(void *arg) {
+    WorkerPool *pool = arg;
+    gcTrack();
+    for (;;) {
+        if (sem_wait(&pool->available) == -1) {
+            if (errno != EINTR) {
+                perror("runWorker: sem_wait");
+            }
+            continue;
+        }
+        void *state;
+        /* the post always follows a finished push, the pop can only lose a race briefly */
+        while (!mpmcQueuePop(&pool->queue, &state)) {
+        }
+        pool->handler(state);
+    }
+    return NULL;
+}
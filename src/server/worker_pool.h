@@ -0,0 +1,22 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#ifndef HTTPSERVERC_WORKER_POOL_H
+#define HTTPSERVERC_WORKER_POOL_H
+
+#include <app_state.h>
+
+typedef void (*ConnectionHandler)(SessionState *state);
+
+typedef struct WorkerPool WorkerPool;
+
+/*
+    Pre spawns workerCount threads fed by a bounded queue of accepted connections.
+    Every worker tracks its own gc allocations, handler must clean them up per connection.
+*/
+WorkerPool *newWorkerPool(int workerCount, unsigned int queueCapacity, ConnectionHandler handler);
+/* Returns -1 without taking ownership of state if the queue is full. */
+int workerPoolSubmit(WorkerPool *pool, SessionState *state);
+
+#endif //HTTPSERVERC_WORKER_POOL_H
@@ -9,25 +9,88 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include "../includes/alloc.h"
 #include <string.h>
 
+#include "helpers/scan_helper.h"
+#include "server/mpmc_queue.h"
+
 
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
 #define POLL_TIMEOUT (60 * 1000)
 
+static MpmcQueue bufferPool;
+static pthread_once_t bufferPoolOnce = PTHREAD_ONCE_INIT;
+
+static void initBufferPool()
+{
+    initMpmcQueue(&bufferPool, TCP_STREAM_BUFFER_POOL_SIZE);
+}
+
+static char *acquireBuffer()
+{
+    pthread_once(&bufferPoolOnce, initBufferPool);
+    void *buffer;
+    if (mpmcQueuePop(&bufferPool, &buffer)) {
+        return buffer;
+    }
+    return allocate(TCP_STREAM_BUFFER_SIZE);
+}
+
+/* Only default sized buffers are pooled, grown ones go back to the allocator */
+static void releaseBuffer(char *buffer, size_t capacity)
+{
+    if (buffer == NULL) {
+        return;
+    }
+    pthread_once(&bufferPoolOnce, initBufferPool);
+    if (capacity != TCP_STREAM_BUFFER_SIZE || !mpmcQueuePush(&bufferPool, buffer)) {
+        deallocate(buffer);
+    }
+}
+
+struct RetiredBuffer {
+    char *buffer;
+    size_t capacity;
+    RetiredBuffer *next;
+};
+
+static void retireBuffer(TcpStream *stream)
+{
+    RetiredBuffer *retired = allocate(sizeof(RetiredBuffer));
+    *retired = (RetiredBuffer) {
+        .buffer = stream->buffer,
+        .capacity = stream->capacity,
+        .next = stream->retired,
+    };
+    stream->retired = retired;
+}
+
+static void freeRetiredBuffers(TcpStream *stream)
+{
+    while (stream->retired != NULL) {
+        RetiredBuffer *next = stream->retired->next;
+        releaseBuffer(stream->retired->buffer, stream->retired->capacity);
+        deallocate(stream->retired);
+        stream->retired = next;
+    }
+}
+
 TcpStream *newTcpStream(TcpSocket *socket) {
-    char *buffer = allocate(TCP_STREAM_BUFFER_SIZE);
+    char *buffer = acquireBuffer();
     TcpStream *stream = allocate(sizeof(TcpStream));
     *stream = (TcpStream){
         .socket = socket,
         .error = 0,
+        .start = 0,
         .cursor = 0,
         .length = 0,
         .capacity = TCP_STREAM_BUFFER_SIZE,
-        .buffer = buffer
+        .buffer = buffer,
+        .retired = NULL,
     };
     return stream;
 }
@@ -35,12 +98,27 @@ TcpStream *newTcpStream(TcpSocket *socket) {
 void freeTcpStream(TcpStream *stream)
 {
     debug("Freeing tcp stream");
-    deallocate(stream->buffer);
+    freeRetiredBuffers(stream);
+    releaseBuffer(stream->buffer, stream->capacity);
     deallocate(stream);
 }
 
 #define MIN_FILL_SIZE 1024
 
+static int readError(ReadEnum result)
+{
+    switch (result) {
+        case READ_CLOSED:
+            return TCP_STREAM_CLOSED;
+        case READ_TIMEOUT:
+            return TCP_STREAM_TIMEOUT;
+        case READ_WOULD_BLOCK:
+            return TCP_STREAM_WOULD_BLOCK;
+        default:
+            return TCP_STREAM_ERROR;
+    }
+}
+
 void tcpStreamFill(TcpStream *stream, size_t length)
 {
     if (stream->socket->closed) {
@@ -50,6 +128,11 @@ void tcpStreamFill(TcpStream *stream, size_t length)
     {
         return;
     }
+    if (stream->buffer == NULL)
+    {
+        stream->buffer = acquireBuffer();
+        stream->capacity = TCP_STREAM_BUFFER_SIZE;
+    }
     size_t newCapacity = stream->capacity;
     while (newCapacity < length)
     {
@@ -57,7 +140,11 @@ void tcpStreamFill(TcpStream *stream, size_t length)
     }
     if (newCapacity > stream->capacity)
     {
-        stream->buffer = reallocate(stream->buffer, newCapacity);
+        /* not reallocated, slices of the current request still point into the old buffer */
+        char *grown = allocate(newCapacity);
+        memcpy(grown, stream->buffer, stream->length);
+        retireBuffer(stream);
+        stream->buffer = grown;
         stream->capacity = newCapacity;
     }
     while (stream->length < length)
@@ -73,25 +160,41 @@ void tcpStreamFill(TcpStream *stream, size_t length)
         const size_t maxReadSize = MAX(length - stream->length, MIN_FILL_SIZE);
         const size_t minReadSize = MIN(stream->capacity - stream->length, maxReadSize);
         ReadResult result = receive(stream->socket, stream->buffer + stream->length, minReadSize);
-
-        switch (result.result) {
-            case READ_OK:
-                break;
-            case READ_CLOSED:
-                stream->error = TCP_STREAM_CLOSED;
-                return;
-            case READ_TIMEOUT:
-                stream->error = TCP_STREAM_TIMEOUT;
-                return;
-            case READ_POLL_ERROR:
-            case READ_RECV_ERROR:
-                stream->error = TCP_STREAM_ERROR;
-                return;
+        if (result.result != READ_OK) {
+            stream->error = readError(result.result);
+            return;
         }
         stream->length += result.received;
     }
 }
 
+ssize_t tcpStreamReadInto(TcpStream *stream, void *buffer, size_t size)
+{
+    const size_t buffered = stream->length - stream->cursor;
+    if (buffered > 0) {
+        const size_t copied = MIN(buffered, size);
+        memcpy(buffer, stream->buffer + stream->cursor, copied);
+        stream->cursor += copied;
+        return (ssize_t) copied;
+    }
+    if (stream->socket->closed) {
+        return TCP_STREAM_CLOSED;
+    }
+    ReadResult result = receive(stream->socket, buffer, size);
+    if (result.result != READ_OK) {
+        return readError(result.result);
+    }
+    return (ssize_t) result.received;
+}
+
+void tcpStreamTruncate(TcpStream *stream, size_t position)
+{
+    if (stream->cursor == stream->length && position >= stream->start && position < stream->length) {
+        stream->cursor = position;
+        stream->length = position;
+    }
+}
+
 void *tcpStreamReadSlice(TcpStream *stream, size_t size)
 {
     tcpStreamFill(stream, stream->cursor + size);
@@ -104,67 +207,131 @@ void *tcpStreamReadSlice(TcpStream *stream, size_t size)
     return slice;
 }
 
+#define COMPACT_BELOW_ROOM 256
+
+/*
+    Pipelined requests are parsed in place, the unread bytes are only moved
+    when too little room is left after them for the next receive.
+*/
 void tcpStreamDrain(TcpStream *stream)
 {
-    if (stream->length > stream->cursor) {
-        memmove(stream->buffer, stream->buffer + stream->cursor, stream->length - stream->cursor);
+    freeRetiredBuffers(stream);
+    stream->start = stream->cursor;
+    stream->error = 0;
+    size_t pending = stream->length - stream->start;
+
+    if (pending == 0) {
+        stream->start = 0;
+        stream->cursor = 0;
+        stream->length = 0;
+        if (stream->capacity > TCP_STREAM_MAX_RETAINED_CAPACITY) {
+            tcpStreamRelease(stream);
+        }
+        return;
     }
-    stream->length -= stream->cursor;
+
+    if (stream->capacity > TCP_STREAM_MAX_RETAINED_CAPACITY && pending <= TCP_STREAM_BUFFER_SIZE) {
+        char *buffer = acquireBuffer();
+        memcpy(buffer, stream->buffer + stream->start, pending);
+        releaseBuffer(stream->buffer, stream->capacity);
+        stream->buffer = buffer;
+        stream->capacity = TCP_STREAM_BUFFER_SIZE;
+    } else if (stream->capacity - stream->length < COMPACT_BELOW_ROOM) {
+        memmove(stream->buffer, stream->buffer + stream->start, pending);
+    } else {
+        return;
+    }
+    stream->start = 0;
     stream->cursor = 0;
-    stream->error = 0;
+    stream->length = pending;
 }
 
-string tcpStreamReadUntilSpace(TcpStream *stream, size_t maxLength)
+void tcpStreamRelease(TcpStream *stream)
 {
-    const size_t start = stream->cursor;
-    size_t check = MIN(stream->length - stream->cursor, maxLength);
-    for (; stream->cursor <= start + check; stream->cursor++) {
-        if (stream->buffer[stream->cursor] == ' ') {
-            const string result = (string) {
-                .ptr = stream->buffer + start,
-                .length = stream->cursor - start,
-            };
-            stream->cursor++;
-            return result;
-        }
+    if (stream->length > stream->start) {
+        return;
     }
+    freeRetiredBuffers(stream);
+    releaseBuffer(stream->buffer, stream->capacity);
+    stream->buffer = NULL;
+    stream->capacity = 0;
+    stream->start = 0;
+    stream->length = 0;
+    stream->cursor = 0;
+}
+
+void tcpStreamRewind(TcpStream *stream)
+{
+    freeRetiredBuffers(stream);
+    stream->cursor = stream->start;
+    stream->error = 0;
+}
+
+size_t tcpStreamPending(const TcpStream *stream)
+{
+    return stream->length - stream->start;
+}
+
+/*
+    Moves the cursor to the first byte from set before limit, receiving more as needed.
+    Returns 0 with the cursor on the delimiter, or a negative error.
+*/
+static int tcpStreamScan(TcpStream *stream, size_t limit, const char *set, size_t setSize)
+{
     for (;;) {
-        if (stream->cursor > start + maxLength)
+        const size_t end = MIN(stream->length, limit);
+        if (stream->cursor < end) {
+            stream->cursor += scanForAny(stream->buffer + stream->cursor, end - stream->cursor, set, setSize);
+            if (stream->cursor < end) {
+                return 0;
+            }
+        }
+        if (stream->cursor >= limit)
         {
-            return (string){.ptr = NULL, .length = ENTITY_TOO_LARGE_ERROR};
+            return ENTITY_TOO_LARGE_ERROR;
         }
-        tcpStreamFill(stream, maxLength);
+        tcpStreamFill(stream, stream->length + 1);
         if (stream->error < 0) {
-            return (string){
-                .ptr = NULL, .length = stream->error
-            };
-        }
-        check = MIN(stream->length - stream->cursor, maxLength);
-        for (; stream->cursor < start + check; stream->cursor++) {
-            if (stream->buffer[stream->cursor] == ' ') {
-                const string result = (string) {
-                    .ptr = stream->buffer + start,
-                    .length = stream->cursor - start,
-                };
-                stream->cursor++;
-                return result;
-            }
+            return stream->error;
         }
     }
 }
 
+/* The delimiter may directly follow maxLength bytes */
+#define SCAN_LIMIT(start, maxLength) ((start) + (maxLength) + 1)
+
+string tcpStreamReadUntilSpace(TcpStream *stream, size_t maxLength)
+{
+    const size_t start = stream->cursor;
+    const int error = tcpStreamScan(stream, SCAN_LIMIT(start, maxLength), " ", 1);
+    if (error < 0) {
+        return (string){.ptr = NULL, .length = error};
+    }
+    stream->cursor++;
+    return (string){
+        .ptr = stream->buffer + start,
+        .length = (ssize_t) (stream->cursor - start - 1),
+    };
+}
+
 string tcpStreamReadUntilCRLF(TcpStream *stream, size_t maxLength, int ignoreLoneCRLF)
 {
-    size_t start = stream->cursor;
+    const size_t start = stream->cursor;
+    /* with lone characters allowed only a carriage return can start the delimiter */
+    const char *set = ignoreLoneCRLF ? "\r" : "\r\n";
 
     for (;;)
     {
+        const int error = tcpStreamScan(stream, SCAN_LIMIT(start, maxLength), set, strlen(set));
+        if (error < 0)
+        {
+            return (string){.ptr = NULL, .length = error};
+        }
         tcpStreamFill(stream, stream->cursor + 2);
         if (stream->error < 0)
         {
             return (string){.ptr = NULL, .length = stream->error};
         }
-
         if (stream->buffer[stream->cursor] == '\r' && stream->buffer[stream->cursor + 1] == '\n')
         {
             stream->cursor += 2;
@@ -173,29 +340,30 @@ string tcpStreamReadUntilCRLF(TcpStream *stream, size_t maxLength, int ignoreLon
                 .length = (ssize_t) (stream->cursor - start - 2),
             };
         }
-        if (!ignoreLoneCRLF && (stream->buffer[stream->cursor] == '\n' || stream->buffer[stream->cursor] == '\r')) {
+        if (!ignoreLoneCRLF) {
             return (string){.ptr = NULL, .length = BAD_REQUEST_ERROR};
         }
         stream->cursor++;
-        if (stream->cursor - start > maxLength)
-        {
-            return (string){.ptr = NULL, .length = ENTITY_TOO_LARGE_ERROR};
-        }
     }
 }
 
 string tcpStreamReadUntilString(TcpStream *stream, size_t maxLength, const char *subStr, size_t size)
 {
     assert(size > 0);
-    size_t start = stream->cursor;
+    const size_t start = stream->cursor;
     for (;;)
     {
+        const int error = tcpStreamScan(stream, SCAN_LIMIT(start, maxLength), subStr, 1);
+        if (error < 0)
+        {
+            return (string){.ptr = NULL, .length = error};
+        }
         tcpStreamFill(stream, stream->cursor + size);
         if (stream->error < 0)
         {
             return (string){.ptr = NULL, .length = stream->error};
         }
-        if (strncmp(stream->buffer + stream->cursor, subStr, size) == 0)
+        if (memcmp(stream->buffer + stream->cursor, subStr, size) == 0)
         {
             stream->cursor += size;
             return (string){
@@ -204,37 +372,21 @@ string tcpStreamReadUntilString(TcpStream *stream, size_t maxLength, const char
             };
         }
         stream->cursor++;
-        if (stream->cursor - start > maxLength)
-        {
-            return (string){.ptr = NULL, .length = ENTITY_TOO_LARGE_ERROR};
-        }
     }
 }
 
 string tcpStreamReadUntilAny(TcpStream *stream, size_t maxLength, const char *anyChar) {
     assert(anyChar != NULL);
 
-    size_t start = stream->cursor;
-
-    for (;;) {
-        tcpStreamFill(stream, stream->cursor + 1);
-        if (stream->error < 0)
-        {
-            return (string){.ptr = NULL, .length = stream->error};
-        }
-        for (const char *c = anyChar; *c != '\0'; c++) {
-            if (stream->buffer[stream->cursor] == *c) {
-                stream->cursor++;
-                return (string){
-                    .ptr = stream->buffer + start,
-                    .length = (ssize_t) (stream->cursor - start - 1),
-                };
-            }
-        }
-        stream->cursor++;
-        if (stream->cursor - start > maxLength)
-        {
-            return (string){.ptr = NULL, .length = ENTITY_TOO_LARGE_ERROR};
-        }
+    const size_t start = stream->cursor;
+    const int error = tcpStreamScan(stream, SCAN_LIMIT(start, maxLength), anyChar, strlen(anyChar));
+    if (error < 0)
+    {
+        return (string){.ptr = NULL, .length = error};
     }
-}
\ No newline at end of file
+    stream->cursor++;
+    return (string){
+        .ptr = stream->buffer + start,
+        .length = (ssize_t) (stream->cursor - start - 1),
+    };
+}
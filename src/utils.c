@@ -10,6 +10,7 @@
 #include <time.h>
 
 #include "logging.h"
+#include "helpers/clock_helper.h"
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 
@@ -130,28 +131,32 @@ unsigned int hash(void *_data, int len)
     return hash;
 }
 
+/* Formats the cached second, see clock_helper */
 size_t getCurrentFormattedTime(char *buf, size_t size) {
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-
-    // convert to local time
-    struct tm tm_info;
-    gmtime_r(&ts.tv_sec, &tm_info);
+    return getLogTime(buf, size);
+}
 
-    // format up to seconds
-    size_t formattedSize = strftime(buf, size, "%Y-%m-%d %H:%M:%S", &tm_info);
-    // append milliseconds
-    formattedSize += snprintf(buf + formattedSize, size - formattedSize, ".%03ld", ts.tv_nsec / 1000000);
+/* Not affected by wall clock changes, for deadlines and intervals */
+long long getMonotonicTimeMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-    return formattedSize;
+long long getMonotonicTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
 
+/* Null terminated copy in the arena, slices of the request become owned strings */
 string copyString(string str) {
-    if (str.length <= 0) {
+    if (str.ptr == NULL || str.length < 0) {
         return str;
     }
     char *ptr = gcArenaAllocate(str.length + 1, sizeof(char));
-    snprintf(ptr, str.length + 1, "%.*s", (int) str.length, str.ptr);
+    memcpy(ptr, str.ptr, str.length);
+    ptr[str.length] = '\0';
     return (string) {
         .ptr = ptr,
         .length = str.length,
@@ -164,7 +169,8 @@ string copyStringFromSlice(const char *ptr, ssize_t len) {
         return (string) {.ptr = NULL, .length = len};
     }
     char *copyPtr = gcArenaAllocate(len + 1, sizeof(char));
-    snprintf(copyPtr, len + 1, "%.*s", (int) len, ptr);
+    memcpy(copyPtr, ptr, len);
+    copyPtr[len] = '\0';
     return (string) {.ptr = copyPtr, .length = len};
 }
 
@@ -179,9 +185,48 @@ ssize_t stringCompare(string *str1, string *str2) {
     return str1->length - str2->length;
 }
 
+int stringEquals(const string *str, const char *cstring) {
+    size_t length = strlen(cstring);
+    return str->length >= 0 && (size_t) str->length == length && (length == 0 || memcmp(str->ptr, cstring, length) == 0);
+}
+
+/* Two digits per division, written backwards into a scratch buffer */
+size_t formatUnsigned(unsigned long long value, char *out) {
+    static const char digitPairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+    char scratch[UNSIGNED_DIGITS_MAX];
+    char *end = scratch + sizeof(scratch);
+    char *cursor = end;
+    while (value >= 100) {
+        unsigned int pair = (unsigned int) (value % 100) * 2;
+        value /= 100;
+        *--cursor = digitPairs[pair + 1];
+        *--cursor = digitPairs[pair];
+    }
+    if (value >= 10) {
+        unsigned int pair = (unsigned int) value * 2;
+        *--cursor = digitPairs[pair + 1];
+        *--cursor = digitPairs[pair];
+    } else {
+        *--cursor = (char) ('0' + value);
+    }
+    size_t length = end - cursor;
+    memcpy(out, cursor, length);
+    return length;
+}
+
 char toLower(char c) {
     if (c >= 'A' && c <= 'Z') {
-        return c + ('A' - 'a');
+        return c + ('a' - 'A');
     }
     return c;
 }
@@ -190,7 +235,7 @@ ssize_t stringCompareIgnoreCase(string *str1, string *str2) {
     if (str1 == NULL || str2 == NULL) {
         return 0;
     }
-    TRACE("stringCompareIgnoreCase %s %s", str1->ptr, str2->ptr);
+    TRACE("stringCompareIgnoreCase %.*s %.*s", (int) str1->length, str1->ptr, (int) str2->length, str2->ptr);
     ssize_t len = MIN(str1->length, str2->length);
     for (int i = 0; i < len; i++) {
         TRACE("stringCompareIgnoreCase i=%d", i);
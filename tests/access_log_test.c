@@ -0,0 +1,126 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <access_log.h>
+#include <alloc.h>
+#include <unistd.h>
+#include <utils.h>
+
+#define ACCESS_LOG_PATH "access_log_test.bin"
+
+static unsigned char logged[16 * 1024];
+
+static size_t readLog() {
+    flushAccessLog();
+    FILE *file = fopen(ACCESS_LOG_PATH, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    size_t got = fread(logged, 1, sizeof(logged), file);
+    fclose(file);
+    return got;
+}
+
+static HttpReq requestFor(SessionState *state, HttpMethod method, const char *path) {
+    HttpReq req = newRequest();
+    req.method = method;
+    req.appState = state;
+    parsePath(&req.path, path, strlen(path));
+    return req;
+}
+
+static int decodesTo(size_t *offset, size_t length, AccessRecord *record, AccessRecordType type) {
+    long size = decodeAccessRecord(logged + *offset, length - *offset, record);
+    if (size <= 0) {
+        return 0;
+    }
+    *offset += (size_t) size;
+    return record->header.type == type;
+}
+
+/* A route is defined once per file, before its first request */
+int test1_records_round_trip() {
+    int testResult = 1;
+    unlink(ACCESS_LOG_PATH);
+    EXPECT(setAccessLogFile(ACCESS_LOG_PATH) == 0);
+    SessionState state = {.clientSocket = {.ip = "10.0.0.7"}, .connectionIndex = 5, .requestIndex = 2};
+    state.requestStartNs = getMonotonicTimeNs() - 1500000;
+
+    HttpReq req = requestFor(&state, POST, "/users/42?x=1");
+    logAccess(&req, "/users/<int>", 201, 300, 1000000);
+    state.requestIndex = 3;
+    req = requestFor(&state, GET, "/missing");
+    logAccess(&req, NULL, 404, 0, 120);
+    state.requestIndex = 4;
+    req = requestFor(&state, DELETE, "/users/7");
+    logAccess(&req, "/users/<int>", 204, 0, 80);
+
+    size_t length = readLog();
+    EXPECT(length > 8 && memcmp(logged, ACCESS_LOG_MAGIC, 8) == 0);
+    size_t offset = 8;
+    AccessRecord record;
+    EXPECT(decodesTo(&offset, length, &record, ACCESS_RECORD_ROUTE));
+    EXPECT(record.routeId == 1 && stringEquals(&record.path, "/users/<int>"));
+
+    EXPECT(decodesTo(&offset, length, &record, ACCESS_RECORD_REQUEST));
+    EXPECT(record.routeId == 1 && record.header.method == POST && record.header.status == 201);
+    EXPECT(record.connectionIndex == 5 && record.requestIndex == 2);
+    EXPECT(record.durationUs >= 1500 && record.header.timeNs > 0);
+    EXPECT(record.requestBytes == 300 && record.responseBytes == 1000000);
+    EXPECT(stringEquals(&record.ip, "10.0.0.7") && stringEquals(&record.path, "/users/42?x=1"));
+
+    EXPECT(decodesTo(&offset, length, &record, ACCESS_RECORD_REQUEST));
+    EXPECT(record.routeId == 0 && record.header.status == 404 && stringEquals(&record.path, "/missing"));
+    EXPECT(decodesTo(&offset, length, &record, ACCESS_RECORD_REQUEST));
+    EXPECT(record.routeId == 1 && record.requestIndex == 4 && record.header.method == DELETE);
+    EXPECT(offset == length);
+    return testResult;
+}
+
+int test2_reopened_file_and_bad_input() {
+    int testResult = 1;
+    size_t before = readLog();
+    EXPECT(setAccessLogFile(ACCESS_LOG_PATH) == 0);
+    SessionState state = {.clientSocket = {.ip = "::1"}, .connectionIndex = 6, .requestIndex = 1};
+    char longPath[ACCESS_LOG_PATH_MAX + 100];
+    memset(longPath, 'a', sizeof(longPath) - 1);
+    longPath[0] = '/';
+    longPath[sizeof(longPath) - 1] = '\0';
+    HttpReq req = requestFor(&state, GET, longPath);
+    logAccess(&req, "/users/<int>", 200, 0, 10);
+    EXPECT(setAccessLogFile(NULL) == 0);
+    logAccess(&req, "/users/<int>", 200, 0, 10);
+
+    /* appended without a second magic, the route is defined again */
+    size_t length = readLog();
+    size_t offset = before;
+    AccessRecord record;
+    EXPECT(decodesTo(&offset, length, &record, ACCESS_RECORD_ROUTE) && record.routeId == 1);
+    EXPECT(decodesTo(&offset, length, &record, ACCESS_RECORD_REQUEST));
+    EXPECT(record.path.length == ACCESS_LOG_PATH_MAX && record.routeId == 1);
+    EXPECT(offset == length);
+
+    EXPECT(decodeAccessRecord(logged + before, 10, &record) == 0);
+    AccessRecordHeader header = {.type = ACCESS_RECORD_REQUEST, .length = 3};
+    unsigned char broken[sizeof(header) + 3] = {0};
+    memcpy(broken, &header, sizeof(header));
+    memset(broken + sizeof(header), 0xff, 3);
+    EXPECT(decodeAccessRecord(broken, sizeof(broken), &record) == -1);
+    unlink(ACCESS_LOG_PATH);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    gcInit();
+    gcTrack();
+
+    UNIT_TEST(test1_records_round_trip)
+    UNIT_TEST(test2_reopened_file_and_bad_input)
+
+    TEST_RESULTS
+    return failed;
+}
@@ -389,6 +389,84 @@ int test31_arena_fill_many_chunks_and_use() {
     return testResult;
 }
 
+void* untrackedThreadRoutine(void*) {
+    long long testResult = 1;
+    void* p = gcArenaAllocate(MEDIUM_SIZE, 8);
+    EXPECT(p != NULL);
+    memset(p, 0xff, MEDIUM_SIZE);
+    deallocate(p);
+    return (void*) testResult;
+}
+
+int test32_untracked_threads_use_the_heap() {
+    long long testResult;
+
+    gcInit(); gcTrack();
+    void* tracked = gcArenaAllocate(SMALL_SIZE, 8);
+    pthread_t t;
+    pthread_create(&t, NULL, untrackedThreadRoutine, NULL);
+    pthread_join(t, (void**) &testResult);
+    EXPECT(tracked != NULL);
+    gcDestroy();
+
+    /* the destroyed arena is not reused */
+    void* p = gcArenaAllocate(SMALL_SIZE, 8);
+    EXPECT(p != NULL);
+    deallocate(p);
+    return testResult;
+}
+
+static int filledWith(const char *p, char value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (p[i] != value) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void* suspendedContextRoutine(void* arg) {
+    (void) arg;
+    long long testResult = 1;
+    gcTrack();
+    char *arenaBytes = gcArenaAllocate(SMALL_SIZE, 8);
+    char *heapBytes = gcAllocate(SMALL_SIZE);
+    memset(arenaBytes, 'a', SMALL_SIZE);
+    memset(heapBytes, 'h', SMALL_SIZE);
+
+    /* the thread cleans up what it allocated afterwards, the suspended bytes survive */
+    GcContext *context = gcSuspend();
+    memset(gcArenaAllocate(SMALL_SIZE, 8), 'x', SMALL_SIZE);
+    gcCleanup();
+    EXPECT(filledWith(arenaBytes, 'a', SMALL_SIZE));
+    EXPECT(filledWith(heapBytes, 'h', SMALL_SIZE));
+
+    /* allocations made while the context is swapped in belong to it */
+    gcSwapContext(context);
+    char *resumedBytes = gcArenaAllocate(MEDIUM_SIZE, 8);
+    memset(resumedBytes, 'r', MEDIUM_SIZE);
+    gcSwapContext(context);
+    memset(gcArenaAllocate(MEDIUM_SIZE, 8), 'y', MEDIUM_SIZE);
+    gcCleanup();
+    EXPECT(filledWith(arenaBytes, 'a', SMALL_SIZE));
+    EXPECT(filledWith(resumedBytes, 'r', MEDIUM_SIZE));
+
+    gcFreeContext(context);
+    EXPECT(gcArenaAllocate(SMALL_SIZE, 8) != NULL);
+    return (void*) testResult;
+}
+
+int test33_suspended_context_outlives_cleanup() {
+    long long testResult;
+
+    gcInit();
+    pthread_t t;
+    pthread_create(&t, NULL, suspendedContextRoutine, NULL);
+    pthread_join(t, (void**) &testResult);
+    gcDestroy();
+    return testResult;
+}
+
 // =============== MAIN RUNNER ===============
 int main() {
     INIT_UNIT_TESTS
@@ -424,6 +502,8 @@ int main() {
     UNIT_TEST(test29_gc_destroy_no_track)
     UNIT_TEST(test30_allocation_pattern_mix)
     UNIT_TEST(test31_arena_fill_many_chunks_and_use)
+    UNIT_TEST(test32_untracked_threads_use_the_heap)
+    UNIT_TEST(test33_suspended_context_outlives_cleanup)
 
     TEST_RESULTS
     return failed;
@@ -0,0 +1,248 @@
+//
+// Created by Rescyy on 10/18/2026.
+//
+
+#include "test.h"
+
+#include <alloc.h>
+#include <app.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define PORT 18433
+#define LOOPS 2
+#define REQUEST "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"
+
+#define PRODUCED_SIZE ((size_t) 64 << 20)
+#define PRODUCED_BLOCK (64 * 1024)
+
+static pthread_t app;
+static atomic_size_t produced;
+static atomic_int producerCalls;
+
+static HttpResp helloH(HttpReq) {
+    HttpRespBuilder builder = newRespBuilder();
+    respBuilderSetStatus(&builder, NO_CONTENT);
+    return respBuild(&builder);
+}
+
+typedef struct Production {
+    size_t produced;
+} Production;
+
+/* Yields whenever the client falls behind, its progress lives in the request arena */
+static int produceBlocks(HttpRespWriter *writer, void *state) {
+    static char block[PRODUCED_BLOCK];
+    Production *production = state;
+    atomic_fetch_add(&producerCalls, 1);
+    while (production->produced < PRODUCED_SIZE) {
+        int written = respWrite(writer, block, sizeof(block));
+        if (written < 0) {
+            return written;
+        }
+        production->produced += sizeof(block);
+        atomic_store(&produced, production->produced);
+        if (written == RESP_PRODUCER_MORE) {
+            return RESP_PRODUCER_MORE;
+        }
+    }
+    return 0;
+}
+
+static HttpResp streamH(HttpReq) {
+    Production *production = gcArenaAllocate(sizeof(Production), alignof(Production));
+    production->produced = 0;
+    HttpRespBuilder builder = newRespBuilder();
+    respBuilderSetStatus(&builder, OK);
+    respBuilderSetProducer(&builder, produceBlocks, production);
+    return respBuild(&builder);
+}
+
+static void *runApp(void *) {
+    char port[6];
+    snprintf(port, sizeof(port), "%d", PORT);
+    startApp(port);
+    return NULL;
+}
+
+static int connectClientWithBuffer(int receiveBuffer) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (receiveBuffer > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    }
+    struct timeval timeout = {.tv_sec = 2, .tv_usec = 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int connectClient() {
+    return connectClientWithBuffer(0);
+}
+
+/* Listening sockets on PORT, state 0A in /proc/net/tcp */
+static int countListeners() {
+    FILE *file = fopen("/proc/net/tcp", "r");
+    if (file == NULL) {
+        return -1;
+    }
+    char line[256];
+    char local[16];
+    snprintf(local, sizeof(local), ":%04X ", PORT);
+    int count = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (strstr(line, local) != NULL && strstr(line, " 0A ") != NULL) {
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+static int answersHello(int fd) {
+    char buffer[256];
+    if (write(fd, REQUEST, strlen(REQUEST)) != (ssize_t) strlen(REQUEST)) {
+        return 0;
+    }
+    ssize_t got = read(fd, buffer, sizeof(buffer) - 1);
+    if (got <= 0) {
+        return 0;
+    }
+    buffer[got] = '\0';
+    return strncmp(buffer, "HTTP/1.1 204", 12) == 0;
+}
+
+/* Runs before the app thread starts, the child registers the endpoint in its own copy of the app */
+int test1_streaming_endpoint_is_rejected() {
+    int testResult = 1;
+    pid_t child = fork();
+    if (child == 0) {
+        addStreamingEndpoint("/upload", helloH, -1);
+        startApp("18434");
+        _exit(0);
+    }
+    int status;
+    EXPECT(waitpid(child, &status, 0) == child);
+    EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 1);
+    return testResult;
+}
+
+int test2_every_loop_listens_on_the_port() {
+    int testResult = 1;
+    for (int attempt = 0; attempt < 100 && countListeners() < LOOPS; attempt++) {
+        usleep(20 * 1000);
+    }
+    EXPECT(countListeners() == LOOPS);
+    return testResult;
+}
+
+int test3_connections_are_accepted_by_the_loops() {
+    int testResult = 1;
+    int clients[8];
+    for (int i = 0; i < 8; i++) {
+        clients[i] = connectClient();
+        EXPECT(clients[i] != -1);
+    }
+    for (int i = 0; i < 8; i++) {
+        EXPECT(answersHello(clients[i]));
+        close(clients[i]);
+    }
+    return testResult;
+}
+
+/* The last chunk ends the response, the chunk framing is counted with the content */
+static size_t readUntilLastChunk(int fd) {
+    static char buffer[1 << 16];
+    char tail[5] = {0};
+    size_t total = 0;
+    for (;;) {
+        ssize_t got = read(fd, buffer, sizeof(buffer));
+        if (got <= 0) {
+            return 0;
+        }
+        total += got;
+        size_t keep = got >= 5 ? 0 : 5 - (size_t) got;
+        memmove(tail, tail + 5 - keep, keep);
+        memcpy(tail + keep, buffer + got - (5 - keep), 5 - keep);
+        if (memcmp(tail, "0\r\n\r\n", 5) == 0) {
+            return total;
+        }
+    }
+}
+
+/* A client that stops reading pauses the producer at the queue limit instead of stalling its loop */
+int test4_slow_client_pauses_the_producer() {
+    int testResult = 1;
+    static const char request[] = "GET /stream HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    int slow = connectClientWithBuffer(4096);
+    EXPECT(slow != -1 && write(slow, request, strlen(request)) == (ssize_t) strlen(request));
+    usleep(300 * 1000);
+    size_t producedWhileStalled = atomic_load(&produced);
+    EXPECT(producedWhileStalled > 0);
+    EXPECT(producedWhileStalled < OUTBOUND_QUEUE_MAX_BYTES + (8 << 20));
+
+    /* some of these share the slow client's loop */
+    for (int i = 0; i < 8; i++) {
+        int client = connectClient();
+        EXPECT(client != -1 && answersHello(client));
+        close(client);
+    }
+
+    EXPECT(readUntilLastChunk(slow) > PRODUCED_SIZE);
+    EXPECT(atomic_load(&produced) == PRODUCED_SIZE);
+    EXPECT(atomic_load(&producerCalls) > 1);
+    EXPECT(answersHello(slow));
+    close(slow);
+    return testResult;
+}
+
+/* startApp returns, the listeners are closed and an open connection is closed too */
+int test5_stop_closes_listeners_and_connections() {
+    int testResult = 1;
+    int client = connectClient();
+    EXPECT(client != -1 && answersHello(client));
+    stopApp();
+    EXPECT(pthread_join(app, NULL) == 0);
+    char byte;
+    EXPECT(read(client, &byte, 1) == 0);
+    EXPECT(countListeners() == 0);
+    EXPECT(connectClient() == -1);
+    close(client);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    initApp();
+    gcTrack();
+    addEndpoint("/hello", helloH);
+    addEndpoint("/stream", streamH);
+    setServerMode(SERVER_MODE_REACTOR);
+    setWorkerThreads(LOOPS);
+    setReusePort(1);
+
+    UNIT_TEST(test1_streaming_endpoint_is_rejected)
+    pthread_create(&app, NULL, runApp, NULL);
+    UNIT_TEST(test2_every_loop_listens_on_the_port)
+    UNIT_TEST(test3_connections_are_accepted_by_the_loops)
+    UNIT_TEST(test4_slow_client_pauses_the_producer)
+    UNIT_TEST(test5_stop_closes_listeners_and_connections)
+
+    TEST_RESULTS
+    return failed;
+}
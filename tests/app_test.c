@@ -0,0 +1,132 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <alloc.h>
+#include <app.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define PORT 18432
+#define REQUEST "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"
+
+/* Thread per connection, a parked connection resumes on a new thread */
+static atomic_long servingThread;
+
+static HttpResp helloH(HttpReq) {
+    atomic_store(&servingThread, syscall(SYS_gettid));
+    HttpRespBuilder builder = newRespBuilder();
+    respBuilderSetStatus(&builder, NO_CONTENT);
+    return respBuild(&builder);
+}
+
+static void *runApp(void *) {
+    char port[6];
+    snprintf(port, sizeof(port), "%d", PORT);
+    startApp(port);
+    return NULL;
+}
+
+/* Retries until the app listens, reads time out after two seconds */
+static int connectClient() {
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    for (int attempt = 0; attempt < 100; attempt++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct timeval timeout = {.tv_sec = 2, .tv_usec = 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (connect(fd, (struct sockaddr *) &address, sizeof(address)) == 0) {
+            return fd;
+        }
+        close(fd);
+        usleep(20 * 1000);
+    }
+    return -1;
+}
+
+/* 204 responses have no content, each ends with the blank line of its head */
+static int readResponses(int fd, int count) {
+    char buffer[4096];
+    size_t length = 0;
+    int found = 0;
+    while (found < count && length < sizeof(buffer) - 1) {
+        ssize_t got = read(fd, buffer + length, sizeof(buffer) - 1 - length);
+        if (got <= 0) {
+            break;
+        }
+        length += got;
+        buffer[length] = '\0';
+        found = 0;
+        for (const char *end = strstr(buffer, "\r\n\r\n"); end != NULL; end = strstr(end + 4, "\r\n\r\n")) {
+            found++;
+        }
+    }
+    return found;
+}
+
+static int sendRequests(int fd, int count) {
+    char requests[sizeof(REQUEST) * 4];
+    size_t length = 0;
+    for (int i = 0; i < count; i++) {
+        memcpy(requests + length, REQUEST, strlen(REQUEST));
+        length += strlen(REQUEST);
+    }
+    return write(fd, requests, length) == (ssize_t) length;
+}
+
+int test1_back_to_back_requests_skip_parking() {
+    int testResult = 1;
+    int fd = connectClient();
+    EXPECT(fd != -1);
+    EXPECT(sendRequests(fd, 1) && readResponses(fd, 1) == 1);
+    long thread = atomic_load(&servingThread);
+    for (int i = 0; i < 5; i++) {
+        EXPECT(sendRequests(fd, 1) && readResponses(fd, 1) == 1);
+    }
+    EXPECT(sendRequests(fd, 3) && readResponses(fd, 3) == 3);
+    EXPECT(atomic_load(&servingThread) == thread);
+    close(fd);
+    return testResult;
+}
+
+int test2_idle_connection_is_parked_and_resumed() {
+    int testResult = 1;
+    int fd = connectClient();
+    EXPECT(fd != -1);
+    EXPECT(sendRequests(fd, 1) && readResponses(fd, 1) == 1);
+    long thread = atomic_load(&servingThread);
+    usleep(400 * 1000);
+    EXPECT(sendRequests(fd, 1) && readResponses(fd, 1) == 1);
+    EXPECT(atomic_load(&servingThread) != thread);
+    close(fd);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    initApp();
+    gcTrack();
+    addEndpoint("/hello", helloH);
+    /* generous, so a busy machine does not park a client that answers right away */
+    setIdleParkingDelay(200);
+    pthread_t app;
+    pthread_create(&app, NULL, runApp, NULL);
+    pthread_detach(app);
+
+    UNIT_TEST(test1_back_to_back_requests_skip_parking)
+    UNIT_TEST(test2_idle_connection_is_parked_and_resumed)
+
+    TEST_RESULTS
+    return failed;
+}
@@ -0,0 +1,305 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <alloc.h>
+#include <arpa/inet.h>
+#include <connection.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BODY_SIZE (1 << 20)
+
+typedef struct Drain {
+    int fd;
+    char *received;
+    size_t length;
+} Drain;
+
+static void *drainPeer(void *arg) {
+    Drain *drain = arg;
+    ssize_t got;
+    while ((got = read(drain->fd, drain->received + drain->length, BODY_SIZE)) > 0) {
+        drain->length += got;
+    }
+    return NULL;
+}
+
+/* The body is bigger than the socket buffer, so sendmsg returns short and iov has to be resumed mid entry */
+static int sendsWholeVector(IoBackendType backend) {
+    int testResult = 1;
+    setIoBackend(backend);
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    TcpSocket socket = {.fd = fds[1], .closed = 0, .nonBlocking = 0};
+
+    static const char head[] = "HTTP/1.1 200 OK\r\nContent-Length: 1048576\r\n\r\n";
+    char *body = allocate(BODY_SIZE);
+    for (int i = 0; i < BODY_SIZE; i++) {
+        body[i] = (char) ('a' + i % 26);
+    }
+    Drain drain = {.fd = fds[0], .received = allocate(BODY_SIZE * 2), .length = 0};
+    pthread_t reader;
+    pthread_create(&reader, NULL, drainPeer, &drain);
+
+    struct iovec iov[3] = {
+        {.iov_base = (void*) head, .iov_len = sizeof(head) - 1},
+        {.iov_base = NULL, .iov_len = 0},
+        {.iov_base = body, .iov_len = BODY_SIZE},
+    };
+    WriteResult result = transmitVector(&socket, iov, 3);
+    close(fds[1]);
+    pthread_join(reader, NULL);
+
+    EXPECT(result.result == WRITE_OK);
+    EXPECT(result.sent == sizeof(head) - 1 + BODY_SIZE);
+    EXPECT(drain.length == result.sent);
+    EXPECT(memcmp(drain.received, head, sizeof(head) - 1) == 0);
+    EXPECT(memcmp(drain.received + sizeof(head) - 1, body, BODY_SIZE) == 0);
+
+    deallocate(body);
+    deallocate(drain.received);
+    close(fds[0]);
+    return testResult;
+}
+
+int test1_direct_vector_resumes_short_writes() {
+    return sendsWholeVector(IO_BACKEND_DIRECT);
+}
+
+int test2_poll_vector_resumes_short_writes() {
+    return sendsWholeVector(IO_BACKEND_POLL);
+}
+
+int test3_vector_to_closed_peer() {
+    int testResult = 1;
+    setIoBackend(IO_BACKEND_DIRECT);
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    TcpSocket socket = {.fd = fds[1], .closed = 0, .nonBlocking = 0};
+    close(fds[0]);
+
+    struct iovec iov[1] = {{.iov_base = "x", .iov_len = 1}};
+    WriteResult result = transmitVector(&socket, iov, 1);
+    EXPECT(result.result != WRITE_OK);
+    EXPECT(socket.closed);
+    EXPECT(transmitVector(&socket, iov, 1).result == WRITE_CLOSED);
+
+    close(fds[1]);
+    return testResult;
+}
+
+#define CAPTURE_PATH "connection_test_capture.bin"
+
+static long readCapture(char *buffer, size_t size) {
+    FILE *file = fopen(CAPTURE_PATH, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    long got = (long) fread(buffer, 1, size, file);
+    fclose(file);
+    return got;
+}
+
+/* Records are drained by a background thread, so the file is polled for a while */
+int test4_wire_capture() {
+    int testResult = 1;
+    unlink(CAPTURE_PATH);
+    setIoBackend(IO_BACKEND_DIRECT);
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    TcpSocket socket = {.fd = fds[1], .closed = 0, .nonBlocking = 0, .ip = "10.0.0.1"};
+
+    transmit(&socket, "before", 6);
+    setWireCaptureOptions((WireCaptureOptions) {.path = CAPTURE_PATH, .maxBytesPerConnection = 8});
+    setWireCapture(1);
+    transmit(&socket, "hello", 5);
+    transmit(&socket, "world", 5);
+    transmit(&socket, "dropped", 7);
+    setWireCapture(0);
+
+    const long expected = 8 + sizeof(WireRecordHeader) * 2 + 8;
+    char captured[256];
+    long got = 0;
+    for (int i = 0; i < 200 && got < expected; i++) {
+        struct timespec wait = {.tv_sec = 0, .tv_nsec = 10 * 1000000L};
+        nanosleep(&wait, NULL);
+        got = readCapture(captured, sizeof(captured));
+    }
+    EXPECT(got == expected);
+    EXPECT(memcmp(captured, WIRE_CAPTURE_MAGIC, 8) == 0);
+    WireRecordHeader header;
+    memcpy(&header, captured + 8, sizeof(header));
+    EXPECT(header.length == 5 && header.originalLength == 5 && header.outgoing == 1);
+    EXPECT(header.fd == fds[1] && strcmp(header.ip, "10.0.0.1") == 0);
+    EXPECT(memcmp(captured + 8 + sizeof(header), "hello", 5) == 0);
+    /* the per connection cap cuts the second payload */
+    memcpy(&header, captured + 8 + sizeof(header) + 5, sizeof(header));
+    EXPECT(header.length == 3 && header.originalLength == 5);
+    EXPECT(memcmp(captured + 8 + sizeof(header) * 2 + 5, "wor", 3) == 0);
+
+    close(fds[0]);
+    close(fds[1]);
+    unlink(CAPTURE_PATH);
+    return testResult;
+}
+
+int test5_uring_vector_resumes_short_writes() {
+    return sendsWholeVector(IO_BACKEND_URING);
+}
+
+/* The linked timeout ends the receive once the deadline passes */
+int test6_uring_receive_times_out() {
+    int testResult = 1;
+    setIoBackend(IO_BACKEND_URING);
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    TcpSocket socket = {.fd = fds[1], .closed = 0, .nonBlocking = 0};
+
+    char buffer[16];
+    transmit(&(TcpSocket) {.fd = fds[0], .closed = 0, .nonBlocking = 0}, "ping", 4);
+    ReadResult result = receive(&socket, buffer, sizeof(buffer));
+    EXPECT(result.result == READ_OK && result.received == 4);
+    EXPECT(memcmp(buffer, "ping", 4) == 0);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    setSocketDeadline(&socket, 100);
+    result = receive(&socket, buffer, sizeof(buffer));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long elapsedMs = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+    EXPECT(result.result == READ_TIMEOUT);
+    EXPECT(socket.closed);
+    EXPECT(elapsedMs >= 90 && elapsedMs < 2000);
+
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int test7_uring_non_blocking_receive_would_block() {
+    int testResult = 1;
+    setIoBackend(IO_BACKEND_URING);
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    TcpSocket socket = {.fd = fds[1], .closed = 0, .nonBlocking = 0};
+    setSocketNonBlocking(&socket);
+
+    char buffer[16];
+    EXPECT(receive(&socket, buffer, sizeof(buffer)).result == READ_WOULD_BLOCK);
+    EXPECT(!socket.closed);
+    write(fds[0], "pong", 4);
+    ReadResult result = receive(&socket, buffer, sizeof(buffer));
+    EXPECT(result.result == READ_OK && result.received == 4);
+
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+/* More than one pipe of file, so the splice chain has several windows */
+int test8_uring_transmit_file() {
+    int testResult = 1;
+    setIoBackend(IO_BACKEND_URING);
+    char path[] = "/tmp/connection_test_XXXXXX";
+    int file = mkstemp(path);
+    unlink(path);
+    char *content = allocate(BODY_SIZE * 2);
+    for (int i = 0; i < BODY_SIZE * 2; i++) {
+        content[i] = (char) ('A' + i % 23);
+    }
+    write(file, content, BODY_SIZE * 2);
+
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    TcpSocket socket = {.fd = fds[1], .closed = 0, .nonBlocking = 0};
+    Drain drain = {.fd = fds[0], .received = allocate(BODY_SIZE * 3), .length = 0};
+    pthread_t reader;
+    pthread_create(&reader, NULL, drainPeer, &drain);
+
+    const size_t count = BODY_SIZE + BODY_SIZE / 2 + 7;
+    WriteResult result = transmitFile(&socket, file, 5, count);
+    close(fds[1]);
+    pthread_join(reader, NULL);
+
+    EXPECT(result.result == WRITE_OK);
+    EXPECT(result.sent == count);
+    EXPECT(drain.length == count);
+    EXPECT(memcmp(drain.received, content + 5, count) == 0);
+
+    deallocate(content);
+    deallocate(drain.received);
+    close(fds[0]);
+    close(file);
+    return testResult;
+}
+
+static int connectLoopback(int port) {
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Every connection comes out of the one multishot accept armed by the first call */
+int test9_uring_multishot_accept() {
+    int testResult = 1;
+    setIoBackend(IO_BACKEND_URING);
+    TcpSocket listener = socketListen("18434");
+    EXPECT(!listener.closed);
+
+    int clients[3];
+    int accepted[3];
+    for (int i = 0; i < 3; i++) {
+        clients[i] = connectLoopback(18434);
+        EXPECT(clients[i] != -1);
+        TcpSocket client = acceptConnection(listener);
+        EXPECT(!client.closed && client.fd >= 0);
+        accepted[i] = client.fd;
+    }
+    EXPECT(accepted[0] != accepted[1] && accepted[1] != accepted[2]);
+
+    TcpSocket server = {.fd = accepted[2], .closed = 0, .nonBlocking = 0};
+    write(clients[2], "hello", 5);
+    char buffer[8];
+    ReadResult result = receive(&server, buffer, sizeof(buffer));
+    EXPECT(result.result == READ_OK && result.received == 5);
+
+    for (int i = 0; i < 3; i++) {
+        close(accepted[i]);
+        close(clients[i]);
+    }
+    close(listener.fd);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+
+    UNIT_TEST(test1_direct_vector_resumes_short_writes)
+    UNIT_TEST(test2_poll_vector_resumes_short_writes)
+    UNIT_TEST(test3_vector_to_closed_peer)
+    UNIT_TEST(test4_wire_capture)
+    UNIT_TEST(test5_uring_vector_resumes_short_writes)
+    UNIT_TEST(test6_uring_receive_times_out)
+    UNIT_TEST(test7_uring_non_blocking_receive_would_block)
+    UNIT_TEST(test8_uring_transmit_file)
+    UNIT_TEST(test9_uring_multishot_accept)
+
+    TEST_RESULTS
+    return failed;
+}
@@ -0,0 +1,195 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <errno.h>
+#include <alloc.h>
+#include <file_cache.h>
+#include <file_handler.h>
+#include <http_resp.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void writeFile(const char *path, const char *content) {
+    FILE *file = fopen(path, "wb");
+    fputs(content, file);
+    fclose(file);
+}
+
+static int readsAs(CachedFile *file, const char *expected) {
+    char buffer[64];
+    ssize_t got = pread(file->fd, buffer, sizeof(buffer), 0);
+    return got == (ssize_t) strlen(expected) && memcmp(buffer, expected, got) == 0;
+}
+
+int test1_hits_share_the_descriptor() {
+    int testResult = 1;
+    writeFile("file_cache_a.css", "body{}");
+    CachedFile *first = acquireCachedFile("file_cache_a.css");
+    CachedFile *second = acquireCachedFile("file_cache_a.css");
+    EXPECT(first != NULL && first == second);
+    EXPECT(first->size == 6);
+    EXPECT(strcmp(first->mimeType, "text/css") == 0);
+    EXPECT(first->etagLength > 2 && first->etag[0] == '"');
+    EXPECT(atomic_load(&first->refs) == 3);
+    releaseCachedFile(first);
+    releaseCachedFile(second);
+
+    errno = 0;
+    EXPECT(acquireCachedFile("file_cache_missing.css") == NULL && errno == ENOENT);
+    EXPECT(acquireCachedFile(".") == NULL);
+    clearFileCache();
+    unlink("file_cache_a.css");
+    return testResult;
+}
+
+/* A replaced file gets a new entry, a sender holding the old one keeps reading the old bytes */
+int test2_revalidates_changed_files() {
+    int testResult = 1;
+    setFileCacheRevalidateMs(0);
+    writeFile("file_cache_b.txt", "old");
+    CachedFile *old = acquireCachedFile("file_cache_b.txt");
+    writeFile("file_cache_b.tmp", "newer");
+    rename("file_cache_b.tmp", "file_cache_b.txt");
+
+    CachedFile *fresh = acquireCachedFile("file_cache_b.txt");
+    EXPECT(old != NULL && fresh != NULL && fresh != old);
+    EXPECT(fresh->size == 5 && readsAs(fresh, "newer"));
+    EXPECT(readsAs(old, "old"));
+    EXPECT(strcmp(old->etag, fresh->etag) != 0);
+    EXPECT(atomic_load(&old->refs) == 1);
+    releaseCachedFile(old);
+    releaseCachedFile(fresh);
+
+    setFileCacheRevalidateMs(1000);
+    clearFileCache();
+    unlink("file_cache_b.txt");
+    return testResult;
+}
+
+int test3_evicts_least_recently_used() {
+    int testResult = 1;
+    setFileCacheCapacity(2);
+    writeFile("file_cache_1.txt", "1");
+    writeFile("file_cache_2.txt", "2");
+    writeFile("file_cache_3.txt", "3");
+    CachedFile *one = acquireCachedFile("file_cache_1.txt");
+    releaseCachedFile(acquireCachedFile("file_cache_2.txt"));
+    releaseCachedFile(acquireCachedFile("file_cache_1.txt"));
+    releaseCachedFile(acquireCachedFile("file_cache_3.txt"));
+
+    /* 2 was the oldest, 1 is still cached */
+    CachedFile *again = acquireCachedFile("file_cache_1.txt");
+    EXPECT(again == one);
+    releaseCachedFile(again);
+    releaseCachedFile(one);
+
+    setFileCacheCapacity(0);
+    CachedFile *uncached = acquireCachedFile("file_cache_3.txt");
+    EXPECT(uncached != NULL && atomic_load(&uncached->refs) == 1 && readsAs(uncached, "3"));
+    releaseCachedFile(uncached);
+
+    setFileCacheCapacity(128);
+    unlink("file_cache_1.txt");
+    unlink("file_cache_2.txt");
+    unlink("file_cache_3.txt");
+    return testResult;
+}
+
+static HttpHeaders requestAccepting(const char *acceptEncoding) {
+    HttpHeaders headers = emptyHeaders();
+    headers.arr = gcAllocate(sizeof(HttpHeader));
+    headers.arr[0] = (HttpHeader) {STRING_LITERAL("Accept-Encoding"), {(char*) acceptEncoding, strlen(acceptEncoding)}};
+    headers.count = 1;
+    indexHeader(&headers, 0);
+    return headers;
+}
+
+/* Encoders are optional, so only what was built in is checked */
+int test4_resident_variants_negotiated() {
+    int testResult = 1;
+    char text[4096];
+    for (size_t i = 0; i < sizeof(text) - 1; i++) {
+        text[i] = "static asset "[i % 13];
+    }
+    text[sizeof(text) - 1] = '\0';
+    writeFile("file_cache_c.html", text);
+
+    CachedFile *file = acquireCachedFile("file_cache_c.html");
+    EXPECT(file != NULL);
+    EncodedContent *identity = &file->variants[CONTENT_ENCODING_IDENTITY];
+    EXPECT(identity->data != NULL && identity->length == sizeof(text) - 1);
+    EXPECT(memcmp(identity->data, text, identity->length) == 0);
+    EncodedContent *gzip = &file->variants[CONTENT_ENCODING_GZIP];
+    if (gzip->data != NULL) {
+        EXPECT(gzip->length < identity->length);
+        EXPECT((unsigned char) gzip->data[0] == 0x1f && (unsigned char) gzip->data[1] == 0x8b);
+    }
+    releaseCachedFile(file);
+
+    HttpRespBuilder builder = newRespBuilder();
+    respBuilderSetFileContent(&builder, "file_cache_c.html", 0);
+    HttpResp resp = respBuild(&builder);
+    HttpHeaders refusing = requestAccepting("gzip;q=0, br;q=0.000, identity");
+    respNegotiateEncoding(&resp, &refusing);
+    EXPECT(!resp.isContentFile && resp.contentLength == sizeof(text) - 1);
+    EXPECT(findHeader(&resp.headers, "Content-Encoding") == NULL);
+    respRelease(&resp);
+
+    builder = newRespBuilder();
+    respBuilderSetFileContent(&builder, "file_cache_c.html", 0);
+    resp = respBuild(&builder);
+    HttpHeaders gzipOnly = requestAccepting("br;q=0, gzip;q=0.5");
+    respNegotiateEncoding(&resp, &gzipOnly);
+    if (gzip->data != NULL) {
+        EXPECT(resp.content == gzip->data && resp.contentLength == gzip->length);
+        EXPECT(stringEquals(&findHeader(&resp.headers, "Content-Encoding")->value, "gzip"));
+        char expectedLength[UNSIGNED_DIGITS_MAX + 1] = {0};
+        formatUnsigned(gzip->length, expectedLength);
+        EXPECT(stringEquals(&getHeader(&resp.headers, HEADER_CONTENT_LENGTH)->value, expectedLength));
+        EXPECT(findHeader(&resp.headers, "Vary") != NULL);
+    }
+    respRelease(&resp);
+
+    writeFile("file_cache_d.png", text);
+    file = acquireCachedFile("file_cache_d.png");
+    EXPECT(file->variants[CONTENT_ENCODING_IDENTITY].data != NULL);
+    EXPECT(file->variants[CONTENT_ENCODING_GZIP].data == NULL && file->variants[CONTENT_ENCODING_BROTLI].data == NULL);
+    releaseCachedFile(file);
+
+    clearFileCache();
+    gcCleanup();
+    unlink("file_cache_c.html");
+    unlink("file_cache_d.png");
+    return testResult;
+}
+
+/* Brotli encodes text types in its text mode, other compressible types generically */
+int test5_text_mime_types() {
+    int testResult = 1;
+    EXPECT(isTextMimeType(getMimeType("html")));
+    EXPECT(isTextMimeType(getMimeType("json")));
+    EXPECT(isTextMimeType(getMimeType("js")));
+    EXPECT(isTextMimeType(getMimeType("svg")));
+    EXPECT(!isTextMimeType(getMimeType("wasm")));
+    EXPECT(!isTextMimeType(getMimeType("bmp")));
+    EXPECT(!isTextMimeType(getMimeType(NULL)));
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    gcInit();
+    gcTrack();
+
+    UNIT_TEST(test1_hits_share_the_descriptor)
+    UNIT_TEST(test2_revalidates_changed_files)
+    UNIT_TEST(test3_evicts_least_recently_used)
+    UNIT_TEST(test4_resident_variants_negotiated)
+    UNIT_TEST(test5_text_mime_types)
+
+    TEST_RESULTS
+    return failed;
+}
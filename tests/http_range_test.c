@@ -0,0 +1,171 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <alloc.h>
+#include <file_cache.h>
+#include <http_range.h>
+#include <unistd.h>
+
+#define FILE_SIZE 1000
+
+static int parses(const char *value, off_t size, int expectedCount, const ByteRange *expected) {
+    ByteRange ranges[MAX_BYTE_RANGES];
+    string header = {(char*) value, strlen(value)};
+    int count = parseByteRanges(&header, size, ranges, MAX_BYTE_RANGES);
+    if (count != expectedCount) {
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        if (ranges[i].start != expected[i].start || ranges[i].end != expected[i].end) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static HttpHeaders requestWith(const char *key, const char *value, const char *key2, const char *value2) {
+    HttpHeaders headers = emptyHeaders();
+    headers.arr = gcAllocate(sizeof(HttpHeader) * 2);
+    headers.arr[headers.count++] = (HttpHeader) {{(char*) key, strlen(key)}, {(char*) value, strlen(value)}};
+    indexHeader(&headers, 0);
+    if (key2 != NULL) {
+        headers.arr[headers.count++] = (HttpHeader) {{(char*) key2, strlen(key2)}, {(char*) value2, strlen(value2)}};
+        indexHeader(&headers, 1);
+    }
+    return headers;
+}
+
+static HttpResp fileResp() {
+    HttpRespBuilder builder = newRespBuilder();
+    respBuilderSetFileContent(&builder, "http_range_test.bin", 0);
+    return respBuild(&builder);
+}
+
+int test1_parse_byte_ranges() {
+    int testResult = 1;
+    EXPECT(parses("bytes=0-99", FILE_SIZE, 1, (ByteRange[]) {{0, 99}}));
+    EXPECT(parses("bytes=900-", FILE_SIZE, 1, (ByteRange[]) {{900, 999}}));
+    EXPECT(parses("bytes=-100", FILE_SIZE, 1, (ByteRange[]) {{900, 999}}));
+    EXPECT(parses("bytes=-5000", FILE_SIZE, 1, (ByteRange[]) {{0, 999}}));
+    EXPECT(parses("bytes=990-5000", FILE_SIZE, 1, (ByteRange[]) {{990, 999}}));
+    EXPECT(parses("BYTES=0-0, 5-9 ,-1", FILE_SIZE, 3, (ByteRange[]) {{0, 0}, {5, 9}, {999, 999}}));
+    EXPECT(parses("bytes=1000-", FILE_SIZE, 0, NULL));
+    EXPECT(parses("bytes=-0", FILE_SIZE, 0, NULL));
+    EXPECT(parses("bytes=2000-3000, 5-9", FILE_SIZE, 1, (ByteRange[]) {{5, 9}}));
+    EXPECT(parses("bytes=9-5", FILE_SIZE, -1, NULL));
+    EXPECT(parses("bytes=a-5", FILE_SIZE, -1, NULL));
+    EXPECT(parses("bytes=", FILE_SIZE, -1, NULL));
+    EXPECT(parses("items=0-5", FILE_SIZE, -1, NULL));
+    EXPECT(parses("bytes=0-1,2-3,4-5,6-7,8-9,10-11,12-13,14-15,16-17,18-19,20-21,22-23,24-25,26-27,28-29,30-31,32-33", FILE_SIZE, -1, NULL));
+    EXPECT(parses("bytes=99999999999999999999-", FILE_SIZE, -1, NULL));
+    return testResult;
+}
+
+int test2_conditionals() {
+    int testResult = 1;
+    HttpResp resp = fileResp();
+    string etag = findHeader(&resp.headers, "ETag")->value;
+    char etagValue[FILE_ETAG_SIZE + 8];
+    snprintf(etagValue, sizeof(etagValue), "\"other\", W/%.*s", (int) etag.length, etag.ptr);
+    HttpHeaders matching = requestWith("If-None-Match", etagValue, NULL, NULL);
+    respApplyConditionals(&resp, GET, &matching);
+    EXPECT(resp.status == NOT_MODIFIED && resp.contentLength == 0 && !resp.isContentFile);
+    respRelease(&resp);
+
+    /* If-Modified-Since is ignored when If-None-Match is present */
+    resp = fileResp();
+    const char *lastModified = resp.file->lastModified;
+    HttpHeaders stale = requestWith("If-None-Match", "\"other\"", "If-Modified-Since", lastModified);
+    respApplyConditionals(&resp, GET, &stale);
+    EXPECT(resp.status == OK && resp.contentLength == FILE_SIZE);
+    respRelease(&resp);
+
+    resp = fileResp();
+    HttpHeaders since = requestWith("If-Modified-Since", lastModified, NULL, NULL);
+    respApplyConditionals(&resp, HEAD, &since);
+    EXPECT(resp.status == NOT_MODIFIED);
+    respRelease(&resp);
+
+    resp = fileResp();
+    HttpHeaders older = requestWith("If-Modified-Since", "Sun, 06 Nov 1994 08:49:37 GMT", NULL, NULL);
+    respApplyConditionals(&resp, GET, &older);
+    EXPECT(resp.status == OK);
+    respApplyConditionals(&resp, POST, &matching);
+    EXPECT(resp.status == OK);
+    respRelease(&resp);
+    return testResult;
+}
+
+int test3_ranges() {
+    int testResult = 1;
+    HttpResp resp = fileResp();
+    HttpHeaders single = requestWith("Range", "bytes=100-199", NULL, NULL);
+    respApplyConditionals(&resp, GET, &single);
+    EXPECT(resp.status == PARTIAL_CONTENT && resp.contentLength == 100);
+    if (resp.isContentFile) {
+        EXPECT(resp.contentOffset == 100);
+    } else {
+        EXPECT(((const char*) resp.content)[0] == (char) 100);
+    }
+    EXPECT(stringEquals(&findHeader(&resp.headers, "Content-Range")->value, "bytes 100-199/1000"));
+    EXPECT(stringEquals(&getHeader(&resp.headers, HEADER_CONTENT_LENGTH)->value, "100"));
+    respRelease(&resp);
+
+    resp = fileResp();
+    HttpHeaders multiple = requestWith("Range", "bytes=0-9,-10", NULL, NULL);
+    respApplyConditionals(&resp, GET, &multiple);
+    EXPECT(resp.status == PARTIAL_CONTENT && resp.parts != NULL && resp.parts->count == 2);
+    EXPECT(resp.parts->items[1].start == 990 && resp.parts->items[1].length == 10);
+    size_t total = resp.parts->tail.length;
+    for (int i = 0; i < resp.parts->count; i++) {
+        total += resp.parts->items[i].head.length + resp.parts->items[i].length;
+    }
+    EXPECT(resp.contentLength == total);
+    EXPECT(strncmp(getHeader(&resp.headers, HEADER_CONTENT_TYPE)->value.ptr, "multipart/byteranges; boundary=", 31) == 0);
+    respRelease(&resp);
+
+    resp = fileResp();
+    HttpHeaders unsatisfiable = requestWith("Range", "bytes=1000-", NULL, NULL);
+    respApplyConditionals(&resp, GET, &unsatisfiable);
+    EXPECT(resp.status == RANGE_NOT_SATISFIABLE && resp.contentLength == 0);
+    EXPECT(stringEquals(&findHeader(&resp.headers, "Content-Range")->value, "bytes */1000"));
+    respRelease(&resp);
+
+    resp = fileResp();
+    HttpHeaders changed = requestWith("Range", "bytes=0-9", "If-Range", "\"older\"");
+    respApplyConditionals(&resp, GET, &changed);
+    EXPECT(resp.status == OK && resp.contentLength == FILE_SIZE);
+    respRelease(&resp);
+
+    resp = fileResp();
+    HttpHeaders headRange = requestWith("Range", "bytes=0-9", NULL, NULL);
+    respApplyConditionals(&resp, HEAD, &headRange);
+    EXPECT(resp.status == OK);
+    respRelease(&resp);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    gcInit();
+    gcTrack();
+
+    FILE *file = fopen("http_range_test.bin", "wb");
+    for (int i = 0; i < FILE_SIZE; i++) {
+        fputc(i & 0xff, file);
+    }
+    fclose(file);
+
+    UNIT_TEST(test1_parse_byte_ranges)
+    UNIT_TEST(test2_conditionals)
+    UNIT_TEST(test3_ranges)
+
+    clearFileCache();
+    gcCleanup();
+    unlink("http_range_test.bin");
+    TEST_RESULTS
+    return failed;
+}
@@ -0,0 +1,318 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <alloc.h>
+#include <errors.h>
+#include <http_body.h>
+#include <http_req.h>
+#include <tcp_stream.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static TcpSocket openPair(int fds[2]) {
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    return (TcpSocket) {.fd = fds[1], .closed = 0, .nonBlocking = 0};
+}
+
+static void sendAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = write(fd, data, length);
+        if (sent <= 0) {
+            return;
+        }
+        data += sent;
+        length -= sent;
+    }
+}
+
+int test1_slices_point_into_stream() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    static const char raw[] = "GET /users/42/?id=1&flag&=skip&name= HTTP/1.1\r\nHost: example\r\nConnection: keep-alive\r\n\r\n";
+    sendAll(fds[0], raw, sizeof(raw) - 1);
+
+    HttpReq req = newRequest();
+    EXPECT(parseRequestStream(&req, stream) == 0);
+    EXPECT(req.method == GET);
+    EXPECT(stringEquals(&req.path.raw, "/users/42/?id=1&flag&=skip&name="));
+    EXPECT(req.path.raw.ptr >= stream->buffer && req.path.raw.ptr < stream->buffer + stream->length);
+    EXPECT(req.path.elCount == 2);
+    EXPECT(stringEquals(&req.path.elements[0], "users") && stringEquals(&req.path.elements[1], "42"));
+    EXPECT(req.query.count == 3);
+    EXPECT(stringEquals(&findQueryParameter(&req.query, "id")->value, "1"));
+    EXPECT(findQueryParameter(&req.query, "flag")->value.length == -1);
+    EXPECT(findQueryParameter(&req.query, "name")->value.length == 0);
+    EXPECT(stringEquals(&req.version, "HTTP/1.1"));
+    EXPECT(req.headers.count == 2);
+    EXPECT(stringEquals(&findHeader(&req.headers, "Host")->value, "example"));
+    EXPECT(isConnectionKeepAlive(&req));
+    EXPECT(req.content == NULL);
+
+    gcCleanup();
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+/* The buffer grows for the content, the head slices taken before must still be readable */
+int test2_slices_survive_buffer_growth() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    static const char head[] = "POST /upload HTTP/1.0\r\nContent-Length: 8192\r\nX-Note: kept\r\n\r\n";
+    sendAll(fds[0], head, sizeof(head) - 1);
+    char *content = allocate(8192);
+    memset(content, 'c', 8192);
+    sendAll(fds[0], content, 8192);
+
+    HttpReq req = newRequest();
+    EXPECT(parseRequestStream(&req, stream) == 0);
+    EXPECT(stream->capacity > TCP_STREAM_BUFFER_SIZE);
+    EXPECT(stringEquals(&req.path.raw, "/upload"));
+    EXPECT(stringEquals(&findHeader(&req.headers, "X-Note")->value, "kept"));
+    EXPECT(req.contentLength == 8192);
+    EXPECT(memcmp(req.content, content, 8192) == 0);
+    EXPECT(!isConnectionKeepAlive(&req));
+
+    deallocate(content);
+    gcCleanup();
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int test3_rejects_invalid_content_length() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    static const char raw[] = "POST / HTTP/1.1\r\nContent-Length: 12abc\r\n\r\n";
+    sendAll(fds[0], raw, sizeof(raw) - 1);
+
+    HttpReq req = newRequest();
+    EXPECT(parseRequestStream(&req, stream) == BAD_REQUEST_ERROR);
+
+    gcCleanup();
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int test4_known_headers_classified() {
+    int testResult = 1;
+    static const char *names[KNOWN_HEADER_COUNT] = {
+        [HEADER_HOST] = "Host",
+        [HEADER_CONTENT_LENGTH] = "Content-Length",
+        [HEADER_CONTENT_TYPE] = "Content-Type",
+        [HEADER_CONTENT_ENCODING] = "Content-Encoding",
+        [HEADER_CONNECTION] = "Connection",
+        [HEADER_TRANSFER_ENCODING] = "Transfer-Encoding",
+        [HEADER_ACCEPT] = "Accept",
+        [HEADER_ACCEPT_ENCODING] = "Accept-Encoding",
+        [HEADER_IF_NONE_MATCH] = "If-None-Match",
+        [HEADER_IF_MODIFIED_SINCE] = "If-Modified-Since",
+        [HEADER_IF_RANGE] = "If-Range",
+        [HEADER_RANGE] = "Range",
+        [HEADER_EXPECT] = "Expect",
+        [HEADER_USER_AGENT] = "User-Agent",
+        [HEADER_COOKIE] = "Cookie",
+        [HEADER_AUTHORIZATION] = "Authorization",
+    };
+    for (int i = 0; i < KNOWN_HEADER_COUNT; i++) {
+        EXPECT(names[i] != NULL && classifyHeader(names[i], strlen(names[i])) == (KnownHeader) i);
+    }
+    EXPECT(classifyHeader("CONTENT-LENGTH", 14) == HEADER_CONTENT_LENGTH);
+    EXPECT(classifyHeader("Content-Lengtx", 14) == HEADER_UNKNOWN);
+    EXPECT(classifyHeader("X-Custom", 8) == HEADER_UNKNOWN);
+    EXPECT(classifyHeader("H", 1) == HEADER_UNKNOWN);
+
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    static const char raw[] = "GET / HTTP/1.1\r\nhOST: a\r\nX-Custom: b\r\nRANGE: bytes=0-1\r\n\r\n";
+    sendAll(fds[0], raw, sizeof(raw) - 1);
+    HttpReq req = newRequest();
+    EXPECT(parseRequestStream(&req, stream) == 0);
+    EXPECT(stringEquals(&getHeader(&req.headers, HEADER_HOST)->value, "a"));
+    EXPECT(stringEquals(&findHeader(&req.headers, "range")->value, "bytes=0-1"));
+    EXPECT(stringEquals(&findHeader(&req.headers, "x-custom")->value, "b"));
+    EXPECT(getHeader(&req.headers, HEADER_CONTENT_LENGTH) == NULL);
+
+    gcCleanup();
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int test5_rejects_repeated_content_length() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    static const char raw[] = "POST / HTTP/1.1\r\nContent-Length: 1\r\ncontent-length: 2\r\n\r\nab";
+    sendAll(fds[0], raw, sizeof(raw) - 1);
+
+    HttpReq req = newRequest();
+    EXPECT(parseRequestStream(&req, stream) == BAD_REQUEST_ERROR);
+
+    gcCleanup();
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int test6_chunked_content_decoded_in_place() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    static const char raw[] =
+        "POST /chunks HTTP/1.1\r\nTransfer-Encoding: Chunked\r\n\r\n"
+        "5;name=value\r\nhello\r\n"
+        "1\r\n \r\n"
+        "A  \r\n0123456789\r\n"
+        "0\r\nX-Trailer: ignored\r\n\r\n"
+        "GET /next HTTP/1.1\r\n\r\n";
+    sendAll(fds[0], raw, sizeof(raw) - 1);
+
+    HttpReq req = newRequest();
+    EXPECT(parseRequestStream(&req, stream) == 0);
+    EXPECT(req.contentLength == 16);
+    EXPECT(memcmp(req.content, "hello 0123456789", 16) == 0);
+    char part[10];
+    EXPECT(reqReadBody(&req, part, sizeof(part)) == 10 && memcmp(part, "hello 0123", 10) == 0);
+    EXPECT(reqReadBody(&req, part, sizeof(part)) == 6 && reqReadBody(&req, part, sizeof(part)) == 0);
+
+    /* the pipelined request right after the trailers is intact */
+    tcpStreamDrain(stream);
+    HttpReq next = newRequest();
+    EXPECT(parseRequestStream(&next, stream) == 0);
+    EXPECT(stringEquals(&next.path.raw, "/next"));
+
+    gcCleanup();
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+static int bodyResult(const char *raw, long maxSize) {
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    sendAll(fds[0], raw, strlen(raw));
+    shutdown(fds[0], SHUT_WR);
+
+    HttpReq req = newRequest();
+    HttpBody body;
+    int result = parseRequestHead(&req, stream);
+    if (result == 0) {
+        result = prepareRequestBody(&body, &req, stream, maxSize);
+    }
+    if (result == 0) {
+        result = bufferRequestBody(&body, &req);
+    }
+
+    gcCleanup();
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return result;
+}
+
+int test7_rejected_bodies() {
+    int testResult = 1;
+    EXPECT(bodyResult("POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\n0123456789", 10) == 0);
+    EXPECT(bodyResult("POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\n0123456789a", 10) == ENTITY_TOO_LARGE_ERROR);
+    EXPECT(bodyResult("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n6\r\n012345\r\n5\r\n67890\r\n0\r\n\r\n", 10) == ENTITY_TOO_LARGE_ERROR);
+    EXPECT(bodyResult("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 3\r\n\r\n", 0) == BAD_REQUEST_ERROR);
+    EXPECT(bodyResult("POST / HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n", 0) == BAD_REQUEST_ERROR);
+    EXPECT(bodyResult("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", 0) == BAD_REQUEST_ERROR);
+    EXPECT(bodyResult("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabcd\r\n0\r\n\r\n", 0) == BAD_REQUEST_ERROR);
+    EXPECT(bodyResult("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nffffffffffffffffff\r\n", 0) == BAD_REQUEST_ERROR);
+    EXPECT(bodyResult("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc", 0) == TCP_STREAM_CLOSED);
+    EXPECT(bodyResult("POST / HTTP/1.1\r\nExpect: 200-ok\r\nContent-Length: 1\r\n\r\na", 0) == EXPECTATION_FAILED_ERROR);
+    return testResult;
+}
+
+/* Content bigger than the stream buffer is streamed without growing it, 100 Continue goes out before the first read */
+int test8_streamed_body_stays_bounded() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    static const char head[] = "PUT /upload HTTP/1.1\r\nTransfer-Encoding: chunked\r\nExpect: 100-continue\r\n\r\n";
+    sendAll(fds[0], head, sizeof(head) - 1);
+
+    HttpReq req = newRequest();
+    HttpBody body;
+    EXPECT(parseRequestHead(&req, stream) == 0);
+    EXPECT(prepareRequestBody(&body, &req, stream, 0) == 0);
+    EXPECT(body.expectContinue && req.contentLength == -1);
+
+    char chunk[600];
+    memset(chunk, 'u', sizeof(chunk));
+    char line[16];
+    for (int i = 0; i < 200; i++) {
+        int length = snprintf(line, sizeof(line), "%zx\r\n", sizeof(chunk));
+        sendAll(fds[0], line, length);
+        sendAll(fds[0], chunk, sizeof(chunk));
+        sendAll(fds[0], "\r\n", 2);
+        size_t got = 0;
+        char buffer[256];
+        while (got < sizeof(chunk)) {
+            ssize_t n = reqReadBody(&req, buffer, sizeof(buffer));
+            if (n <= 0) {
+                break;
+            }
+            got += n;
+        }
+        EXPECT(got == sizeof(chunk));
+        if (i == 0) {
+            char interim[64] = {0};
+            EXPECT(read(fds[0], interim, sizeof(interim)) == 25);
+            EXPECT(strcmp(interim, "HTTP/1.1 100 Continue\r\n\r\n") == 0);
+        }
+    }
+    sendAll(fds[0], "0\r\n\r\n", 5);
+    char end[8];
+    EXPECT(reqReadBody(&req, end, sizeof(end)) == 0);
+    EXPECT(body.finished && body.received == 200 * (long) sizeof(chunk));
+    EXPECT(stream->capacity == TCP_STREAM_BUFFER_SIZE);
+    EXPECT(stringEquals(&findHeader(&req.headers, "Expect")->value, "100-continue"));
+
+    gcCleanup();
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    gcInit();
+    gcTrack();
+
+    UNIT_TEST(test1_slices_point_into_stream)
+    UNIT_TEST(test2_slices_survive_buffer_growth)
+    UNIT_TEST(test3_rejects_invalid_content_length)
+    UNIT_TEST(test4_known_headers_classified)
+    UNIT_TEST(test5_rejects_repeated_content_length)
+    UNIT_TEST(test6_chunked_content_decoded_in_place)
+    UNIT_TEST(test7_rejected_bodies)
+    UNIT_TEST(test8_streamed_body_stays_bounded)
+
+    TEST_RESULTS
+    return failed;
+}
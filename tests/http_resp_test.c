@@ -0,0 +1,209 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <alloc.h>
+#include <http_resp.h>
+#include <http_writer.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int headEquals(HttpResp *resp, const char *expected) {
+    char head[512];
+    size_t size = respHeadSize(resp);
+    if (size > sizeof(head)) {
+        return 0;
+    }
+    size_t written = writeRespHead(resp, head);
+    return written <= size && written == strlen(expected) && memcmp(head, expected, written) == 0;
+}
+
+static int formatsAs(unsigned long long value, const char *expected) {
+    char digits[UNSIGNED_DIGITS_MAX];
+    size_t length = formatUnsigned(value, digits);
+    return length == strlen(expected) && memcmp(digits, expected, length) == 0;
+}
+
+int test1_format_unsigned() {
+    int testResult = 1;
+    EXPECT(formatsAs(0, "0"));
+    EXPECT(formatsAs(7, "7"));
+    EXPECT(formatsAs(10, "10"));
+    EXPECT(formatsAs(99, "99"));
+    EXPECT(formatsAs(100, "100"));
+    EXPECT(formatsAs(1048576, "1048576"));
+    EXPECT(formatsAs(ULLONG_MAX, "18446744073709551615"));
+    return testResult;
+}
+
+int test2_built_response_head() {
+    int testResult = 1;
+    HttpRespBuilder builder = newRespBuilder();
+    respBuilderSetStatus(&builder, NOT_FOUND);
+    respBuilderAddHeader(&builder, "X-Trace", "abc");
+    respBuilderSetContent(&builder, "missing", 7, 0);
+    HttpResp resp = respBuild(&builder);
+    EXPECT(headEquals(&resp,
+        "HTTP/1.1 404 Not Found\r\n"
+        "X-Trace: abc\r\n"
+        "Content-Length: 7\r\n"
+        "Content-Type: application/octet-stream\r\n"
+        "Server: http-server-c\r\n"
+        "\r\n"));
+
+    HttpResp empty = newResp(NO_CONTENT);
+    EXPECT(headEquals(&empty, "HTTP/1.1 204 No Content\r\n\r\n"));
+    return testResult;
+}
+
+int test3_other_versions_and_statuses() {
+    int testResult = 1;
+    HttpResp resp = newResp(OK);
+    resp.version = "HTTP/1.0";
+    EXPECT(headEquals(&resp, "HTTP/1.0 200 OK\r\n\r\n"));
+
+    HttpResp unknown = newResp(299);
+    EXPECT(headEquals(&unknown, "HTTP/1.1 299 Unknown status\r\n\r\n"));
+    EXPECT(strcmp(statusToStr(RANGE_NOT_SATISFIABLE), "Range Not Satisfiable") == 0);
+    EXPECT(strcmp(statusToStr(NETWORK_AUTHENTICATION_REQUIRED), "Network Authentication Required") == 0);
+    EXPECT(strcmp(statusToStr(600), "Unknown status") == 0);
+
+    char *arenaHead;
+    size_t size = buildRespStringUntilContent(&resp, &arenaHead);
+    EXPECT(size == 19 && memcmp(arenaHead, "HTTP/1.0 200 OK\r\n\r\n", size) == 0);
+    return testResult;
+}
+
+int test4_date_header() {
+    int testResult = 1;
+    respSetDateHeaderEnabled(1);
+    HttpResp resp = newResp(OK);
+    char head[128];
+    size_t size = respHeadSize(&resp);
+    EXPECT(size == strlen("HTTP/1.1 200 OK\r\nDate: Sun, 06 Nov 1994 08:49:37 GMT\r\n\r\n"));
+    EXPECT(writeRespHead(&resp, head) == size);
+    EXPECT(memcmp(head + 17, "Date: ", 6) == 0);
+    EXPECT(memcmp(head + 23 + 25, " GMT\r\n\r\n", 8) == 0);
+
+    /* the handler's own Date wins */
+    HttpRespBuilder builder = newRespBuilder();
+    respBuilderSetFlags(&builder, 0, REPLACE_FLAGS);
+    respBuilderSetStatus(&builder, NO_CONTENT);
+    respBuilderSetFlags(&builder, USE_NO_CONTENT_RESPONSE_FLAG, SET_FLAGS);
+    respBuilderAddHeader(&builder, "Date", "Sun, 06 Nov 1994 08:49:37 GMT");
+    HttpResp dated = respBuild(&builder);
+    size = writeRespHead(&dated, head);
+    EXPECT(size == respHeadSize(&dated));
+    EXPECT(memcmp(head, "HTTP/1.1 204 No Content\r\nDate: Sun, 06 Nov 1994 08:49:37 GMT\r\n\r\n", size) == 0);
+    respSetDateHeaderEnabled(0);
+    return testResult;
+}
+
+static long readAll(int fd, char *buffer, size_t size) {
+    long total = 0;
+    ssize_t got;
+    while (total < (long) size && (got = read(fd, buffer + total, size - total)) > 0) {
+        total += got;
+    }
+    return total;
+}
+
+/* Small writes are gathered, a write over the buffer size is a chunk of its own */
+int test5_chunked_writer() {
+    int testResult = 1;
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    TcpSocket socket = {.fd = fds[1], .closed = 0, .nonBlocking = 0};
+    static const char head[] = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+    char buffer[8];
+    HttpRespWriter writer;
+    initRespWriter(&writer, &socket, head, sizeof(head) - 1, buffer, sizeof(buffer), 1);
+
+    EXPECT(respWrite(&writer, "ab", 2) == 0);
+    EXPECT(respWrite(&writer, "cdef", 4) == 0);
+    EXPECT(writer.sent == 0);
+    EXPECT(respWrite(&writer, "0123456789abcdefXYZ", 19) == 0);
+    EXPECT(respWrite(&writer, "gh", 2) == 0);
+    WriteResult result = finishRespWriter(&writer);
+    close(fds[1]);
+
+    static const char expected[] =
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "6\r\nabcdef\r\n"
+        "13\r\n0123456789abcdefXYZ\r\n"
+        "2\r\ngh\r\n"
+        "0\r\n\r\n";
+    char received[256];
+    long got = readAll(fds[0], received, sizeof(received));
+    EXPECT(result.result == WRITE_OK && result.sent == sizeof(expected) - 1);
+    EXPECT(got == sizeof(expected) - 1 && memcmp(received, expected, got) == 0);
+    close(fds[0]);
+    return testResult;
+}
+
+/* HTTP/1.0 gets the bytes as they are, an empty content still sends the head */
+int test6_unchunked_writer() {
+    int testResult = 1;
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    TcpSocket socket = {.fd = fds[1], .closed = 0, .nonBlocking = 0};
+    char buffer[16];
+    HttpRespWriter writer;
+    initRespWriter(&writer, &socket, "HEAD\n", 5, buffer, sizeof(buffer), 0);
+    EXPECT(respWrite(&writer, "raw", 3) == 0);
+    EXPECT(respFlush(&writer) == 0);
+    EXPECT(respWrite(&writer, "tail", 4) == 0);
+    finishRespWriter(&writer);
+
+    initRespWriter(&writer, &socket, "EMPTY\n", 6, buffer, sizeof(buffer), 0);
+    finishRespWriter(&writer);
+    close(fds[1]);
+
+    char received[64];
+    long got = readAll(fds[0], received, sizeof(received));
+    EXPECT(got == 18 && memcmp(received, "HEAD\nrawtailEMPTY\n", 18) == 0);
+
+    /* a gone client fails the writes that follow */
+    initRespWriter(&writer, &socket, "x", 1, buffer, sizeof(buffer), 1);
+    socket.closed = 1;
+    EXPECT(respFlush(&writer) < 0);
+    EXPECT(respWrite(&writer, "y", 1) < 0);
+    EXPECT(finishRespWriter(&writer).result == WRITE_CLOSED);
+    close(fds[0]);
+    return testResult;
+}
+
+/* A HEAD answer without generated content must not claim a length of 0, nor turn into 204 */
+int test7_skipped_content() {
+    int testResult = 1;
+    HttpRespBuilder builder = newRespBuilder();
+    respBuilderSetFlags(&builder, USE_NO_CONTENT_RESPONSE_FLAG, REPLACE_FLAGS);
+    respBuilderSkipContent(&builder);
+    HttpResp resp = respBuild(&builder);
+    EXPECT(headEquals(&resp,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/octet-stream\r\n"
+        "\r\n"));
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    gcInit();
+    gcTrack();
+    respSetDateHeaderEnabled(0);
+
+    UNIT_TEST(test1_format_unsigned)
+    UNIT_TEST(test2_built_response_head)
+    UNIT_TEST(test3_other_versions_and_statuses)
+    UNIT_TEST(test4_date_header)
+    UNIT_TEST(test5_chunked_writer)
+    UNIT_TEST(test6_unchunked_writer)
+    UNIT_TEST(test7_skipped_content)
+
+    TEST_RESULTS
+    return failed;
+}
@@ -0,0 +1,174 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <alloc.h>
+#include <http_router.h>
+
+#define MANY_ROUTES 400
+
+static HttpResp noopH(HttpReq) {
+    return (HttpResp) {0};
+}
+
+static HttpEndpoint *routeMethod(HttpRouter *router, HttpReq *req, HttpMethod method, const char *path, unsigned int *allowed) {
+    *req = newRequest();
+    req->method = method;
+    parsePath(&req->path, path, strlen(path));
+    return findEndpoint(router, req, allowed);
+}
+
+static HttpEndpoint *route(HttpRouter *router, HttpReq *req, const char *path) {
+    unsigned int allowed;
+    return routeMethod(router, req, GET, path, &allowed);
+}
+
+static HttpEndpoint newMethodEndpoint(const char *path, unsigned int methods) {
+    HttpEndpoint endpoint = newEndpoint(path, noopH);
+    endpoint.methods = methods;
+    return endpoint;
+}
+
+static int routesTo(HttpRouter *router, const char *path, const char *pattern) {
+    HttpReq req;
+    HttpEndpoint *endpoint = route(router, &req, path);
+    if (pattern == NULL) {
+        return endpoint == NULL;
+    }
+    return endpoint != NULL && strcmp(endpoint->raw, pattern) == 0;
+}
+
+int test1_static_over_wildcards() {
+    int testResult = 1;
+    HttpRouter router = emptyRouter();
+    routerAddEndpoint(&router, newEndpoint("/", noopH));
+    routerAddEndpoint(&router, newEndpoint("/users/<str>", noopH));
+    routerAddEndpoint(&router, newEndpoint("/users/<int>", noopH));
+    routerAddEndpoint(&router, newEndpoint("/users/me", noopH));
+    routerAddEndpoint(&router, newEndpoint("/users/<uuid>", noopH));
+
+    EXPECT(routesTo(&router, "/", "/"));
+    EXPECT(routesTo(&router, "/users/me", "/users/me"));
+    EXPECT(routesTo(&router, "/users/42", "/users/<int>"));
+    EXPECT(routesTo(&router, "/users/-7", "/users/<int>"));
+    EXPECT(routesTo(&router, "/users/42abc", "/users/<str>"));
+    EXPECT(routesTo(&router, "/users/123e4567-e89b-12d3-a456-426614174000", "/users/<uuid>"));
+    EXPECT(routesTo(&router, "/users/123e4567-e89b-12d3-a456-42661417400z", "/users/<str>"));
+    EXPECT(routesTo(&router, "/users", NULL));
+    EXPECT(routesTo(&router, "/users/1/posts", NULL));
+    return testResult;
+}
+
+/* /files/<int>/meta must not hide /files/<str>/raw for numeric names */
+int test2_backtracks_to_less_specific() {
+    int testResult = 1;
+    HttpRouter router = emptyRouter();
+    routerAddEndpoint(&router, newEndpoint("/files/<int>/meta", noopH));
+    routerAddEndpoint(&router, newEndpoint("/files/<str>/raw", noopH));
+    routerAddEndpoint(&router, newEndpoint("/files/<path...>", noopH));
+
+    EXPECT(routesTo(&router, "/files/12/meta", "/files/<int>/meta"));
+    EXPECT(routesTo(&router, "/files/12/raw", "/files/<str>/raw"));
+    EXPECT(routesTo(&router, "/files/12/other", "/files/<path...>"));
+    EXPECT(routesTo(&router, "/files/a/b/c", "/files/<path...>"));
+    EXPECT(routesTo(&router, "/files", NULL));
+    return testResult;
+}
+
+int test3_captures() {
+    int testResult = 1;
+    HttpRouter router = emptyRouter();
+    routerAddEndpoint(&router, newEndpoint("/users/<int:id>/files/<path...:rest>", noopH));
+    routerAddEndpoint(&router, newEndpoint("/tags/<str>", noopH));
+
+    HttpReq req;
+    EXPECT(route(&router, &req, "/users/-15/files/docs/a.txt?x=1") != NULL);
+    EXPECT(req.params.count == 2);
+    HttpPathParam *id = findPathParam(&req.params, "id");
+    EXPECT(id != NULL && id->type == PATH_PARAM_INT && id->intValue == -15);
+    HttpPathParam *rest = findPathParam(&req.params, "rest");
+    EXPECT(rest != NULL && rest->type == PATH_PARAM_PATH && stringEquals(&rest->value, "docs/a.txt"));
+
+    EXPECT(route(&router, &req, "/tags/c") != NULL);
+    EXPECT(req.params.count == 1 && req.params.items[0].name.length == 0);
+    EXPECT(stringEquals(&req.params.items[0].value, "c"));
+    EXPECT(routesTo(&router, "/users/99999999999999999999/files/a", NULL));
+    return testResult;
+}
+
+int test4_first_registration_wins() {
+    int testResult = 1;
+    HttpRouter router = emptyRouter();
+    routerAddEndpoint(&router, newEndpoint("/a/<int:first>", noopH));
+    routerAddEndpoint(&router, newEndpoint("/a/<int:second>", noopH));
+    HttpReq req;
+    EXPECT(route(&router, &req, "/a/1") != NULL);
+    EXPECT(findPathParam(&req.params, "first") != NULL);
+    return testResult;
+}
+
+int test5_many_routes() {
+    int testResult = 1;
+    static char patterns[MANY_ROUTES][32];
+    HttpRouter router = emptyRouter();
+    for (int i = 0; i < MANY_ROUTES; i++) {
+        snprintf(patterns[i], sizeof(patterns[i]), "/r%d/<int>", i);
+        routerAddEndpoint(&router, newEndpoint(patterns[i], noopH));
+    }
+    for (int i = 0; i < MANY_ROUTES; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "/r%d/%d", i, i);
+        EXPECT(routesTo(&router, path, patterns[i]));
+    }
+    EXPECT(routesTo(&router, "/r400/1", NULL));
+    return testResult;
+}
+
+int test6_methods_and_allowed() {
+    int testResult = 1;
+    HttpRouter router = emptyRouter();
+    routerAddEndpoint(&router, newMethodEndpoint("/items", METHOD_BIT(GET)));
+    routerAddEndpoint(&router, newMethodEndpoint("/items", METHOD_BIT(POST)));
+    routerAddEndpoint(&router, newMethodEndpoint("/items/<int>", METHOD_BIT(DELETE)));
+    routerAddEndpoint(&router, newMethodEndpoint("/items/<str>", METHOD_BIT(PUT)));
+
+    HttpReq req;
+    unsigned int allowed;
+    HttpEndpoint *endpoint = routeMethod(&router, &req, POST, "/items", &allowed);
+    EXPECT(endpoint != NULL && endpoint->methods == METHOD_BIT(POST));
+    endpoint = routeMethod(&router, &req, HEAD, "/items", &allowed);
+    EXPECT(endpoint != NULL && endpoint->methods == METHOD_BIT(GET));
+
+    EXPECT(routeMethod(&router, &req, PATCH, "/items", &allowed) == NULL);
+    EXPECT(allowed == (METHOD_BIT(GET) | METHOD_BIT(HEAD) | METHOD_BIT(POST) | METHOD_BIT(OPTIONS)));
+    EXPECT(routeMethod(&router, &req, OPTIONS, "/items", &allowed) == NULL);
+    EXPECT(allowed & METHOD_BIT(OPTIONS));
+
+    /* the <str> branch serves PUT for numeric ids the <int> branch only deletes */
+    endpoint = routeMethod(&router, &req, PUT, "/items/5", &allowed);
+    EXPECT(endpoint != NULL && endpoint->methods == METHOD_BIT(PUT));
+    EXPECT(routeMethod(&router, &req, GET, "/items/5", &allowed) == NULL);
+    EXPECT(allowed == (METHOD_BIT(DELETE) | METHOD_BIT(PUT) | METHOD_BIT(OPTIONS)));
+
+    EXPECT(routeMethod(&router, &req, GET, "/missing", &allowed) == NULL);
+    EXPECT(allowed == 0);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    gcInit();
+    gcTrack();
+
+    UNIT_TEST(test1_static_over_wildcards)
+    UNIT_TEST(test2_backtracks_to_less_specific)
+    UNIT_TEST(test3_captures)
+    UNIT_TEST(test4_first_registration_wins)
+    UNIT_TEST(test5_many_routes)
+    UNIT_TEST(test6_methods_and_allowed)
+
+    TEST_RESULTS
+    return failed;
+}
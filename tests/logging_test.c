@@ -0,0 +1,136 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+/* before test.h, its DEBUG print macro would replace the log level */
+#include <logging.h>
+#include "test.h"
+#undef DEBUG
+
+#include <pthread.h>
+#include <unistd.h>
+
+#define THREADS 4
+#define LINES_PER_THREAD 500
+
+static FILE *logStream;
+static char logged[256 * 1024];
+
+/* Everything logged since the previous call */
+static const char *readLogged() {
+    flushLogs();
+    long size = ftell(logStream);
+    rewind(logStream);
+    size_t got = fread(logged, 1, size < (long) sizeof(logged) - 1 ? (size_t) size : sizeof(logged) - 1, logStream);
+    logged[got] = '\0';
+    rewind(logStream);
+    ftruncate(fileno(logStream), 0);
+    return logged;
+}
+
+static int lineEquals(const char *line, const char *level, const char *message) {
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "[%s|", level);
+    const char *end = strstr(line, "|MAIN] ");
+    return strncmp(line, prefix, strlen(prefix)) == 0 && end != NULL
+        && strncmp(end + 7, message, strlen(message)) == 0 && end[7 + strlen(message)] == '\n';
+}
+
+/* Arguments are formatted by the writer, strings have to be copied when logged */
+int test1_formats_recorded_arguments() {
+    int testResult = 1;
+    char transient[16] = "temporary";
+    const char *path = "/users/42?page=1";
+    void *pointer = &testResult;
+    info("int %d long %ld size %zu [%s] [%.*s] [%-6s|%6s] %04x %% %.2f %p %c",
+        -7, 123456789012L, (size_t) 42, transient, 9, path, "ab", "cd", 0xbeef, 2.5, pointer, 'z');
+    strcpy(transient, "overwritten");
+
+    char expected[256];
+    snprintf(expected, sizeof(expected), "int %d long %ld size %zu [%s] [%.*s] [%-6s|%6s] %04x %% %.2f %p %c",
+        -7, 123456789012L, (size_t) 42, "temporary", 9, path, "ab", "cd", 0xbeef, 2.5, pointer, 'z');
+    EXPECT(lineEquals(readLogged(), "INFO", expected));
+
+    /* %n cannot be deferred, so the producer formats that one */
+    int count = 0;
+    const char *missing = NULL;
+    warning("status %d%n, %s", 404, &count, missing);
+    EXPECT(count == 10);
+    EXPECT(lineEquals(readLogged(), "WARNING", "status 404, (null)"));
+    return testResult;
+}
+
+static int evaluated = 0;
+
+static int countEvaluation() {
+    return ++evaluated;
+}
+
+int test2_levels_filtered_at_runtime() {
+    int testResult = 1;
+    setLogLevel(WARNING);
+    debug("hidden %d", countEvaluation());
+    info("hidden %d", countEvaluation());
+    error("shown %d", 1);
+    EXPECT(evaluated == 0);
+    EXPECT(lineEquals(readLogged(), "ERROR", "shown 1"));
+
+    setLogLevel(DEBUG);
+    debug("shown %d", countEvaluation());
+    EXPECT(evaluated == 1);
+    EXPECT(lineEquals(readLogged(), "DEBUG", "shown 1"));
+    return testResult;
+}
+
+static void *logLines(void *arg) {
+    long thread = (long) arg;
+    for (int i = 0; i < LINES_PER_THREAD; i++) {
+        debug("thread %ld line %d", thread, i);
+    }
+    return NULL;
+}
+
+/* Every thread gets its own ring, rings of exited threads are still drained */
+int test3_threads_keep_their_order() {
+    int testResult = 1;
+    pthread_t threads[THREADS];
+    for (long i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, logLines, (void*) i);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    int next[THREADS] = {0};
+    int lines = 0;
+    for (const char *line = readLogged(); *line != '\0'; line = strchr(line, '\n') + 1) {
+        long thread;
+        int index;
+        const char *message = strstr(line, "] ");
+        if (message != NULL && sscanf(message + 2, "thread %ld line %d", &thread, &index) == 2
+            && thread >= 0 && thread < THREADS && next[thread] == index) {
+            next[thread]++;
+        }
+        lines++;
+    }
+    EXPECT(lines == THREADS * LINES_PER_THREAD);
+    for (int i = 0; i < THREADS; i++) {
+        EXPECT(next[i] == LINES_PER_THREAD);
+    }
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    logStream = tmpfile();
+    setLogStream(logStream);
+
+    UNIT_TEST(test1_formats_recorded_arguments)
+    UNIT_TEST(test2_levels_filtered_at_runtime)
+    UNIT_TEST(test3_threads_keep_their_order)
+
+    setLogStream(NULL);
+    fclose(logStream);
+    TEST_RESULTS
+    return failed;
+}
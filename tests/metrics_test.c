@@ -0,0 +1,176 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <alloc.h>
+#include <connection.h>
+#include <metrics.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define THREADS 4
+#define PER_THREAD 1000
+
+/* Value of the series starting with prefix followed by a space, -1 when missing */
+static double seriesValue(const char *text, const char *series) {
+    size_t length = strlen(series);
+    for (const char *line = text; line != NULL && *line != '\0'; line = strchr(line, '\n')) {
+        if (*line == '\n') {
+            line++;
+        }
+        if (strncmp(line, series, length) == 0 && line[length] == ' ') {
+            return strtod(line + length + 1, NULL);
+        }
+    }
+    return -1;
+}
+
+static double scrape(const char *series) {
+    char *text;
+    formatMetrics(&text);
+    return seriesValue(text, series);
+}
+
+/* Quantiles are the highest value of their bucket, 8 buckets per power of two */
+int test1_latency_histogram() {
+    int testResult = 1;
+    int route = addMetricsRoute("/latency/<int>");
+    EXPECT(route > 0 && addMetricsRoute("/latency/<int>") == route);
+    for (long long us = 1; us <= 1000; us++) {
+        metricsObserveRequest(route, 200, us * 1000);
+    }
+    metricsObserveRequest(route, 404, 7000000);
+
+    char *text;
+    formatMetrics(&text);
+    EXPECT(seriesValue(text, "httpserverc_requests_total{route=\"/latency/<int>\",status=\"200\"}") == 1000);
+    EXPECT(seriesValue(text, "httpserverc_requests_total{route=\"/latency/<int>\",status=\"404\"}") == 1);
+    EXPECT(seriesValue(text, "httpserverc_request_latency_seconds{route=\"/latency/<int>\",quantile=\"0.5\"}") == 0.000511);
+    EXPECT(seriesValue(text, "httpserverc_request_latency_seconds{route=\"/latency/<int>\",quantile=\"0.99\"}") == 0.001023);
+    EXPECT(seriesValue(text, "httpserverc_request_latency_seconds{route=\"/latency/<int>\",quantile=\"0.9\"}") == 0.000959);
+    EXPECT(seriesValue(text, "httpserverc_request_duration_seconds_bucket{route=\"/latency/<int>\",le=\"0.0005\"}") == 479);
+    EXPECT(seriesValue(text, "httpserverc_request_duration_seconds_bucket{route=\"/latency/<int>\",le=\"0.001\"}") == 959);
+    EXPECT(seriesValue(text, "httpserverc_request_duration_seconds_bucket{route=\"/latency/<int>\",le=\"0.01\"}") == 1001);
+    EXPECT(seriesValue(text, "httpserverc_request_duration_seconds_bucket{route=\"/latency/<int>\",le=\"+Inf\"}") == 1001);
+    EXPECT(seriesValue(text, "httpserverc_request_duration_seconds_sum{route=\"/latency/<int>\"}") == 0.5075);
+    return testResult;
+}
+
+static int threadRoute;
+
+static void *countRequests(void *) {
+    for (int i = 0; i < PER_THREAD; i++) {
+        metricsObserveRequest(threadRoute, 201, 50000);
+        metricsAdd(METRIC_BYTES_SENT, 10);
+    }
+    return NULL;
+}
+
+/* Shards of exited threads are kept */
+int test2_exited_threads_are_folded() {
+    int testResult = 1;
+    threadRoute = addMetricsRoute("/threads");
+    double sentBefore = scrape("httpserverc_sent_bytes_total");
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, countRequests, NULL);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    EXPECT(scrape("httpserverc_requests_total{route=\"/threads\",status=\"201\"}") == THREADS * PER_THREAD);
+    EXPECT(scrape("httpserverc_request_duration_seconds_count{route=\"/threads\"}") == THREADS * PER_THREAD);
+    EXPECT(scrape("httpserverc_sent_bytes_total") - sentBefore == THREADS * PER_THREAD * 10);
+    return testResult;
+}
+
+int test3_labels_errors_and_gauges() {
+    int testResult = 1;
+    int route = addMetricsRoute("/a\"b\\c");
+    metricsObserveRequest(route, 200, 1000);
+    metricsObserveRequest(0, 400, 1000);
+    metricsCountError(-5);
+    metricsCountError(-5);
+    metricsCountError(-100);
+    metricsAdd(METRIC_CONNECTIONS_OPENED, 3);
+    metricsAdd(METRIC_CONNECTIONS_CLOSED, 1);
+
+    char *text;
+    size_t length = formatMetrics(&text);
+    EXPECT(length == strlen(text));
+    EXPECT(seriesValue(text, "httpserverc_requests_total{route=\"/a\\\"b\\\\c\",status=\"200\"}") == 1);
+    EXPECT(seriesValue(text, "httpserverc_requests_total{route=\"unmatched\",status=\"400\"}") == 1);
+    EXPECT(seriesValue(text, "httpserverc_request_errors_total{error=\"bad_request\"}") == 2);
+    EXPECT(seriesValue(text, "httpserverc_request_errors_total{error=\"unknown_method\"}") == 0);
+    EXPECT(seriesValue(text, "httpserverc_connections_active") == 2);
+    EXPECT(strstr(text, "# TYPE httpserverc_request_duration_seconds histogram\n") != NULL);
+    return testResult;
+}
+
+int test4_stage_histograms() {
+    int testResult = 1;
+    int route = addMetricsRoute("/stages");
+    long long stageNs[REQUEST_STAGE_COUNT] = {
+        [REQUEST_STAGE_PARSE] = 40000000,
+        [REQUEST_STAGE_ROUTE] = 500,
+        [REQUEST_STAGE_BODY] = 0,
+        [REQUEST_STAGE_HANDLER] = 3000000,
+        [REQUEST_STAGE_SEND] = 200000,
+    };
+    metricsObserveStages(route, stageNs);
+    metricsObserveStages(route, stageNs);
+
+    char *text;
+    formatMetrics(&text);
+    EXPECT(strcmp(stageToStr(REQUEST_STAGE_HANDLER), "handler") == 0);
+    EXPECT(seriesValue(text, "httpserverc_request_stage_duration_seconds_count{route=\"/stages\",stage=\"parse\"}") == 2);
+    EXPECT(seriesValue(text, "httpserverc_request_stage_duration_seconds_bucket{route=\"/stages\",stage=\"parse\",le=\"0.025\"}") == 0);
+    EXPECT(seriesValue(text, "httpserverc_request_stage_duration_seconds_bucket{route=\"/stages\",stage=\"parse\",le=\"0.05\"}") == 2);
+    EXPECT(seriesValue(text, "httpserverc_request_stage_duration_seconds_sum{route=\"/stages\",stage=\"handler\"}") == 0.006);
+    EXPECT(seriesValue(text, "httpserverc_request_stage_latency_seconds{route=\"/stages\",stage=\"body\",quantile=\"0.99\"}") == 0);
+    /* stages alone are not requests */
+    EXPECT(seriesValue(text, "httpserverc_request_duration_seconds_count{route=\"/stages\"}") == -1);
+    return testResult;
+}
+
+/* A timeout reports -1 received bytes, which must not reach the counter */
+int test5_received_bytes_skip_failed_reads() {
+    int testResult = 1;
+    setIoBackend(IO_BACKEND_DIRECT);
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    TcpSocket socket = {.fd = fds[1], .closed = 0, .nonBlocking = 0};
+    char buffer[16];
+    double before = scrape("httpserverc_received_bytes_total");
+
+    setSocketDeadline(&socket, 20);
+    EXPECT(receive(&socket, buffer, sizeof(buffer)).result == READ_TIMEOUT);
+    EXPECT(scrape("httpserverc_received_bytes_total") == before);
+
+    socket.closed = 0;
+    setSocketDeadline(&socket, 1000);
+    EXPECT(write(fds[0], "hello", 5) == 5);
+    EXPECT(receive(&socket, buffer, sizeof(buffer)).result == READ_OK);
+    EXPECT(scrape("httpserverc_received_bytes_total") == before + 5);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    gcInit();
+    gcTrack();
+
+    UNIT_TEST(test1_latency_histogram)
+    UNIT_TEST(test2_exited_threads_are_folded)
+    UNIT_TEST(test3_labels_errors_and_gauges)
+    UNIT_TEST(test4_stage_histograms)
+    UNIT_TEST(test5_received_bytes_skip_failed_reads)
+
+    TEST_RESULTS
+    return failed;
+}
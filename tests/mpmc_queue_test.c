@@ -0,0 +1,141 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+#include "server/mpmc_queue.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define ITEMS_PER_PRODUCER 10000
+
+int test1_capacity_rounded_to_power_of_two() {
+    int testResult = 1;
+    MpmcQueue queue;
+    initMpmcQueue(&queue, 5);
+    EXPECT(queue.mask + 1 == 8);
+    destroyMpmcQueue(&queue);
+    return testResult;
+}
+
+int test2_push_until_full() {
+    int testResult = 1;
+    MpmcQueue queue;
+    initMpmcQueue(&queue, 4);
+    for (intptr_t i = 1; i <= 4; i++) {
+        EXPECT(mpmcQueuePush(&queue, (void *) i));
+    }
+    EXPECT(!mpmcQueuePush(&queue, (void *) 5));
+    destroyMpmcQueue(&queue);
+    return testResult;
+}
+
+int test3_pop_empty() {
+    int testResult = 1;
+    MpmcQueue queue;
+    initMpmcQueue(&queue, 4);
+    void *data = NULL;
+    EXPECT(!mpmcQueuePop(&queue, &data));
+    EXPECT(data == NULL);
+    destroyMpmcQueue(&queue);
+    return testResult;
+}
+
+int test4_fifo_order_with_wraparound() {
+    int testResult = 1;
+    MpmcQueue queue;
+    initMpmcQueue(&queue, 4);
+    intptr_t next = 1;
+    for (intptr_t i = 1; i <= 20; i++) {
+        EXPECT(mpmcQueuePush(&queue, (void *) i));
+        if (i % 3 == 0) {
+            void *data;
+            while (mpmcQueuePop(&queue, &data)) {
+                EXPECT((intptr_t) data == next);
+                next++;
+            }
+        }
+    }
+    void *data;
+    while (mpmcQueuePop(&queue, &data)) {
+        EXPECT((intptr_t) data == next);
+        next++;
+    }
+    EXPECT(next == 21);
+    destroyMpmcQueue(&queue);
+    return testResult;
+}
+
+typedef struct {
+    MpmcQueue *queue;
+    atomic_long *sum;
+    atomic_int *consumed;
+} ThreadArgs;
+
+void *producer(void *arg) {
+    ThreadArgs *args = arg;
+    for (intptr_t i = 1; i <= ITEMS_PER_PRODUCER; i++) {
+        while (!mpmcQueuePush(args->queue, (void *) i)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+void *consumer(void *arg) {
+    ThreadArgs *args = arg;
+    while (atomic_load(args->consumed) < PRODUCERS * ITEMS_PER_PRODUCER) {
+        void *data;
+        if (mpmcQueuePop(args->queue, &data)) {
+            atomic_fetch_add(args->sum, (long) (intptr_t) data);
+            atomic_fetch_add(args->consumed, 1);
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int test5_concurrent_producers_consumers() {
+    int testResult = 1;
+    MpmcQueue queue;
+    initMpmcQueue(&queue, 64);
+    atomic_long sum = 0;
+    atomic_int consumed = 0;
+    ThreadArgs args = {&queue, &sum, &consumed};
+    pthread_t producers[PRODUCERS], consumers[CONSUMERS];
+    for (int i = 0; i < CONSUMERS; i++) {
+        pthread_create(&consumers[i], NULL, consumer, &args);
+    }
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_create(&producers[i], NULL, producer, &args);
+    }
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    for (int i = 0; i < CONSUMERS; i++) {
+        pthread_join(consumers[i], NULL);
+    }
+    long expected = (long) PRODUCERS * ITEMS_PER_PRODUCER * (ITEMS_PER_PRODUCER + 1) / 2;
+    EXPECT(atomic_load(&consumed) == PRODUCERS * ITEMS_PER_PRODUCER);
+    EXPECT(atomic_load(&sum) == expected);
+    destroyMpmcQueue(&queue);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+
+    UNIT_TEST(test1_capacity_rounded_to_power_of_two)
+    UNIT_TEST(test2_push_until_full)
+    UNIT_TEST(test3_pop_empty)
+    UNIT_TEST(test4_fifo_order_with_wraparound)
+    UNIT_TEST(test5_concurrent_producers_consumers)
+
+    TEST_RESULTS
+    return failed;
+}
@@ -0,0 +1,206 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <alloc.h>
+#include <app_state.h>
+#include <arpa/inet.h>
+#include <connection.h>
+#include <errors.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "server/reactor.h"
+
+#define PORT 18431
+#define RESPONSE_SIZE (8 << 20)
+
+static Reactor *reactor;
+static unsigned long connectionIndex = 1;
+static char *response;
+static int responseFile;
+
+/* Every line is a request answered with its length, a partial line is reparsed on the next readiness */
+static RequestOutcome answerLines(SessionState *state, TcpStream *stream) {
+    string line = tcpStreamReadUntilString(stream, 64, "\n", 1);
+    if (line.length == TCP_STREAM_WOULD_BLOCK) {
+        return REQUEST_INCOMPLETE;
+    }
+    if (line.length < 0) {
+        return REQUEST_CLOSE;
+    }
+    char reply[16];
+    int length = snprintf(reply, sizeof(reply), "%zd\n", line.length);
+    return transmit(&state->clientSocket, reply, length).result == WRITE_OK ? REQUEST_KEEP_ALIVE : REQUEST_CLOSE;
+}
+
+/* Every byte received is a request, 'f' is answered with sendfile and anything else from memory */
+static RequestOutcome answerEveryByte(SessionState *state, TcpStream *stream) {
+    (void) stream;
+    char request;
+    ReadResult read = receive(&state->clientSocket, &request, 1);
+    if (read.result == READ_WOULD_BLOCK) {
+        return REQUEST_INCOMPLETE;
+    }
+    if (read.result != READ_OK) {
+        return REQUEST_CLOSE;
+    }
+    WriteResult result = request == 'f'
+        ? transmitFile(&state->clientSocket, responseFile, 0, RESPONSE_SIZE)
+        : transmit(&state->clientSocket, response, RESPONSE_SIZE);
+    return result.result == WRITE_OK && result.sent == RESPONSE_SIZE ? REQUEST_KEEP_ALIVE : REQUEST_CLOSE;
+}
+
+/* Hands one end of a socket pair to the reactor and returns the other, its reads time out after two seconds */
+static int addClient() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    struct timeval timeout = {.tv_sec = 2, .tv_usec = 0};
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    TcpSocket socket = {.fd = fds[1], .closed = 0};
+    reactorAddConnection(reactor, newSessionState(socket, connectionIndex++));
+    return fds[0];
+}
+
+static int readsReply(int fd, const char *expected) {
+    char buffer[64];
+    size_t length = strlen(expected);
+    size_t total = 0;
+    while (total < length) {
+        ssize_t got = read(fd, buffer + total, length - total);
+        if (got <= 0) {
+            return 0;
+        }
+        total += got;
+    }
+    return memcmp(buffer, expected, length) == 0;
+}
+
+int test1_partial_request_is_resumed() {
+    int testResult = 1;
+    int client = addClient();
+    EXPECT(write(client, "hel", 3) == 3);
+    usleep(50 * 1000);
+    EXPECT(write(client, "lo\n", 3) == 3);
+    EXPECT(readsReply(client, "5\n"));
+    close(client);
+    return testResult;
+}
+
+/* Both connections are served by the only loop, pipelined lines are answered in order */
+int test2_connections_share_a_loop() {
+    int testResult = 1;
+    int first = addClient();
+    int second = addClient();
+    EXPECT(write(first, "a\nbb\n", 5) == 5);
+    EXPECT(write(second, "ccc\n", 4) == 4);
+    EXPECT(readsReply(second, "3\n"));
+    EXPECT(readsReply(first, "1\n2\n"));
+    close(first);
+    close(second);
+    return testResult;
+}
+
+/* Reads time out after two seconds, a stalled loop would hold the response for the whole write timeout */
+static int connectClient(int receiveBuffer) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (receiveBuffer > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    }
+    struct timeval timeout = {.tv_sec = 2, .tv_usec = 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) == -1) {
+        perror("connectClient: connect");
+    }
+    return fd;
+}
+
+/* Bytes of the response read before a mismatch or a timeout */
+static size_t readResponse(int fd) {
+    static char buffer[1 << 16];
+    size_t total = 0;
+    while (total < RESPONSE_SIZE) {
+        size_t wanted = RESPONSE_SIZE - total < sizeof(buffer) ? RESPONSE_SIZE - total : sizeof(buffer);
+        ssize_t got = read(fd, buffer, wanted);
+        if (got <= 0 || memcmp(buffer, response + total, got) != 0) {
+            break;
+        }
+        total += got;
+    }
+    return total;
+}
+
+static int slowReaderDoesNotStallTheLoop(char request) {
+    int testResult = 1;
+    int slow = connectClient(4096);
+    EXPECT(write(slow, &request, 1) == 1);
+    /* the loop fills the slow socket and queues the rest */
+    usleep(200 * 1000);
+
+    int fast = connectClient(0);
+    EXPECT(write(fast, &request, 1) == 1);
+    EXPECT(readResponse(fast) == RESPONSE_SIZE);
+
+    /* the queued bytes arrive in order, and the connection serves the next request after them */
+    EXPECT(readResponse(slow) == RESPONSE_SIZE);
+    EXPECT(write(slow, &request, 1) == 1);
+    EXPECT(readResponse(slow) == RESPONSE_SIZE);
+    close(fast);
+    close(slow);
+    return testResult;
+}
+
+int test3_slow_reader_of_buffered_response() {
+    return slowReaderDoesNotStallTheLoop('m');
+}
+
+int test4_slow_reader_of_sendfile_response() {
+    return slowReaderDoesNotStallTheLoop('f');
+}
+
+int main() {
+    INIT_UNIT_TESTS
+    gcInit();
+    gcTrack();
+    initSessionStateFactory();
+    setIoBackend(IO_BACKEND_DIRECT);
+    reactor = newReactor(1, 0, answerLines);
+
+    response = allocate(RESPONSE_SIZE);
+    for (int i = 0; i < RESPONSE_SIZE; i++) {
+        response[i] = (char) ('a' + i % 26);
+    }
+    FILE *file = tmpfile();
+    fwrite(response, 1, RESPONSE_SIZE, file);
+    fflush(file);
+    responseFile = fileno(file);
+
+    /* one loop, so both clients of a slow reader test are served by the same thread */
+    Reactor *listening = newReactor(1, 0, answerEveryByte);
+    ListenOptions options = defaultListenOptions();
+    port_t port;
+    snprintf(port, sizeof(port), "%d", PORT);
+    if (reactor == NULL || listening == NULL || reactorListen(listening, port, options) == -1) {
+        printf("Could not start the reactor\n");
+        return 1;
+    }
+
+    UNIT_TEST(test1_partial_request_is_resumed)
+    UNIT_TEST(test2_connections_share_a_loop)
+    UNIT_TEST(test3_slow_reader_of_buffered_response)
+    UNIT_TEST(test4_slow_reader_of_sendfile_response)
+
+    TEST_RESULTS
+    fclose(file);
+    return failed;
+}
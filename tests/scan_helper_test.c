@@ -0,0 +1,93 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+#include "helpers/scan_helper.h"
+
+#include <stdlib.h>
+
+#define SAMPLE_SIZE 300
+
+static const ScanKernel kernels[] = {SCAN_KERNEL_SCALAR, SCAN_KERNEL_SSE42, SCAN_KERNEL_AVX2};
+static const int kernelCount = (int) (sizeof(kernels) / sizeof(kernels[0]));
+
+static size_t referenceScan(const char *data, size_t length, const char *set, size_t setSize) {
+    for (size_t offset = 0; offset < length; offset++) {
+        if (memchr(set, data[offset], setSize) != NULL) {
+            return offset;
+        }
+    }
+    return length;
+}
+
+/* Every length and alignment around the 16 and 32 byte blocks, with the delimiter at each position */
+static int matchesReference(const char *set, size_t setSize) {
+    int testResult = 1;
+    char sample[SAMPLE_SIZE];
+    srand(7);
+    for (int i = 0; i < SAMPLE_SIZE; i++) {
+        char c;
+        do {
+            c = (char) ('a' + rand() % 26);
+        } while (memchr(set, c, setSize) != NULL);
+        sample[i] = c;
+    }
+    for (size_t start = 0; start < 33; start++) {
+        for (size_t length = 0; start + length <= 100; length++) {
+            EXPECT(scanForAny(sample + start, length, set, setSize) == length);
+            for (size_t at = 0; at < length; at++) {
+                char saved = sample[start + at];
+                sample[start + at] = set[at % setSize];
+                EXPECT(scanForAny(sample + start, length, set, setSize) == referenceScan(sample + start, length, set, setSize));
+                sample[start + at] = saved;
+            }
+        }
+    }
+    return testResult;
+}
+
+int test1_kernels_match_reference() {
+    int testResult = 1;
+    const ScanKernel detected = getScanKernel();
+    for (int i = 0; i < kernelCount; i++) {
+        if (selectScanKernel(kernels[i]) != 0) {
+            printf("Kernel %d not supported, skipped\n", kernels[i]);
+            continue;
+        }
+        EXPECT(matchesReference(" ", 1));
+        EXPECT(matchesReference("\r\n", 2));
+        EXPECT(matchesReference(":=&?#", 5));
+    }
+    selectScanKernel(detected);
+    return testResult;
+}
+
+int test2_high_bytes_and_nul() {
+    int testResult = 1;
+    const ScanKernel detected = getScanKernel();
+    char data[64];
+    memset(data, '\xff', sizeof(data));
+    data[40] = '\0';
+    data[50] = '\x80';
+    for (int i = 0; i < kernelCount; i++) {
+        if (selectScanKernel(kernels[i]) != 0) {
+            continue;
+        }
+        EXPECT(scanForAny(data, sizeof(data), "\0", 1) == 40);
+        EXPECT(scanForAny(data, sizeof(data), "\x80", 1) == 50);
+        EXPECT(scanForAny(data, 50, "\x80", 1) == 50);
+    }
+    selectScanKernel(detected);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+
+    UNIT_TEST(test1_kernels_match_reference)
+    UNIT_TEST(test2_high_bytes_and_nul)
+
+    TEST_RESULTS
+    return failed;
+}
@@ -0,0 +1,114 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+#include "server/spsc_ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+#define RECORDS 200000
+
+static int pushValue(SpscRing *ring, uint32_t value) {
+    struct iovec part = {.iov_base = &value, .iov_len = sizeof(value)};
+    return spscRingPush(ring, &part, 1);
+}
+
+int test1_records_fit_whole_or_not_at_all() {
+    int testResult = 1;
+    SpscRing ring;
+    initSpscRing(&ring, 10);
+    EXPECT(ring.mask + 1 == 16);
+    struct iovec parts[2] = {
+        {.iov_base = "abcdef", .iov_len = 6},
+        {.iov_base = "ghij", .iov_len = 4},
+    };
+    EXPECT(spscRingPush(&ring, parts, 2));
+    EXPECT(!spscRingPush(&ring, parts, 2));
+
+    struct iovec spans[2];
+    EXPECT(spscRingPeek(&ring, spans) == 10);
+    EXPECT(spans[0].iov_len == 10 && spans[1].iov_len == 0);
+    EXPECT(memcmp(spans[0].iov_base, "abcdefghij", 10) == 0);
+    spscRingConsume(&ring, 10);
+    EXPECT(spscRingPeek(&ring, spans) == 0);
+    destroySpscRing(&ring);
+    return testResult;
+}
+
+/* The second record starts at offset 10 and wraps, it is read back as two spans */
+int test2_wraparound_spans() {
+    int testResult = 1;
+    SpscRing ring;
+    initSpscRing(&ring, 16);
+    struct iovec first = {.iov_base = "0123456789", .iov_len = 10};
+    EXPECT(spscRingPush(&ring, &first, 1));
+    struct iovec spans[2];
+    spscRingPeek(&ring, spans);
+    spscRingConsume(&ring, 10);
+
+    struct iovec second = {.iov_base = "ABCDEFGHIJKL", .iov_len = 12};
+    EXPECT(spscRingPush(&ring, &second, 1));
+    EXPECT(spscRingPeek(&ring, spans) == 12);
+    EXPECT(spans[0].iov_len == 6 && spans[1].iov_len == 6);
+    EXPECT(memcmp(spans[0].iov_base, "ABCDEF", 6) == 0);
+    EXPECT(memcmp(spans[1].iov_base, "GHIJKL", 6) == 0);
+    destroySpscRing(&ring);
+    return testResult;
+}
+
+static void *produce(void *arg) {
+    SpscRing *ring = arg;
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        while (!pushValue(ring, i)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int test3_producer_and_consumer_threads() {
+    int testResult = 1;
+    SpscRing ring;
+    initSpscRing(&ring, 256);
+    pthread_t producer;
+    pthread_create(&producer, NULL, produce, &ring);
+
+    uint32_t expected = 0;
+    while (expected < RECORDS) {
+        struct iovec spans[2];
+        size_t size = spscRingPeek(&ring, spans);
+        /* values are 4 byte aligned in a power of two ring, a wrap never splits one */
+        for (int s = 0; s < 2; s++) {
+            for (size_t offset = 0; offset + sizeof(uint32_t) <= spans[s].iov_len; offset += sizeof(uint32_t)) {
+                uint32_t value;
+                memcpy(&value, (char*) spans[s].iov_base + offset, sizeof(value));
+                if (value != expected) {
+                    testResult = 0;
+                }
+                expected++;
+            }
+        }
+        spscRingConsume(&ring, size);
+        if (!testResult) {
+            break;
+        }
+    }
+    pthread_join(producer, NULL);
+    EXPECT(testResult && expected == RECORDS);
+    destroySpscRing(&ring);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+
+    UNIT_TEST(test1_records_fit_whole_or_not_at_all)
+    UNIT_TEST(test2_wraparound_spans)
+    UNIT_TEST(test3_producer_and_consumer_threads)
+
+    TEST_RESULTS
+    return failed;
+}
@@ -0,0 +1,164 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+
+#include <alloc.h>
+#include <errors.h>
+#include <tcp_stream.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Client end in fds[0], the stream reads fds[1] */
+static TcpSocket openPair(int fds[2]) {
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    return (TcpSocket) {.fd = fds[1], .closed = 0, .nonBlocking = 0};
+}
+
+static void sendAll(int fd, const char *data) {
+    size_t length = strlen(data);
+    while (length > 0) {
+        ssize_t sent = write(fd, data, length);
+        if (sent <= 0) {
+            return;
+        }
+        data += sent;
+        length -= sent;
+    }
+}
+
+int test1_pipelined_drain_keeps_position() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    sendAll(fds[0], "GET /a HTTP/1.1\r\nGET /b HTTP/1.1\r\n");
+
+    string method = tcpStreamReadUntilSpace(stream, 7);
+    EXPECT(method.length == 3 && strncmp(method.ptr, "GET", 3) == 0);
+    string rest = tcpStreamReadUntilCRLF(stream, 64, 0);
+    EXPECT(rest.length == 11);
+    char *buffer = stream->buffer;
+    size_t secondStart = stream->cursor;
+    tcpStreamDrain(stream);
+    /* the second request is parsed where it was received */
+    EXPECT(stream->buffer == buffer);
+    EXPECT(stream->start == secondStart && stream->cursor == secondStart);
+    EXPECT(tcpStreamPending(stream) == 17);
+
+    tcpStreamReadUntilSpace(stream, 7);
+    string path = tcpStreamReadUntilSpace(stream, 1024);
+    EXPECT(path.length == 2 && strncmp(path.ptr, "/b", 2) == 0);
+    tcpStreamReadUntilCRLF(stream, 64, 0);
+    tcpStreamDrain(stream);
+    EXPECT(stream->start == 0 && stream->length == 0);
+    EXPECT(tcpStreamPending(stream) == 0);
+
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int test2_rewind_returns_to_request_start() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    sendAll(fds[0], "A B C ");
+
+    tcpStreamReadUntilSpace(stream, 7);
+    tcpStreamDrain(stream);
+    tcpStreamReadUntilSpace(stream, 7);
+    tcpStreamReadUntilSpace(stream, 7);
+    tcpStreamRewind(stream);
+    string again = tcpStreamReadUntilSpace(stream, 7);
+    EXPECT(again.length == 1 && again.ptr[0] == 'B');
+
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int test3_large_body_capacity_not_retained() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    size_t bodySize = TCP_STREAM_MAX_RETAINED_CAPACITY * 2;
+    char *body = allocate(bodySize + 1);
+    memset(body, 'x', bodySize);
+    body[bodySize] = '\0';
+    sendAll(fds[0], body);
+    sendAll(fds[0], "NEXT ");
+
+    EXPECT(tcpStreamReadSlice(stream, bodySize) != NULL);
+    EXPECT(stream->capacity >= bodySize);
+    tcpStreamDrain(stream);
+    EXPECT(stream->capacity <= TCP_STREAM_MAX_RETAINED_CAPACITY);
+    string next = tcpStreamReadUntilSpace(stream, 7);
+    EXPECT(next.length == 4 && strncmp(next.ptr, "NEXT", 4) == 0);
+
+    deallocate(body);
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int test4_release_and_refill() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    sendAll(fds[0], "GET ");
+
+    tcpStreamReadUntilSpace(stream, 7);
+    tcpStreamDrain(stream);
+    tcpStreamRelease(stream);
+    EXPECT(stream->buffer == NULL && stream->capacity == 0);
+
+    sendAll(fds[0], "POST ");
+    string method = tcpStreamReadUntilSpace(stream, 7);
+    EXPECT(method.length == 4 && strncmp(method.ptr, "POST", 4) == 0);
+    EXPECT(stream->capacity == TCP_STREAM_BUFFER_SIZE);
+
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int test5_token_of_max_length() {
+    int testResult = 1;
+    int fds[2];
+    TcpSocket socket = openPair(fds);
+    TcpStream *stream = newTcpStream(&socket);
+    sendAll(fds[0], "OPTIONS * CONNECTED ");
+
+    string method = tcpStreamReadUntilSpace(stream, 7);
+    EXPECT(method.length == 7);
+    tcpStreamReadUntilSpace(stream, 7);
+    string tooLong = tcpStreamReadUntilSpace(stream, 7);
+    EXPECT(tooLong.length == ENTITY_TOO_LARGE_ERROR);
+
+    freeTcpStream(stream);
+    close(fds[0]);
+    close(fds[1]);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+
+    UNIT_TEST(test1_pipelined_drain_keeps_position)
+    UNIT_TEST(test2_rewind_returns_to_request_start)
+    UNIT_TEST(test3_large_body_capacity_not_retained)
+    UNIT_TEST(test4_release_and_refill)
+    UNIT_TEST(test5_token_of_max_length)
+
+    TEST_RESULTS
+    return failed;
+}
@@ -0,0 +1,178 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+#include "test.h"
+#include "server/timer_wheel.h"
+
+#define MAX_FIRED 1024
+
+typedef struct {
+    Timer timer;
+    long long deadline;
+    long long firedAt;
+} TestTimer;
+
+static long long clockMs = 0;
+static int firedCount = 0;
+static TestTimer *fired[MAX_FIRED];
+
+static void recordFired(Timer *timer) {
+    TestTimer *testTimer = timer->arg;
+    testTimer->firedAt = clockMs;
+    if (firedCount < MAX_FIRED) {
+        fired[firedCount] = testTimer;
+    }
+    firedCount++;
+}
+
+static void resetClock(TimerWheel *wheel, unsigned int tickMs) {
+    clockMs = 1000;
+    firedCount = 0;
+    initTimerWheel(wheel, clockMs, tickMs);
+}
+
+static void advanceTo(TimerWheel *wheel, long long nowMs, long long stepMs) {
+    while (clockMs < nowMs) {
+        clockMs += stepMs;
+        timerWheelAdvance(wheel, clockMs);
+    }
+}
+
+static void scheduleTest(TimerWheel *wheel, TestTimer *testTimer, long long deadline) {
+    initTimer(&testTimer->timer, recordFired, testTimer);
+    testTimer->deadline = deadline;
+    testTimer->firedAt = -1;
+    timerWheelSchedule(wheel, &testTimer->timer, deadline);
+}
+
+int test1_fires_at_deadline() {
+    int testResult = 1;
+    TimerWheel wheel;
+    resetClock(&wheel, 10);
+    TestTimer timer;
+    scheduleTest(&wheel, &timer, clockMs + 95);
+    advanceTo(&wheel, clockMs + 90, 10);
+    EXPECT(firedCount == 0);
+    advanceTo(&wheel, clockMs + 20, 10);
+    EXPECT(firedCount == 1);
+    EXPECT(timer.firedAt >= timer.deadline);
+    EXPECT(!timerIsPending(&timer.timer));
+    EXPECT(wheel.pending == 0);
+    return testResult;
+}
+
+int test2_cancel() {
+    int testResult = 1;
+    TimerWheel wheel;
+    resetClock(&wheel, 10);
+    TestTimer first, second;
+    scheduleTest(&wheel, &first, clockMs + 50);
+    scheduleTest(&wheel, &second, clockMs + 50);
+    timerWheelCancel(&wheel, &first.timer);
+    timerWheelCancel(&wheel, &first.timer);
+    EXPECT(wheel.pending == 1);
+    advanceTo(&wheel, clockMs + 100, 10);
+    EXPECT(firedCount == 1);
+    EXPECT(first.firedAt == -1);
+    EXPECT(second.firedAt >= second.deadline);
+    return testResult;
+}
+
+int test3_reschedule_moves_deadline() {
+    int testResult = 1;
+    TimerWheel wheel;
+    resetClock(&wheel, 10);
+    TestTimer timer;
+    scheduleTest(&wheel, &timer, clockMs + 50);
+    advanceTo(&wheel, clockMs + 40, 10);
+    timer.deadline = clockMs + 5000;
+    timerWheelSchedule(&wheel, &timer.timer, timer.deadline);
+    EXPECT(wheel.pending == 1);
+    advanceTo(&wheel, clockMs + 4900, 10);
+    EXPECT(firedCount == 0);
+    advanceTo(&wheel, clockMs + 200, 10);
+    EXPECT(firedCount == 1);
+    EXPECT(timer.firedAt >= timer.deadline && timer.firedAt < timer.deadline + 20);
+    return testResult;
+}
+
+/* Deadlines spread over every level, including ones past the wheel range */
+int test4_cascades_in_order() {
+    int testResult = 1;
+    TimerWheel wheel;
+    resetClock(&wheel, 1);
+    static TestTimer timers[64];
+    long long offsets[] = {0, 1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 300000, 16777215, 16777216, 20000000};
+    int count = (int) (sizeof(offsets) / sizeof(offsets[0]));
+    for (int i = 0; i < count; i++) {
+        scheduleTest(&wheel, &timers[i], clockMs + offsets[i]);
+    }
+    advanceTo(&wheel, clockMs + 20000100, 97);
+    EXPECT(firedCount == count);
+    for (int i = 0; i < count; i++) {
+        EXPECT(timers[i].firedAt >= timers[i].deadline);
+        EXPECT(timers[i].firedAt <= timers[i].deadline + 97);
+    }
+    for (int i = 1; i < count && i < firedCount; i++) {
+        EXPECT(fired[i - 1]->deadline <= fired[i]->deadline);
+    }
+    return testResult;
+}
+
+static TimerWheel *callbackWheel;
+
+static void rescheduleOnce(Timer *timer) {
+    TestTimer *testTimer = timer->arg;
+    recordFired(timer);
+    if (firedCount == 1) {
+        testTimer->deadline = clockMs + 30;
+        timerWheelSchedule(callbackWheel, timer, testTimer->deadline);
+    }
+}
+
+int test5_schedule_from_callback() {
+    int testResult = 1;
+    TimerWheel wheel;
+    resetClock(&wheel, 10);
+    callbackWheel = &wheel;
+    TestTimer timer;
+    scheduleTest(&wheel, &timer, clockMs + 20);
+    timer.timer.callback = rescheduleOnce;
+    advanceTo(&wheel, clockMs + 25, 25);
+    EXPECT(firedCount == 1);
+    EXPECT(timerIsPending(&timer.timer));
+    advanceTo(&wheel, clockMs + 40, 10);
+    EXPECT(firedCount == 2);
+    EXPECT(timer.firedAt >= timer.deadline);
+    return testResult;
+}
+
+int test6_next_timeout() {
+    int testResult = 1;
+    TimerWheel wheel;
+    resetClock(&wheel, 10);
+    EXPECT(timerWheelNextTimeout(&wheel, clockMs) == -1);
+    TestTimer timer;
+    scheduleTest(&wheel, &timer, clockMs + 200);
+    int timeout = timerWheelNextTimeout(&wheel, clockMs);
+    EXPECT(timeout > 0 && timeout <= 200);
+    TestTimer late;
+    scheduleTest(&wheel, &late, clockMs - 50);
+    EXPECT(timerWheelNextTimeout(&wheel, clockMs) == 0);
+    return testResult;
+}
+
+int main() {
+    INIT_UNIT_TESTS
+
+    UNIT_TEST(test1_fires_at_deadline)
+    UNIT_TEST(test2_cancel)
+    UNIT_TEST(test3_reschedule_moves_deadline)
+    UNIT_TEST(test4_cascades_in_order)
+    UNIT_TEST(test5_schedule_from_callback)
+    UNIT_TEST(test6_next_timeout)
+
+    TEST_RESULTS
+    return failed;
+}
@@ -0,0 +1,195 @@
+//
+// Created by Rescyy on 10/17/2026.
+//
+
+/*
+    Converts a binary access log to JSON Lines or CSV.
+    Usage: access_log_decode [--csv] [file], reads stdin without a file.
+*/
+
+#include <access_log.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define READ_SIZE (1024 * 1024)
+
+typedef struct Routes {
+    char **patterns; /* indexed by route id */
+    size_t capacity;
+} Routes;
+
+static void defineRoute(Routes *routes, const AccessRecord *record) {
+    if (record->routeId >= routes->capacity) {
+        size_t capacity = routes->capacity > 0 ? routes->capacity : 64;
+        while (capacity <= record->routeId) {
+            capacity *= 2;
+        }
+        routes->patterns = realloc(routes->patterns, capacity * sizeof(char*));
+        memset(routes->patterns + routes->capacity, 0, (capacity - routes->capacity) * sizeof(char*));
+        routes->capacity = capacity;
+    }
+    /* a reopened file interns again, the later definition holds for what follows */
+    free(routes->patterns[record->routeId]);
+    routes->patterns[record->routeId] = strndup(record->path.ptr, record->path.length);
+}
+
+static const char *findRoute(const Routes *routes, uint64_t id) {
+    return id > 0 && id < routes->capacity ? routes->patterns[id] : NULL;
+}
+
+static void printJsonString(const char *str, size_t length) {
+    putchar('"');
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char) str[i];
+        if (c == '"' || c == '\\') {
+            printf("\\%c", c);
+        } else if (c < 0x20) {
+            printf("\\u%04x", c);
+        } else {
+            putchar(c);
+        }
+    }
+    putchar('"');
+}
+
+static void printCsvString(const char *str, size_t length) {
+    putchar('"');
+    for (size_t i = 0; i < length; i++) {
+        if (str[i] == '"') {
+            putchar('"');
+        }
+        putchar(str[i]);
+    }
+    putchar('"');
+}
+
+static void formatTime(uint64_t timeNs, char *out, size_t size) {
+    time_t seconds = (time_t) (timeNs / 1000000000ull);
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    size_t length = strftime(out, size, "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(out + length, size - length, ".%03uZ", (unsigned int) (timeNs / 1000000ull % 1000));
+}
+
+static const char *methodName(uint8_t method) {
+    return method < METHOD_COUNT ? methodToStr(method) : "UNKNOWN";
+}
+
+static void printJson(const AccessRecord *record, const char *route) {
+    char time[64];
+    formatTime(record->header.timeNs, time, sizeof(time));
+    printf("{\"time\":\"%s\",\"connection\":%llu,\"request\":%llu,\"client\":", time,
+        (unsigned long long) record->connectionIndex, (unsigned long long) record->requestIndex);
+    printJsonString(record->ip.ptr, record->ip.length);
+    printf(",\"method\":\"%s\",\"path\":", methodName(record->header.method));
+    printJsonString(record->path.ptr, record->path.length);
+    printf(",\"route\":");
+    if (route != NULL) {
+        printJsonString(route, strlen(route));
+    } else {
+        printf("null");
+    }
+    printf(",\"status\":%u,\"durationUs\":%llu,\"requestBytes\":%llu,\"responseBytes\":%llu}\n",
+        record->header.status, (unsigned long long) record->durationUs,
+        (unsigned long long) record->requestBytes, (unsigned long long) record->responseBytes);
+}
+
+static void printCsv(const AccessRecord *record, const char *route) {
+    char time[64];
+    formatTime(record->header.timeNs, time, sizeof(time));
+    printf("%s,%llu,%llu,", time, (unsigned long long) record->connectionIndex, (unsigned long long) record->requestIndex);
+    printCsvString(record->ip.ptr, record->ip.length);
+    printf(",%s,", methodName(record->header.method));
+    printCsvString(record->path.ptr, record->path.length);
+    putchar(',');
+    if (route != NULL) {
+        printCsvString(route, strlen(route));
+    }
+    printf(",%u,%llu,%llu,%llu\n", record->header.status, (unsigned long long) record->durationUs,
+        (unsigned long long) record->requestBytes, (unsigned long long) record->responseBytes);
+}
+
+int main(int argc, char **argv) {
+    int csv = 0;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            csv = 1;
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--csv] [file]\n", argv[0]);
+            return 2;
+        }
+    }
+    FILE *file = path != NULL ? fopen(path, "rb") : stdin;
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    size_t capacity = READ_SIZE;
+    unsigned char *buffer = malloc(capacity);
+    size_t length = fread(buffer, 1, capacity, file);
+    const size_t magicLength = sizeof(ACCESS_LOG_MAGIC) - 1;
+    if (length < magicLength || memcmp(buffer, ACCESS_LOG_MAGIC, magicLength) != 0) {
+        fprintf(stderr, "%s is not an access log\n", path != NULL ? path : "stdin");
+        return 1;
+    }
+    if (csv) {
+        printf("time,connection,request,client,method,path,route,status,duration_us,request_bytes,response_bytes\n");
+    }
+
+    Routes routes = {0};
+    size_t offset = magicLength;
+    int status = 0;
+    for (;;) {
+        AccessRecord record;
+        long size = decodeAccessRecord(buffer + offset, length - offset, &record);
+        if (size < 0) {
+            fprintf(stderr, "Malformed record at byte %zu\n", offset);
+            status = 1;
+            break;
+        }
+        if (size > 0) {
+            if (record.header.type == ACCESS_RECORD_ROUTE) {
+                defineRoute(&routes, &record);
+            } else if (record.header.type == ACCESS_RECORD_REQUEST) {
+                const char *route = findRoute(&routes, record.routeId);
+                csv ? printCsv(&record, route) : printJson(&record, route);
+            }
+            offset += (size_t) size;
+            continue;
+        }
+
+        /* the rest is a partial record, keep it and read more */
+        memmove(buffer, buffer + offset, length - offset);
+        length -= offset;
+        offset = 0;
+        if (length == capacity) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity);
+        }
+        size_t got = fread(buffer + length, 1, capacity - length, file);
+        if (got == 0) {
+            if (length > 0) {
+                fprintf(stderr, "Log ends with a cut record of %zu bytes\n", length);
+                status = 1;
+            }
+            break;
+        }
+        length += got;
+    }
+
+    for (size_t i = 0; i < routes.capacity; i++) {
+        free(routes.patterns[i]);
+    }
+    free(routes.patterns);
+    free(buffer);
+    if (file != stdin) {
+        fclose(file);
+    }
+    return status;
+}